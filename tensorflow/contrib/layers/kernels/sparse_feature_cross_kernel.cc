@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/kernels/fingerprint_lanes.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/util/work_sharder.h"
@@ -354,16 +355,23 @@ class SparseFeatureCrossOp : public OpKernel {
     ValidateInput(context, indices_list_in, values_list_in, shapes_list_in,
                   dense_list_in);
 
+    std::vector<Tensor> values_list;
+    OP_REQUIRES_OK(context,
+                   FeatureTensors(context, values_list_in, &values_list));
+    std::vector<Tensor> dense_list;
+    OP_REQUIRES_OK(context,
+                   FeatureTensors(context, dense_list_in, &dense_list));
+
+    const int64 batch_size = CalculateBatchSize(shapes_list_in, dense_list_in);
     std::vector<std::unique_ptr<ColumnInterface<InternalType>>> columns =
-        GenerateColumnsFromInput(indices_list_in, values_list_in,
-                                 shapes_list_in, dense_list_in);
+        GenerateColumnsFromInput(indices_list_in, values_list, dense_list,
+                                 batch_size);
 
     typename CrossTraits<HASHED_OUTPUT, InternalType, VERSION_2>::Crosser
         crosser(columns, num_buckets_, hash_key_);
     Tensor* indices_out;
     Tensor* values_out;
     Tensor* shape_out;
-    const int64 batch_size = CalculateBatchSize(shapes_list_in, dense_list_in);
     std::vector<int64> output_start_indices(batch_size);
     CreateOutputTensors(columns, batch_size, context, &indices_out, &values_out,
                         &shape_out, &output_start_indices);
@@ -483,15 +491,62 @@ class SparseFeatureCrossOp : public OpKernel {
     return 0;
   }
 
+  // Returns the tensors of 'inputs' in 'features'. When the crosses are
+  // hashed, string tensors are replaced by the fingerprints of their strings,
+  // so that each string is fingerprinted once rather than once for every
+  // cross that it is part of.
+  Status FeatureTensors(OpKernelContext* context, const OpInputList& inputs,
+                        std::vector<Tensor>* features) {
+    features->reserve(inputs.size());
+    for (const Tensor& input : inputs) {
+      if (!HASHED_OUTPUT || input.dtype() != DT_STRING) {
+        features->push_back(input);
+        continue;
+      }
+      Tensor fingerprints;
+      TF_RETURN_IF_ERROR(
+          context->allocate_temp(DT_INT64, input.shape(), &fingerprints));
+      FingerprintStrings(context, input, &fingerprints);
+      features->push_back(fingerprints);
+    }
+    return Status::OK();
+  }
+
+  // Fingerprints the strings of 'input' into 'output', sharded across the
+  // intra-op threads.
+  static void FingerprintStrings(OpKernelContext* context,
+                                 const Tensor& input, Tensor* output) {
+    static const int64 kCostPerString = 100;
+
+    const string* input_base = input.flat<string>().data();
+    uint64* output_base =
+        reinterpret_cast<uint64*>(output->flat<int64>().data());
+    const bool use_lanes =
+        UseFingerprint64Lanes(input_base, input.NumElements());
+    auto work = [input_base, output_base, use_lanes](int64 start,
+                                                     int64 limit) {
+      if (use_lanes) {
+        Fingerprint64Lanes(input_base + start, limit - start,
+                           output_base + start);
+        return;
+      }
+      for (int64 i = start; i < limit; ++i) {
+        output_base[i] = Fingerprint64(input_base[i]);
+      }
+    };
+    auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers,
+          input.NumElements(), kCostPerString, work);
+  }
+
   // Generate the columns given the sparse and dense inputs.
   std::vector<std::unique_ptr<ColumnInterface<InternalType>>>
   GenerateColumnsFromInput(const OpInputList& indices_list_in,
-                           const OpInputList& values_list_in,
-                           const OpInputList& shapes_list_in,
-                           const OpInputList& dense_list_in) {
+                           const std::vector<Tensor>& values_list,
+                           const std::vector<Tensor>& dense_list,
+                           int64 batch_size) {
     std::vector<std::unique_ptr<ColumnInterface<InternalType>>> columns;
-    const int64 batch_size = CalculateBatchSize(shapes_list_in, dense_list_in);
-    const int64 number_of_columns = shapes_list_in.size();
+    const int64 number_of_columns = values_list.size();
 
     std::vector<std::vector<int64>> feature_counts(number_of_columns,
                                                    std::vector<int64>());
@@ -501,15 +556,14 @@ class SparseFeatureCrossOp : public OpKernel {
     ExtractFeatureData(indices_list_in, batch_size, &feature_counts,
                        &feature_start_indices);
 
-    columns.reserve(values_list_in.size());
-    for (int i = 0; i < values_list_in.size(); ++i) {
+    columns.reserve(values_list.size() + dense_list.size());
+    for (int i = 0; i < values_list.size(); ++i) {
       columns.emplace_back(new SparseTensorColumn<InternalType>(
-          values_list_in[i], std::move(feature_counts[i]),
+          values_list[i], std::move(feature_counts[i]),
           std::move(feature_start_indices[i])));
     }
-    for (int i = 0; i < dense_list_in.size(); ++i) {
-      columns.emplace_back(
-          new DenseTensorColumn<InternalType>(dense_list_in[i]));
+    for (int i = 0; i < dense_list.size(); ++i) {
+      columns.emplace_back(new DenseTensorColumn<InternalType>(dense_list[i]));
     }
 
     return columns;
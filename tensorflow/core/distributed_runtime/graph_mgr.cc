@@ -32,12 +32,14 @@ limitations under the License.
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_constructor.h"
 #include "tensorflow/core/graph/graph_partition.h"
 #include "tensorflow/core/graph/validate.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -63,7 +65,35 @@ GraphMgr::~GraphMgr() {
   for (auto p : table_) p.second->Unref();
 }
 
+struct GraphMgr::StepState {
+  // The item this state is pooled on. Not owned.
+  Item* item = nullptr;
+
+  // Arguments passed to every execution unit. "runner", "sync_on_finish"
+  // and "step_container" are set once when the state is created.
+  Executor::Args args;
+
+  // Done callback handed to every execution unit. Bound to this state.
+  StatusCallback unit_done;
+
+  // Constructed at the start of each step and destroyed at its end, which
+  // clears the per-step containers on all devices.
+  std::function<void(const string&)> cleanup;
+  ManualConstructor<ScopedStepContainer> step_container;
+
+  // Per-step values. Cleared when the state is released.
+  Rendezvous* rendezvous = nullptr;
+  StepStatsCollector* collector = nullptr;
+  CostGraphDef* cost_graph = nullptr;
+  StatusCallback done = nullptr;
+
+  mutex mu;
+  int pending GUARDED_BY(mu) = 0;
+  Status status GUARDED_BY(mu);
+};
+
 GraphMgr::Item::~Item() {
+  for (StepState* state : free_step_states) delete state;
   for (const auto& unit : this->units) {
     CHECK_NOTNULL(unit.device);
     if (!graph_mgr->skip_cost_models_) {
@@ -496,19 +526,18 @@ void GraphMgr::StartParallelExecutors(const string& handle, int64 step_id,
                                       StatusCallback done) {
   const int num_units = item->units.size();
   CHECK_GE(num_units, 1);
-  ScopedStepContainer* step_container = new ScopedStepContainer(
-      step_id,
-      [this](const string& name) { device_mgr_->ClearContainers({name}); });
   // NOTE: Transfer one ref of rendezvous and item.
-  ExecutorBarrier* barrier =
-      new ExecutorBarrier(num_units, rendezvous,
-                          [this, item, collector, cost_graph, step_container,
-                           done](const Status& s) {
-                            BuildCostModel(item, collector, cost_graph);
-                            done(s);
-                            delete step_container;
-                          });
-  Executor::Args args;
+  StepState* state = AcquireStepState(item);
+  state->step_container.Init(step_id, state->cleanup);
+  state->rendezvous = rendezvous;
+  state->collector = collector;
+  state->cost_graph = cost_graph;
+  state->done = std::move(done);
+  {
+    mutex_lock l(state->mu);
+    state->pending = num_units;
+  }
+  Executor::Args& args = state->args;
   {
     mutex_lock l(mu_);
     args.step_id = ++next_id_;
@@ -516,18 +545,95 @@ void GraphMgr::StartParallelExecutors(const string& handle, int64 step_id,
   args.rendezvous = rendezvous;
   args.cancellation_manager = cancellation_manager;
   args.stats_collector = collector;
-  args.step_container = step_container;
-  args.sync_on_finish = sync_on_finish_;
   if (LogMemory::IsEnabled()) {
     LogMemory::RecordStep(args.step_id, handle);
   }
+  // NOTE: "state" may be recycled as soon as the last unit is done, so it
+  // must not be touched after the last call to RunAsync.
+  for (const auto& unit : item->units) {
+    unit.root->RunAsync(args, state->unit_done);
+  }
+}
+
+GraphMgr::StepState* GraphMgr::AcquireStepState(Item* item) {
+  {
+    mutex_lock l(item->step_state_mu);
+    if (!item->free_step_states.empty()) {
+      StepState* state = item->free_step_states.back();
+      item->free_step_states.pop_back();
+      return state;
+    }
+  }
+  StepState* state = new StepState;
+  state->item = item;
   thread::ThreadPool* pool = worker_env_->compute_pool;
   using std::placeholders::_1;
   // Line below is equivalent to this code, but does one less indirect call:
   //  args.runner = [pool](std::function<void()> fn) { pool->Schedule(fn); };
-  args.runner = std::bind(&thread::ThreadPool::Schedule, pool, _1);
-  for (const auto& unit : item->units) {
-    unit.root->RunAsync(args, barrier->Get());
+  state->args.runner = std::bind(&thread::ThreadPool::Schedule, pool, _1);
+  state->args.sync_on_finish = sync_on_finish_;
+  state->args.step_container = state->step_container.get();
+  state->unit_done = std::bind(&GraphMgr::UnitDone, this, state, _1);
+  state->cleanup = [this](const string& name) {
+    device_mgr_->ClearContainers({name});
+  };
+  return state;
+}
+
+void GraphMgr::ReleaseStepState(Item* item, StepState* state) {
+  // Bounds the memory kept alive by an item after a burst of concurrent
+  // steps.
+  static const size_t kMaxFreeStepStates = 64;
+  state->rendezvous = nullptr;
+  state->collector = nullptr;
+  state->cost_graph = nullptr;
+  state->done = nullptr;
+  state->args.rendezvous = nullptr;
+  state->args.cancellation_manager = nullptr;
+  state->args.stats_collector = nullptr;
+  {
+    mutex_lock l(state->mu);
+    state->status = Status::OK();
+  }
+  {
+    mutex_lock l(item->step_state_mu);
+    if (item->free_step_states.size() < kMaxFreeStepStates) {
+      item->free_step_states.push_back(state);
+      return;
+    }
+  }
+  delete state;
+}
+
+void GraphMgr::UnitDone(StepState* state, const Status& s) {
+  Rendezvous* error_rendez = nullptr;
+  bool last = false;
+  Status status;
+  {
+    mutex_lock l(state->mu);
+    // If we are the first error encountered, abort the rendezvous so
+    // that the other units do not wait for tensors that never arrive.
+    if (state->status.ok() && !s.ok()) {
+      error_rendez = state->rendezvous;
+      error_rendez->Ref();
+      state->status = s;
+    }
+    last = (--state->pending == 0);
+    status = state->status;
+  }
+
+  if (error_rendez != nullptr) {
+    error_rendez->StartAbort(status);
+    error_rendez->Unref();
+  }
+  if (last) {
+    Item* item = state->item;
+    BuildCostModel(item, state->collector, state->cost_graph);
+    StatusCallback done = std::move(state->done);
+    state->step_container.Destroy();
+    // "done" releases the ref on "item" that keeps "state" alive.
+    ReleaseStepState(item, state);
+    done(status);
   }
 }
 
@@ -107,6 +107,11 @@ class GraphMgr {
     int64 build_cost_model = 0;
   };
 
+  // State for one in-flight step of a registered graph. Recycled through
+  // Item::free_step_states so that repeated steps on the same graph do not
+  // rebuild it each time.
+  struct StepState;
+
   struct Item : public core::RefCounted {
     // TODO(zhifengc): Keeps a copy of the original graph if the need arises.
     // TODO(zhifengc): Stats, updated by multiple runs potentially.
@@ -129,6 +134,10 @@ class GraphMgr {
     // Used to deresgister a cost model when cost model is required in graph
     // manager.
     GraphMgr* graph_mgr;
+
+    // Step states that are not used by any in-flight step. Owned.
+    mutex step_state_mu;
+    std::vector<StepState*> free_step_states GUARDED_BY(step_state_mu);
   };
 
   const WorkerEnv* worker_env_;             // Not owned.
@@ -164,6 +173,14 @@ class GraphMgr {
   void BuildCostModel(Item* item, StepStatsCollector* collector,
                       CostGraphDef* cost_graph);
 
+  // Returns a step state for "item", reusing a free one if possible, and
+  // gives it back to "item" once the step is finished.
+  StepState* AcquireStepState(Item* item);
+  void ReleaseStepState(Item* item, StepState* state);
+
+  // Called by each execution unit of the step "state" when it is done.
+  void UnitDone(StepState* state, const Status& s);
+
   Status SendInputsToRendezvous(Rendezvous* rendezvous, const NamedTensors& in);
   Status RecvOutputsFromRendezvous(Rendezvous* rendezvous, NamedTensors* out);
   void RecvOutputsFromRendezvousAsync(Rendezvous* rendezvous, NamedTensors* out,
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/master_session.h"
 
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -42,6 +43,8 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -56,6 +59,77 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+auto* partition_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/core/master_session_partition_cache_lookups",
+    "The number of partitions looked up in the MasterSession partition cache, "
+    "by outcome (hit or miss).",
+    "outcome");
+
+}  // namespace
+
+// Reference-counted table of the worker subgraphs registered by one
+// MasterSession.  Each entry is shared by every ReffedClientGraph whose
+// partition for that worker has the same fingerprint, and the subgraph is
+// deregistered only when the last of them releases it.  The table is
+// reference counted because ReffedClientGraphs release their entries from
+// their destructors.
+class MasterSession::PartitionCache : public core::RefCounted {
+ public:
+  PartitionCache() {}
+
+  // If a partition with `fingerprint` is registered on `worker`, takes a
+  // reference on it, sets "*graph_handle" and returns true.
+  bool Lookup(const string& worker, uint64 fingerprint, string* graph_handle) {
+    mutex_lock l(mu_);
+    auto iter = entries_.find({worker, fingerprint});
+    if (iter == entries_.end()) {
+      partition_cache_lookups->GetCell("miss")->IncrementBy(1);
+      return false;
+    }
+    partition_cache_lookups->GetCell("hit")->IncrementBy(1);
+    ++iter->second.refs;
+    *graph_handle = iter->second.graph_handle;
+    return true;
+  }
+
+  // Records a newly registered partition, holding one reference on it.
+  // Returns false if an identical partition was registered concurrently, in
+  // which case the caller remains the sole owner of "graph_handle".
+  bool Insert(const string& worker, uint64 fingerprint,
+              const string& graph_handle) {
+    mutex_lock l(mu_);
+    Entry* entry = &entries_[{worker, fingerprint}];
+    if (entry->refs > 0) return false;
+    entry->graph_handle = graph_handle;
+    entry->refs = 1;
+    return true;
+  }
+
+  // Releases one reference on a partition.  Returns true iff that was the
+  // last reference, in which case the caller must deregister the subgraph.
+  bool Release(const string& worker, uint64 fingerprint) {
+    mutex_lock l(mu_);
+    auto iter = entries_.find({worker, fingerprint});
+    CHECK(iter != entries_.end());
+    if (--iter->second.refs > 0) return false;
+    entries_.erase(iter);
+    return true;
+  }
+
+ private:
+  struct Entry {
+    string graph_handle;
+    int refs = 0;
+  };
+
+  mutex mu_;
+  std::map<std::pair<string, uint64>, Entry> entries_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PartitionCache);
+};
+
 // MasterSession wraps SimpleClientGraph in a reference counted object.
 // This way, MasterSession can clear up the cache mapping Run requests to
 // compiled graphs while the compiled graph is still being used.
@@ -68,13 +142,16 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
                     const SessionOptions& session_opts,
                     const StatsPublisherFactory& stats_publisher_factory,
                     SimpleGraphExecutionState* execution_state, bool is_partial,
-                    WorkerCacheInterface* worker_cache)
+                    WorkerCacheInterface* worker_cache,
+                    PartitionCache* partition_cache)
       : session_handle_(handle),
         client_graph_(std::move(cg)),
         session_opts_(session_opts),
         is_partial_(is_partial),
         debug_opts_(bopts.debug_options),
-        worker_cache_(worker_cache) {
+        worker_cache_(worker_cache),
+        partition_cache_(partition_cache) {
+    partition_cache_->Ref();
     VLOG(1) << "Created ReffedClientGraph for node with "
             << client_graph_->graph.num_node_ids();
 
@@ -86,7 +163,10 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
     }
   }
 
-  ~ReffedClientGraph() override { DeregisterPartitions(); }
+  ~ReffedClientGraph() override {
+    DeregisterPartitions();
+    partition_cache_->Unref();
+  }
 
   const SimpleClientGraph* client_graph() { return client_graph_.get(); }
 
@@ -211,6 +291,7 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   const bool is_partial_;
   const DebugOptions& debug_opts_;
   WorkerCacheInterface* const worker_cache_;  // Not owned.
+  PartitionCache* const partition_cache_;     // Owns one reference.
   std::unordered_map<StringPiece, Node*, StringPiece::Hasher> name_to_node_;
 
   // Graph partitioned into per-location subgraphs.
@@ -231,6 +312,11 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
     // this partition on the worker.
     string graph_handle;
 
+    // Fingerprint of the registered subgraph and whether graph_handle is
+    // shared through the session's PartitionCache.
+    uint64 fingerprint = 0;
+    bool cached = false;
+
     Part() : feed_key(3), key_fetch(3) {}
   };
 
@@ -258,13 +344,24 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   static void TrackFeedsAndFetches(Part* part, const GraphDef& graph_def,
                                    const PartitionOptions& popts);
 
+  // Returns a fingerprint of "graph_def" that does not depend on the
+  // names in "generated_names", which Partition() creates from a
+  // session-wide counter and therefore differ between otherwise identical
+  // partitions of different client graphs.
+  static uint64 PartitionFingerprint(
+      const GraphDef& graph_def,
+      const std::unordered_set<string>& generated_names, uint64 seed);
+
   // The actual graph partitioning and registration implementation.
+  // "generated_names" receives the names of the nodes added by Partition().
   Status DoBuildPartitions(
       PartitionOptions pots,
-      std::unordered_map<string, GraphDef>* out_partitions);
+      std::unordered_map<string, GraphDef>* out_partitions,
+      std::unordered_set<string>* generated_names);
   Status DoRegisterPartitions(
       const PartitionOptions& popts, const FunctionDefLibrary& func_def_lib,
-      std::unordered_map<string, GraphDef> graph_partitions);
+      std::unordered_map<string, GraphDef> graph_partitions,
+      const std::unordered_set<string>& generated_names);
 
   // Deregisters the partitions on the workers.  Called in the
   // destructor and does not wait for the rpc completion.
@@ -281,7 +378,8 @@ Status MasterSession::ReffedClientGraph::RegisterPartitions(
       init_started_ = true;
       mu_.unlock();
       std::unordered_map<string, GraphDef> graph_defs;
-      Status s = DoBuildPartitions(popts, &graph_defs);
+      std::unordered_set<string> generated_names;
+      Status s = DoBuildPartitions(popts, &graph_defs, &generated_names);
       if (s.ok()) {
         // NOTE(mrry): The pointers in `graph_defs_for_publishing` do not remain
         // valid after the call to DoRegisterPartitions begins, so
@@ -294,7 +392,7 @@ Status MasterSession::ReffedClientGraph::RegisterPartitions(
         }
         stats_publisher_->PublishGraphProto(graph_defs_for_publishing);
         s = DoRegisterPartitions(popts, flib_def.ToProto(),
-                                 std::move(graph_defs));
+                                 std::move(graph_defs), generated_names);
       }
       mu_.lock();
       init_result_ = s;
@@ -357,9 +455,66 @@ void MasterSession::ReffedClientGraph::TrackFeedsAndFetches(
   }
 }
 
+uint64 MasterSession::ReffedClientGraph::PartitionFingerprint(
+    const GraphDef& graph_def,
+    const std::unordered_set<string>& generated_names, uint64 seed) {
+  // Generated names are replaced by their order of definition in this
+  // partition.
+  std::unordered_map<StringPiece, int, StringPiece::Hasher> canonical;
+  for (const NodeDef& ndef : graph_def.node()) {
+    if (generated_names.count(ndef.name()) > 0) {
+      canonical.insert({ndef.name(), canonical.size()});
+    }
+  }
+  auto hash_name = [&canonical](StringPiece name, uint64 h) {
+    auto iter = canonical.find(name);
+    if (iter != canonical.end()) {
+      return Hash64Combine(h, static_cast<uint64>(iter->second));
+    }
+    return Hash64(name.data(), name.size(), h);
+  };
+
+  uint64 h = seed;
+  const string versions = graph_def.versions().SerializeAsString();
+  h = Hash64(versions.data(), versions.size(), h);
+  std::vector<StringPiece> attr_names;
+  for (const NodeDef& ndef : graph_def.node()) {
+    h = hash_name(ndef.name(), h);
+    h = Hash64(ndef.op().data(), ndef.op().size(), h);
+    h = Hash64(ndef.device().data(), ndef.device().size(), h);
+    for (const string& input : ndef.input()) {
+      StringPiece node(input);
+      StringPiece port;
+      if (node.Consume("^")) {
+        h = Hash64Combine(h, 1);
+      } else {
+        const size_t colon = node.rfind(':');
+        if (colon != StringPiece::npos) {
+          port = node.substr(colon);
+          node.remove_suffix(node.size() - colon);
+        }
+      }
+      h = hash_name(node, h);
+      h = Hash64(port.data(), port.size(), h);
+    }
+    // Attrs are hashed in name order since the map is unordered.
+    attr_names.clear();
+    for (const auto& attr : ndef.attr()) attr_names.push_back(attr.first);
+    std::sort(attr_names.begin(), attr_names.end());
+    for (StringPiece attr_name : attr_names) {
+      const string value = ndef.attr().at(attr_name.ToString())
+                               .SerializeAsString();
+      h = Hash64(attr_name.data(), attr_name.size(), h);
+      h = Hash64(value.data(), value.size(), h);
+    }
+  }
+  return h;
+}
+
 Status MasterSession::ReffedClientGraph::DoBuildPartitions(
     PartitionOptions popts,
-    std::unordered_map<string, GraphDef>* out_partitions) {
+    std::unordered_map<string, GraphDef>* out_partitions,
+    std::unordered_set<string>* generated_names) {
   if (popts.need_to_record_start_times) {
     CostModel cost_model(true);
     cost_model.InitFromGraph(client_graph()->graph);
@@ -369,19 +524,40 @@ Status MasterSession::ReffedClientGraph::DoBuildPartitions(
     sa.ComputeAsap(&popts.start_times);
   }
 
+  // Remember the names Partition() generates so that they can be
+  // canonicalized when fingerprinting the partitions.
+  auto new_name = popts.new_name;
+  popts.new_name = [new_name, generated_names](const string& prefix) {
+    string name = new_name(prefix);
+    generated_names->insert(name);
+    return name;
+  };
+
   // Partition the graph.
   return Partition(popts, &client_graph_->graph, out_partitions);
 }
 
 Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     const PartitionOptions& popts, const FunctionDefLibrary& func_def_lib,
-    std::unordered_map<string, GraphDef> graph_partitions) {
+    std::unordered_map<string, GraphDef> graph_partitions,
+    const std::unordered_set<string>& generated_names) {
   partitions_.reserve(graph_partitions.size());
+  // Everything shipped with a partition besides its GraphDef contributes to
+  // the fingerprint.
+  uint64 seed = 0x6d1c0d3a9b0e5f27ull;
+  for (const string& bytes :
+       {func_def_lib.SerializeAsString(),
+        session_opts_.config.graph_options().SerializeAsString(),
+        debug_opts_.SerializeAsString()}) {
+    seed = Hash64(bytes.data(), bytes.size(), seed);
+  }
   Status s;
   for (auto& name_def : graph_partitions) {
     partitions_.resize(partitions_.size() + 1);
     Part* part = &partitions_.back();
     part->name = name_def.first;
+    part->fingerprint =
+        PartitionFingerprint(name_def.second, generated_names, seed);
     TrackFeedsAndFetches(part, name_def.second, popts);
     part->worker = worker_cache_->CreateWorker(part->name);
     if (part->worker == nullptr) {
@@ -400,11 +576,25 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     RegisterGraphResponse resp;
     Status status;
   };
-  const int num = partitions_.size();
+  // Only the partitions that are not already registered by another
+  // ReffedClientGraph of this session need a RegisterGraph call.
+  std::vector<int> to_register;
+  for (int i = 0; i < partitions_.size(); ++i) {
+    Part* part = &partitions_[i];
+    if (partition_cache_->Lookup(part->name, part->fingerprint,
+                                 &part->graph_handle)) {
+      part->cached = true;
+      VLOG(1) << "Reusing registered partition " << part->graph_handle
+              << " on " << part->name;
+    } else {
+      to_register.push_back(i);
+    }
+  }
+  const int num = to_register.size();
   gtl::InlinedVector<Call, 4> calls(num);
   BlockingCounter done(num);
   for (int i = 0; i < num; ++i) {
-    const Part& part = partitions_[i];
+    const Part& part = partitions_[to_register[i]];
     Call* c = &calls[i];
     c->req.set_session_handle(session_handle_);
     c->req.mutable_graph_def()->Swap(&graph_partitions[part.name]);
@@ -423,7 +613,12 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
   for (int i = 0; i < num; ++i) {
     Call* c = &calls[i];
     s.Update(c->status);
-    partitions_[i].graph_handle = c->resp.graph_handle();
+    Part* part = &partitions_[to_register[i]];
+    part->graph_handle = c->resp.graph_handle();
+    if (c->status.ok()) {
+      part->cached = partition_cache_->Insert(part->name, part->fingerprint,
+                                              part->graph_handle);
+    }
   }
   return s;
 }
@@ -870,6 +1065,13 @@ void MasterSession::ReffedClientGraph::DeregisterPartitions() {
     DeregisterGraphResponse resp;
   };
   for (Part& part : partitions_) {
+    // A shared partition stays registered while other ReffedClientGraphs
+    // still use it.
+    if (part.cached &&
+        !partition_cache_->Release(part.name, part.fingerprint)) {
+      worker_cache_->ReleaseWorker(part.name, part.worker);
+      continue;
+    }
     // The graph handle may be empty if we failed during partition registration.
     if (!part.graph_handle.empty()) {
       Call* c = new Call;
@@ -988,7 +1190,8 @@ MasterSession::MasterSession(
       stats_publisher_factory_(std::move(stats_publisher_factory)),
       graph_version_(0),
       run_graphs_(5),
-      partial_run_graphs_(5) {
+      partial_run_graphs_(5),
+      partition_cache_(new PartitionCache) {
   UpdateLastAccessTime();
   CHECK(devices_) << "device_set was null!";
 
@@ -1002,6 +1205,7 @@ MasterSession::MasterSession(
 MasterSession::~MasterSession() {
   for (const auto& iter : run_graphs_) iter.second->Unref();
   for (const auto& iter : partial_run_graphs_) iter.second->Unref();
+  partition_cache_->Unref();
 }
 
 void MasterSession::UpdateLastAccessTime() {
@@ -1190,7 +1394,7 @@ Status MasterSession::StartStep(const BuildGraphOptions& opts, int64* count,
       auto entry = new ReffedClientGraph(
           handle_, opts, std::move(client_graph), session_opts_,
           stats_publisher_factory_, execution_state_.get(), is_partial,
-          worker_cache);
+          worker_cache, partition_cache_);
       iter = m->insert({hash, entry}).first;
       VLOG(1) << "Preparing to execute new graph";
     }
@@ -141,6 +141,14 @@ class MasterSession : public core::RefCounted {
   RCGMap run_graphs_ GUARDED_BY(mu_);
   RCGMap partial_run_graphs_ GUARDED_BY(mu_);
 
+  // Worker subgraphs registered by this session, keyed by worker and by
+  // a fingerprint of the partition.  A ReffedClientGraph whose freshly
+  // built partition matches a registered one reuses its graph handle
+  // instead of issuing another RegisterGraph call, so adding a feed or
+  // fetch only re-registers the partitions that actually changed.
+  class PartitionCache;
+  PartitionCache* const partition_cache_;  // Owns one reference.
+
   struct PerStepState {
     bool collect_costs = false;
     bool collect_timeline = false;
@@ -118,29 +118,32 @@ const RunStepRequest& InMemoryRunStepRequest::ToProto() const {
   return *proto_version_;
 }
 
+MutableProtoRunStepRequest::MutableProtoRunStepRequest()
+    : request_(protobuf::Arena::CreateMessage<RunStepRequest>(&arena_)) {}
+
 const string& MutableProtoRunStepRequest::session_handle() const {
-  return request_.session_handle();
+  return request_->session_handle();
 }
 void MutableProtoRunStepRequest::set_session_handle(const string& handle) {
-  request_.set_session_handle(handle);
+  request_->set_session_handle(handle);
 }
 
 const string& MutableProtoRunStepRequest::partial_run_handle() const {
-  return request_.partial_run_handle();
+  return request_->partial_run_handle();
 }
 void MutableProtoRunStepRequest::set_partial_run_handle(const string& handle) {
-  request_.set_partial_run_handle(handle);
+  request_->set_partial_run_handle(handle);
 }
 
 size_t MutableProtoRunStepRequest::num_feeds() const {
-  return request_.feed_size();
+  return request_->feed_size();
 }
 const string& MutableProtoRunStepRequest::feed_name(size_t i) const {
-  return request_.feed(i).name();
+  return request_->feed(i).name();
 }
 Status MutableProtoRunStepRequest::FeedValue(size_t i,
                                              Tensor* out_tensor) const {
-  if (!ParseTensorProtoToTensor(request_.feed(i).tensor(), out_tensor)) {
+  if (!ParseTensorProtoToTensor(request_->feed(i).tensor(), out_tensor)) {
     return errors::InvalidArgument("Invalid TensorProto for feed value ", i);
   } else {
     return Status::OK();
@@ -149,55 +152,55 @@ Status MutableProtoRunStepRequest::FeedValue(size_t i,
 
 Status MutableProtoRunStepRequest::FeedValue(size_t i,
                                              TensorProto* out_tensor) const {
-  *out_tensor = request_.feed(i).tensor();
+  *out_tensor = request_->feed(i).tensor();
   return Status::OK();
 }
 
 void MutableProtoRunStepRequest::add_feed(const string& name,
                                           const Tensor& value) {
-  NamedTensorProto* feed = request_.add_feed();
+  NamedTensorProto* feed = request_->add_feed();
   feed->set_name(name);
   TensorProto* value_proto = feed->mutable_tensor();
   value.AsProtoTensorContent(value_proto);
 }
 
 size_t MutableProtoRunStepRequest::num_fetches() const {
-  return request_.fetch_size();
+  return request_->fetch_size();
 }
 
 const string& MutableProtoRunStepRequest::fetch_name(size_t i) const {
-  return request_.fetch(i);
+  return request_->fetch(i);
 }
 void MutableProtoRunStepRequest::add_fetch(const string& name) {
-  request_.add_fetch(name);
+  request_->add_fetch(name);
 }
 
 size_t MutableProtoRunStepRequest::num_targets() const {
-  return request_.target_size();
+  return request_->target_size();
 }
 
 const string& MutableProtoRunStepRequest::target_name(size_t i) const {
-  return request_.target(i);
+  return request_->target(i);
 }
 
 void MutableProtoRunStepRequest::add_target(const string& name) {
-  request_.add_target(name);
+  request_->add_target(name);
 }
 
 const RunOptions& MutableProtoRunStepRequest::options() const {
-  return request_.options();
+  return request_->options();
 }
 
 RunOptions* MutableProtoRunStepRequest::mutable_options() {
-  return request_.mutable_options();
+  return request_->mutable_options();
 }
 
 string MutableProtoRunStepRequest::DebugString() const {
-  return request_.DebugString();
+  return request_->DebugString();
 }
 
 const RunStepRequest& MutableProtoRunStepRequest::ToProto() const {
-  return request_;
+  return *request_;
 }
 
 ProtoRunStepRequest::ProtoRunStepRequest(const RunStepRequest* request)
@@ -350,49 +353,52 @@ const RunGraphRequest& InMemoryRunGraphRequest::ToProto() const {
   return *proto_version_;
 }
 
+MutableProtoRunGraphRequest::MutableProtoRunGraphRequest()
+    : request_(protobuf::Arena::CreateMessage<RunGraphRequest>(&arena_)) {}
+
 const string& MutableProtoRunGraphRequest::session_handle() const {
-  return request_.session_handle();
+  return request_->session_handle();
 }
 
 void MutableProtoRunGraphRequest::set_session_handle(const string& handle) {
-  request_.set_session_handle(handle);
+  request_->set_session_handle(handle);
 }
 
 const string& MutableProtoRunGraphRequest::graph_handle() const {
-  return request_.graph_handle();
+  return request_->graph_handle();
 }
 
 void MutableProtoRunGraphRequest::set_graph_handle(const string& handle) {
-  request_.set_graph_handle(handle);
+  request_->set_graph_handle(handle);
 }
 
 int64 MutableProtoRunGraphRequest::step_id() const {
-  return request_.step_id();
+  return request_->step_id();
 }
 
 void MutableProtoRunGraphRequest::set_step_id(int64 step_id) {
-  request_.set_step_id(step_id);
+  request_->set_step_id(step_id);
 }
 
 const ExecutorOpts& MutableProtoRunGraphRequest::exec_opts() const {
-  return request_.exec_opts();
+  return request_->exec_opts();
 }
 
 ExecutorOpts* MutableProtoRunGraphRequest::mutable_exec_opts() {
-  return request_.mutable_exec_opts();
+  return request_->mutable_exec_opts();
 }
 
 size_t MutableProtoRunGraphRequest::num_sends() const {
-  return request_.send_size();
+  return request_->send_size();
 }
 
 const string& MutableProtoRunGraphRequest::send_key(size_t i) const {
-  return request_.send(i).name();
+  return request_->send(i).name();
 }
 
 Status MutableProtoRunGraphRequest::SendValue(size_t i,
                                               Tensor* out_tensor) const {
-  if (!ParseTensorProtoToTensor(request_.send(i).tensor(), out_tensor)) {
+  if (!ParseTensorProtoToTensor(request_->send(i).tensor(), out_tensor)) {
     return errors::InvalidArgument("Invalid TensorProto for feed value ", i);
   } else {
     return Status::OK();
@@ -402,43 +408,43 @@ Status MutableProtoRunGraphRequest::SendValue(size_t i,
 Status MutableProtoRunGraphRequest::AddSendFromRunStepRequest(
     const RunStepRequestWrapper& run_step_request, size_t i,
     const string& send_key) {
-  NamedTensorProto* send = request_.add_send();
+  NamedTensorProto* send = request_->add_send();
   send->set_name(send_key);
   TF_RETURN_IF_ERROR(run_step_request.FeedValue(i, send->mutable_tensor()));
   return Status::OK();
 }
 
 size_t MutableProtoRunGraphRequest::num_recvs() const {
-  return request_.recv_key_size();
+  return request_->recv_key_size();
 }
 
 const string& MutableProtoRunGraphRequest::recv_key(size_t i) const {
-  return request_.recv_key(i);
+  return request_->recv_key(i);
 }
 
 void MutableProtoRunGraphRequest::add_recv_key(const string& recv_key) {
-  request_.add_recv_key(recv_key);
+  request_->add_recv_key(recv_key);
 }
 
 bool MutableProtoRunGraphRequest::is_partial() const {
-  return request_.is_partial();
+  return request_->is_partial();
 }
 
 void MutableProtoRunGraphRequest::set_is_partial(bool is_partial) {
-  request_.set_is_partial(is_partial);
+  request_->set_is_partial(is_partial);
 }
 
 bool MutableProtoRunGraphRequest::is_last_partial_run() const {
-  return request_.is_last_partial_run();
+  return request_->is_last_partial_run();
 }
 
 void MutableProtoRunGraphRequest::set_is_last_partial_run(
     bool is_last_partial_run) {
-  request_.set_is_last_partial_run(is_last_partial_run);
+  request_->set_is_last_partial_run(is_last_partial_run);
 }
 
 const RunGraphRequest& MutableProtoRunGraphRequest::ToProto() const {
-  return request_;
+  return *request_;
 }
 
 ProtoRunGraphRequest::ProtoRunGraphRequest(const RunGraphRequest* request)
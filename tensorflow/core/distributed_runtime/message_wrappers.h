@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb_text.h"
 #include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/master.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -148,8 +149,14 @@ class InMemoryRunStepRequest : public MutableRunStepRequestWrapper {
 //
 // This wrapper class should be used for RunStep requests between a
 // client and master in different address spaces.
+//
+// The message is allocated on an arena owned by the wrapper, so that the
+// per-feed submessages and tensor contents added while building the
+// request are released in bulk with it.
 class MutableProtoRunStepRequest : public MutableRunStepRequestWrapper {
  public:
+  MutableProtoRunStepRequest();
+
   // RunStepRequestWrapper methods.
   const string& session_handle() const override;
   const string& partial_run_handle() const override;
@@ -174,7 +181,8 @@ class MutableProtoRunStepRequest : public MutableRunStepRequestWrapper {
   RunOptions* mutable_options() override;
 
  private:
-  RunStepRequest request_;
+  protobuf::Arena arena_;
+  RunStepRequest* const request_;  // Allocated on `arena_`.
 };
 
 // Wrapper for immutable RunStep requests that use a non-owned
@@ -334,8 +342,14 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   mutable std::unique_ptr<RunGraphRequest> proto_version_;
 };
 
+// Wrapper for mutable RunGraph requests that uses a protobuf message.
+//
+// As with `MutableProtoRunStepRequest`, the message is allocated on an
+// arena owned by the wrapper.
 class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
  public:
+  MutableProtoRunGraphRequest();
+
   // RunGraphRequestWrapper methods.
   const string& session_handle() const override;
   const string& graph_handle() const override;
@@ -363,7 +377,8 @@ class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
   void set_is_last_partial_run(bool is_last_partial_run) override;
 
  private:
-  RunGraphRequest request_;
+  protobuf::Arena arena_;
+  RunGraphRequest* const request_;  // Allocated on `arena_`.
 };
 
 class ProtoRunGraphRequest : public RunGraphRequestWrapper {
@@ -19,7 +19,9 @@ limitations under the License.
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
@@ -323,4 +325,71 @@ TEST(MessageWrappers, RunStepResponse_Basic) {
   }
 }
 
+// Measures the per-step cost of building a RunStep request with `num_feeds`
+// small feeds, as a client does for every call to Session::Run().
+template <typename Request>
+static void BuildRunStepRequestBenchmark(int iters, int num_feeds) {
+  testing::StopTiming();
+  std::vector<string> names;
+  for (int i = 0; i < num_feeds; ++i) {
+    names.push_back(strings::StrCat("feed_", i, ":0"));
+  }
+  const Tensor value = TensorA();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Request request;
+    request.set_session_handle("handle");
+    for (const string& name : names) {
+      request.add_feed(name, value);
+    }
+    request.add_fetch("fetch_x:0");
+  }
+}
+
+static void BM_BuildRunStepRequest_InMemory(int iters, int num_feeds) {
+  BuildRunStepRequestBenchmark<InMemoryRunStepRequest>(iters, num_feeds);
+}
+BENCHMARK(BM_BuildRunStepRequest_InMemory)->Arg(100)->Arg(1000);
+
+static void BM_BuildRunStepRequest_MutableProto(int iters, int num_feeds) {
+  BuildRunStepRequestBenchmark<MutableProtoRunStepRequest>(iters, num_feeds);
+}
+BENCHMARK(BM_BuildRunStepRequest_MutableProto)->Arg(100)->Arg(1000);
+
+// Measures the per-step cost of building the RunGraph request that the
+// master forwards to a worker from a RunStep request with `num_feeds` feeds.
+template <typename Request>
+static void BuildRunGraphRequestBenchmark(int iters, int num_feeds) {
+  testing::StopTiming();
+  MutableProtoRunStepRequest run_step_request;
+  for (int i = 0; i < num_feeds; ++i) {
+    run_step_request.add_feed(strings::StrCat("feed_", i, ":0"), TensorA());
+  }
+  ProtoRunStepRequest proto_run_step_request(&run_step_request.ToProto());
+  std::vector<string> keys;
+  for (int i = 0; i < num_feeds; ++i) {
+    keys.push_back(strings::StrCat("send_", i));
+  }
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Request request;
+    request.set_graph_handle("graph_handle");
+    request.set_step_id(13);
+    for (int j = 0; j < num_feeds; ++j) {
+      TF_CHECK_OK(
+          request.AddSendFromRunStepRequest(proto_run_step_request, j, keys[j]));
+    }
+  }
+}
+
+static void BM_BuildRunGraphRequest_InMemory(int iters, int num_feeds) {
+  BuildRunGraphRequestBenchmark<InMemoryRunGraphRequest>(iters, num_feeds);
+}
+BENCHMARK(BM_BuildRunGraphRequest_InMemory)->Arg(100)->Arg(1000);
+
+static void BM_BuildRunGraphRequest_MutableProto(int iters, int num_feeds) {
+  BuildRunGraphRequestBenchmark<MutableProtoRunGraphRequest>(iters, num_feeds);
+}
+BENCHMARK(BM_BuildRunGraphRequest_MutableProto)->Arg(100)->Arg(1000);
+
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_server_lib.h"
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include <memory>
@@ -42,9 +43,11 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -184,8 +187,17 @@ Status GrpcServer::Init(
   master_service_ = NewGrpcMasterService(
       master_impl_.get(), config.operation_timeout_in_ms(), &builder);
   worker_impl_ = NewGrpcWorker(&worker_env_);
+  GrpcWorkerServiceOptions worker_service_options;
+  int64 num_serving_threads;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar(
+      "TF_GRPC_WORKER_SERVICE_THREADS",
+      std::min(worker_service_options.num_serving_threads,
+               std::max(port::NumSchedulableCPUs(), 1)),
+      &num_serving_threads));
+  worker_service_options.num_serving_threads = num_serving_threads;
   worker_service_ =
-      NewGrpcWorkerService(worker_impl_.get(), &builder).release();
+      NewGrpcWorkerService(worker_impl_.get(), &builder, worker_service_options)
+          .release();
   // extra service:
   if (service_func != nullptr) {
     service_func(&worker_env_, &builder);
@@ -333,8 +345,15 @@ Status GrpcServer::Stop() {
       state_ = STOPPED;
       return Status::OK();
     case STARTED:
-      return errors::Unimplemented(
-          "Clean shutdown is not currently implemented");
+      // Stops accepting calls, then shuts down the completion queues of the
+      // services. Their polling threads drain the queues and exit, which
+      // Join() waits for.
+      server_->Shutdown();
+      master_service_->Shutdown();
+      worker_service_->Shutdown();
+      state_ = STOPPED;
+      LOG(INFO) << "Stopped server with target: " << target();
+      return Status::OK();
     case STOPPED:
       LOG(INFO) << "Server already stopped (target: " << target() << ")";
       return Status::OK();
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_testlib.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
@@ -24,11 +25,14 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/init_main.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/util/port.h"
 
@@ -515,6 +519,122 @@ TEST(GrpcSessionTest, SendRecv_Node_Naming) {
   TF_CHECK_OK(session->Close());
 }
 
+// Starts a cluster of "num_tasks" servers in this process, unlike
+// test::TestCluster, so that tests can observe the master's metrics. The
+// servers are added to "servers", and the task targets are returned.
+static std::vector<string> MakeInProcessCluster(
+    int num_tasks, std::vector<std::unique_ptr<ServerInterface>>* servers) {
+  std::vector<int> ports(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    ports[i] = testing::PickUnusedPortOrDie();
+  }
+  std::vector<string> targets;
+  for (int i = 0; i < num_tasks; ++i) {
+    ServerDef server_def;
+    server_def.set_protocol("grpc");
+    server_def.set_job_name("localhost");
+    server_def.set_task_index(i);
+    auto* job_def = server_def.mutable_cluster()->add_job();
+    job_def->set_name("localhost");
+    for (int j = 0; j < num_tasks; ++j) {
+      (*job_def->mutable_tasks())[j] = strings::StrCat("localhost:", ports[j]);
+    }
+    (*server_def.mutable_default_session_config()
+          ->mutable_device_count())["CPU"] = 1;
+    std::unique_ptr<ServerInterface> server;
+    TF_CHECK_OK(NewServer(server_def, &server));
+    TF_CHECK_OK(server->Start());
+    servers->push_back(std::move(server));
+    targets.push_back(strings::StrCat("localhost:", ports[i]));
+  }
+  return targets;
+}
+
+// Returns the number of MasterSession partition cache lookups in this
+// process with "outcome" ("hit" or "miss"). Every miss is followed by a
+// RegisterGraph call.
+static int64 PartitionCacheLookups(const string& outcome) {
+  const std::unique_ptr<monitoring::CollectedMetrics> metrics =
+      monitoring::CollectionRegistry::Default()->CollectMetrics(
+          monitoring::CollectionRegistry::CollectMetricsOptions());
+  auto iter = metrics->point_set_map.find(
+      "/tensorflow/core/master_session_partition_cache_lookups");
+  if (iter == metrics->point_set_map.end()) return 0;
+  for (const auto& point : iter->second->points) {
+    for (const auto& label : point->labels) {
+      if (label.name == "outcome" && label.value == outcome) {
+        return point->int64_value;
+      }
+    }
+  }
+  return 0;
+}
+
+TEST(GrpcSessionTest, AddFetchToRegisteredSignature) {
+  std::vector<std::unique_ptr<ServerInterface>> servers;
+  const std::vector<string> targets = MakeInProcessCluster(2, &servers);
+  std::unique_ptr<Session> session(NewRemote(Options(targets[0], 1)));
+  ASSERT_TRUE(session != nullptr);
+
+  // a on task 0 feeds b and c on task 1.  Fetching different subsets of b
+  // and c changes the partition on task 1, while the partition on task 0 is
+  // identical when b is fetched and is shared between those signatures.
+  Graph graph(OpRegistry::Global());
+  Tensor a_tensor(DT_FLOAT, TensorShape({1, 1}));
+  a_tensor.flat<float>()(0) = 100;
+  Node* a = test::graph::Constant(&graph, a_tensor);
+  Node* b = test::graph::Identity(&graph, a);
+  Node* c = test::graph::Identity(&graph, a);
+
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  SetDevice(&def, a->name(), "/job:localhost/replica:0/task:0/cpu:0");
+  SetDevice(&def, b->name(), "/job:localhost/replica:0/task:1/cpu:0");
+  SetDevice(&def, c->name(), "/job:localhost/replica:0/task:1/cpu:0");
+  TF_CHECK_OK(session->Create(def));
+
+  auto run = [&session](const std::vector<string>& fetches) {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, fetches, {}, &outputs));
+    ASSERT_EQ(fetches.size(), outputs.size());
+    for (const Tensor& t : outputs) {
+      IsSingleFloatValue(t, 100);
+    }
+  };
+
+  // The first signature registers both partitions.
+  int64 hits = PartitionCacheLookups("hit");
+  int64 misses = PartitionCacheLookups("miss");
+  run({b->name()});
+  EXPECT_EQ(hits, PartitionCacheLookups("hit"));
+  EXPECT_EQ(misses + 2, PartitionCacheLookups("miss"));
+
+  // Adding a fetch reuses the partition on task 0, and only the partition on
+  // task 1 is registered.
+  hits = PartitionCacheLookups("hit");
+  misses = PartitionCacheLookups("miss");
+  run({b->name(), c->name()});
+  EXPECT_EQ(hits + 1, PartitionCacheLookups("hit"));
+  EXPECT_EQ(misses + 1, PartitionCacheLookups("miss"));
+
+  run({c->name()});
+
+  // A signature that has run before reuses its client graph without looking
+  // up any partitions.
+  hits = PartitionCacheLookups("hit");
+  misses = PartitionCacheLookups("miss");
+  run({b->name()});
+  EXPECT_EQ(hits, PartitionCacheLookups("hit"));
+  EXPECT_EQ(misses, PartitionCacheLookups("miss"));
+
+  TF_CHECK_OK(session->Close());
+  session.reset();
+  for (auto& server : servers) {
+    TF_CHECK_OK(server->Stop());
+    TF_CHECK_OK(server->Join());
+  }
+}
+
 TEST(GrpcSessionTest, Error) {
   std::unique_ptr<test::TestCluster> cluster;
   TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
@@ -930,4 +1050,40 @@ TEST(SessionTest, RunTimeoutWithRunOptions) {
               error::INTERNAL == status.code());
 }
 
+// Measures the per-step overhead of RunGraph on a trivial graph, spread
+// over "num_workers" workers.
+static void BM_TrivialRunGraph(int iters, int num_workers) {
+  testing::StopTiming();
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(
+      test::TestCluster::MakeTestCluster(Devices(1, 0), num_workers, &cluster));
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1)));
+
+  Graph graph(OpRegistry::Global());
+  Tensor a_tensor(DT_FLOAT, TensorShape({}));
+  a_tensor.scalar<float>()() = 1.0;
+  Node* a = test::graph::Constant(&graph, a_tensor);
+  Node* b = a;
+  for (int i = 0; i < num_workers; ++i) {
+    b = test::graph::Identity(&graph, b);
+  }
+  GraphDef gdef;
+  test::graph::ToGraphDef(&graph, &gdef);
+  TF_CHECK_OK(session->Create(gdef));
+
+  const std::vector<string> fetches = {strings::StrCat(b->name(), ":0")};
+  std::vector<Tensor> outputs;
+  // Registers the partitions before timing starts.
+  TF_CHECK_OK(session->Run({}, fetches, {}, &outputs));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run({}, fetches, {}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_TrivialRunGraph)->Arg(1)->Arg(2);
+
 }  // namespace tensorflow
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 
+#include <algorithm>
 #include <deque>
+#include <vector>
 
 #include "grpc++/alarm.h"
 #include "grpc++/server_builder.h"
@@ -42,6 +44,7 @@ limitations under the License.
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -50,35 +53,49 @@ namespace tensorflow {
 
 namespace {
 
-class GrpcWorkerService : public AsyncServiceInterface {
+// A completion queue with a dedicated polling thread.
+//
+// GrpcWorkerService shards incoming calls over several of these, so that a
+// burst of small RPCs (typically RecvTensor) is not serialized behind a
+// single thread draining a single completion queue. Each
+// GrpcWorkerServiceThread enqueues its own pending requests, and re-enqueues
+// every handled request on the same queue.
+class GrpcWorkerServiceThread {
  public:
-  GrpcWorkerService(GrpcWorker* worker, ::grpc::ServerBuilder* builder)
-      : worker_(worker), is_shutdown_(false) {
-    builder->RegisterService(&worker_service_);
+  GrpcWorkerServiceThread(GrpcWorker* worker, ::grpc::ServerBuilder* builder,
+                          grpc::WorkerService::AsyncService* worker_service,
+                          int num_threads)
+      : worker_(worker),
+        worker_service_(worker_service),
+        num_threads_(num_threads),
+        is_shutdown_(false) {
     cq_ = builder->AddCompletionQueue();
   }
 
-  ~GrpcWorkerService() override { delete shutdown_alarm_; }
+  ~GrpcWorkerServiceThread() { delete shutdown_alarm_; }
 
-  void Shutdown() override {
-    bool did_shutdown = false;
+  void Shutdown() {
     {
       mutex_lock l(shutdown_mu_);
-      if (!is_shutdown_) {
-        LOG(INFO) << "Shutting down GrpcWorkerService.";
-        is_shutdown_ = true;
-        did_shutdown = true;
-      }
-    }
-    if (did_shutdown) {
-      // NOTE(mrry): This enqueues a special event (with a null tag)
-      // that causes the completion queue to be shut down on the
-      // polling thread.
-      shutdown_alarm_ =
-          new ::grpc::Alarm(cq_.get(), gpr_now(GPR_CLOCK_MONOTONIC), nullptr);
+      if (is_shutdown_) return;
+      is_shutdown_ = true;
     }
+    // NOTE(mrry): This enqueues a special event (with a null tag)
+    // that causes the completion queue to be shut down on the
+    // polling thread.
+    shutdown_alarm_ =
+        new ::grpc::Alarm(cq_.get(), gpr_now(GPR_CLOCK_MONOTONIC), nullptr);
   }
 
+  // Starts polling the completion queue on a new thread.
+  void Start() {
+    thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "TF_worker_service", [this] { HandleRPCsLoop(); }));
+  }
+
+  // Waits for the thread started by `Start()` to finish.
+  void Join() { thread_.reset(); }
+
 // This macro creates a new request for the given RPC method name
 // (e.g., `ENQUEUE_REQUEST(GetStatus, false);`), and enqueues it on
 // `this->cq_`.
@@ -90,27 +107,26 @@ class GrpcWorkerService : public AsyncServiceInterface {
 // The implementation of the request handler for each RPC method
 // must ensure that it calls ENQUEUE_REQUEST() for that RPC method,
 // to keep accepting new requests.
-#define ENQUEUE_REQUEST(method, supports_cancel)                       \
-  do {                                                                 \
-    mutex_lock l(shutdown_mu_);                                        \
-    if (!is_shutdown_) {                                               \
-      Call<GrpcWorkerService, grpc::WorkerService::AsyncService,       \
-           method##Request, method##Response>::                        \
-          EnqueueRequestForMethod(                                     \
-              &worker_service_, cq_.get(),                             \
-              static_cast<int>(GrpcWorkerMethod::k##method),           \
-              &GrpcWorkerService::method##Handler, (supports_cancel)); \
-    }                                                                  \
+#define ENQUEUE_REQUEST(method, supports_cancel)                             \
+  do {                                                                       \
+    mutex_lock l(shutdown_mu_);                                              \
+    if (!is_shutdown_) {                                                     \
+      Call<GrpcWorkerServiceThread, grpc::WorkerService::AsyncService,       \
+           method##Request, method##Response>::                              \
+          EnqueueRequestForMethod(                                           \
+              worker_service_, cq_.get(),                                    \
+              static_cast<int>(GrpcWorkerMethod::k##method),                 \
+              &GrpcWorkerServiceThread::method##Handler, (supports_cancel)); \
+    }                                                                        \
   } while (0)
 
   // This method blocks forever handling requests from the completion queue.
-  void HandleRPCsLoop() override {
+  void HandleRPCsLoop() {
     // TODO(mrry): This may require performance engineering. We can
-    // add more threads to service the completion queue, and add more
-    // of various request types if they are short and frequent.
-    // Currently we allow unbounded numbers of pending calls for each
-    // method, by re-enqueuing a request before the previous one
-    // completes, and we may decide to bound some of the request
+    // add more of various request types if they are short and
+    // frequent. Currently we allow unbounded numbers of pending calls
+    // for each method, by re-enqueuing a request before the previous
+    // one completes, and we may decide to bound some of the request
     // types.
     ENQUEUE_REQUEST(GetStatus, false);
     ENQUEUE_REQUEST(CreateWorkerSession, false);
@@ -120,13 +136,13 @@ class GrpcWorkerService : public AsyncServiceInterface {
 
     // TODO(mrry): Determine a better policy for enqueuing the appropriate
     // number of each request type.
-    for (int i = 0; i < 1000; ++i) {
+    for (int i = 0; i < QueueDepth(1000); ++i) {
       EnqueueRecvTensorRequestRaw();
     }
-    for (int i = 0; i < 100; ++i) {
+    for (int i = 0; i < QueueDepth(100); ++i) {
       ENQUEUE_REQUEST(RunGraph, true);
     }
-    for (int i = 0; i < 100; ++i) {
+    for (int i = 0; i < QueueDepth(100); ++i) {
       ENQUEUE_REQUEST(CleanupGraph, false);
     }
 
@@ -137,8 +153,8 @@ class GrpcWorkerService : public AsyncServiceInterface {
     bool ok;
 
     while (cq_->Next(&tag, &ok)) {
-      UntypedCall<GrpcWorkerService>::Tag* callback_tag =
-          static_cast<UntypedCall<GrpcWorkerService>::Tag*>(tag);
+      UntypedCall<GrpcWorkerServiceThread>::Tag* callback_tag =
+          static_cast<UntypedCall<GrpcWorkerServiceThread>::Tag*>(tag);
       if (callback_tag) {
         callback_tag->OnCompleted(this, ok);
       } else {
@@ -150,15 +166,23 @@ class GrpcWorkerService : public AsyncServiceInterface {
   }
 
  private:
-  GrpcWorker* worker_ = nullptr;  // Not owned.
+  GrpcWorker* const worker_;                                 // Not owned.
+  grpc::WorkerService::AsyncService* const worker_service_;  // Not owned.
+  const int num_threads_;
   std::unique_ptr<::grpc::ServerCompletionQueue> cq_;
-
-  grpc::WorkerService::AsyncService worker_service_;
+  std::unique_ptr<Thread> thread_;
 
   mutex shutdown_mu_;
   bool is_shutdown_ GUARDED_BY(shutdown_mu_);
   ::grpc::Alarm* shutdown_alarm_ = nullptr;
 
+  // Returns this thread's share of `total_depth` pending requests for a
+  // method, so that the total number of pending requests does not depend
+  // on the number of threads.
+  int QueueDepth(int total_depth) const {
+    return (total_depth + num_threads_ - 1) / num_threads_;
+  }
+
   void Schedule(std::function<void()> f) {
     worker_->env()->compute_pool->Schedule(std::move(f));
   }
@@ -171,8 +195,9 @@ class GrpcWorkerService : public AsyncServiceInterface {
   // `ENQUEUE_REQUEST(Foo)`.
 
   template <class RequestMessage, class ResponseMessage>
-  using WorkerCall = Call<GrpcWorkerService, grpc::WorkerService::AsyncService,
-                          RequestMessage, ResponseMessage>;
+  using WorkerCall =
+      Call<GrpcWorkerServiceThread, grpc::WorkerService::AsyncService,
+           RequestMessage, ResponseMessage>;
 
   void GetStatusHandler(WorkerCall<GetStatusRequest, GetStatusResponse>* call) {
     Schedule([this, call]() {
@@ -240,18 +265,20 @@ class GrpcWorkerService : public AsyncServiceInterface {
     ENQUEUE_REQUEST(RunGraph, true);
   }
 
+  // Unlike the other handlers, this handler runs on the polling thread.
+  // RecvTensorAsync() never blocks: if the tensor has already been
+  // produced, it is encoded into the response directly on this thread,
+  // and otherwise the response is sent from the thread that produces it.
   void RecvTensorHandlerRaw(
       WorkerCall<RecvTensorRequest, ::grpc::ByteBuffer>* call) {
-    Schedule([this, call]() {
-      CallOptions* call_opts = new CallOptions;
-      call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
-      worker_->RecvTensorAsync(call_opts, &call->request, &call->response,
-                               [call, call_opts](const Status& s) {
-                                 call->ClearCancelCallback();
-                                 delete call_opts;
-                                 call->SendResponse(ToGrpcStatus(s));
-                               });
-    });
+    CallOptions* call_opts = new CallOptions;
+    call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+    worker_->RecvTensorAsync(call_opts, &call->request, &call->response,
+                             [call, call_opts](const Status& s) {
+                               call->ClearCancelCallback();
+                               delete call_opts;
+                               call->SendResponse(ToGrpcStatus(s));
+                             });
     EnqueueRecvTensorRequestRaw();
   }
 
@@ -284,16 +311,68 @@ class GrpcWorkerService : public AsyncServiceInterface {
   void EnqueueRecvTensorRequestRaw() {
     mutex_lock l(shutdown_mu_);
     if (!is_shutdown_) {
-      Call<GrpcWorkerService, grpc::WorkerService::AsyncService,
+      Call<GrpcWorkerServiceThread, grpc::WorkerService::AsyncService,
            RecvTensorRequest, ::grpc::ByteBuffer>::
           EnqueueRequestForMethod(
-              &worker_service_, cq_.get(),
+              worker_service_, cq_.get(),
               static_cast<int>(GrpcWorkerMethod::kRecvTensor),
-              &GrpcWorkerService::RecvTensorHandlerRaw,
+              &GrpcWorkerServiceThread::RecvTensorHandlerRaw,
               true /* supports cancel*/);
     }
   }
 
+  TF_DISALLOW_COPY_AND_ASSIGN(GrpcWorkerServiceThread);
+};
+
+class GrpcWorkerService : public AsyncServiceInterface {
+ public:
+  GrpcWorkerService(GrpcWorker* worker, ::grpc::ServerBuilder* builder,
+                    const GrpcWorkerServiceOptions& options)
+      : is_shutdown_(false) {
+    builder->RegisterService(&worker_service_);
+    const int num_threads = std::max(1, options.num_serving_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back(new GrpcWorkerServiceThread(
+          worker, builder, &worker_service_, num_threads));
+    }
+  }
+
+  void Shutdown() override {
+    bool did_shutdown = false;
+    {
+      mutex_lock l(shutdown_mu_);
+      if (!is_shutdown_) {
+        LOG(INFO) << "Shutting down GrpcWorkerService.";
+        is_shutdown_ = true;
+        did_shutdown = true;
+      }
+    }
+    if (did_shutdown) {
+      for (auto& thread : threads_) {
+        thread->Shutdown();
+      }
+    }
+  }
+
+  // This method blocks forever handling requests from the completion
+  // queues. The first queue is polled by the calling thread.
+  void HandleRPCsLoop() override {
+    for (size_t i = 1; i < threads_.size(); ++i) {
+      threads_[i]->Start();
+    }
+    threads_[0]->HandleRPCsLoop();
+    for (size_t i = 1; i < threads_.size(); ++i) {
+      threads_[i]->Join();
+    }
+  }
+
+ private:
+  grpc::WorkerService::AsyncService worker_service_;
+  std::vector<std::unique_ptr<GrpcWorkerServiceThread>> threads_;
+
+  mutex shutdown_mu_;
+  bool is_shutdown_ GUARDED_BY(shutdown_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(GrpcWorkerService);
 };
 
@@ -395,9 +474,10 @@ std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* env) {
 }
 
 std::unique_ptr<AsyncServiceInterface> NewGrpcWorkerService(
-    GrpcWorker* worker, ::grpc::ServerBuilder* builder) {
+    GrpcWorker* worker, ::grpc::ServerBuilder* builder,
+    const GrpcWorkerServiceOptions& options) {
   return std::unique_ptr<AsyncServiceInterface>(
-      new GrpcWorkerService(worker, builder));
+      new GrpcWorkerService(worker, builder, options));
 }
 
 }  // namespace tensorflow
@@ -42,9 +42,21 @@ class GrpcWorker : public Worker {
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env);
 
+struct GrpcWorkerServiceOptions {
+  // Number of completion queues used by the service, each polled by its
+  // own thread. Incoming calls are spread across the queues.
+  //
+  // GrpcServer lowers this to the number of schedulable CPUs, as extra
+  // polling threads only compete with each other on smaller hosts, and
+  // overrides it with the TF_GRPC_WORKER_SERVICE_THREADS environment
+  // variable, if set.
+  int num_serving_threads = 8;
+};
+
 // Returns an implementation of WorkerService rpc service.
 std::unique_ptr<AsyncServiceInterface> NewGrpcWorkerService(
-    GrpcWorker* worker, ::grpc::ServerBuilder* builder);
+    GrpcWorker* worker, ::grpc::ServerBuilder* builder,
+    const GrpcWorkerServiceOptions& options = GrpcWorkerServiceOptions());
 
 }  // namespace tensorflow
 
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
@@ -237,6 +238,60 @@ static void BM_RPC(int iters, int width, int tensor_size) {
 }
 BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
 
+// Runs `num_streams` concurrent steps of a two-stage, multi-device program
+// against the same session. Each step moves tensors of `tensor_size` floats
+// between the workers with RecvTensor calls, so this measures how the
+// worker services keep up with many concurrent RecvTensor streams.
+static void BM_ConcurrentRPC(int iters, int num_streams, int tensor_size) {
+  testing::StopTiming();
+  const Cluster* cluster = GetCluster();
+  const int width = 4;
+
+  std::unique_ptr<Session> session(NewSession(cluster->options));
+  GraphDef def = CreateGraphDef(2 /*num_stages*/, width, tensor_size,
+                                true /*multi-device*/, cluster);
+  graph::SetDefaultDevice(cluster->devices[0].name(), &def);
+  TF_CHECK_OK(session->Create(def));
+
+  Tensor x(DT_FLOAT, TensorShape({tensor_size, 1}));
+  testing::SetLabel(strings::StrCat(num_streams, " streams; ",
+                                    "tensor bytes/send: ",
+                                    tensor_size * sizeof(float)));
+
+  // Do a few warmup iterations.
+  for (int i = 0; i < 3; i++) {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({{"x", x}}, {"y:0"}, {}, &outputs));
+  }
+
+  thread::ThreadPool streams(Env::Default(), "streams", num_streams);
+  testing::StartTiming();
+  BlockingCounter done(num_streams);
+  for (int s = 0; s < num_streams; ++s) {
+    const int steps = iters / num_streams + (s < iters % num_streams ? 1 : 0);
+    streams.Schedule([&session, &x, &done, steps]() {
+      for (int i = 0; i < steps; ++i) {
+        std::vector<Tensor> outputs;
+        TF_CHECK_OK(session->Run({{"x", x}}, {"y:0"}, {}, &outputs));
+      }
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * width);
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_ConcurrentRPC)
+    ->ArgPair(1, 2)
+    ->ArgPair(4, 2)
+    ->ArgPair(16, 2)
+    ->ArgPair(64, 2)
+    ->ArgPair(1, 100000)
+    ->ArgPair(4, 100000)
+    ->ArgPair(16, 100000)
+    ->ArgPair(64, 100000);
+
 static void BM_SingleDevice(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/,
             false /*not multi-device*/);
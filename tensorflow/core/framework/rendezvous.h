@@ -67,11 +67,17 @@ class Rendezvous : public core::RefCounted {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // Hash64 of FullKey(), computed once by ParseKey() so that
+    // rendezvous implementations do not need to rehash the key on every
+    // Send and Recv.
+    uint64 FullKeyHash() const { return full_key_hash_; }
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     string buf_;
+    uint64 full_key_hash_ = 0;
   };
   static Status ParseKey(StringPiece key, ParsedKey* out);
 
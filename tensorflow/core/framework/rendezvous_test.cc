@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -261,6 +262,44 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+// The table is split into shards by key hash. StartAbort() must cancel the
+// waiters and drop the sent values of every shard, and every shard must
+// reject later calls.
+TEST_F(LocalRendezvousTest, AbortCancelsAllShards) {
+  // Enough keys to land in every shard.
+  static const int N = 256;
+  BlockingCounter recvs_done(N);
+  std::vector<Status> recv_status(N);
+  Rendezvous::Args args;
+  for (int i = 0; i < N; ++i) {
+    rendez_->RecvAsync(MakeKey(strings::StrCat("recv", i)), args,
+                       [&recv_status, &recvs_done, i](
+                           const Status& s, const Rendezvous::Args& send_args,
+                           const Rendezvous::Args& recv_args,
+                           const Tensor& v, bool dead) {
+                         recv_status[i] = s;
+                         recvs_done.DecrementCount();
+                       });
+    TF_ASSERT_OK(rendez_->Send(MakeKey(strings::StrCat("send", i)), args,
+                               V("hello"), false));
+  }
+
+  rendez_->StartAbort(errors::Aborted(""));
+  recvs_done.Wait();
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(errors::IsAborted(recv_status[i])) << recv_status[i];
+  }
+
+  Tensor val(DT_STRING);
+  bool val_dead = false;
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(errors::IsAborted(rendez_->Recv(
+        MakeKey(strings::StrCat("send", i)), args, &val, &val_dead)));
+    EXPECT_TRUE(errors::IsAborted(rendez_->Send(
+        MakeKey(strings::StrCat("recv", i)), args, V("hello"), false)));
+  }
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -346,4 +385,42 @@ static void BM_RecvSend(int iters) {
 }
 BENCHMARK(BM_RecvSend);
 
+// Each iteration creates a rendezvous, as for one step, and `num_threads`
+// threads concurrently send and receive 1000 distinct keys each, as the
+// executors of the devices in a step do.
+static void BM_ConcurrentSendRecv(int iters, int num_threads) {
+  testing::StopTiming();
+  const int kTransfersPerThread = 1000;
+  std::vector<std::vector<Rendezvous::ParsedKey>> keys(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    for (int i = 0; i < kTransfersPerThread; ++i) {
+      keys[t].push_back(MakeKey(strings::StrCat("edge_", t, "_", i)));
+    }
+  }
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  const Tensor orig = V("val");
+  testing::StartTiming();
+  for (int iter = 0; iter < iters; ++iter) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    BlockingCounter done(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([rendez, &keys, &orig, &done, t]() {
+        Tensor val;
+        bool is_dead = false;
+        Rendezvous::Args args;
+        for (const Rendezvous::ParsedKey& key : keys[t]) {
+          TF_CHECK_OK(rendez->Send(key, args, orig, is_dead));
+          TF_CHECK_OK(rendez->Recv(key, args, &val, &is_dead));
+        }
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+    rendez->Unref();
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads *
+                          kTransfersPerThread);
+}
+BENCHMARK(BM_ConcurrentSendRecv)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16);
+
 }  // namespace tensorflow
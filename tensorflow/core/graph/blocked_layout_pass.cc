@@ -0,0 +1,428 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/blocked_layout_pass.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+// This pass moves chains of CPU Conv2D, MaxPool, AvgPool, BiasAdd, Relu and
+// Relu6 nodes to the blocked NCHWc layout of kernels/nchwc_ops.cc.
+//
+// A chain starts at a Conv2D, MaxPool or AvgPool node (the "window" ops, which
+// always see 4-D NHWC tensors) and extends through any BiasAdd, Relu or Relu6
+// node whose first input is produced by a node of the chain. For example,
+//
+//     A = Conv2D(X, F1); B = BiasAdd(A, b); C = Relu(B); D = MaxPool(C)
+//
+// is rewritten to
+//
+//     Xb, Xc = _NHWCToNCHWc(X)
+//     Ab, Ac = _NCHWcConv2D(Xb, F1); Bb = _NCHWcBiasAdd(Ab, b); Cb = Relu(Bb)
+//     Db = _NCHWcMaxPool(Cb); D = _NCHWcToNHWC(Db, Ac)
+//
+// Every tensor of the chain that is also consumed outside of it gets one
+// _NCHWcToNHWC conversion, fed by the channel count output of the op that
+// last changed the number of channels. Relu and Relu6 run on the blocked
+// tensor unchanged, because they map the zero padding channels to zero.
+//
+// Chains with fewer than kMinWindowOpsPerChain window ops are left alone: for
+// them the two conversions cost about as much as the blocked kernels save.
+//
+// The pass is off unless TF_ENABLE_BLOCKED_LAYOUT is set to true. The block
+// size defaults to 16 channels when the CPU supports AVX-512 and 8 otherwise;
+// TF_BLOCKED_LAYOUT_BLOCK_SIZE overrides it.
+class BlockedLayoutRewritePass : public GraphOptimizationPass {
+ public:
+  explicit BlockedLayoutRewritePass(int block_size = 0)
+      : block_size_(block_size) {}
+
+  Status Run(const GraphOptimizationPassOptions& options) override;
+
+  // Rewrites 'g' with channel blocks of 'block_size_'. Returns true if and
+  // only if 'g' was mutated.
+  bool RunPass(std::unique_ptr<Graph>* g);
+
+ private:
+  enum class Kind {
+    kNone,
+    kConv2D,
+    kMaxPool,
+    kAvgPool,
+    kBiasAdd,
+    kElementwise,
+  };
+
+  static const int kMinWindowOpsPerChain = 2;
+
+  static bool IsWindowOp(Kind kind) {
+    return kind == Kind::kConv2D || kind == Kind::kMaxPool ||
+           kind == Kind::kAvgPool;
+  }
+
+  // Returns the kind of rewrite 'n' is eligible for, ignoring its inputs.
+  static Kind Classify(const Node* n);
+
+  // Returns true if 'n' may run on the CPU device.
+  static bool CanOpRunOnCPUDevice(const Node* n);
+
+  // Returns the blocked replacement of 'n', built from the (already rewritten)
+  // nodes feeding it.
+  Status RewriteNode(Graph* g, Node* n, Kind kind);
+
+  // Returns the node converting output 'slot' of the non-chain node 'src' to
+  // the blocked layout, creating it on first use.
+  Status GetToBlocked(Graph* g, Node* src, int slot, const Node* consumer,
+                      Node** out);
+
+  // Returns the node converting the blocked output of the chain node 'n' back
+  // to NHWC, creating it on first use.
+  Status GetFromBlocked(Graph* g, const Node* n, Node** out);
+
+  int block_size_;
+
+  // Per original node id: the replacement node, and where its blocked output
+  // and its channel count come from.
+  std::vector<Node*> replacement_;
+  std::vector<std::pair<Node*, int>> channels_;
+  std::vector<Node*> from_blocked_;
+  std::map<std::pair<const Node*, int>, Node*> to_blocked_;
+};
+
+namespace {
+
+int DefaultBlockSize() {
+  int64 block_size;
+  Status s =
+      ReadInt64FromEnvVar("TF_BLOCKED_LAYOUT_BLOCK_SIZE", 0, &block_size);
+  if (!s.ok()) {
+    LOG(ERROR) << s.error_message();
+    block_size = 0;
+  }
+  if (block_size > 0) return static_cast<int>(block_size);
+  return port::TestCPUFeature(port::CPUFeature::AVX512F) ? 16 : 8;
+}
+
+}  // namespace
+
+bool BlockedLayoutRewritePass::CanOpRunOnCPUDevice(const Node* n) {
+  // Substring that should be checked for in device name for CPU device.
+  const char* const kCPUDeviceSubStr = "cpu";
+  if (!n->assigned_device_name().empty() &&
+      !StringPiece(n->assigned_device_name()).contains(kCPUDeviceSubStr)) {
+    return false;
+  }
+  if (!n->def().device().empty() &&
+      !StringPiece(n->def().device()).contains(kCPUDeviceSubStr)) {
+    return false;
+  }
+  return true;
+}
+
+BlockedLayoutRewritePass::Kind BlockedLayoutRewritePass::Classify(
+    const Node* n) {
+  DataType dtype;
+  if (!n->IsOp() || !GetNodeAttr(n->attrs(), "T", &dtype).ok() ||
+      dtype != DT_FLOAT || !CanOpRunOnCPUDevice(n)) {
+    return Kind::kNone;
+  }
+  const string& op = n->type_string();
+  if (op == "Relu" || op == "Relu6") {
+    return Kind::kElementwise;
+  }
+
+  string data_format;
+  if (!GetNodeAttr(n->attrs(), "data_format", &data_format).ok() ||
+      data_format != "NHWC") {
+    return Kind::kNone;
+  }
+  if (op == "BiasAdd") {
+    return Kind::kBiasAdd;
+  }
+
+  std::vector<int32> strides;
+  if (!GetNodeAttr(n->attrs(), "strides", &strides).ok() ||
+      strides.size() != 4 || strides[0] != 1 || strides[3] != 1) {
+    return Kind::kNone;
+  }
+  if (op == "Conv2D") {
+    return Kind::kConv2D;
+  }
+  if (op == "MaxPool" || op == "AvgPool") {
+    std::vector<int32> ksize;
+    if (!GetNodeAttr(n->attrs(), "ksize", &ksize).ok() || ksize.size() != 4 ||
+        ksize[0] != 1 || ksize[3] != 1) {
+      return Kind::kNone;
+    }
+    return op == "MaxPool" ? Kind::kMaxPool : Kind::kAvgPool;
+  }
+  return Kind::kNone;
+}
+
+Status BlockedLayoutRewritePass::GetToBlocked(Graph* g, Node* src, int slot,
+                                              const Node* consumer,
+                                              Node** out) {
+  Node*& node = to_blocked_[std::make_pair(src, slot)];
+  if (node == nullptr) {
+    const string name =
+        slot == 0 ? strings::StrCat(src->name(), "/_NHWCToNCHWc")
+                  : strings::StrCat(src->name(), "/_NHWCToNCHWc_", slot);
+    TF_RETURN_IF_ERROR(NodeBuilder(name, "_NHWCToNCHWc")
+                           .Input(src, slot)
+                           .Attr("T", DT_FLOAT)
+                           .Attr("block_size", block_size_)
+                           .Device(consumer->def().device())
+                           .Finalize(g, &node));
+    node->set_assigned_device_name(consumer->assigned_device_name());
+  }
+  *out = node;
+  return Status::OK();
+}
+
+Status BlockedLayoutRewritePass::GetFromBlocked(Graph* g, const Node* n,
+                                                Node** out) {
+  Node*& node = from_blocked_[n->id()];
+  if (node == nullptr) {
+    const std::pair<Node*, int>& channels = channels_[n->id()];
+    TF_RETURN_IF_ERROR(
+        NodeBuilder(strings::StrCat(n->name(), "/_NCHWcToNHWC"),
+                    "_NCHWcToNHWC")
+            .Input(replacement_[n->id()], 0)
+            .Input(channels.first, channels.second)
+            .Attr("T", DT_FLOAT)
+            .Device(n->def().device())
+            .Finalize(g, &node));
+    node->set_assigned_device_name(n->assigned_device_name());
+  }
+  *out = node;
+  return Status::OK();
+}
+
+Status BlockedLayoutRewritePass::RewriteNode(Graph* g, Node* n, Kind kind) {
+  std::vector<const Edge*> inputs;
+  TF_RETURN_IF_ERROR(n->input_edges(&inputs));
+
+  // The first input is blocked, either by the chain or by a conversion.
+  Node* blocked_input = replacement_[inputs[0]->src()->id()];
+  std::pair<Node*, int> channels;
+  if (blocked_input != nullptr && inputs[0]->src_output() == 0) {
+    channels = channels_[inputs[0]->src()->id()];
+  } else {
+    TF_RETURN_IF_ERROR(GetToBlocked(g, inputs[0]->src(),
+                                    inputs[0]->src_output(), n,
+                                    &blocked_input));
+    channels = std::make_pair(blocked_input, 1);
+  }
+
+  // Any other input stays in NHWC, converted back if the chain produces it.
+  auto add_nhwc_input = [this, g, &inputs](NodeBuilder* nb, int index) {
+    const Edge* e = inputs[index];
+    if (replacement_[e->src()->id()] == nullptr) {
+      nb->Input(e->src(), e->src_output());
+      return Status::OK();
+    }
+    Node* converted;
+    TF_RETURN_IF_ERROR(GetFromBlocked(g, e->src(), &converted));
+    nb->Input(converted, 0);
+    return Status::OK();
+  };
+
+  static const char* const kNewOps[] = {
+      nullptr, "_NCHWcConv2D", "_NCHWcMaxPool", "_NCHWcAvgPool",
+      "_NCHWcBiasAdd", nullptr};
+  const string new_op = kind == Kind::kElementwise
+                            ? n->type_string()
+                            : kNewOps[static_cast<int>(kind)];
+  NodeBuilder nb(n->name(), new_op);
+  nb.Input(blocked_input, 0);
+  nb.Attr("T", DT_FLOAT);
+  nb.Device(n->def().device());
+  std::vector<int32> list;
+  string padding;
+  switch (kind) {
+    case Kind::kConv2D:
+      TF_RETURN_IF_ERROR(add_nhwc_input(&nb, 1));
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "strides", &list));
+      nb.Attr("strides", list);
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "padding", &padding));
+      nb.Attr("padding", padding);
+      break;
+    case Kind::kMaxPool:
+    case Kind::kAvgPool:
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "ksize", &list));
+      nb.Attr("ksize", list);
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "strides", &list));
+      nb.Attr("strides", list);
+      TF_RETURN_IF_ERROR(GetNodeAttr(n->attrs(), "padding", &padding));
+      nb.Attr("padding", padding);
+      break;
+    case Kind::kBiasAdd:
+      TF_RETURN_IF_ERROR(add_nhwc_input(&nb, 1));
+      break;
+    case Kind::kElementwise:
+    case Kind::kNone:
+      break;
+  }
+
+  Node* new_node;
+  TF_RETURN_IF_ERROR(nb.Finalize(g, &new_node));
+  new_node->set_assigned_device_name(n->assigned_device_name());
+  for (const Edge* e : n->in_edges()) {
+    if (e->IsControlEdge()) {
+      Node* src = replacement_[e->src()->id()];
+      g->AddControlEdge(src != nullptr ? src : e->src(), new_node);
+    }
+  }
+
+  replacement_[n->id()] = new_node;
+  channels_[n->id()] =
+      kind == Kind::kConv2D ? std::make_pair(new_node, 1) : channels;
+  return Status::OK();
+}
+
+bool BlockedLayoutRewritePass::RunPass(std::unique_ptr<Graph>* g) {
+  CHECK_NOTNULL(g);
+  Graph* graph = g->get();
+  if (block_size_ <= 0) block_size_ = DefaultBlockSize();
+
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph, &order);  // This will give us topological sort.
+
+  // Find the chains: window ops start them, and bias-adds and relus extend
+  // the chain of their first input. Chains are tracked as a union-find forest.
+  const int num_ids = graph->num_node_ids();
+  std::vector<Kind> kinds(num_ids, Kind::kNone);
+  std::vector<int> parent(num_ids);
+  for (int i = 0; i < num_ids; ++i) parent[i] = i;
+  auto find = [&parent](int id) {
+    while (parent[id] != id) {
+      parent[id] = parent[parent[id]];
+      id = parent[id];
+    }
+    return id;
+  };
+  for (Node* n : order) {
+    const Kind kind = Classify(n);
+    if (kind == Kind::kNone) continue;
+    const Edge* input = nullptr;
+    if (!n->input_edge(0, &input).ok()) continue;
+    const bool input_in_chain = input->src_output() == 0 &&
+                                kinds[input->src()->id()] != Kind::kNone;
+    if (!IsWindowOp(kind) && !input_in_chain) continue;
+    kinds[n->id()] = kind;
+    if (input_in_chain) {
+      parent[find(n->id())] = find(input->src()->id());
+    }
+  }
+  std::vector<int> window_ops(num_ids, 0);
+  for (Node* n : order) {
+    if (IsWindowOp(kinds[n->id()])) ++window_ops[find(n->id())];
+  }
+
+  replacement_.assign(num_ids, nullptr);
+  channels_.assign(num_ids, std::make_pair(nullptr, 0));
+  from_blocked_.assign(num_ids, nullptr);
+  to_blocked_.clear();
+
+  std::vector<Node*> rewritten;
+  for (Node* n : order) {
+    const Kind kind = kinds[n->id()];
+    if (kind == Kind::kNone ||
+        window_ops[find(n->id())] < kMinWindowOpsPerChain) {
+      continue;
+    }
+    Status s = RewriteNode(graph, n, kind);
+    if (!s.ok()) {
+      // Nodes already added for this one are left unused and pruned later.
+      LOG(WARNING) << "BlockedLayoutRewritePass: failed to rewrite "
+                   << n->name() << ": " << s;
+      replacement_[n->id()] = nullptr;
+      continue;
+    }
+    VLOG(1) << "BlockedLayoutRewritePass: rewrote " << n->name() << " ("
+            << n->type_string() << ") to "
+            << replacement_[n->id()]->type_string();
+    rewritten.push_back(n);
+  }
+  if (rewritten.empty()) return false;
+
+  // Route every use outside the chains through a conversion back to NHWC.
+  for (Node* n : rewritten) {
+    std::vector<const Edge*> out_edges(n->out_edges().begin(),
+                                       n->out_edges().end());
+    for (const Edge* e : out_edges) {
+      Node* dst = e->dst();
+      if (replacement_[dst->id()] != nullptr) {
+        // Data inputs of rewritten nodes were set up by RewriteNode.
+        if (e->IsControlEdge()) {
+          graph->AddControlEdge(replacement_[n->id()], replacement_[dst->id()]);
+        }
+        continue;
+      }
+      if (e->IsControlEdge()) {
+        graph->AddControlEdge(replacement_[n->id()], dst);
+        continue;
+      }
+      Node* converted;
+      TF_CHECK_OK(GetFromBlocked(graph, n, &converted));
+      const int dst_input = e->dst_input();
+      graph->RemoveEdge(e);
+      graph->AddEdge(converted, 0, dst, dst_input);
+    }
+  }
+  for (Node* n : rewritten) {
+    graph->RemoveNode(n);
+  }
+  return true;
+}
+
+bool RunBlockedLayoutRewritePass(std::unique_ptr<Graph>* g, int block_size) {
+  return BlockedLayoutRewritePass(block_size).RunPass(g);
+}
+
+Status BlockedLayoutRewritePass::Run(
+    const GraphOptimizationPassOptions& options) {
+  bool enabled;
+  TF_RETURN_IF_ERROR(
+      ReadBoolFromEnvVar("TF_ENABLE_BLOCKED_LAYOUT", false, &enabled));
+  if (!enabled || options.partition_graphs == nullptr) {
+    return Status::OK();
+  }
+  for (auto& pg : *options.partition_graphs) {
+    RunPass(&pg.second);
+  }
+  return Status::OK();
+}
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_PARTITIONING, 2,
+                      BlockedLayoutRewritePass);
+
+}  // namespace tensorflow
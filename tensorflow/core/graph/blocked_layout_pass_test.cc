@@ -0,0 +1,185 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/blocked_layout_pass.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const char kCPUDevice[] = "/job:a/replica:0/task:0/cpu:0";
+const char kGPUDevice[] = "/job:a/replica:0/task:0/gpu:0";
+
+class BlockedLayoutPassTest : public ::testing::Test {
+ public:
+  BlockedLayoutPassTest() : graph_(OpRegistry::Global()) {}
+
+  void InitGraph(const string& s, const string& device = kCPUDevice) {
+    GraphDef graph_def;
+    auto parser = protobuf::TextFormat::Parser();
+    CHECK(parser.MergeFromString(s, &graph_def)) << s;
+    GraphConstructorOptions opts;
+    TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &graph_));
+    for (Node* node : graph_.nodes()) {
+      node->set_assigned_device_name(device);
+    }
+    original_ = CanonicalGraphString(&graph_);
+  }
+
+  static bool IncludeNode(const Node* n) { return n->IsOp(); }
+
+  static string EdgeId(const Node* n, int index) {
+    if (index == 0) {
+      return n->name();
+    } else if (index == Graph::kControlSlot) {
+      return strings::StrCat(n->name(), ":control");
+    } else {
+      return strings::StrCat(n->name(), ":", index);
+    }
+  }
+
+  string CanonicalGraphString(Graph* g) {
+    std::vector<string> nodes;
+    std::vector<string> edges;
+    for (const Node* n : g->nodes()) {
+      if (IncludeNode(n)) {
+        nodes.push_back(strings::StrCat(n->name(), "(", n->type_string(), ")"));
+      }
+    }
+    for (const Edge* e : g->edges()) {
+      if (IncludeNode(e->src()) && IncludeNode(e->dst())) {
+        edges.push_back(strings::StrCat(EdgeId(e->src(), e->src_output()), "->",
+                                        EdgeId(e->dst(), e->dst_input())));
+      }
+    }
+    // Canonicalize
+    std::sort(nodes.begin(), nodes.end());
+    std::sort(edges.begin(), edges.end());
+    return strings::StrCat(str_util::Join(nodes, ";"), "|",
+                           str_util::Join(edges, ";"));
+  }
+
+  string DoBlockedLayoutPass() {
+    std::unique_ptr<Graph> ug(&graph_);
+    RunBlockedLayoutRewritePass(&ug, 8);
+    ug.release();
+    return CanonicalGraphString(&graph_);
+  }
+
+  const string& OriginalGraph() const { return original_; }
+
+  Graph graph_;
+  string original_;
+};
+
+REGISTER_OP("Input").Output("o: float").SetIsStateful();
+
+#define CONV2D(name, input, filter)                            \
+  "node { name: '" name "' op: 'Conv2D'"                       \
+  " attr { key: 'T' value { type: DT_FLOAT } }"                \
+  " attr { key: 'data_format' value { s: 'NHWC' } }"           \
+  " attr { key: 'use_cudnn_on_gpu' value { b: false } }"       \
+  " attr { key: 'strides' value { list: {i: [1,1,1,1]} } }"    \
+  " attr { key: 'padding' value { s: 'SAME' } }"               \
+  " input: ['" input "', '" filter "'] }"
+
+TEST_F(BlockedLayoutPassTest, ConvReluConv) {
+  InitGraph(
+      "node { name: 'A' op: 'Input'}"
+      "node { name: 'B' op: 'Input'}"
+      "node { name: 'C' op: 'Input'}" CONV2D("D", "A", "B")
+      "node { name: 'E' op: 'Relu' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['D'] }" CONV2D("F", "E", "C")
+      "node { name: 'G' op: 'Zeta' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['F', 'A'] }");
+  EXPECT_EQ(DoBlockedLayoutPass(),
+            "A(Input);A/_NHWCToNCHWc(_NHWCToNCHWc);B(Input);C(Input);"
+            "D(_NCHWcConv2D);E(Relu);F(_NCHWcConv2D);"
+            "F/_NCHWcToNHWC(_NCHWcToNHWC);G(Zeta)|"
+            "A->A/_NHWCToNCHWc;A->G:1;A/_NHWCToNCHWc->D;B->D:1;C->F:1;D->E;"
+            "E->F;F->F/_NCHWcToNHWC;F/_NCHWcToNHWC->G;"
+            "F:1->F/_NCHWcToNHWC:1");
+}
+
+// Tensors used both inside and outside the chain get one conversion each,
+// with the channel count taken from the last Conv2D before them.
+TEST_F(BlockedLayoutPassTest, ConvBiasAddMaxPoolWithSideOutput) {
+  InitGraph(
+      "node { name: 'A' op: 'Input'}"
+      "node { name: 'B' op: 'Input'}"
+      "node { name: 'C' op: 'Input'}" CONV2D("D", "A", "B")
+      "node { name: 'E' op: 'BiasAdd'"
+      " attr { key: 'T' value { type: DT_FLOAT } }"
+      " attr { key: 'data_format' value { s: 'NHWC' } }"
+      " input: ['D', 'C'] }"
+      "node { name: 'F' op: 'MaxPool'"
+      " attr { key: 'T' value { type: DT_FLOAT } }"
+      " attr { key: 'data_format' value { s: 'NHWC' } }"
+      " attr { key: 'ksize' value { list: {i: [1,2,2,1]} } }"
+      " attr { key: 'strides' value { list: {i: [1,2,2,1]} } }"
+      " attr { key: 'padding' value { s: 'VALID' } }"
+      " input: ['E'] }"
+      "node { name: 'G' op: 'Zeta' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['F', 'E'] }");
+  EXPECT_EQ(DoBlockedLayoutPass(),
+            "A(Input);A/_NHWCToNCHWc(_NHWCToNCHWc);B(Input);C(Input);"
+            "D(_NCHWcConv2D);E(_NCHWcBiasAdd);E/_NCHWcToNHWC(_NCHWcToNHWC);"
+            "F(_NCHWcMaxPool);F/_NCHWcToNHWC(_NCHWcToNHWC);G(Zeta)|"
+            "A->A/_NHWCToNCHWc;A/_NHWCToNCHWc->D;B->D:1;C->E:1;D->E;"
+            "D:1->E/_NCHWcToNHWC:1;D:1->F/_NCHWcToNHWC:1;E->E/_NCHWcToNHWC;"
+            "E->F;E/_NCHWcToNHWC->G:1;F->F/_NCHWcToNHWC;"
+            "F/_NCHWcToNHWC->G");
+}
+
+// A single Conv2D is not worth two layout conversions.
+TEST_F(BlockedLayoutPassTest, SingleConvIsNotRewritten) {
+  InitGraph(
+      "node { name: 'A' op: 'Input'}"
+      "node { name: 'B' op: 'Input'}" CONV2D("C", "A", "B")
+      "node { name: 'D' op: 'Relu' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['C'] }"
+      "node { name: 'E' op: 'Zeta' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['D', 'A'] }");
+  EXPECT_EQ(DoBlockedLayoutPass(), OriginalGraph());
+}
+
+TEST_F(BlockedLayoutPassTest, GpuChainIsNotRewritten) {
+  InitGraph(
+      "node { name: 'A' op: 'Input'}"
+      "node { name: 'B' op: 'Input'}"
+      "node { name: 'C' op: 'Input'}" CONV2D("D", "A", "B")
+          CONV2D("E", "D", "C")
+      "node { name: 'F' op: 'Zeta' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['E', 'A'] }",
+      kGPUDevice);
+  EXPECT_EQ(DoBlockedLayoutPass(), OriginalGraph());
+}
+
+#undef CONV2D
+
+}  // namespace
+}  // namespace tensorflow
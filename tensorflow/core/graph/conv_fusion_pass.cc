@@ -0,0 +1,249 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/conv_fusion_pass.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+// This pass replaces
+//
+//     A = Conv2D(X, F); B = BiasAdd(A, b); C = Relu(B)
+//
+// on the CPU with
+//
+//     C = _FusedConv2DWithBias(X, F, b, activation="Relu")
+//
+// whose kernel (in kernels/conv_ops_fused.cc) runs the same convolution as
+// Conv2D and then applies the bias and the activation in one pass over the
+// output, instead of two. Relu6 is fused the same way, and a
+// Conv2D -> BiasAdd pair without an activation becomes a fused node with
+// activation="Identity".
+//
+// A node is only fused into its consumer when that consumer is its sole user:
+// a Conv2D or BiasAdd output that is also used elsewhere (as it may be by
+// gradient computations) has to be materialized anyway, and the sequence is
+// left alone. This is the common case in inference graphs.
+//
+// The pass runs after the blocked layout pass, whose kernels replace these
+// ops when it is enabled. TF_ENABLE_CONV_FUSION=false turns it off. The fused
+// kernel always uses the Eigen convolution, so the pass also stands aside when
+// TF_USE_DEEP_CONV2D or TF_CPU_CONV_USE_AUTOTUNE asks Conv2D to pick another
+// algorithm.
+class ConvFusionPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override;
+
+  // Fuses the eligible sequences of 'g'. Returns true if and only if 'g' was
+  // mutated.
+  bool RunPass(std::unique_ptr<Graph>* g);
+
+ private:
+  // Returns true if 'n' may run on the CPU device.
+  static bool CanOpRunOnCPUDevice(const Node* n);
+
+  // Returns true if 'n' has a float "T" attr and, if it has a "data_format"
+  // attr, that attr is "NHWC".
+  static bool IsFloatNHWC(const Node* n);
+
+  // Returns the node consuming output 0 of 'n', if that is the only use of
+  // any output of 'n' and the consumer is placed with 'n'. Returns nullptr
+  // otherwise.
+  static Node* SoleConsumer(const Node* n);
+
+  // Replaces 'conv', 'bias_add' and (if not null) 'activation' by one
+  // _FusedConv2DWithBias node.
+  static Status Fuse(Graph* g, Node* conv, Node* bias_add, Node* activation);
+};
+
+bool ConvFusionPass::CanOpRunOnCPUDevice(const Node* n) {
+  // Substring that should be checked for in device name for CPU device.
+  const char* const kCPUDeviceSubStr = "cpu";
+  if (!n->assigned_device_name().empty() &&
+      !StringPiece(n->assigned_device_name()).contains(kCPUDeviceSubStr)) {
+    return false;
+  }
+  if (!n->def().device().empty() &&
+      !StringPiece(n->def().device()).contains(kCPUDeviceSubStr)) {
+    return false;
+  }
+  return true;
+}
+
+bool ConvFusionPass::IsFloatNHWC(const Node* n) {
+  DataType dtype;
+  if (!GetNodeAttr(n->attrs(), "T", &dtype).ok() || dtype != DT_FLOAT) {
+    return false;
+  }
+  string data_format;
+  return !GetNodeAttr(n->attrs(), "data_format", &data_format).ok() ||
+         data_format == "NHWC";
+}
+
+Node* ConvFusionPass::SoleConsumer(const Node* n) {
+  if (n->out_edges().size() != 1) return nullptr;
+  const Edge* e = *n->out_edges().begin();
+  if (e->IsControlEdge() || e->src_output() != 0 || e->dst_input() != 0) {
+    return nullptr;
+  }
+  Node* consumer = e->dst();
+  if (consumer->assigned_device_name() != n->assigned_device_name() ||
+      consumer->def().device() != n->def().device()) {
+    return nullptr;
+  }
+  return consumer;
+}
+
+Status ConvFusionPass::Fuse(Graph* g, Node* conv, Node* bias_add,
+                            Node* activation) {
+  const Edge* input;
+  const Edge* filter;
+  const Edge* bias;
+  TF_RETURN_IF_ERROR(conv->input_edge(0, &input));
+  TF_RETURN_IF_ERROR(conv->input_edge(1, &filter));
+  TF_RETURN_IF_ERROR(bias_add->input_edge(1, &bias));
+  std::vector<int32> strides;
+  TF_RETURN_IF_ERROR(GetNodeAttr(conv->attrs(), "strides", &strides));
+  string padding;
+  TF_RETURN_IF_ERROR(GetNodeAttr(conv->attrs(), "padding", &padding));
+
+  // The fused node takes over the name of the last node it replaces, so that
+  // it produces the tensor of the same name.
+  Node* last = activation != nullptr ? activation : bias_add;
+  Node* fused;
+  TF_RETURN_IF_ERROR(
+      NodeBuilder(last->name(), "_FusedConv2DWithBias")
+          .Input(input->src(), input->src_output())
+          .Input(filter->src(), filter->src_output())
+          .Input(bias->src(), bias->src_output())
+          .Attr("T", DT_FLOAT)
+          .Attr("strides", strides)
+          .Attr("padding", padding)
+          .Attr("activation",
+                activation != nullptr ? activation->type_string() : "Identity")
+          .Device(last->def().device())
+          .Finalize(g, &fused));
+  fused->set_assigned_device_name(last->assigned_device_name());
+
+  for (Node* n : {conv, bias_add, activation}) {
+    if (n == nullptr) continue;
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) g->AddControlEdge(e->src(), fused);
+    }
+  }
+  std::vector<const Edge*> out_edges(last->out_edges().begin(),
+                                     last->out_edges().end());
+  for (const Edge* e : out_edges) {
+    if (e->IsControlEdge()) {
+      g->AddControlEdge(fused, e->dst());
+    } else {
+      g->AddEdge(fused, e->src_output(), e->dst(), e->dst_input());
+    }
+    g->RemoveEdge(e);
+  }
+  if (activation != nullptr) g->RemoveNode(activation);
+  g->RemoveNode(bias_add);
+  g->RemoveNode(conv);
+  return Status::OK();
+}
+
+bool ConvFusionPass::RunPass(std::unique_ptr<Graph>* g) {
+  CHECK_NOTNULL(g);
+  Graph* graph = g->get();
+
+  struct Match {
+    Node* conv;
+    Node* bias_add;
+    Node* activation;
+  };
+  std::vector<Match> matches;
+  for (Node* n : graph->op_nodes()) {
+    if (n->type_string() != "Conv2D" || !IsFloatNHWC(n) ||
+        !CanOpRunOnCPUDevice(n)) {
+      continue;
+    }
+    std::vector<int32> strides;
+    if (!GetNodeAttr(n->attrs(), "strides", &strides).ok() ||
+        strides.size() != 4 || strides[0] != 1 || strides[3] != 1) {
+      continue;
+    }
+    Node* bias_add = SoleConsumer(n);
+    if (bias_add == nullptr || bias_add->type_string() != "BiasAdd" ||
+        !IsFloatNHWC(bias_add)) {
+      continue;
+    }
+    Node* activation = SoleConsumer(bias_add);
+    if (activation != nullptr &&
+        ((activation->type_string() != "Relu" &&
+          activation->type_string() != "Relu6") ||
+         !IsFloatNHWC(activation))) {
+      activation = nullptr;
+    }
+    matches.push_back({n, bias_add, activation});
+  }
+
+  bool changed = false;
+  for (const Match& m : matches) {
+    const string name = m.conv->name();
+    Status s = Fuse(graph, m.conv, m.bias_add, m.activation);
+    if (!s.ok()) {
+      LOG(WARNING) << "ConvFusionPass: failed to fuse " << name << ": " << s;
+      continue;
+    }
+    VLOG(1) << "ConvFusionPass: fused " << name;
+    changed = true;
+  }
+  return changed;
+}
+
+bool RunConvFusionPass(std::unique_ptr<Graph>* g) {
+  return ConvFusionPass().RunPass(g);
+}
+
+Status ConvFusionPass::Run(const GraphOptimizationPassOptions& options) {
+  bool enabled;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_ENABLE_CONV_FUSION", true,
+                                        &enabled));
+  bool use_deep_conv;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_USE_DEEP_CONV2D", false,
+                                        &use_deep_conv));
+  bool use_cpu_autotune;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CPU_CONV_USE_AUTOTUNE", false,
+                                        &use_cpu_autotune));
+  if (!enabled || use_deep_conv || use_cpu_autotune ||
+      options.partition_graphs == nullptr) {
+    return Status::OK();
+  }
+  for (auto& pg : *options.partition_graphs) {
+    RunPass(&pg.second);
+  }
+  return Status::OK();
+}
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_PARTITIONING, 3,
+                      ConvFusionPass);
+
+}  // namespace tensorflow
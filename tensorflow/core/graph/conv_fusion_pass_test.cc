@@ -0,0 +1,215 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/conv_fusion_pass.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const char kCPUDevice[] = "/job:a/replica:0/task:0/cpu:0";
+const char kGPUDevice[] = "/job:a/replica:0/task:0/gpu:0";
+
+class ConvFusionPassTest : public ::testing::Test {
+ public:
+  ConvFusionPassTest() : graph_(OpRegistry::Global()) {}
+
+  void InitGraph(const string& s, const string& device = kCPUDevice) {
+    GraphDef graph_def;
+    auto parser = protobuf::TextFormat::Parser();
+    CHECK(parser.MergeFromString(s, &graph_def)) << s;
+    GraphConstructorOptions opts;
+    TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &graph_));
+    for (Node* node : graph_.nodes()) {
+      node->set_assigned_device_name(device);
+    }
+    original_ = CanonicalGraphString(&graph_);
+  }
+
+  static bool IncludeNode(const Node* n) { return n->IsOp(); }
+
+  static string EdgeId(const Node* n, int index) {
+    if (index == 0) {
+      return n->name();
+    } else if (index == Graph::kControlSlot) {
+      return strings::StrCat(n->name(), ":control");
+    } else {
+      return strings::StrCat(n->name(), ":", index);
+    }
+  }
+
+  string CanonicalGraphString(Graph* g) {
+    std::vector<string> nodes;
+    std::vector<string> edges;
+    for (const Node* n : g->nodes()) {
+      if (IncludeNode(n)) {
+        nodes.push_back(strings::StrCat(n->name(), "(", n->type_string(), ")"));
+      }
+    }
+    for (const Edge* e : g->edges()) {
+      if (IncludeNode(e->src()) && IncludeNode(e->dst())) {
+        edges.push_back(strings::StrCat(EdgeId(e->src(), e->src_output()), "->",
+                                        EdgeId(e->dst(), e->dst_input())));
+      }
+    }
+    // Canonicalize
+    std::sort(nodes.begin(), nodes.end());
+    std::sort(edges.begin(), edges.end());
+    return strings::StrCat(str_util::Join(nodes, ";"), "|",
+                           str_util::Join(edges, ";"));
+  }
+
+  string DoConvFusionPass() {
+    std::unique_ptr<Graph> ug(&graph_);
+    RunConvFusionPass(&ug);
+    ug.release();
+    return CanonicalGraphString(&graph_);
+  }
+
+  const string& OriginalGraph() const { return original_; }
+
+  string ActivationOf(const string& name) {
+    for (const Node* n : graph_.op_nodes()) {
+      if (n->name() == name) {
+        string activation;
+        TF_CHECK_OK(GetNodeAttr(n->attrs(), "activation", &activation));
+        return activation;
+      }
+    }
+    return "";
+  }
+
+  Graph graph_;
+  string original_;
+};
+
+REGISTER_OP("Input").Output("o: float").SetIsStateful();
+
+#define CONV2D(name, input, filter)                            \
+  "node { name: '" name "' op: 'Conv2D'"                       \
+  " attr { key: 'T' value { type: DT_FLOAT } }"                \
+  " attr { key: 'data_format' value { s: 'NHWC' } }"           \
+  " attr { key: 'use_cudnn_on_gpu' value { b: false } }"       \
+  " attr { key: 'strides' value { list: {i: [1,1,1,1]} } }"    \
+  " attr { key: 'padding' value { s: 'SAME' } }"               \
+  " input: ['" input "', '" filter "'] }"
+
+#define BIASADD(name, value, bias)                             \
+  "node { name: '" name "' op: 'BiasAdd'"                      \
+  " attr { key: 'T' value { type: DT_FLOAT } }"                \
+  " attr { key: 'data_format' value { s: 'NHWC' } }"           \
+  " input: ['" value "', '" bias "'] }"
+
+#define UNARY(name, op, input)                                         \
+  "node { name: '" name "' op: '" op "'"                               \
+  " attr { key: 'T' value { type: DT_FLOAT } } input: ['" input "'] }"
+
+#define ZETA(name, x, q)                                                    \
+  "node { name: '" name "' op: 'Zeta'"                                      \
+  " attr { key: 'T' value { type: DT_FLOAT } } input: ['" x "', '" q "'] }"
+
+#define INPUTS                                                 \
+  "node { name: 'A' op: 'Input'}"                              \
+  "node { name: 'B' op: 'Input'}"                              \
+  "node { name: 'C' op: 'Input'}"
+
+TEST_F(ConvFusionPassTest, ConvBiasAddRelu) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Relu", "E") ZETA("G", "F", "A"));
+  EXPECT_EQ(DoConvFusionPass(),
+            "A(Input);B(Input);C(Input);F(_FusedConv2DWithBias);G(Zeta)|"
+            "A->F;A->G:1;B->F:1;C->F:2;F->G");
+  EXPECT_EQ("Relu", ActivationOf("F"));
+}
+
+TEST_F(ConvFusionPassTest, ConvBiasAddRelu6) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Relu6", "E") ZETA("G", "F", "A"));
+  EXPECT_EQ(DoConvFusionPass(),
+            "A(Input);B(Input);C(Input);F(_FusedConv2DWithBias);G(Zeta)|"
+            "A->F;A->G:1;B->F:1;C->F:2;F->G");
+  EXPECT_EQ("Relu6", ActivationOf("F"));
+}
+
+TEST_F(ConvFusionPassTest, ConvBiasAddWithoutActivation) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Tanh", "E") ZETA("G", "F", "A"));
+  EXPECT_EQ(DoConvFusionPass(),
+            "A(Input);B(Input);C(Input);E(_FusedConv2DWithBias);F(Tanh);"
+            "G(Zeta)|A->E;A->G:1;B->E:1;C->E:2;E->F;F->G");
+  EXPECT_EQ("Identity", ActivationOf("E"));
+}
+
+// A bias-add output that is used elsewhere is still computed by the fused
+// node, but the activation stays separate.
+TEST_F(ConvFusionPassTest, BiasAddWithOtherUses) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Relu", "E") ZETA("G", "F", "E"));
+  EXPECT_EQ(DoConvFusionPass(),
+            "A(Input);B(Input);C(Input);E(_FusedConv2DWithBias);F(Relu);"
+            "G(Zeta)|A->E;B->E:1;C->E:2;E->F;E->G:1;F->G");
+  EXPECT_EQ("Identity", ActivationOf("E"));
+}
+
+TEST_F(ConvFusionPassTest, ConvWithOtherUsesIsNotFused) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Relu", "E") ZETA("G", "F", "D"));
+  EXPECT_EQ(DoConvFusionPass(), OriginalGraph());
+}
+
+TEST_F(ConvFusionPassTest, ControlEdgesAreKept) {
+  InitGraph(INPUTS
+            "node { name: 'H' op: 'Input'}" CONV2D("D", "A", "B")
+            "node { name: 'E' op: 'BiasAdd'"
+            " attr { key: 'T' value { type: DT_FLOAT } }"
+            " attr { key: 'data_format' value { s: 'NHWC' } }"
+            " input: ['D', 'C', '^H'] }" UNARY("F", "Relu", "E")
+            "node { name: 'G' op: 'Zeta'"
+            " attr { key: 'T' value { type: DT_FLOAT } }"
+            " input: ['A', 'A', '^F'] }");
+  EXPECT_EQ(DoConvFusionPass(),
+            "A(Input);B(Input);C(Input);F(_FusedConv2DWithBias);G(Zeta);"
+            "H(Input)|A->F;A->G;A->G:1;B->F:1;C->F:2;F:control->G:control;"
+            "H:control->F:control");
+}
+
+TEST_F(ConvFusionPassTest, GpuConvIsNotFused) {
+  InitGraph(INPUTS CONV2D("D", "A", "B") BIASADD("E", "D", "C")
+                UNARY("F", "Relu", "E") ZETA("G", "F", "A"),
+            kGPUDevice);
+  EXPECT_EQ(DoConvFusionPass(), OriginalGraph());
+}
+
+#undef INPUTS
+#undef ZETA
+#undef UNARY
+#undef BIASADD
+#undef CONV2D
+
+}  // namespace
+}  // namespace tensorflow
@@ -89,6 +89,7 @@ class ConcatBaseOp : public OpKernel {
       inputs_flat_dim0 *= input_shape.dim_size(d);
     }
     int64 output_concat_dim = 0;
+    int non_empty_input = -1;
     const bool input_is_scalar = IsLegacyScalar(input_shape);
     for (int i = 0; i < N; ++i) {
       const auto in = values[i];
@@ -114,6 +115,7 @@ class ConcatBaseOp : public OpKernel {
         int64 inputs_flat_dim1 = in.NumElements() / inputs_flat_dim0;
         inputs_flat.emplace_back(new typename TTypes<T, 2>::ConstMatrix(
             in.shaped<T, 2>({inputs_flat_dim0, inputs_flat_dim1})));
+        non_empty_input = i;
       }
       // TODO(irving): Remove check once !allow_legacy_scalars().
       output_concat_dim += in.dims() > 0 ? in.dim_size(axis) : 1;
@@ -126,6 +128,14 @@ class ConcatBaseOp : public OpKernel {
     } else {
       output_shape.set_dim(axis, output_concat_dim);
     }
+    // If all the other inputs are empty, the output shares the buffer of the
+    // remaining one.
+    if (inputs_flat.size() == 1) {
+      Tensor output;
+      CHECK(output.CopyFrom(values[non_empty_input], output_shape));
+      c->set_output(0, output);
+      return;
+    }
     Tensor* output = nullptr;
     OP_REQUIRES_OK(c, c->allocate_output(0, output_shape, &output));
     if (output->NumElements() > 0) {
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/kernels/conv_2d.h"
+#include "tensorflow/core/kernels/deep_conv2d.h"
 #ifdef TENSORFLOW_USE_LIBXSMM
 #include "tensorflow/core/kernels/xsmm_conv2d.h"
 #endif
@@ -38,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
 #include "tensorflow/core/util/use_cudnn.h"
@@ -190,6 +192,81 @@ struct LaunchXsmmBackwardInputConvolution<CPUDevice, float> {
 };
 #endif
 
+// Computes the input gradient of a stride 1 convolution with DeepConv2D.
+// The input gradient is the forward convolution of 'out_backprop' with the
+// spatially reversed filter, whose in_depth and out_depth are swapped:
+//
+//   in_backprop[r, c, i] = sum_{fr, fc, o}
+//       out_backprop[r - pad_r + fr, c - pad_c + fc, o] *
+//       filter[filter_rows - 1 - fr, filter_cols - 1 - fc, i, o]
+//
+// where pad_r = filter_rows - 1 - pad_top (and likewise for columns).
+// The reversed filter is written to 'reversed_filter', which is allocated
+// if it does not hold a tensor of the right shape yet, so that callers can
+// keep it across calls. Returns false if DeepConv2D is not used for the
+// resulting convolution.
+template <typename Device, class T>
+struct LaunchDeepConvBackpropInput {
+  static bool Run(OpKernelContext* ctx, const Tensor& filter,
+                  const Tensor& out_backprop,
+                  const ConvBackpropDimensions& dims, int64 pad_top,
+                  int64 pad_left, PersistentTensor* reversed_filter,
+                  Tensor* in_backprop) {
+    return false;
+  }
+};
+
+template <>
+struct LaunchDeepConvBackpropInput<CPUDevice, float> {
+  static bool Run(OpKernelContext* ctx, const Tensor& filter,
+                  const Tensor& out_backprop,
+                  const ConvBackpropDimensions& dims, int64 pad_top,
+                  int64 pad_left, PersistentTensor* reversed_filter,
+                  Tensor* in_backprop) {
+    const ConvBackpropSpatialDimension& rows = dims.spatial_dims[0];
+    const ConvBackpropSpatialDimension& cols = dims.spatial_dims[1];
+    if (!CanUseDeepConv2D(rows.stride, cols.stride, rows.filter_size,
+                          cols.filter_size, dims.out_depth, dims.in_depth,
+                          rows.input_size, cols.input_size)) {
+      return false;
+    }
+
+    // Reversed filter: [filter_rows, filter_cols, out_depth, in_depth].
+    const TensorShape reversed_shape(
+        {rows.filter_size, cols.filter_size, dims.out_depth, dims.in_depth});
+    Tensor* reversed = reversed_filter->AccessTensor(ctx);
+    if (reversed == nullptr || reversed->shape() != reversed_shape) {
+      if (!ctx->allocate_persistent(DT_FLOAT, reversed_shape, reversed_filter,
+                                    &reversed)
+               .ok()) {
+        return false;
+      }
+    }
+    Eigen::array<bool, 4> reverse_dims = {{true, true, false, false}};
+    Eigen::array<int, 4> shuffle = {{0, 1, 3, 2}};
+    reversed->tensor<float, 4>().device(ctx->eigen_device<CPUDevice>()) =
+        filter.tensor<float, 4>().reverse(reverse_dims).shuffle(shuffle);
+
+    Conv2DArgs args;
+    args.batch = dims.batch_size;
+    args.in_rows = rows.output_size;
+    args.in_cols = cols.output_size;
+    args.in_depth = dims.out_depth;
+    args.filter_rows = rows.filter_size;
+    args.filter_cols = cols.filter_size;
+    args.pad_rows = rows.filter_size - 1 - pad_top;
+    args.pad_cols = cols.filter_size - 1 - pad_left;
+    args.out_rows = rows.input_size;
+    args.out_cols = cols.input_size;
+    args.out_depth = dims.in_depth;
+
+    functor::DeepConv2D<CPUDevice, float>()(
+        ctx, args, out_backprop.flat<float>().data(),
+        reversed->flat<float>().data(), in_backprop->flat<float>().data());
+    return true;
+  }
+};
+
 template <typename Device, class T>
 class Conv2DFastBackpropInputOp : public OpKernel {
  public:
@@ -379,6 +456,23 @@ class Conv2DCustomBackpropInputOp : public OpKernel {
             dims.spatial_dims[1].stride, padding_,
             &dims.spatial_dims[1].output_size, &pad_left, &pad_right));
 
+    // Steps that run this kernel concurrently cannot share the reversed
+    // filter, so only one of them uses the kept one and the others allocate
+    // their own.
+    bool used_deep_conv;
+    if (reversed_filter_mu_.try_lock()) {
+      used_deep_conv = LaunchDeepConvBackpropInput<Device, T>::Run(
+          context, filter, out_backprop, dims, pad_top, pad_left,
+          &reversed_filter_, in_backprop);
+      reversed_filter_mu_.unlock();
+    } else {
+      PersistentTensor reversed_filter;
+      used_deep_conv = LaunchDeepConvBackpropInput<Device, T>::Run(
+          context, filter, out_backprop, dims, pad_top, pad_left,
+          &reversed_filter, in_backprop);
+    }
+    if (used_deep_conv) return;
+
     // The total dimension size of each kernel.
     const int filter_total_size = dims.spatial_dims[0].filter_size *
                                   dims.spatial_dims[1].filter_size *
@@ -539,6 +633,10 @@ class Conv2DCustomBackpropInputOp : public OpKernel {
   Padding padding_;
   TensorFormat data_format_;
 
+  // Reversed filter for DeepConv2D, reallocated only when its shape changes.
+  mutex reversed_filter_mu_;
+  PersistentTensor reversed_filter_ GUARDED_BY(reversed_filter_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(Conv2DCustomBackpropInputOp);
 };
 
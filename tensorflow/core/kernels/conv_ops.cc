@@ -21,7 +21,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/conv_ops.h"
 #include <string.h>
 #include <map>
+#include <type_traits>
 #include <vector>
+#include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/numeric_op.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -30,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/conv_2d.h"
+#include "tensorflow/core/kernels/conv_ops_cpu_autotune.h"
 #include "tensorflow/core/kernels/deep_conv2d.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #ifdef TENSORFLOW_USE_LIBXSMM
@@ -39,8 +42,11 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
 #include "tensorflow/core/util/use_cudnn.h"
@@ -140,6 +146,15 @@ class LaunchDeepConvOp {
                   Tensor* output, TensorFormat data_format) {
     return false;
   }
+  static bool Launch(OpKernelContext* ctx, const Tensor& input,
+                     const Tensor& filter, int batch, int input_rows,
+                     int input_cols, int in_depth, int filter_rows,
+                     int filter_cols, int pad_rows, int pad_cols,
+                     int out_rows, int out_cols, int out_depth,
+                     int stride_rows, int stride_cols, Tensor* output,
+                     TensorFormat data_format) {
+    return false;
+  }
 };
 
 // Conditionally launches DeepConv operation based on convolution parameters.
@@ -157,6 +172,26 @@ class LaunchDeepConvOp<CPUDevice, float> {
                           in_depth, out_depth, out_rows, out_cols)) {
       return false;
     }
+    return Launch(ctx, input, filter, batch, input_rows, input_cols, in_depth,
+                  filter_rows, filter_cols, pad_rows, pad_cols, out_rows,
+                  out_cols, out_depth, stride_rows, stride_cols, output,
+                  data_format);
+  }
+
+  // Launches DeepConv2D whenever it supports the convolution, without
+  // consulting its cost model. Used when the cost is measured instead.
+  static bool Launch(OpKernelContext* ctx, const Tensor& input,
+                     const Tensor& filter, int batch, int input_rows,
+                     int input_cols, int in_depth, int filter_rows,
+                     int filter_cols, int pad_rows, int pad_cols,
+                     int out_rows, int out_cols, int out_depth,
+                     int stride_rows, int stride_cols, Tensor* output,
+                     TensorFormat data_format) {
+    if (data_format != FORMAT_NHWC ||
+        !DeepConv2DSupports(stride_rows, stride_cols, filter_rows,
+                            filter_cols)) {
+      return false;
+    }
 
     Conv2DArgs args;
     args.batch = batch;
@@ -250,6 +285,11 @@ class LaunchXsmmConvOp<CPUDevice, float> {
 };
 #endif
 
+// Number of times each candidate runs when a Conv2D shape is autotuned on CPU.
+// The fastest run counts, so that one-time costs such as libxsmm code
+// generation or first-touch page faults in the scratch buffer do not decide.
+static const int kCpuConvAutotuneRuns = 2;
+
 template <typename Device, typename T>
 class Conv2DOp : public BinaryOp<T> {
  public:
@@ -262,6 +302,8 @@ class Conv2DOp : public BinaryOp<T> {
     OP_REQUIRES_OK(context, context->GetAttr("use_cudnn_on_gpu", &use_cudnn_));
     use_cudnn_ &= CanUseCudnn();
     cudnn_use_autotune_ = CudnnUseAutotune();
+    cpu_use_autotune_ =
+        std::is_same<Device, CPUDevice>::value && CpuConvUseAutotune();
     OP_REQUIRES(context, strides_.size() == 4,
                 errors::InvalidArgument("Sliding window strides field must "
                                         "specify 4 dimensions"));
@@ -371,6 +413,27 @@ class Conv2DOp : public BinaryOp<T> {
       return;
     }
 
+    if (cpu_use_autotune_) {
+      CpuConvParameters params;
+      params.batch = batch;
+      params.in_rows = input_rows;
+      params.in_cols = input_cols;
+      params.in_depth = in_depth;
+      params.filter_rows = filter_rows;
+      params.filter_cols = filter_cols;
+      params.out_depth = out_depth;
+      params.stride_rows = stride_rows;
+      params.stride_cols = stride_cols;
+      params.pad_rows = pad_rows;
+      params.pad_cols = pad_cols;
+      params.num_threads =
+          context->device()->tensorflow_cpu_worker_threads()->num_threads;
+      params.dtype = DataTypeToEnum<T>::v();
+      LaunchCpuAutotuned(context, input, filter, params, out_rows, out_cols,
+                         output);
+      return;
+    }
+
 #ifdef TENSORFLOW_USE_LIBXSMM
     if (LaunchXsmmConvOp<Device, T>::Run(
             context, input, filter, batch, input_rows, input_cols, in_depth,
@@ -393,12 +456,104 @@ class Conv2DOp : public BinaryOp<T> {
   }
 
  private:
+  // Runs 'algorithm' on the convolution described by 'params'. Returns false
+  // if the algorithm does not support it, in which case 'output' is untouched.
+  bool LaunchCpuAlgorithm(OpKernelContext* context, CpuConvAlgorithm algorithm,
+                          const Tensor& input, const Tensor& filter,
+                          const CpuConvParameters& p, int out_rows,
+                          int out_cols, Tensor* output) {
+    switch (algorithm) {
+      case CpuConvAlgorithm::kXsmm:
+#ifdef TENSORFLOW_USE_LIBXSMM
+        return LaunchXsmmConvOp<Device, T>::Run(
+            context, input, filter, p.batch, p.in_rows, p.in_cols, p.in_depth,
+            p.filter_rows, p.filter_cols, p.pad_rows, p.pad_cols, out_rows,
+            out_cols, p.out_depth, p.stride_rows, p.stride_cols, output,
+            data_format_);
+#else
+        return false;
+#endif
+      case CpuConvAlgorithm::kDeepConv:
+        return LaunchDeepConvOp<Device, T>::Launch(
+            context, input, filter, p.batch, p.in_rows, p.in_cols, p.in_depth,
+            p.filter_rows, p.filter_cols, p.pad_rows, p.pad_cols, out_rows,
+            out_cols, p.out_depth, p.stride_rows, p.stride_cols, output,
+            data_format_);
+      case CpuConvAlgorithm::kEigen:
+        launcher_.launch(context, use_cudnn_, cudnn_use_autotune_, input,
+                         filter, p.stride_rows, p.stride_cols,
+                         BrainPadding2EigenPadding(padding_), output,
+                         data_format_);
+        return true;
+    }
+    return false;
+  }
+
+  // Runs the algorithm that was fastest for this shape and thread count. The
+  // first time a shape is seen, every supported algorithm is timed and the
+  // winner is recorded in CpuConvAutoTuneMap::Global().
+  void LaunchCpuAutotuned(OpKernelContext* context, const Tensor& input,
+                          const Tensor& filter, const CpuConvParameters& params,
+                          int out_rows, int out_cols, Tensor* output) {
+    CpuConvAutoTuneMap* autotune_map = CpuConvAutoTuneMap::Global();
+    CpuConvAlgorithm algorithm;
+    if (autotune_map->Find(params, &algorithm)) {
+      // An entry loaded from a file may name an algorithm this build lacks.
+      if (!LaunchCpuAlgorithm(context, algorithm, input, filter, params,
+                              out_rows, out_cols, output)) {
+        LaunchCpuAlgorithm(context, CpuConvAlgorithm::kEigen, input, filter,
+                           params, out_rows, out_cols, output);
+      }
+      return;
+    }
+
+    // Candidates are timed into a scratch buffer so that the output is
+    // written exactly once, by the winner.
+    Tensor scratch;
+    OP_REQUIRES_OK(context, context->allocate_temp(DataTypeToEnum<T>::value,
+                                                   output->shape(), &scratch));
+    port::Tracing::TraceMe trace_me(this->name(), "cpu_conv_autotune");
+    Env* env = Env::Default();
+    string summary =
+        strings::StrCat("Conv2D autotune ", params.ToString(), ":");
+    CpuConvAlgorithm best_algorithm = CpuConvAlgorithm::kEigen;
+    uint64 best_micros = kuint64max;
+    for (CpuConvAlgorithm candidate :
+         {CpuConvAlgorithm::kXsmm, CpuConvAlgorithm::kDeepConv,
+          CpuConvAlgorithm::kEigen}) {
+      uint64 candidate_micros = kuint64max;
+      bool supported = true;
+      for (int run = 0; run < kCpuConvAutotuneRuns && supported; ++run) {
+        const uint64 start = env->NowMicros();
+        supported = LaunchCpuAlgorithm(context, candidate, input, filter,
+                                       params, out_rows, out_cols, &scratch);
+        if (!context->status().ok()) return;
+        candidate_micros = std::min(candidate_micros, env->NowMicros() - start);
+      }
+      if (!supported) continue;
+      strings::StrAppend(&summary, " ", CpuConvAlgorithmName(candidate), "=",
+                         candidate_micros, "us");
+      if (candidate_micros < best_micros) {
+        best_micros = candidate_micros;
+        best_algorithm = candidate;
+      }
+    }
+    VLOG(1) << this->name() << " on " << context->device()->attributes().name()
+            << ": " << summary << " -> "
+            << CpuConvAlgorithmName(best_algorithm);
+
+    autotune_map->Insert(params, best_algorithm);
+    LaunchCpuAlgorithm(context, best_algorithm, input, filter, params,
+                       out_rows, out_cols, output);
+  }
+
   std::vector<int32> strides_;
   bool use_cudnn_;
   Padding padding_;
   TensorFormat data_format_;
   LaunchConv2DOp<Device, T> launcher_;
   bool cudnn_use_autotune_;
+  bool cpu_use_autotune_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(Conv2DOp);
 };
@@ -0,0 +1,159 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/conv_ops_cpu_autotune.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+const char* CpuConvAlgorithmName(CpuConvAlgorithm algorithm) {
+  switch (algorithm) {
+    case CpuConvAlgorithm::kEigen:
+      return "eigen";
+    case CpuConvAlgorithm::kDeepConv:
+      return "deep_conv";
+    case CpuConvAlgorithm::kXsmm:
+      return "xsmm";
+  }
+  return "unknown";
+}
+
+bool CpuConvAlgorithmFromName(StringPiece name, CpuConvAlgorithm* algorithm) {
+  for (CpuConvAlgorithm candidate :
+       {CpuConvAlgorithm::kEigen, CpuConvAlgorithm::kDeepConv,
+        CpuConvAlgorithm::kXsmm}) {
+    if (name == CpuConvAlgorithmName(candidate)) {
+      *algorithm = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CpuConvUseAutotune() {
+  bool value;
+  Status status = ReadBoolFromEnvVar("TF_CPU_CONV_USE_AUTOTUNE", false, &value);
+  if (!status.ok()) {
+    LOG(ERROR) << status.error_message();
+  }
+  return value;
+}
+
+string CpuConvParameters::ToString() const {
+  return strings::StrCat(
+      DataTypeString(dtype), "/n", batch, "/in", in_rows, "x", in_cols, "x",
+      in_depth, "/f", filter_rows, "x", filter_cols, "x", out_depth, "/s",
+      stride_rows, "x", stride_cols, "/p", pad_rows, "x", pad_cols, "/t",
+      num_threads);
+}
+
+CpuConvAutoTuneMap::CpuConvAutoTuneMap(const string& cache_file)
+    : cache_file_(cache_file) {
+  if (!cache_file_.empty()) {
+    Load();
+  }
+}
+
+CpuConvAutoTuneMap* CpuConvAutoTuneMap::Global() {
+  static CpuConvAutoTuneMap* instance = [] {
+    const char* cache_file = getenv("TF_CPU_CONV_AUTOTUNE_FILE");
+    return new CpuConvAutoTuneMap(cache_file == nullptr ? "" : cache_file);
+  }();
+  return instance;
+}
+
+bool CpuConvAutoTuneMap::Find(const CpuConvParameters& params,
+                              CpuConvAlgorithm* algorithm) const {
+  const string key = params.ToString();
+  mutex_lock lock(mu_);
+  auto iter = algorithms_.find(key);
+  if (iter == algorithms_.end()) {
+    return false;
+  }
+  *algorithm = iter->second;
+  return true;
+}
+
+void CpuConvAutoTuneMap::Insert(const CpuConvParameters& params,
+                                CpuConvAlgorithm algorithm) {
+  const string key = params.ToString();
+  mutex_lock lock(mu_);
+  if (!algorithms_.insert(std::make_pair(key, algorithm)).second) {
+    return;
+  }
+  VLOG(1) << "cpu_conv_autotune_map accepts " << key << " -> "
+          << CpuConvAlgorithmName(algorithm);
+  if (cache_file_.empty()) {
+    return;
+  }
+  // Appending under the lock keeps the lines of concurrent inserts whole. A
+  // failure to persist only costs a re-tune in the next process.
+  std::unique_ptr<WritableFile> file;
+  Status s = Env::Default()->NewAppendableFile(cache_file_, &file);
+  if (s.ok()) {
+    s = file->Append(
+        strings::StrCat(key, " ", CpuConvAlgorithmName(algorithm), "\n"));
+  }
+  if (s.ok()) {
+    s = file->Close();
+  }
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to append to CPU conv autotune file "
+                 << cache_file_ << ": " << s;
+  }
+}
+
+void CpuConvAutoTuneMap::Load() {
+  Env* env = Env::Default();
+  if (!env->FileExists(cache_file_).ok()) {
+    return;
+  }
+  string contents;
+  Status s = ReadFileToString(env, cache_file_, &contents);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to read CPU conv autotune file " << cache_file_
+                 << ": " << s;
+    return;
+  }
+  mutex_lock lock(mu_);
+  for (const string& line : str_util::Split(contents, '\n')) {
+    const std::vector<string> fields =
+        str_util::Split(line, ' ', str_util::SkipEmpty());
+    CpuConvAlgorithm algorithm;
+    if (fields.size() != 2 ||
+        !CpuConvAlgorithmFromName(fields[1], &algorithm)) {
+      if (!line.empty()) {
+        LOG(WARNING) << "Ignoring malformed CPU conv autotune entry: " << line;
+      }
+      continue;
+    }
+    // As with Insert, the first entry for a key wins.
+    algorithms_.insert(std::make_pair(fields[0], algorithm));
+  }
+  VLOG(1) << "Loaded " << algorithms_.size()
+          << " CPU conv autotune entries from " << cache_file_;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,103 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_CONV_OPS_CPU_AUTOTUNE_H_
+#define TENSORFLOW_CORE_KERNELS_CONV_OPS_CPU_AUTOTUNE_H_
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// The CPU implementations Conv2DOp can choose between.
+enum class CpuConvAlgorithm {
+  kEigen = 0,     // Eigen::SpatialConvolution.
+  kDeepConv = 1,  // DeepConv2D (Winograd), see deep_conv2d.h.
+  kXsmm = 2,      // libxsmm direct convolution, see xsmm_conv2d.h.
+};
+
+// Returns a short, stable name for 'algorithm' ("eigen", "deep_conv", "xsmm").
+const char* CpuConvAlgorithmName(CpuConvAlgorithm algorithm);
+
+// Parses a name returned by CpuConvAlgorithmName. Returns false if 'name' is
+// not recognized.
+bool CpuConvAlgorithmFromName(StringPiece name, CpuConvAlgorithm* algorithm);
+
+// Returns true if Conv2DOp<CPUDevice> should time its candidate algorithms the
+// first time it sees a shape instead of using the static selection rules.
+// Controlled by the TF_CPU_CONV_USE_AUTOTUNE environment variable (default
+// off).
+bool CpuConvUseAutotune();
+
+// Everything the relative speed of the CPU convolution algorithms depends on.
+struct CpuConvParameters {
+  int batch;
+  int in_rows;
+  int in_cols;
+  int in_depth;
+  int filter_rows;
+  int filter_cols;
+  int out_depth;
+  int stride_rows;
+  int stride_cols;
+  int pad_rows;
+  int pad_cols;
+  int num_threads;
+  DataType dtype;
+
+  // Returns the key used in CpuConvAutoTuneMap and in its cache file. The
+  // key contains no whitespace.
+  string ToString() const;
+};
+
+// A process-wide table of the fastest CPU convolution algorithm per
+// CpuConvParameters. The first decision for a key wins; later inserts for the
+// same key are ignored so that concurrent first runs agree.
+//
+// If the TF_CPU_CONV_AUTOTUNE_FILE environment variable names a file, the
+// global table is seeded from it on first use and every new decision is
+// appended to it, one "<key> <algorithm name>" line per decision, so that the
+// timing cost is paid once per machine rather than once per process.
+class CpuConvAutoTuneMap {
+ public:
+  // 'cache_file' may be empty, in which case nothing is persisted.
+  explicit CpuConvAutoTuneMap(const string& cache_file);
+
+  // Returns the table shared by all Conv2D kernels in this process.
+  static CpuConvAutoTuneMap* Global();
+
+  bool Find(const CpuConvParameters& params,
+            CpuConvAlgorithm* algorithm) const;
+  void Insert(const CpuConvParameters& params, CpuConvAlgorithm algorithm);
+
+ private:
+  void Load();
+
+  const string cache_file_;
+  mutable mutex mu_;
+  std::unordered_map<string, CpuConvAlgorithm> algorithms_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CpuConvAutoTuneMap);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_CONV_OPS_CPU_AUTOTUNE_H_
@@ -33,10 +33,12 @@ limitations under the License.
 #include "tensorflow/core/kernels/conv_ops.h"
 #include "tensorflow/core/kernels/gemm_functors.h"
 #include "tensorflow/core/kernels/image_resizer_state.h"
+#include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/util/mirror_pad_mode.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -55,6 +57,10 @@ const size_t kMaxChunkSize = (16 * 1024 * 1024);
 #endif
 const size_t kResizeCacheSize = (8 * 1024 * 1024);
 
+// _FusedConv2DWithBias shards its epilogue in blocks of whole output pixels
+// of roughly this many bytes.
+const int64 kBiasConvBlockSize = (256 * 1024);
+
 // Lookup method used when resizing.
 enum SamplingMode {
   BILINEAR = 0,
@@ -886,4 +892,167 @@ TF_CALL_float(REGISTER_FUSED);
 
 TF_CALL_float(REGISTER_PAD_ONLY_FUSED);
 
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+// Extern template instantiated in conv_ops.cc.
+extern template class LaunchConv2DOp<CPUDevice, float>;
+
+// Implements _FusedConv2DWithBias, which computes
+// activation(conv(input, filter) + bias).
+//
+// The convolution itself is the one Conv2D uses on the CPU. The bias and
+// activation are then applied in parallel to blocks of the output, in a single
+// pass instead of the two full passes over the activations that separate
+// BiasAdd and Relu kernels would make.
+template <class T>
+class FusedConv2DWithBiasOp : public OpKernel {
+ public:
+  explicit FusedConv2DWithBiasOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    const int64 stride_n = GetTensorDim(strides_, FORMAT_NHWC, 'N');
+    const int64 stride_c = GetTensorDim(strides_, FORMAT_NHWC, 'C');
+    OP_REQUIRES(
+        context, stride_n == 1 && stride_c == 1,
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    string activation;
+    OP_REQUIRES_OK(context, context->GetAttr("activation", &activation));
+    if (activation == "Identity") {
+      activation_ = IDENTITY;
+    } else if (activation == "Relu") {
+      activation_ = RELU;
+    } else if (activation == "Relu6") {
+      activation_ = RELU6;
+    } else {
+      OP_REQUIRES(context, false, errors::InvalidArgument(
+                                      "Unsupported activation: ", activation));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& filter = context->input(1);
+    const Tensor& bias = context->input(2);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    for (int i = 0; i < 4; i++) {
+      OP_REQUIRES(context, FastBoundsCheck(filter.dim_size(i),
+                                           std::numeric_limits<int>::max()),
+                  errors::InvalidArgument("filter too large"));
+    }
+    const int64 in_depth = input.dim_size(3);
+    OP_REQUIRES(
+        context, in_depth == filter.dim_size(2),
+        errors::InvalidArgument("input and filter must have the same depth: ",
+                                in_depth, " vs ", filter.dim_size(2)));
+    const int64 out_depth = filter.dim_size(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()) &&
+                             bias.dim_size(0) == out_depth,
+                errors::InvalidArgument(
+                    "bias must be a vector of size ", out_depth,
+                    " (the filter's out_channels): ",
+                    bias.shape().DebugString()));
+
+    const int64 batch = input.dim_size(0);
+    const int64 in_rows = input.dim_size(1);
+    const int64 in_cols = input.dim_size(2);
+    const int64 filter_rows = filter.dim_size(0);
+    const int64 filter_cols = filter.dim_size(1);
+    const int64 stride_rows = GetTensorDim(strides_, FORMAT_NHWC, 'H');
+    const int64 stride_cols = GetTensorDim(strides_, FORMAT_NHWC, 'W');
+
+    int64 out_rows = 0, out_cols = 0, pad_rows = 0, pad_cols = 0;
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(in_rows, filter_rows, stride_rows,
+                                         padding_, &out_rows, &pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(in_cols, filter_cols, stride_cols,
+                                         padding_, &out_cols, &pad_cols));
+    TensorShape out_shape =
+        ShapeFromFormat(FORMAT_NHWC, batch, out_rows, out_cols, out_depth);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, out_shape, &output));
+
+    VLOG(2) << "FusedConv2DWithBias: " << name() << ", in_depth = " << in_depth
+            << ", in_cols = " << in_cols << ", filter_cols = " << filter_cols
+            << ", in_rows = " << in_rows << ", filter_rows = " << filter_rows
+            << ", stride_rows = " << stride_rows
+            << ", stride_cols = " << stride_cols
+            << ", out_depth = " << out_depth;
+
+    // If there is nothing to compute, return.
+    if (out_shape.num_elements() == 0) {
+      return;
+    }
+
+    launcher_.launch(context, /*use_cudnn=*/false,
+                     /*cudnn_use_autotune=*/false, input, filter,
+                     static_cast<int>(stride_rows),
+                     static_cast<int>(stride_cols),
+                     BrainPadding2EigenPadding(padding_), output, FORMAT_NHWC);
+    if (!context->status().ok()) return;
+
+    const int64 num_pixels = batch * out_rows * out_cols;
+    const int64 pixels_per_block = std::max<int64>(
+        1, kBiasConvBlockSize / (out_depth * static_cast<int64>(sizeof(T))));
+    const int64 num_blocks =
+        (num_pixels + pixels_per_block - 1) / pixels_per_block;
+
+    typedef Eigen::Map<Eigen::Array<T, 1, Eigen::Dynamic>> PixelMap;
+    typedef Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>> ConstPixelMap;
+
+    const T* bias_data = bias.flat<T>().data();
+    T* output_data = output->flat<T>().data();
+    const Activation activation = activation_;
+
+    // Each output pixel is read and written once, with the bias and the
+    // activation in the same expression.
+    auto work = [&](int64 block_start, int64 block_limit) {
+      ConstPixelMap bias_pixel(bias_data, out_depth);
+      const int64 begin = block_start * pixels_per_block;
+      const int64 end = std::min(block_limit * pixels_per_block, num_pixels);
+      for (int64 i = begin; i < end; ++i) {
+        PixelMap pixel(output_data + i * out_depth, out_depth);
+        if (activation == RELU) {
+          pixel = (pixel + bias_pixel).max(T(0));
+        } else if (activation == RELU6) {
+          pixel = (pixel + bias_pixel).max(T(0)).min(T(6));
+        } else {
+          pixel += bias_pixel;
+        }
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, num_blocks,
+          pixels_per_block * out_depth, work);
+  }
+
+ private:
+  enum Activation { IDENTITY, RELU, RELU6 };
+
+  std::vector<int32> strides_;
+  Padding padding_;
+  Activation activation_;
+  LaunchConv2DOp<CPUDevice, T> launcher_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DWithBiasOp);
+};
+
+#define REGISTER_FUSED_WITH_BIAS(T)                                        \
+  REGISTER_KERNEL_BUILDER(                                                 \
+      Name("_FusedConv2DWithBias").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedConv2DWithBiasOp<T>);
+
+TF_CALL_float(REGISTER_FUSED_WITH_BIAS);
+
 }  // namespace tensorflow
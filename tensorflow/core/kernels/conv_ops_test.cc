@@ -21,11 +21,16 @@ limitations under the License.
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/kernels/conv_ops_cpu_autotune.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/public/session.h"
 
 #include "tensorflow/core/kernels/conv_ops_gpu.h"
@@ -346,4 +351,223 @@ TEST_F(FusedResizePadConvOpTest, ResizeAndPadSymmetricComparativeLarge) {
                           "SYMMETRIC", 1, "SAME");
 }
 
+// Sets an environment variable for the lifetime of the object, and then
+// restores its previous value, also when a failed ASSERT returns early.
+class ScopedEnvVar {
+ public:
+  ScopedEnvVar(const char* name, const char* value) : name_(name) {
+    const char* old_value = getenv(name);
+    had_value_ = old_value != nullptr;
+    if (had_value_) old_value_ = old_value;
+    setenv(name, value, 1 /* replace */);
+  }
+
+  ~ScopedEnvVar() {
+    if (had_value_) {
+      setenv(name_.c_str(), old_value_.c_str(), 1 /* replace */);
+    } else {
+      unsetenv(name_.c_str());
+    }
+  }
+
+ private:
+  const string name_;
+  bool had_value_;
+  string old_value_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedEnvVar);
+};
+
+// Runs Conv2D -> BiasAdd -> 'activation' (if not empty) on random data, with
+// and without the graph pass that fuses them into _FusedConv2DWithBias, and
+// compares the results.
+void CompareFusedAndSeparateBiasConv(int batch, int rows, int cols,
+                                     int in_depth, int filter_size,
+                                     int out_depth, int stride,
+                                     const string& padding,
+                                     const string& activation) {
+  auto root = tensorflow::Scope::NewRootScope();
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  Tensor input_data(DT_FLOAT, TensorShape({batch, rows, cols, in_depth}));
+  input_data.flat<float>().setRandom();
+  input_data.flat<float>() = input_data.flat<float>() - 0.5f;
+  Tensor filter_data(DT_FLOAT, TensorShape({filter_size, filter_size,
+                                            in_depth, out_depth}));
+  filter_data.flat<float>().setRandom();
+  filter_data.flat<float>() = filter_data.flat<float>() - 0.5f;
+  Tensor bias_data(DT_FLOAT, TensorShape({out_depth}));
+  bias_data.flat<float>().setRandom();
+
+  // The input is fed, so that constant folding leaves the convolution alone.
+  Output input = Placeholder(root.WithOpName("input"), DT_FLOAT);
+  Output filter =
+      Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+  Output bias = Const(root.WithOpName("bias"), Input::Initializer(bias_data));
+  Output conv = Conv2D(root.WithOpName("conv"), input, filter,
+                       {1, stride, stride, 1}, padding);
+  if (activation.empty()) {
+    BiasAdd(root.WithOpName("output"), conv, bias);
+  } else {
+    Output bias_add = BiasAdd(root.WithOpName("bias_add"), conv, bias);
+    if (activation == "Relu") {
+      Relu(root.WithOpName("output"), bias_add);
+    } else {
+      Relu6(root.WithOpName("output"), bias_add);
+    }
+  }
+  tensorflow::GraphDef graph;
+  TF_ASSERT_OK(root.ToGraphDef(&graph));
+
+  // The fusion pass reads TF_ENABLE_CONV_FUSION when the session builds its
+  // executors, which happens on the first Run.
+  std::vector<Tensor> separate_tensors;
+  {
+    ScopedEnvVar no_fusion("TF_ENABLE_CONV_FUSION", "0");
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(session->Create(graph));
+    TF_ASSERT_OK(session->Run({{"input", input_data}}, {"output"}, {},
+                              &separate_tensors));
+  }
+
+  ScopedEnvVar fusion("TF_ENABLE_CONV_FUSION", "1");
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  TF_ASSERT_OK(session->Create(graph));
+  RunOptions run_options;
+  run_options.set_trace_level(RunOptions::FULL_TRACE);
+  RunMetadata run_metadata;
+  std::vector<Tensor> fused_tensors;
+  TF_ASSERT_OK(session->Run(run_options, {{"input", input_data}}, {"output"},
+                            {}, &fused_tensors, &run_metadata));
+  test::ExpectTensorNear<float>(separate_tensors[0], fused_tensors[0], 1e-4);
+
+  int num_fused = 0;
+  for (const auto& dev_stats : run_metadata.step_stats().dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      if (StringPiece(node_stats.timeline_label())
+              .starts_with("output = _FusedConv2DWithBias(")) {
+        ++num_fused;
+      }
+    }
+  }
+  EXPECT_EQ(1, num_fused);
+}
+
+TEST(FusedConv2DWithBiasTest, ReluSame) {
+  CompareFusedAndSeparateBiasConv(2, 9, 11, 5, 3, 7, 1, "SAME", "Relu");
+}
+
+TEST(FusedConv2DWithBiasTest, Relu6ValidStrided) {
+  CompareFusedAndSeparateBiasConv(3, 13, 10, 4, 5, 9, 2, "VALID", "Relu6");
+}
+
+TEST(FusedConv2DWithBiasTest, NoActivationPointwise) {
+  CompareFusedAndSeparateBiasConv(2, 7, 6, 16, 1, 24, 1, "SAME", "");
+}
+
+TEST(FusedConv2DWithBiasTest, ReluPointwiseStrided) {
+  CompareFusedAndSeparateBiasConv(1, 9, 9, 8, 1, 3, 2, "SAME", "Relu");
+}
+
+TEST(FusedConv2DWithBiasTest, ReluLarge) {
+  CompareFusedAndSeparateBiasConv(4, 56, 56, 64, 3, 64, 1, "SAME", "Relu");
+}
+
+TEST(CpuConvAutoTuneMap, PersistsDecisions) {
+  const string cache_file =
+      io::JoinPath(testing::TmpDir(), "cpu_conv_autotune_cache");
+  Env::Default()->DeleteFile(cache_file).IgnoreError();
+
+  CpuConvParameters params = {1, 10, 10, 8, 3, 3, 16, 1, 1, 1, 1, 4, DT_FLOAT};
+  CpuConvParameters other_threads = params;
+  other_threads.num_threads = 8;
+
+  CpuConvAlgorithm algorithm;
+  {
+    CpuConvAutoTuneMap map(cache_file);
+    EXPECT_FALSE(map.Find(params, &algorithm));
+    map.Insert(params, CpuConvAlgorithm::kDeepConv);
+    // The first decision for a key wins.
+    map.Insert(params, CpuConvAlgorithm::kEigen);
+    map.Insert(other_threads, CpuConvAlgorithm::kEigen);
+    ASSERT_TRUE(map.Find(params, &algorithm));
+    EXPECT_EQ(CpuConvAlgorithm::kDeepConv, algorithm);
+  }
+
+  CpuConvAutoTuneMap reloaded(cache_file);
+  ASSERT_TRUE(reloaded.Find(params, &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kDeepConv, algorithm);
+  ASSERT_TRUE(reloaded.Find(other_threads, &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kEigen, algorithm);
+}
+
+TEST(CpuConvAutotune, MatchesStaticSelectionAndRecordsDecision) {
+  auto root = tensorflow::Scope::NewRootScope();
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  // A 3x3 stride-1 convolution, so that DeepConv2D is a candidate too. The
+  // shape is not used elsewhere in this test, so the first run tunes it.
+  Tensor input_data(DT_FLOAT, TensorShape({2, 17, 19, 24}));
+  test::FillIota<float>(&input_data, -100.0f);
+  input_data.flat<float>() = input_data.flat<float>() * 0.01f;
+  Tensor filter_data(DT_FLOAT, TensorShape({3, 3, 24, 40}));
+  test::FillIota<float>(&filter_data, -4.0f);
+  filter_data.flat<float>() = filter_data.flat<float>() * 0.001f;
+  // The input is fed, so that constant folding leaves the convolution alone.
+  Output input = Placeholder(root.WithOpName("input"), DT_FLOAT);
+  Output filter =
+      Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+  Output conv =
+      Conv2D(root.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "SAME");
+  tensorflow::GraphDef graph;
+  TF_ASSERT_OK(root.ToGraphDef(&graph));
+
+  // The thread count is part of the tuning key, so pin it.
+  SessionOptions options;
+  options.config.set_intra_op_parallelism_threads(2);
+  CpuConvParameters params;
+  params.batch = 2;
+  params.in_rows = 17;
+  params.in_cols = 19;
+  params.in_depth = 24;
+  params.filter_rows = 3;
+  params.filter_cols = 3;
+  params.out_depth = 40;
+  params.stride_rows = 1;
+  params.stride_cols = 1;
+  params.pad_rows = 1;
+  params.pad_cols = 1;
+  params.num_threads = 2;
+  params.dtype = DT_FLOAT;
+  CpuConvAlgorithm algorithm;
+
+  // Kernels read TF_CPU_CONV_USE_AUTOTUNE when the session instantiates them,
+  // which happens on the first Run.
+  std::vector<Tensor> static_tensors;
+  {
+    ScopedEnvVar no_autotune("TF_CPU_CONV_USE_AUTOTUNE", "0");
+    std::unique_ptr<Session> session(NewSession(options));
+    TF_ASSERT_OK(session->Create(graph));
+    TF_ASSERT_OK(
+        session->Run({{"input", input_data}}, {"conv"}, {}, &static_tensors));
+  }
+  EXPECT_FALSE(CpuConvAutoTuneMap::Global()->Find(params, &algorithm));
+
+  ScopedEnvVar autotune("TF_CPU_CONV_USE_AUTOTUNE", "1");
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(graph));
+  CpuConvAlgorithm tuned_algorithm;
+  for (int step = 0; step < 2; ++step) {
+    std::vector<Tensor> tuned_tensors;
+    TF_ASSERT_OK(
+        session->Run({{"input", input_data}}, {"conv"}, {}, &tuned_tensors));
+    test::ExpectTensorNear<float>(static_tensors[0], tuned_tensors[0], 1e-3);
+
+    // The first step records the decision and later steps reuse it.
+    ASSERT_TRUE(CpuConvAutoTuneMap::Global()->Find(params, &algorithm));
+    if (step == 0) tuned_algorithm = algorithm;
+    EXPECT_EQ(tuned_algorithm, algorithm);
+  }
+}
+
 }  // namespace tensorflow
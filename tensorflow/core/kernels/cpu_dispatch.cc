@@ -0,0 +1,89 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/cpu_dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace cpu_dispatch {
+
+namespace {
+
+const InstructionSet kInstructionSets[] = {kBaseline, kAvx2, kAvx512};
+
+InstructionSet ComputeMaxInstructionSet() {
+  InstructionSet max_isa = kBaseline;
+  for (InstructionSet isa : kInstructionSets) {
+    if (!CPUSupports(isa)) break;
+    max_isa = isa;
+  }
+  const char* cap = getenv("TF_CPU_DISPATCH_MAX_ISA");
+  if (cap != nullptr && cap[0] != '\0') {
+    bool found = false;
+    for (InstructionSet isa : kInstructionSets) {
+      if (strcmp(cap, InstructionSetName(isa)) == 0) {
+        found = true;
+        if (isa < max_isa) max_isa = isa;
+      }
+    }
+    if (!found) {
+      LOG(WARNING) << "Ignoring TF_CPU_DISPATCH_MAX_ISA=" << cap
+                   << ", which is not one of baseline, avx2 or avx512.";
+    }
+  }
+  VLOG(1) << "CPU kernels with runtime dispatch use up to "
+          << InstructionSetName(max_isa) << " instructions.";
+  return max_isa;
+}
+
+}  // namespace
+
+bool CPUSupports(InstructionSet isa) {
+  switch (isa) {
+    case kBaseline:
+      return true;
+    case kAvx2:
+      return port::TestCPUFeature(port::CPUFeature::AVX2) &&
+             port::TestCPUFeature(port::CPUFeature::FMA);
+    case kAvx512:
+      return port::TestCPUFeature(port::CPUFeature::AVX512F);
+  }
+  return false;
+}
+
+InstructionSet MaxInstructionSet() {
+  static const InstructionSet max_isa = ComputeMaxInstructionSet();
+  return max_isa;
+}
+
+const char* InstructionSetName(InstructionSet isa) {
+  switch (isa) {
+    case kBaseline:
+      return "baseline";
+    case kAvx2:
+      return "avx2";
+    case kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+}  // namespace cpu_dispatch
+}  // namespace tensorflow
@@ -0,0 +1,79 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_CPU_DISPATCH_H_
+#define TENSORFLOW_KERNELS_CPU_DISPATCH_H_
+
+// Runtime selection between versions of a CPU kernel's inner loops that are
+// compiled for different x86 instruction sets.
+//
+// The binary as a whole is built for a baseline instruction set, so that it
+// runs on every CPU it is deployed to. A kernel that benefits from wider
+// vectors puts its inner loops in extra files, each compiled with the flags
+// of one instruction set (see vectorized_math_avx2.cc for an example), which
+// return a function pointer, or nullptr when the file was compiled for a
+// target without that instruction set. The kernel then calls Select() once,
+// typically to initialize a function-local static:
+//
+//   static const TileFunction tile = cpu_dispatch::Select<TileFunction>(
+//       nullptr, GetAvx2TileFunction(), GetAvx512TileFunction());
+//   if (tile == nullptr) { ... baseline code ... }
+//
+// The files compiled for an instruction set must only be entered through
+// such pointers, and must not call inline functions defined in headers that
+// the rest of the binary also uses: the linker keeps a single copy of each
+// inline function, which could be the one compiled with instructions the CPU
+// lacks.
+//
+// The environment variable TF_CPU_DISPATCH_MAX_ISA, set to "baseline",
+// "avx2" or "avx512", caps the instruction set that is selected, e.g. to
+// compare the versions or to rule one out when debugging.
+
+namespace tensorflow {
+namespace cpu_dispatch {
+
+// In increasing order: a CPU that supports one also supports those before.
+enum InstructionSet {
+  kBaseline,
+  // AVX2 and FMA.
+  kAvx2,
+  // AVX-512 Foundation.
+  kAvx512,
+};
+
+// Returns true if the CPU supports 'isa'.
+bool CPUSupports(InstructionSet isa);
+
+// Returns the widest instruction set that the CPU supports, capped by
+// TF_CPU_DISPATCH_MAX_ISA. Computed once.
+InstructionSet MaxInstructionSet();
+
+// Returns a lowercase name of 'isa', as accepted by TF_CPU_DISPATCH_MAX_ISA.
+const char* InstructionSetName(InstructionSet isa);
+
+// Returns the version for the widest instruction set up to
+// MaxInstructionSet() that is not nullptr, or 'baseline'.
+template <typename Function>
+Function Select(Function baseline, Function avx2, Function avx512) {
+  const InstructionSet max_isa = MaxInstructionSet();
+  if (max_isa >= kAvx512 && avx512 != nullptr) return avx512;
+  if (max_isa >= kAvx2 && avx2 != nullptr) return avx2;
+  return baseline;
+}
+
+}  // namespace cpu_dispatch
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_CPU_DISPATCH_H_
@@ -0,0 +1,64 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/cpu_dispatch.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace cpu_dispatch {
+namespace {
+
+int Baseline() { return 0; }
+int Avx2() { return 2; }
+int Avx512() { return 512; }
+
+typedef int (*Function)();
+
+TEST(CpuDispatchTest, MaxInstructionSetIsSupported) {
+  EXPECT_TRUE(CPUSupports(kBaseline));
+  EXPECT_TRUE(CPUSupports(MaxInstructionSet()));
+  for (InstructionSet isa : {kBaseline, kAvx2, kAvx512}) {
+    if (isa <= MaxInstructionSet()) EXPECT_TRUE(CPUSupports(isa)) << isa;
+  }
+}
+
+TEST(CpuDispatchTest, SelectsWidestAllowedVersion) {
+  const InstructionSet max_isa = MaxInstructionSet();
+  const int expected = max_isa == kAvx512 ? 512 : max_isa == kAvx2 ? 2 : 0;
+  EXPECT_EQ(expected, Select<Function>(Baseline, Avx2, Avx512)());
+}
+
+TEST(CpuDispatchTest, SkipsMissingVersions) {
+  const InstructionSet max_isa = MaxInstructionSet();
+  EXPECT_EQ(max_isa >= kAvx2 ? 2 : 0,
+            Select<Function>(Baseline, Avx2, nullptr)());
+  EXPECT_EQ(max_isa >= kAvx512 ? 512 : 0,
+            Select<Function>(Baseline, nullptr, Avx512)());
+  EXPECT_EQ(0, Select<Function>(Baseline, nullptr, nullptr)());
+  if (max_isa == kBaseline) {
+    EXPECT_EQ(nullptr, Select<Function>(nullptr, Avx2, Avx512));
+  }
+}
+
+TEST(CpuDispatchTest, InstructionSetName) {
+  EXPECT_STREQ("baseline", InstructionSetName(kBaseline));
+  EXPECT_STREQ("avx2", InstructionSetName(kAvx2));
+  EXPECT_STREQ("avx512", InstructionSetName(kAvx512));
+}
+
+}  // namespace
+}  // namespace cpu_dispatch
+}  // namespace tensorflow
@@ -13,7 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include "tensorflow/core/kernels/cwise_ops_common.h"
+#include "tensorflow/core/kernels/cwise_ops_vectorized.h"
 
 namespace tensorflow {
 REGISTER3(UnaryOp, CPU, "Erf", functor::erf, float, Eigen::half, double);
@@ -85,6 +85,29 @@ BM_UNARY(cpu, Rint, float, DT_FLOAT);
 BM_UNARY(gpu, Rint, float, DT_FLOAT);
 #endif // GOOGLE_CUDA
 
+// The float versions of Exp, Log, Tanh, Sigmoid and Erf use
+// vectorized_math.h on CPUs with AVX2 or AVX-512.
+BM_UNARY(cpu, Abs, float, DT_FLOAT);
+BM_UNARY(cpu, Neg, float, DT_FLOAT);
+BM_UNARY(cpu, Square, float, DT_FLOAT);
+BM_UNARY(cpu, Reciprocal, float, DT_FLOAT);
+BM_UNARY(cpu, Sqrt, float, DT_FLOAT);
+BM_UNARY(cpu, Rsqrt, float, DT_FLOAT);
+BM_UNARY(cpu, Exp, float, DT_FLOAT);
+BM_UNARY(cpu, Expm1, float, DT_FLOAT);
+BM_UNARY(cpu, Log, float, DT_FLOAT);
+BM_UNARY(cpu, Log1p, float, DT_FLOAT);
+BM_UNARY(cpu, Sin, float, DT_FLOAT);
+BM_UNARY(cpu, Cos, float, DT_FLOAT);
+BM_UNARY(cpu, Tanh, float, DT_FLOAT);
+BM_UNARY(cpu, Sigmoid, float, DT_FLOAT);
+BM_UNARY(cpu, Erf, float, DT_FLOAT);
+BM_UNARY(cpu, Erfc, float, DT_FLOAT);
+BM_UNARY(cpu, Lgamma, float, DT_FLOAT);
+BM_UNARY(cpu, Exp, double, DT_DOUBLE);
+BM_UNARY(cpu, Log, double, DT_DOUBLE);
+BM_UNARY(cpu, Tanh, double, DT_DOUBLE);
+
 // data func scalar.
 Graph* BinaryScalar(int num, const string& func) {
   Graph* g = new Graph(OpRegistry::Global());
@@ -0,0 +1,77 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_CWISE_OPS_VECTORIZED_H_
+#define TENSORFLOW_KERNELS_CWISE_OPS_VECTORIZED_H_
+
+// CPU functors for the float unary cwise ops that have a version in
+// vectorized_math.h. Include this instead of cwise_ops_common.h in the files
+// registering those ops, so that every instantiation sees the
+// specializations below.
+
+#include "tensorflow/core/kernels/cwise_ops_common.h"
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+namespace tensorflow {
+namespace functor {
+
+// Computes Functor with 'function' from vectorized_math.h if the CPU has an
+// implementation of it, and with Eigen otherwise.
+template <typename Functor, vectorized_math::Function function>
+struct VectorizedUnaryFunctor {
+  void operator()(const CPUDevice& d, typename Functor::tout_type out,
+                  typename Functor::tin_type in) {
+    static const vectorized_math::FloatFunction vectorized =
+        vectorized_math::GetFloatFunction(function);
+    if (vectorized == nullptr) {
+      Assign(d, out, in.unaryExpr(typename Functor::func()));
+      return;
+    }
+    const float* in_data = in.data();
+    float* out_data = out.data();
+    const Eigen::TensorOpCost cost(
+        sizeof(float), sizeof(float),
+        Eigen::internal::functor_traits<typename Functor::func>::Cost);
+    d.parallelFor(in.size(), cost,
+                  [vectorized, in_data, out_data](int64 start, int64 end) {
+                    vectorized(in_data + start, out_data + start, end - start);
+                  });
+  }
+};
+
+template <>
+struct UnaryFunctor<CPUDevice, exp<float>>
+    : VectorizedUnaryFunctor<exp<float>, vectorized_math::kExp> {};
+
+template <>
+struct UnaryFunctor<CPUDevice, log<float>>
+    : VectorizedUnaryFunctor<log<float>, vectorized_math::kLog> {};
+
+template <>
+struct UnaryFunctor<CPUDevice, tanh<float>>
+    : VectorizedUnaryFunctor<tanh<float>, vectorized_math::kTanh> {};
+
+template <>
+struct UnaryFunctor<CPUDevice, sigmoid<float>>
+    : VectorizedUnaryFunctor<sigmoid<float>, vectorized_math::kSigmoid> {};
+
+template <>
+struct UnaryFunctor<CPUDevice, erf<float>>
+    : VectorizedUnaryFunctor<erf<float>, vectorized_math::kErf> {};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_CWISE_OPS_VECTORIZED_H_
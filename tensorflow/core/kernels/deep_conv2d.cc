@@ -90,17 +90,50 @@ static bool ReadBoolFromEnvVar(const char* env_var_name, bool default_val) {
   return default_val;
 }
 
+// Output tile sizes of the Winograd transforms available for 3x3 filters:
+// F(2x2, 3x3), F(4x4, 3x3) and F(6x6, 3x3).
+static const int kWinogradOutputTileSizes[] = {2, 4, 6};
+
+// Returns the output tile size of the Winograd transform with the lowest
+// modeled cost for a 3x3 convolution, and stores that cost in 'cost'.
+static int GetDeepConvOutputTileSize(int in_depth, int out_depth, int out_rows,
+                                     int out_cols, int64* cost) {
+  int best_tile_size = 0;
+  for (const int tile_size : kWinogradOutputTileSizes) {
+    const int64 tile_cost =
+        GetDeepConvCost(tile_size + 2, tile_size + 2, tile_size, tile_size,
+                        in_depth, out_depth, out_rows, out_cols);
+    if (best_tile_size == 0 || tile_cost < *cost) {
+      *cost = tile_cost;
+      best_tile_size = tile_size;
+    }
+  }
+  return best_tile_size;
+}
+
+// Returns a new transform with output tiles of 'tile_size' x 'tile_size'.
+template <typename T>
+static DeepConv2DTransform<T>* NewDeepConv2DTransform(int tile_size) {
+  if (tile_size == 2) return new WinogradTransform<T>;
+  return new WinogradLargeTileTransform<T>(tile_size);
+}
+
+// TODO(andydavis) Add support for multiple filter sizes and strides.
+bool DeepConv2DSupports(int stride_rows, int stride_cols, int filter_rows,
+                        int filter_cols) {
+  return stride_rows == 1 && stride_cols == 1 && filter_rows == 3 &&
+         filter_cols == 3;
+}
+
 // Returns true if convolution can be computed efficiently by DeepConv2D,
 // returns false otherwise.
 // TODO(andydavis) Add support for other filter sizes and strides.
-// TODO(andydavis) Add support for autotuning.
 bool CanUseDeepConv2D(int stride_rows, int stride_cols, int filter_rows,
                       int filter_cols, int in_depth, int out_depth,
                       int out_rows, int out_cols) {
   // Check if convolution parameters are supported.
-  // TODO(andydavis) Add support for multiple filter sizes and strides.
-  if (stride_rows > 1 || stride_cols > 1 || filter_rows != 3 ||
-      filter_cols != 3) {
+  if (!DeepConv2DSupports(stride_rows, stride_cols, filter_rows,
+                          filter_cols)) {
     return false;
   }
 
@@ -111,20 +144,21 @@ bool CanUseDeepConv2D(int stride_rows, int stride_cols, int filter_rows,
   }
 
   // Check if flop cost of deep convolution is less than direct convolution.
-  WinogradTransform<float> t;
-  const int64 deep_conv_cost = GetDeepConvCost(
-      t.input_shape().rows, t.input_shape().cols, t.output_shape().rows,
-      t.output_shape().cols, in_depth, out_depth, out_rows, out_cols);
+  int64 deep_conv_cost = 0;
+  const int tile_size = GetDeepConvOutputTileSize(
+      in_depth, out_depth, out_rows, out_cols, &deep_conv_cost);
   const int64 direct_conv_cost = GetDirectConvCost(
       filter_rows, filter_cols, in_depth, out_depth, out_rows, out_cols);
+  const bool use_deep_conv = deep_conv_cost < direct_conv_cost;
 
   VLOG(2) << "CanUseDeepConv2D"
+          << " tile_size: " << tile_size
           << " deep_conv_cost: " << deep_conv_cost
           << " direct_conv_cost: " << direct_conv_cost
           << " deep_direct_ratio: " << (static_cast<float>(deep_conv_cost) /
                                         static_cast<float>(direct_conv_cost))
-          << " use_deep_conv: " << (deep_conv_cost < direct_conv_cost);
-  return deep_conv_cost < direct_conv_cost;
+          << " use_deep_conv: " << use_deep_conv;
+  return use_deep_conv;
 }
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
@@ -936,8 +970,12 @@ template <typename T>
 struct DeepConv2D<CPUDevice, T> {
   void operator()(OpKernelContext* ctx, const Conv2DArgs& args, const T* input,
                   const T* filter, T* output) {
-    // TODO(andydavis) Add function to select transform based on conv params.
-    std::unique_ptr<DeepConv2DTransform<T>> transform(new WinogradTransform<T>);
+    int64 deep_conv_cost = 0;
+    const int tile_size =
+        GetDeepConvOutputTileSize(args.in_depth, args.out_depth, args.out_rows,
+                                  args.out_cols, &deep_conv_cost);
+    std::unique_ptr<DeepConv2DTransform<T>> transform(
+        NewDeepConv2DTransform<T>(tile_size));
 
     const int64 in_depth = args.in_depth;
     const int64 out_depth = args.out_depth;
@@ -101,6 +101,12 @@ bool CanUseDeepConv2D(int stride_rows, int stride_cols, int filter_rows,
                       int filter_cols, int in_depth, int out_depth,
                       int out_rows, int out_cols);
 
+// Returns true if DeepConv2D implements convolutions with the given strides
+// and filter size, regardless of its cost or of TF_USE_DEEP_CONV2D. Used by
+// callers that measure the cost themselves (see conv_ops_cpu_autotune.h).
+bool DeepConv2DSupports(int stride_rows, int stride_cols, int filter_rows,
+                        int filter_cols);
+
 namespace functor {
 
 // Calls DeepConv2D implementation (see deep_conv2d.cc for details).
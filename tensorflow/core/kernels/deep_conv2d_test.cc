@@ -13,7 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "tensorflow/core/kernels/winograd_transform.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -155,5 +161,201 @@ TEST(DeepConv2DTransformTest, WingradOutputTransformMatrix) {
   }
 }
 
+TEST(DeepConv2DTransformTest, WinogradLargeTileFilterTransformMatrix) {
+  // Test that the F(4x4, 3x3) filter transform matrix returned is the
+  // kronecker product of the following matrix with itself:
+  //
+  //   [  1/4     0     0   ]
+  //   [ -1/6  -1/6  -1/6   ]
+  //   [ -1/6   1/6  -1/6   ]
+  //   [  1/24  1/12  1/6   ]
+  //   [  1/24 -1/12  1/6   ]
+  //   [  0     0     1     ]
+  //
+  const int rows = 6;
+  const int cols = 3;
+
+  float transform_matrix[] = {1.0f / 4,  0,          0,         -1.0f / 6,
+                              -1.0f / 6, -1.0f / 6,  -1.0f / 6, 1.0f / 6,
+                              -1.0f / 6, 1.0f / 24,  1.0f / 12, 1.0f / 6,
+                              1.0f / 24, -1.0f / 12, 1.0f / 6,  0,
+                              0,         1};
+
+  const int kron_rows = rows * rows;
+  const int kron_cols = cols * cols;
+
+  float transform_matrix_kron[kron_rows * kron_cols];
+
+  ComputeKroneckerProduct(rows, cols, &transform_matrix[0],
+                          &transform_matrix_kron[0]);
+
+  float transform_matrix_test[kron_rows * kron_cols];
+  WinogradLargeTileTransform<float> t(4);
+  t.GetFilterTransformMatrix(kron_rows, kron_cols, &transform_matrix_test[0]);
+
+  for (int i = 0; i < kron_rows * kron_cols; ++i) {
+    EXPECT_FLOAT_EQ(transform_matrix_kron[i], transform_matrix_test[i]);
+  }
+}
+
+// Checks that output transform(input transform(d) .* filter transform(g))
+// computes the 3x3 correlation of a single-channel tile 'd' with 'g'.
+static void TestWinogradTileCorrelation(const DeepConv2DTransform<float>& t) {
+  const int tile_size = t.input_shape().rows;
+  const int out_tile_size = t.output_shape().rows;
+  const int tile_spatial_size = tile_size * tile_size;
+  const int out_tile_spatial_size = out_tile_size * out_tile_size;
+
+  std::vector<float> d(tile_spatial_size);
+  for (int i = 0; i < tile_spatial_size; ++i) d[i] = (i * 7) % 11 - 5;
+  std::vector<float> g(9);
+  for (int i = 0; i < 9; ++i) g[i] = (i * 5) % 7 - 3;
+
+  std::vector<float> filter_transform(tile_spatial_size * 9);
+  t.GetFilterTransformMatrix(tile_spatial_size, 9, filter_transform.data());
+  std::vector<float> input_transform(tile_spatial_size * tile_spatial_size);
+  t.GetInputTransformMatrix(tile_spatial_size, tile_spatial_size,
+                            input_transform.data());
+  std::vector<float> output_transform(out_tile_spatial_size *
+                                      tile_spatial_size);
+  t.GetOutputTransformMatrix(out_tile_spatial_size, tile_spatial_size,
+                             output_transform.data());
+
+  std::vector<float> product(tile_spatial_size);
+  for (int i = 0; i < tile_spatial_size; ++i) {
+    float u = 0;
+    for (int j = 0; j < 9; ++j) u += filter_transform[i * 9 + j] * g[j];
+    float v = 0;
+    for (int j = 0; j < tile_spatial_size; ++j) {
+      v += input_transform[i * tile_spatial_size + j] * d[j];
+    }
+    product[i] = u * v;
+  }
+
+  for (int r = 0; r < out_tile_size; ++r) {
+    for (int c = 0; c < out_tile_size; ++c) {
+      float y = 0;
+      for (int j = 0; j < tile_spatial_size; ++j) {
+        y += output_transform[(r * out_tile_size + c) * tile_spatial_size +
+                              j] *
+             product[j];
+      }
+      float expected = 0;
+      for (int fr = 0; fr < 3; ++fr) {
+        for (int fc = 0; fc < 3; ++fc) {
+          expected += d[(r + fr) * tile_size + c + fc] * g[fr * 3 + fc];
+        }
+      }
+      EXPECT_NEAR(expected, y, 1e-3) << "tile " << out_tile_size << " at ("
+                                     << r << ", " << c << ")";
+    }
+  }
+}
+
+TEST(DeepConv2DTransformTest, WinogradTileCorrelation) {
+  TestWinogradTileCorrelation(WinogradTransform<float>());
+  TestWinogradTileCorrelation(WinogradLargeTileTransform<float>(4));
+  TestWinogradTileCorrelation(WinogradLargeTileTransform<float>(6));
+}
+
+// Returns the largest error of fp32 output tiles computed by 't' relative to
+// the largest magnitude of the exact output, over 'num_tiles' random tiles.
+// As in DeepConv2D, the element-wise products of the transformed input and
+// filter are accumulated over 'depth' channels before the output transform.
+static double MaxWinogradRelativeError(const DeepConv2DTransform<float>& t,
+                                       int depth, int num_tiles) {
+  const int tile_size = t.input_shape().rows;
+  const int out_tile_size = t.output_shape().rows;
+  const int tile_spatial_size = tile_size * tile_size;
+  const int out_tile_spatial_size = out_tile_size * out_tile_size;
+
+  std::vector<float> filter_transform(tile_spatial_size * 9);
+  t.GetFilterTransformMatrix(tile_spatial_size, 9, filter_transform.data());
+  std::vector<float> input_transform(tile_spatial_size * tile_spatial_size);
+  t.GetInputTransformMatrix(tile_spatial_size, tile_spatial_size,
+                            input_transform.data());
+  std::vector<float> output_transform(out_tile_spatial_size *
+                                      tile_spatial_size);
+  t.GetOutputTransformMatrix(out_tile_spatial_size, tile_spatial_size,
+                             output_transform.data());
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  double max_error = 0;
+  for (int n = 0; n < num_tiles; ++n) {
+    // Values in [-1, 1), so that the outputs involve cancellation.
+    std::vector<float> d(depth * tile_spatial_size);
+    for (float& v : d) v = 2 * rnd.RandFloat() - 1;
+    std::vector<float> g(depth * 9);
+    for (float& v : g) v = 2 * rnd.RandFloat() - 1;
+
+    std::vector<float> product(tile_spatial_size, 0.0f);
+    for (int k = 0; k < depth; ++k) {
+      for (int i = 0; i < tile_spatial_size; ++i) {
+        float u = 0;
+        for (int j = 0; j < 9; ++j) {
+          u += filter_transform[i * 9 + j] * g[k * 9 + j];
+        }
+        float v = 0;
+        for (int j = 0; j < tile_spatial_size; ++j) {
+          v += input_transform[i * tile_spatial_size + j] *
+               d[k * tile_spatial_size + j];
+        }
+        product[i] += u * v;
+      }
+    }
+
+    double error = 0;
+    double magnitude = 0;
+    for (int r = 0; r < out_tile_size; ++r) {
+      for (int c = 0; c < out_tile_size; ++c) {
+        float y = 0;
+        for (int j = 0; j < tile_spatial_size; ++j) {
+          y += output_transform[(r * out_tile_size + c) * tile_spatial_size +
+                                j] *
+               product[j];
+        }
+        double expected = 0;
+        for (int k = 0; k < depth; ++k) {
+          for (int fr = 0; fr < 3; ++fr) {
+            for (int fc = 0; fc < 3; ++fc) {
+              expected +=
+                  static_cast<double>(
+                      d[k * tile_spatial_size + (r + fr) * tile_size + c +
+                        fc]) *
+                  g[k * 9 + fr * 3 + fc];
+            }
+          }
+        }
+        error = std::max(error, std::abs(y - expected));
+        magnitude = std::max(magnitude, std::abs(expected));
+      }
+    }
+    max_error = std::max(max_error, error / magnitude);
+  }
+  return max_error;
+}
+
+// DeepConv2D may be selected for Conv2D and Conv2DBackpropInput with
+// TF_USE_DEEP_CONV2D or by the CPU autotuner, so the fp32 error of every tile
+// size is bounded here.
+// Over many more tiles the largest relative errors measured at depth 512
+// were about 4e-6, 2e-5 and 4e-5 for F(2x2), F(4x4) and F(6x6).
+TEST(DeepConv2DTransformTest, WinogradTileAccuracy) {
+  for (const int depth : {1, 64, 512}) {
+    EXPECT_LT(MaxWinogradRelativeError(WinogradTransform<float>(), depth, 20),
+              2e-5)
+        << "depth " << depth;
+    EXPECT_LT(MaxWinogradRelativeError(WinogradLargeTileTransform<float>(4),
+                                       depth, 20),
+              1e-4)
+        << "depth " << depth;
+    EXPECT_LT(MaxWinogradRelativeError(WinogradLargeTileTransform<float>(6),
+                                       depth, 20),
+              2e-4)
+        << "depth " << depth;
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
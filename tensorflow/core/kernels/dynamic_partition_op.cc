@@ -15,6 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
+#include <algorithm>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -23,9 +24,17 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+// The rows of data are split into blocks of consecutive rows. Each block is
+// processed in two passes, with all blocks running in parallel in each pass:
+// the first counts the rows of the block that go to each partition, and the
+// second copies them to the outputs, starting at the output rows that the
+// counts of the earlier blocks add up to. This keeps the rows of each output
+// in the order of data.
+
 // Shared code that is not dependent on the type of T.  We do this to reduce
 // code size by not duplicating all this for all T (float, double, int32, etc.)
 class DynamicPartitionOp_Shared : public OpKernel {
@@ -39,9 +48,18 @@ class DynamicPartitionOp_Shared : public OpKernel {
     //   in the graph?
   }
 
+ protected:
+  struct Blocks {
+    int64 rows_per_block = 0;
+    int64 num_blocks = 0;
+    // offsets[b * num_partitions_ + p] is the row of outputs[p] that the
+    // first row of block b in partition p is copied to.
+    std::vector<int64> offsets;
+  };
+
   void ValidateAndAllocateOutputs(OpKernelContext* c, const Tensor** data,
                                   const Tensor** partitions,
-                                  OpOutputList* Tout) {
+                                  OpOutputList* Tout, Blocks* blocks) {
     OP_REQUIRES_OK(c, c->input("data", data));
     OP_REQUIRES_OK(c, c->input("partitions", partitions));
     OP_REQUIRES(
@@ -52,24 +70,46 @@ class DynamicPartitionOp_Shared : public OpKernel {
             "got data.shape = ", (*data)->shape().DebugString(),
             ", partitions.shape = ", (*partitions)->shape().DebugString()));
 
-    // Count how many occurrences of each partition id we have in partitions
-    gtl::InlinedVector<int, 32> partition_count(num_partitions_);
     auto e_partitions = (*partitions)->flat<int32>();
     const int64 N = e_partitions.dimension(0);
-    for (int64 i = 0; i < N; i++) {
-      const int32 p = internal::SubtleMustCopy(e_partitions(i));
-      OP_REQUIRES(c, FastBoundsCheck(p, num_partitions_),
+    const int64 slice_size = N == 0 ? 0 : (*data)->NumElements() / N;
+    SplitIntoBlocks(c, N, slice_size, blocks);
+
+    // Count how many occurrences of each partition id we have in each block
+    std::vector<int64>& offsets = blocks->offsets;
+    std::vector<int64> first_invalid(blocks->num_blocks, N);
+    RunBlocks(c, *blocks, N, 1, [&](int64 b, int64 start, int64 limit) {
+      int64* counts = offsets.data() + b * num_partitions_;
+      for (int64 i = start; i < limit; i++) {
+        const int32 p = internal::SubtleMustCopy(e_partitions(i));
+        if (!FastBoundsCheck(p, num_partitions_)) {
+          first_invalid[b] = i;
+          return;
+        }
+        counts[p]++;
+      }
+    });
+    for (int64 b = 0; b < blocks->num_blocks; b++) {
+      const int64 i = first_invalid[b];
+      OP_REQUIRES(c, i == N,
                   errors::InvalidArgument(
                       "partitions", SliceDebugString((*partitions)->shape(), i),
-                      " = ", p, " is not in [0, ", num_partitions_, ")"));
-      partition_count[p]++;
+                      " = ", e_partitions(i), " is not in [0, ",
+                      num_partitions_, ")"));
     }
 
-    // Allocate output tensors of the right size
+    // Turn the counts into offsets and allocate output tensors of the right
+    // size
     OP_REQUIRES_OK(c, c->output_list("outputs", Tout));
     for (int p = 0; p < num_partitions_; p++) {
+      int64 partition_count = 0;
+      for (int64 b = 0; b < blocks->num_blocks; b++) {
+        const int64 count = offsets[b * num_partitions_ + p];
+        offsets[b * num_partitions_ + p] = partition_count;
+        partition_count += count;
+      }
       TensorShape shape;
-      shape.AddDim(partition_count[p]);
+      shape.AddDim(partition_count);
       for (int i = (*partitions)->dims(); i < (*data)->dims(); i++) {
         shape.AddDim((*data)->dim_size(i));
       }
@@ -78,8 +118,46 @@ class DynamicPartitionOp_Shared : public OpKernel {
     }
   }
 
- protected:
+  // Calls work(b, start, limit) for the rows [start, limit) of each block b,
+  // running blocks in parallel. 'cost_per_row' estimates the cost of a row
+  // in units of copied elements.
+  template <typename Work>
+  static void RunBlocks(OpKernelContext* c, const Blocks& blocks, int64 N,
+                        int64 cost_per_row, Work work) {
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *c->device()->tensorflow_cpu_worker_threads();
+    const int64 rows_per_block = blocks.rows_per_block;
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          blocks.num_blocks, rows_per_block * cost_per_row,
+          [rows_per_block, N, &work](int64 start_block, int64 limit_block) {
+            for (int64 b = start_block; b < limit_block; b++) {
+              const int64 start = b * rows_per_block;
+              work(b, start, std::min(start + rows_per_block, N));
+            }
+          });
+  }
+
   int num_partitions_;
+
+ private:
+  // Blocks are large enough to amortize scheduling them, and there are a few
+  // per thread for load balancing. There are fewer when there are many
+  // partitions, which would make the counts too large to add up.
+  static constexpr int64 kMinElementsPerBlock = 16384;
+
+  void SplitIntoBlocks(OpKernelContext* c, int64 N, int64 slice_size,
+                       Blocks* blocks) {
+    const int num_threads =
+        c->device()->tensorflow_cpu_worker_threads()->num_threads;
+    const int64 max_blocks = std::max<int64>(
+        1, std::min<int64>(4 * num_threads, N / std::max(num_partitions_, 1)));
+    const int64 min_rows = kMinElementsPerBlock / (slice_size + 1) + 1;
+    blocks->rows_per_block =
+        std::max(min_rows, (N + max_blocks - 1) / max_blocks);
+    blocks->num_blocks =
+        (N + blocks->rows_per_block - 1) / blocks->rows_per_block;
+    blocks->offsets.assign(blocks->num_blocks * num_partitions_, 0);
+  }
 };
 
 template <class T>
@@ -91,67 +169,62 @@ class DynamicPartitionOp : public DynamicPartitionOp_Shared {
     const Tensor* data;
     const Tensor* partitions;
     OpOutputList outputs;
-    ValidateAndAllocateOutputs(c, &data, &partitions, &outputs);
+    Blocks blocks;
+    ValidateAndAllocateOutputs(c, &data, &partitions, &outputs, &blocks);
     if (!c->status().ok()) return;
     if (num_partitions_ == 0 || data->NumElements() == 0) return;
 
     auto e_partitions = partitions->flat<int32>();
     const int64 N = e_partitions.dimension(0);
-    gtl::InlinedVector<int, 32> output_index(num_partitions_);
-
-    if (partitions->dims() == data->dims()) {
-      // Walk through data and copy the data to the appropriate output tensor
-      const auto data_flat = data->flat<T>();
-      std::vector<Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
-                                   Eigen::Aligned> > out_vec;
-      out_vec.reserve(num_partitions_);
-      for (int p = 0; p < num_partitions_; p++) {
-        out_vec.push_back(outputs[p]->vec<T>());
-      }
-      for (int64 i = 0; i < N; i++) {
-        const int32 p = internal::SubtleMustCopy(e_partitions(i));
-        OP_REQUIRES(
-            c, FastBoundsCheck(p, num_partitions_),
-            errors::InvalidArgument("indices[", i, "] is out of range"));
-        auto oi = output_index[p];
-        OP_REQUIRES(c, FastBoundsCheck(oi, out_vec[p].size()),
-                    errors::InvalidArgument(
-                        "out_vec[", p, "] size: ", out_vec[p].size(),
-                        " is not LTE output_index[", p, "] : ", oi));
-        out_vec[p](oi) = data_flat(i);
-        output_index[p]++;
-      }
-    } else {
-      // If data has extra dimensions, use Eigen slices
-      std::vector<Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
-                                   Eigen::Aligned> > out_flat;
-      out_flat.reserve(num_partitions_);
-      for (int p = 0; p < num_partitions_; p++) {
-        out_flat.push_back(outputs[p]->flat_outer_dims<T>());
-      }
+    const int64 slice_size = data->NumElements() / N;
+    const T* data_base = data->flat<T>().data();
+    gtl::InlinedVector<T*, 32> out_base(num_partitions_);
+    gtl::InlinedVector<int64, 32> out_rows(num_partitions_);
+    for (int p = 0; p < num_partitions_; p++) {
+      out_base[p] = outputs[p]->flat<T>().data();
+      out_rows[p] = outputs[p]->dim_size(0);
+    }
 
-      // Walk through data and copy the data to the appropriate output tensor
-      const int64 slice_size = data->NumElements() / N;
-      const auto data_flat = data->shaped<T, 2>({N, slice_size});
-      Eigen::DSizes<Eigen::DenseIndex, 2> sizes(1, slice_size);
-      for (int64 i = 0; i < N; i++) {
-        // outputs[p][output_index[p]++] = data[i]
-        const int32 p = internal::SubtleMustCopy(e_partitions(i));
-        OP_REQUIRES(
-            c, FastBoundsCheck(p, num_partitions_),
-            errors::InvalidArgument("indices[", i,
-                                    "] has been asynchronously overwitten and "
-                                    "is no longer in range!"));
-        auto oi = output_index[p];
-        OP_REQUIRES(c, FastBoundsCheck(oi, out_flat[p].dimension(0)),
-                    errors::InvalidArgument("Size of output_index: ", oi,
-                                            " is no longer in range."));
-        Eigen::DSizes<Eigen::DenseIndex, 2> out_indices(oi, 0);
-        Eigen::DSizes<Eigen::DenseIndex, 2> data_indices(i, 0);
-        out_flat[p].slice(out_indices, sizes) =
-            data_flat.slice(data_indices, sizes);
-        output_index[p]++;
-      }
+    // Walk through data and copy each run of consecutive rows that go to the
+    // same partition to the appropriate output tensor at once. The partitions
+    // are read again, so they are checked again in case they have changed
+    // since they were counted.
+    std::vector<int64> first_invalid(blocks.num_blocks, N);
+    RunBlocks(
+        c, blocks, N, slice_size, [&](int64 b, int64 start, int64 limit) {
+          const int64* block_offsets =
+              blocks.offsets.data() + b * num_partitions_;
+          const int64* next_block_offsets =
+              b + 1 < blocks.num_blocks ? block_offsets + num_partitions_
+                                        : out_rows.data();
+          gtl::InlinedVector<int64, 32> output_index(
+              block_offsets, block_offsets + num_partitions_);
+          int64 i = start;
+          while (i < limit) {
+            const int32 p = internal::SubtleMustCopy(e_partitions(i));
+            int64 run_limit = i + 1;
+            while (run_limit < limit &&
+                   internal::SubtleMustCopy(e_partitions(run_limit)) == p) {
+              run_limit++;
+            }
+            if (!FastBoundsCheck(p, num_partitions_) ||
+                output_index[p] + (run_limit - i) > next_block_offsets[p]) {
+              first_invalid[b] = i;
+              return;
+            }
+            std::copy(data_base + i * slice_size,
+                      data_base + run_limit * slice_size,
+                      out_base[p] + output_index[p] * slice_size);
+            output_index[p] += run_limit - i;
+            i = run_limit;
+          }
+        });
+    for (int64 b = 0; b < blocks.num_blocks; b++) {
+      OP_REQUIRES(c, first_invalid[b] == N,
+                  errors::InvalidArgument(
+                      "partitions[", first_invalid[b],
+                      "] has been asynchronously overwritten and is no "
+                      "longer in range!"));
     }
   }
 };
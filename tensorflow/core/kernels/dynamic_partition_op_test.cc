@@ -15,7 +15,9 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
@@ -23,10 +25,12 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -153,5 +157,70 @@ TEST_F(DynamicPartitionOpTest, Error_IndexOutOfRange) {
       << s;
 }
 
+TEST_F(DynamicPartitionOpTest, ManyRows) {
+  MakeOp();
+
+  // Enough rows to be split into several blocks, with runs of rows in the
+  // same partition that cross block boundaries.
+  const int kRows = 100000;
+  std::vector<float> data(kRows);
+  std::vector<int32> partitions(kRows);
+  std::vector<std::vector<float>> expected(4);
+  for (int i = 0; i < kRows; i++) {
+    data[i] = i;
+    partitions[i] = (i / 7 + i / 1000) % 4;
+    expected[partitions[i]].push_back(i);
+  }
+  AddInputFromArray<float>(TensorShape({kRows}), data);
+  AddInputFromArray<int32>(TensorShape({kRows}), partitions);
+  TF_ASSERT_OK(RunOpKernel());
+
+  for (int p = 0; p < 4; p++) {
+    Tensor expected_p(allocator(), DT_FLOAT,
+                      TensorShape({static_cast<int64>(expected[p].size())}));
+    test::FillValues<float>(&expected_p, expected[p]);
+    test::ExpectTensorEqual<float>(expected_p, *GetOutput(p));
+  }
+}
+
+static Graph* DynamicPartition(int num_partitions, int rows, int slice_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor data(DT_FLOAT, TensorShape({rows, slice_size}));
+  data.flat<float>().setRandom();
+  Tensor partitions(DT_INT32, TensorShape({rows}));
+  auto partitions_vec = partitions.vec<int32>();
+  for (int i = 0; i < rows; i++) {
+    // Scatters the rows, like the ids of an embedding sharded by id % n.
+    partitions_vec(i) = (i * 7919) % num_partitions;
+  }
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DynamicPartition")
+                  .Input(test::graph::Constant(g, data))
+                  .Input(test::graph::Constant(g, partitions))
+                  .Attr("num_partitions", num_partitions)
+                  .Finalize(g, &node));
+  return g;
+}
+
+// Sweeps over (number of partitions, slice size) pairs.
+static void BM_DynamicPartition(int iters, int num_partitions,
+                                int slice_size) {
+  const int kRows = (1 << 20) / slice_size;
+  const int64 tot = static_cast<int64>(iters) * kRows * slice_size;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * sizeof(float));
+  testing::UseRealTime();
+  test::Benchmark("cpu", DynamicPartition(num_partitions, kRows, slice_size))
+      .Run(iters);
+}
+BENCHMARK(BM_DynamicPartition)
+    ->ArgPair(2, 1)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 1)
+    ->ArgPair(2, 64)
+    ->ArgPair(16, 64)
+    ->ArgPair(256, 64)
+    ->ArgPair(1024, 64);
+
 }  // namespace
 }  // namespace tensorflow
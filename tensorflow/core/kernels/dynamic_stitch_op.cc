@@ -15,10 +15,17 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -100,45 +107,154 @@ class DynamicStitchOp : public OpKernel {
     // merged that aren't covered by an index in indices.  What should we do?
     if (first_dim_size > 0) {
       auto merged_flat = merged->flat_outer_dims<T>();
-      const int slice_size = merged_flat.dimension(1);
-      for (int input_num = 0; input_num < indices_inputs.size(); input_num++) {
-        const Tensor& indices = indices_inputs[input_num];
-        auto indices_vec = indices.flat<int32>();
-        const Tensor& data = data_inputs[input_num];
-        auto data_flat =
-            data.shaped<T, 2>({indices_vec.dimension(0), slice_size});
-
-        if (DataTypeCanUseMemcpy(DataTypeToEnum<T>::v())) {
-          T* merged_base = &merged_flat(0, 0);
-          const T* data_base = &data_flat(0, 0);
-          const size_t slice_bytes = slice_size * sizeof(T);
-          for (int i = 0; i < indices_vec.size(); i++) {
-            int32 index = internal::SubtleMustCopy(indices_vec(i));
-            OP_REQUIRES(
-                c, FastBoundsCheck(index, first_dim_size),
-                errors::InvalidArgument("indices[", i, "] is out of range"));
-            memcpy(merged_base + index * slice_size, data_base + i * slice_size,
-                   slice_bytes);
-          }
-        } else {
-          Eigen::DSizes<Eigen::DenseIndex, 2> sizes(1, slice_size);
-          for (int i = 0; i < indices_vec.size(); i++) {
-            // Copy slice data[i] to merged[indices[i]]
-            Eigen::DSizes<Eigen::DenseIndex, 2> data_indices(i, 0);
-            int32 index = internal::SubtleMustCopy(indices_vec(i));
-            OP_REQUIRES(
-                c, FastBoundsCheck(index, first_dim_size),
-                errors::InvalidArgument("indices[", i, "] is out of range"));
-            Eigen::DSizes<Eigen::DenseIndex, 2> merged_indices(index, 0);
-            merged_flat.slice(merged_indices, sizes) =
-                data_flat.slice(data_indices, sizes);
-          }
-        }
+      const int64 slice_size = merged_flat.dimension(1);
+      int64 num_slices = 0;
+      for (const Tensor& indices : indices_inputs) {
+        num_slices += indices.NumElements();
+      }
+      const int num_threads =
+          c->device()->tensorflow_cpu_worker_threads()->num_threads;
+      if (num_threads > 1 &&
+          num_slices * (slice_size + 1) >= kMinParallelElements) {
+        ParallelStitch(c, indices_inputs, data_inputs, num_slices,
+                       first_dim_size, slice_size, merged_flat.data());
+      } else {
+        SerialStitch(c, indices_inputs, data_inputs, first_dim_size,
+                     slice_size, merged_flat.data());
       }
     }
   }
 
  private:
+  // Inputs with fewer elements are stitched on the calling thread.
+  static constexpr int64 kMinParallelElements = 32768;
+
+  // Copies data[m][i] to merged[indices[m][i]] in the order of (m, i), so
+  // that later slices overwrite earlier ones with the same index, and copies
+  // each run of slices to consecutive indices at once.
+  static void SerialStitch(OpKernelContext* c,
+                           const OpInputList& indices_inputs,
+                           const OpInputList& data_inputs,
+                           int32 first_dim_size, int64 slice_size,
+                           T* merged_base) {
+    for (int input_num = 0; input_num < indices_inputs.size(); input_num++) {
+      auto indices_vec = indices_inputs[input_num].flat<int32>();
+      const T* data_base = data_inputs[input_num].flat<T>().data();
+      const int64 n = indices_vec.size();
+      int64 i = 0;
+      while (i < n) {
+        const int32 index = internal::SubtleMustCopy(indices_vec(i));
+        OP_REQUIRES(
+            c, FastBoundsCheck(index, first_dim_size),
+            errors::InvalidArgument("indices[", i, "] is out of range"));
+        int64 run_limit = i + 1;
+        while (run_limit < n && index + (run_limit - i) < first_dim_size &&
+               internal::SubtleMustCopy(indices_vec(run_limit)) ==
+                   index + (run_limit - i)) {
+          run_limit++;
+        }
+        std::copy(data_base + i * slice_size,
+                  data_base + run_limit * slice_size,
+                  merged_base + index * slice_size);
+        i = run_limit;
+      }
+    }
+  }
+
+  // Numbers the slices of all data inputs in the order of (m, i) and first
+  // finds, in parallel, the largest number of a slice copied to each index of
+  // merged, i.e. the slice that SerialStitch would leave there. Then fills
+  // merged in parallel from those slices.
+  static void ParallelStitch(OpKernelContext* c,
+                             const OpInputList& indices_inputs,
+                             const OpInputList& data_inputs, int64 num_slices,
+                             int32 first_dim_size, int64 slice_size,
+                             T* merged_base) {
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *c->device()->tensorflow_cpu_worker_threads();
+    const int num_inputs = indices_inputs.size();
+    // Slice 'g' is data[m][g - input_start[m]].
+    std::vector<int64> input_start(num_inputs + 1, 0);
+    std::vector<const int32*> indices_base(num_inputs);
+    std::vector<const T*> data_base(num_inputs);
+    for (int m = 0; m < num_inputs; m++) {
+      input_start[m + 1] = input_start[m] + indices_inputs[m].NumElements();
+      indices_base[m] = indices_inputs[m].flat<int32>().data();
+      data_base[m] = data_inputs[m].flat<T>().data();
+    }
+    // Returns the input of slice 'g'.
+    auto input_of = [&input_start](int64 g) {
+      return static_cast<int>(
+          std::upper_bound(input_start.begin(), input_start.end(), g) -
+          input_start.begin() - 1);
+    };
+
+    std::unique_ptr<std::atomic<int64>[]> source(
+        new std::atomic<int64>[first_dim_size]);
+    Shard(worker_threads.num_threads, worker_threads.workers, first_dim_size,
+          1, [&source](int64 start, int64 limit) {
+            for (int64 r = start; r < limit; r++) {
+              source[r].store(-1, std::memory_order_relaxed);
+            }
+          });
+
+    mutex mu;
+    int64 first_invalid = num_slices;
+    Shard(worker_threads.num_threads, worker_threads.workers, num_slices, 10,
+          [&](int64 start, int64 limit) {
+            int m = input_of(start);
+            for (int64 g = start; g < limit; g++) {
+              while (g >= input_start[m + 1]) m++;
+              const int32 index = internal::SubtleMustCopy(
+                  indices_base[m][g - input_start[m]]);
+              if (!FastBoundsCheck(index, first_dim_size)) {
+                mutex_lock l(mu);
+                first_invalid = std::min(first_invalid, g);
+                return;
+              }
+              std::atomic<int64>& s = source[index];
+              int64 current = s.load(std::memory_order_relaxed);
+              while (current < g &&
+                     !s.compare_exchange_weak(current, g,
+                                              std::memory_order_relaxed)) {
+              }
+            }
+          });
+    if (first_invalid < num_slices) {
+      const int m = input_of(first_invalid);
+      c->CtxFailure(errors::InvalidArgument(
+          "indices[", first_invalid - input_start[m], "] is out of range"));
+      return;
+    }
+
+    // Each run of indices filled from consecutive slices of the same input is
+    // copied at once.
+    Shard(worker_threads.num_threads, worker_threads.workers, first_dim_size,
+          slice_size, [&](int64 start, int64 limit) {
+            int64 r = start;
+            while (r < limit) {
+              const int64 g = source[r].load(std::memory_order_relaxed);
+              if (g < 0) {
+                r++;
+                continue;
+              }
+              const int m = input_of(g);
+              int64 run_limit = r + 1;
+              while (run_limit < limit &&
+                     g + (run_limit - r) < input_start[m + 1] &&
+                     source[run_limit].load(std::memory_order_relaxed) ==
+                         g + (run_limit - r)) {
+                run_limit++;
+              }
+              const T* slices =
+                  data_base[m] + (g - input_start[m]) * slice_size;
+              std::copy(slices, slices + (run_limit - r) * slice_size,
+                        merged_base + r * slice_size);
+              r = run_limit;
+            }
+          });
+  }
+
   // Check if data0.shape[indices0.dims():] == data1.shape[indices1.dims():]
   static bool SameExtraShape(const Tensor& data0, const Tensor& indices0,
                              const Tensor& data1, const Tensor& indices1) {
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
@@ -23,12 +25,14 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -141,5 +145,88 @@ TEST_F(DynamicStitchOpTest, Error_DataAndIndicesSizeMismatch) {
       << s;
 }
 
+TEST_F(DynamicStitchOpTest, ManyRowsWithDuplicates) {
+  MakeOp(2, DT_FLOAT);
+
+  // Enough rows to be stitched in parallel. The second input overwrites
+  // every third row of the first one, and later rows of an input overwrite
+  // earlier rows with the same index.
+  const int kRows = 30000;
+  std::vector<int32> indices0(kRows);
+  std::vector<float> data0(kRows);
+  for (int i = 0; i < kRows; i++) {
+    indices0[i] = i;
+    data0[i] = i;
+  }
+  std::vector<int32> indices1;
+  std::vector<float> data1;
+  for (int i = 0; i < kRows; i += 3) {
+    indices1.push_back(i);
+    data1.push_back(-1);
+    indices1.push_back(i);
+    data1.push_back(-i);
+  }
+  std::vector<float> expected_values(kRows);
+  for (int i = 0; i < kRows; i++) {
+    expected_values[i] = i % 3 == 0 ? -i : i;
+  }
+  const int64 n1 = indices1.size();
+  AddInputFromArray<int32>(TensorShape({kRows}), indices0);
+  AddInputFromArray<int32>(TensorShape({n1}), indices1);
+  AddInputFromArray<float>(TensorShape({kRows}), data0);
+  AddInputFromArray<float>(TensorShape({n1}), data1);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kRows}));
+  test::FillValues<float>(&expected, expected_values);
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+// Stitches back the outputs of partitioning 'rows' rows of 'slice_size'
+// floats into 'num_partitions' partitions by row % num_partitions.
+static Graph* DynamicStitch(int num_partitions, int rows, int slice_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  std::vector<NodeBuilder::NodeOut> indices;
+  std::vector<NodeBuilder::NodeOut> data;
+  for (int p = 0; p < num_partitions; p++) {
+    const int n = (rows - p + num_partitions - 1) / num_partitions;
+    Tensor indices_p(DT_INT32, TensorShape({n}));
+    auto indices_vec = indices_p.vec<int32>();
+    for (int i = 0; i < n; i++) {
+      indices_vec(i) = p + i * num_partitions;
+    }
+    Tensor data_p(DT_FLOAT, TensorShape({n, slice_size}));
+    data_p.flat<float>().setRandom();
+    indices.push_back(test::graph::Constant(g, indices_p));
+    data.push_back(test::graph::Constant(g, data_p));
+  }
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DynamicStitch")
+                  .Input(indices)
+                  .Input(data)
+                  .Finalize(g, &node));
+  return g;
+}
+
+// Sweeps over (number of partitions, slice size) pairs.
+static void BM_DynamicStitch(int iters, int num_partitions, int slice_size) {
+  const int kRows = (1 << 20) / slice_size;
+  const int64 tot = static_cast<int64>(iters) * kRows * slice_size;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * sizeof(float));
+  testing::UseRealTime();
+  test::Benchmark("cpu", DynamicStitch(num_partitions, kRows, slice_size))
+      .Run(iters);
+}
+BENCHMARK(BM_DynamicStitch)
+    ->ArgPair(1, 1)
+    ->ArgPair(2, 1)
+    ->ArgPair(16, 1)
+    ->ArgPair(256, 1)
+    ->ArgPair(1, 64)
+    ->ArgPair(2, 64)
+    ->ArgPair(16, 64)
+    ->ArgPair(256, 64);
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,44 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_FINGERPRINT_LANES_H_
+#define TENSORFLOW_KERNELS_FINGERPRINT_LANES_H_
+
+// Fingerprint64 of many strings at once.
+//
+// Fingerprint64 hashes a string of over 64 bytes in a loop over its 64 byte
+// blocks, with a chain of multiplies from each block to the next. Hashing
+// such strings one after the other leaves the CPU waiting on that chain, as
+// it cannot look far enough ahead to start on the next string. Here the
+// loops of several strings run in lockstep, so that
+// their chains overlap. Shorter strings are hashed by Fingerprint64 itself.
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Sets out[i] = Fingerprint64(in[i]) for i in [0, n).
+void Fingerprint64Lanes(const string* in, int64 n, uint64* out);
+
+// Returns whether Fingerprint64Lanes is expected to be faster than calling
+// Fingerprint64 on each of the 'n' strings at 'in'. It only is when the bytes
+// of the strings do not fit in the caches: on cached strings the lockstep
+// loops cost more than they overlap. Callers that shard their strings should
+// ask once for all of them, not per shard.
+bool UseFingerprint64Lanes(const string* in, int64 n);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_FINGERPRINT_LANES_H_
@@ -0,0 +1,153 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/fingerprint_lanes.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/platform.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns 'n' strings of lengths drawn uniformly from [min_length,
+// max_length], with bytes drawn uniformly from all 256 values.
+std::vector<string> RandomStrings(int n, int min_length, int max_length) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> strings(n);
+  for (string& s : strings) {
+    s.resize(min_length + rnd.Uniform(max_length - min_length + 1));
+    for (char& c : s) {
+      c = static_cast<char>(rnd.Uniform(256));
+    }
+  }
+  return strings;
+}
+
+void ExpectFingerprint64(const std::vector<string>& strings) {
+  std::vector<uint64> out(strings.size());
+  Fingerprint64Lanes(strings.data(), strings.size(), out.data());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(Fingerprint64(strings[i]), out[i])
+        << "string " << i << " of length " << strings[i].size();
+  }
+}
+
+TEST(Fingerprint64LanesTest, Empty) {
+  Fingerprint64Lanes(nullptr, 0, nullptr);
+}
+
+TEST(Fingerprint64LanesTest, KnownValues) {
+  const std::vector<string> strings = {"", "Hello", "World"};
+  std::vector<uint64> out(strings.size());
+  Fingerprint64Lanes(strings.data(), strings.size(), out.data());
+  EXPECT_EQ(Fingerprint64(""), out[0]);
+  EXPECT_EQ(15404698994557526151ULL, out[1]);
+  EXPECT_EQ(18308117990299812472ULL, out[2]);
+}
+
+// Each length up to several blocks, so that the lanes finish after different
+// numbers of blocks and with every size of tail.
+TEST(Fingerprint64LanesTest, AllLengths) {
+  random::PhiloxRandom philox(7, 11);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> strings;
+  for (int length = 0; length <= 700; ++length) {
+    string s(length, '\0');
+    for (char& c : s) {
+      c = static_cast<char>(rnd.Uniform(256));
+    }
+    strings.push_back(s);
+  }
+  ExpectFingerprint64(strings);
+}
+
+TEST(Fingerprint64LanesTest, MixedLengths) {
+  ExpectFingerprint64(RandomStrings(5000, 0, 2000));
+}
+
+// Long strings alone, and fewer of them than there are lanes.
+TEST(Fingerprint64LanesTest, FewLongStrings) {
+  for (int n = 1; n <= 9; ++n) {
+    ExpectFingerprint64(RandomStrings(n, 65, 300));
+  }
+}
+
+// The lanes are only worth it for strings that do not fit in cache.
+TEST(Fingerprint64LanesTest, UseOnlyForLargeInputs) {
+  EXPECT_FALSE(UseFingerprint64Lanes(nullptr, 0));
+  std::vector<string> strings(1 << 15, string(100, 'x'));
+  EXPECT_FALSE(UseFingerprint64Lanes(strings.data(), strings.size()));
+#if !defined(PLATFORM_GOOGLE)
+  if (!port::kLittleEndian) return;
+  strings.assign(1 << 15, string(1024, 'x'));
+  EXPECT_TRUE(UseFingerprint64Lanes(strings.data(), strings.size()));
+#endif
+}
+
+// Hashes through Fingerprint64Lanes (lanes = true) or a loop over
+// Fingerprint64, to compare the two.
+static void BM_Fingerprint64(int iters, bool lanes, int min_length,
+                             int max_length) {
+  testing::StopTiming();
+  const int kStrings = 1 << 16;
+  const std::vector<string> strings =
+      RandomStrings(kStrings, min_length, max_length);
+  std::vector<uint64> out(kStrings);
+  const int64 tot = static_cast<int64>(iters) * kStrings;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * (min_length + max_length) / 2);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    if (lanes) {
+      Fingerprint64Lanes(strings.data(), kStrings, out.data());
+    } else {
+      for (int j = 0; j < kStrings; ++j) {
+        out[j] = Fingerprint64(strings[j]);
+      }
+    }
+  }
+  testing::StopTiming();
+  uint64 x = 0;
+  for (uint64 h : out) x ^= h;
+  CHECK_NE(x, 0);
+}
+
+static void BM_Fingerprint64Loop(int iters, int min_length, int max_length) {
+  BM_Fingerprint64(iters, false, min_length, max_length);
+}
+static void BM_Fingerprint64Lanes(int iters, int min_length, int max_length) {
+  BM_Fingerprint64(iters, true, min_length, max_length);
+}
+BENCHMARK(BM_Fingerprint64Loop)
+    ->ArgPair(8, 64)
+    ->ArgPair(64, 128)
+    ->ArgPair(256, 1024)
+    ->ArgPair(1, 1024);
+BENCHMARK(BM_Fingerprint64Lanes)
+    ->ArgPair(8, 64)
+    ->ArgPair(64, 128)
+    ->ArgPair(256, 1024)
+    ->ArgPair(1, 1024);
+
+}  // namespace
+}  // namespace tensorflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/type_traits.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -29,10 +30,13 @@ typedef Eigen::ThreadPoolDevice CPUDevice;
 
 namespace functor {
 
-// Helper method to copy using memcpy.
+// Helper method to copy using memcpy. The (batch, index) pairs are sharded
+// over the threads of "d", with a cost proportional to the slice size.
+// Returns the smallest position in "indices" that is out of bounds, or -1.
 template <typename T, typename Index, typename SliceIndex,
-          SliceIndex static_slice_elems>
-SliceIndex HandleCopies(typename TTypes<T, 3>::ConstTensor params,
+          SliceIndex static_slice_elems, typename Device>
+SliceIndex HandleCopies(const Device& d,
+                        typename TTypes<T, 3>::ConstTensor params,
                         typename TTypes<Index>::ConstFlat indices,
                         SliceIndex slice_elems,
                         typename TTypes<T, 3>::Tensor out) {
@@ -47,8 +51,16 @@ SliceIndex HandleCopies(typename TTypes<T, 3>::ConstTensor params,
   }
   // Compute slice_bytes here so that static knowledge is available
   const size_t slice_bytes = slice_elems * sizeof(T);
-  for (SliceIndex b = 0; b < batch_size; b++) {
-    for (SliceIndex i = 0; i < indices_size; i++) {
+
+  mutex mu;
+  // The smallest out-of-bounds position seen by any shard.
+  SliceIndex result = -1;
+  auto work = [&](int64 start, int64 end) {
+    SliceIndex b = static_cast<SliceIndex>(start / indices_size);
+    SliceIndex i = static_cast<SliceIndex>(start % indices_size);
+    const SliceIndex b_end = static_cast<SliceIndex>(end / indices_size);
+    const SliceIndex i_end = static_cast<SliceIndex>(end % indices_size);
+    while (b < b_end || (b == b_end && i < i_end)) {
       const SliceIndex i_next = i + 1;
       const SliceIndex b_next = b + 1;
       if (i_next < indices_size) {
@@ -62,7 +74,11 @@ SliceIndex HandleCopies(typename TTypes<T, 3>::ConstTensor params,
       // code checked it and then grabbed it from memory a second time, which
       // was a security risk since it could have changed in between.
       const Index index = internal::SubtleMustCopy(indices(i));
-      if (!FastBoundsCheck(index, limit)) return i;
+      if (!FastBoundsCheck(index, limit)) {
+        mutex_lock l(mu);
+        if (result < 0 || i < result) result = i;
+        return;
+      }
       // Copy using memcpy if possible, otherwise an Eigen loop
       // TODO(cwhipkey): avoid linking to framework to get Allocator (to improve
       // ahead-of-time compilation binary size).
@@ -75,18 +91,54 @@ SliceIndex HandleCopies(typename TTypes<T, 3>::ConstTensor params,
                slice_bytes);
       } else {
         // For non-"simple" types (e.g. strings).
-        out.template chip<1>(i) = params.template chip<1>(index);
+        out.template chip<0>(b).template chip<0>(i) =
+            params.template chip<0>(b).template chip<0>(index);
+      }
+      if (i_next < indices_size) {
+        i = i_next;
+      } else {
+        i = 0;
+        b = b_next;
       }
     }
-  }
-  return -1;
+  };
+  d.parallelFor(static_cast<int64>(batch_size) * indices_size,
+                Eigen::TensorOpCost(slice_bytes, slice_bytes, 0), work);
+  return result;
 }
 
+// Stands in for a CPUDevice in HandleCopies when the caller has none, and
+// runs all the copies on the calling thread.
+struct SerialCopyDevice {
+  template <typename Work>
+  void parallelFor(int64 n, const Eigen::TensorOpCost& cost,
+                   Work work) const {
+    work(0, n);
+  }
+};
+
 template <typename T, typename Index>
 struct GatherFunctorCPU {
+  int64 operator()(const CPUDevice& d,
+                   typename TTypes<T, 3>::ConstTensor params,
+                   typename TTypes<Index>::ConstFlat indices,
+                   typename TTypes<T, 3>::Tensor out) {
+    return Run(d, params, indices, out);
+  }
+
+  // For callers without a CPUDevice, such as the XLA CPU custom calls in
+  // tf2xla/kernels/gather_op_kernel_float_*.cc. Copies serially.
   int64 operator()(typename TTypes<T, 3>::ConstTensor params,
                    typename TTypes<Index>::ConstFlat indices,
                    typename TTypes<T, 3>::Tensor out) {
+    return Run(SerialCopyDevice(), params, indices, out);
+  }
+
+ private:
+  template <typename Device>
+  static int64 Run(const Device& d, typename TTypes<T, 3>::ConstTensor params,
+                   typename TTypes<Index>::ConstFlat indices,
+                   typename TTypes<T, 3>::Tensor out) {
     const int64 N = indices.size();
     const int64 slice_size = out.dimension(2);
     int64 bad_i;
@@ -94,16 +146,16 @@ struct GatherFunctorCPU {
     bool use_large = (slice_size > std::numeric_limits<int32>::max() ||
                       params.size() > std::numeric_limits<int32>::max() ||
                       N > std::numeric_limits<int32>::max());
-#define CALL(elems)                                                   \
-  do {                                                                \
-    if (use_large) {                                                  \
-      bad_i = HandleCopies<T, Index, int64, elems>(params, indices,   \
-                                                   slice_size, out);  \
-    } else {                                                          \
-      const int32 small_slice = static_cast<int32>(slice_size);       \
-      bad_i = HandleCopies<T, Index, int32, elems>(params, indices,   \
-                                                   small_slice, out); \
-    }                                                                 \
+#define CALL(elems)                                                      \
+  do {                                                                   \
+    if (use_large) {                                                     \
+      bad_i = HandleCopies<T, Index, int64, elems>(d, params, indices,   \
+                                                   slice_size, out);     \
+    } else {                                                             \
+      const int32 small_slice = static_cast<int32>(slice_size);          \
+      bad_i = HandleCopies<T, Index, int32, elems>(d, params, indices,   \
+                                                   small_slice, out);    \
+    }                                                                    \
   } while (0)
 
     if (slice_size == 10)
@@ -131,7 +183,7 @@ struct GatherFunctor<CPUDevice, T, Index> {
                    typename TTypes<T, 3>::ConstTensor params,
                    typename TTypes<Index>::ConstFlat indices,
                    typename TTypes<T, 3>::Tensor out) {
-    return GatherFunctorCPU<T, Index>()(params, indices, out);
+    return GatherFunctorCPU<T, Index>()(d, params, indices, out);
   }
 };
 
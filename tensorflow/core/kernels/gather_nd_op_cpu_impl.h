@@ -103,20 +103,22 @@ struct GatherNdSlice<CPUDevice, T, Index, IXDIM> {
     std::atomic<Index> error_loc(-1);
 
     const Eigen::DenseIndex batch_size = Tindices.dimension(0);
-#if !defined(EIGEN_HAS_INDEX_LIST)
-    Eigen::Tensor<Eigen::DenseIndex, 1>::Dimensions reshape_dims{{ 1 }};
-    Eigen::array<Eigen::DenseIndex, 1> broadcast_dims{{ batch_size }};
-#else
-    Eigen::IndexList<Eigen::type2index<1> > reshape_dims;
-    Eigen::IndexList<Eigen::DenseIndex> broadcast_dims;
-    broadcast_dims.set(0, batch_size);
-#endif
     generator::GatherNdSliceGenerator<T, Index, IXDIM> gather_nd_generator(
         slice_size, Tindices, Tparams, Tout, &error_loc);
-    Tscratch.device(d) = Tscratch.reshape(reshape_dims)
-                             .broadcast(broadcast_dims)
-                             .generate(gather_nd_generator)
-                             .sum();
+    // Each location reads its IXDIM indices and copies one slice, so the
+    // locations are sharded with a cost proportional to the slice size.
+    auto work = [&gather_nd_generator](int64 start, int64 end) {
+      Eigen::array<Eigen::DenseIndex, 1> loc;
+      for (int64 i = start; i < end; ++i) {
+        loc[0] = i;
+        gather_nd_generator(loc);
+      }
+    };
+    const int64 slice_bytes = slice_size * sizeof(T);
+    d.parallelFor(batch_size,
+                  Eigen::TensorOpCost(slice_bytes + IXDIM * sizeof(Index),
+                                      slice_bytes, IXDIM),
+                  work);
 
     // error_loc() returns -1 if there's no out-of-bounds index,
     // otherwise it returns the location of an OOB index in Tindices.
@@ -125,5 +125,44 @@ BM_GATHER_ND(gpu, int32);
 BM_GATHER_ND(cpu, int64);
 BM_GATHER_ND(gpu, int64);
 
+// Gathers whole [8, 16, 32] slices, so that the cost of each lookup is
+// dominated by the copy rather than by the index computation.
+template <typename Index>
+static Graph* GatherNdSlices(int lookups) {
+  Graph* g = new Graph(OpRegistry::Global());
+  const int kRows = 1000;
+  Tensor params(DT_FLOAT, TensorShape({kRows, 8, 16, 32}));
+  params.flat<float>().setRandom();
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor indices(DataTypeToEnum<Index>::value, TensorShape({lookups, 1}));
+  auto indices_mat = indices.matrix<Index>();
+  for (int i = 0; i < lookups; i++) {
+    indices_mat(i, 0) = rnd.Uniform(kRows);
+  }
+
+  test::graph::GatherNd(g, test::graph::Constant(g, params),
+                        test::graph::Constant(g, indices));
+  return g;
+}
+
+#define BM_GATHER_ND_SLICES(DEVICE, INDEX)                               \
+  static void BM_##DEVICE##_gather_nd_slices_##INDEX(int iters,          \
+                                                    int lookups) {       \
+    const int64 tot = static_cast<int64>(iters) * lookups * 8 * 16 * 32; \
+    testing::ItemsProcessed(tot);                                        \
+    testing::BytesProcessed(tot * sizeof(float));                        \
+    testing::UseRealTime();                                              \
+    test::Benchmark(#DEVICE, GatherNdSlices<INDEX>(lookups)).Run(iters); \
+  }                                                                      \
+  BENCHMARK(BM_##DEVICE##_gather_nd_slices_##INDEX)                      \
+      ->Arg(10)                                                          \
+      ->Arg(100)                                                         \
+      ->Arg(2000)
+
+BM_GATHER_ND_SLICES(cpu, int32);
+BM_GATHER_ND_SLICES(cpu, int64);
+
 }  // namespace
 }  // namespace tensorflow
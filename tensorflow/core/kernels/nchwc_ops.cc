@@ -0,0 +1,596 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/nn_ops.cc.
+//
+// CPU kernels for the blocked channel layout NCHWc: a tensor with logical
+// shape [N, H, W, C] is stored as [N, ceil(C / c), H, W, c]. Each spatial
+// position then holds c consecutive channels, which is exactly one SIMD
+// register of outputs for c = 8 (AVX) or c = 16 (AVX-512). The convolution
+// below keeps a row of such registers as accumulators and streams both the
+// input row and the packed filter contiguously, instead of striding over the
+// full channel dimension at every position as the NHWC kernels do.
+//
+// Channels past C in the last block are always zero: the conversion writes
+// zeros there, the packed filter and the padded bias are zero there, and max
+// or average pooling of zeros is zero.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/common_shape_fns.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Returns the number of blocks of size 'block' needed to hold 'channels'.
+inline int64 NumChannelBlocks(int64 channels, int64 block) {
+  return (channels + block - 1) / block;
+}
+
+// Checks that 'channels' logical channels fit a blocked tensor with
+// 'num_blocks' blocks of size 'block' without a block of pure padding.
+Status CheckBlockedChannels(int64 channels, int64 num_blocks, int64 block) {
+  if (block <= 0 || channels < 0 ||
+      NumChannelBlocks(channels, block) != num_blocks) {
+    return errors::InvalidArgument(channels, " channels do not match ",
+                                   num_blocks, " blocks of size ", block);
+  }
+  return Status::OK();
+}
+
+// Runs 'work(start, limit)' over [0, total) on the CPU worker threads.
+void ShardRows(OpKernelContext* context, int64 total, int64 cost_per_row,
+               const std::function<void(int64, int64)>& work) {
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, total,
+        cost_per_row, work);
+}
+
+// Calls 'fn' with a compile-time block size for the common SIMD widths, and
+// with 0 (meaning "use the runtime block size") otherwise.
+template <template <int> class Fn, typename... Args>
+void DispatchBlockSize(int64 block, Args&&... args) {
+  switch (block) {
+    case 8:
+      Fn<8>()(block, std::forward<Args>(args)...);
+      break;
+    case 16:
+      Fn<16>()(block, std::forward<Args>(args)...);
+      break;
+    default:
+      Fn<0>()(block, std::forward<Args>(args)...);
+      break;
+  }
+}
+
+}  // namespace
+
+template <typename T>
+class NHWCToNCHWcOp : public OpKernel {
+ public:
+  explicit NHWCToNCHWcOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("block_size", &block_size_));
+    OP_REQUIRES(context, block_size_ >= 1,
+                errors::InvalidArgument("block_size must be positive"));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional: ",
+                                        input.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 rows = input.dim_size(1);
+    const int64 cols = input.dim_size(2);
+    const int64 channels = input.dim_size(3);
+    OP_REQUIRES(context, channels <= std::numeric_limits<int32>::max(),
+                errors::InvalidArgument("too many channels: ", channels));
+    const int64 block = block_size_;
+    const int64 num_blocks = NumChannelBlocks(channels, block);
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch, num_blocks, rows, cols,
+                                                block}),
+                                &output));
+    Tensor* channels_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(1, TensorShape({}),
+                                                     &channels_out));
+    channels_out->scalar<int32>()() = static_cast<int32>(channels);
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // One unit of work is one (n, channel block, row) output row.
+    auto work = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        const int64 r = i % rows;
+        const int64 cb = (i / rows) % num_blocks;
+        const int64 n = i / (rows * num_blocks);
+        const int64 c_begin = cb * block;
+        const int64 c_count = std::min(block, channels - c_begin);
+        const T* src = in + ((n * rows + r) * cols) * channels + c_begin;
+        T* dst = out + i * cols * block;
+        for (int64 col = 0; col < cols; ++col) {
+          std::copy_n(src, c_count, dst);
+          std::fill(dst + c_count, dst + block, T(0));
+          src += channels;
+          dst += block;
+        }
+      }
+    };
+    ShardRows(context, batch * num_blocks * rows, cols * block, work);
+  }
+
+ private:
+  int64 block_size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(NHWCToNCHWcOp);
+};
+
+template <typename T>
+class NCHWcToNHWCOp : public OpKernel {
+ public:
+  explicit NCHWcToNHWCOp(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& channels_t = context->input(1);
+    OP_REQUIRES(context, input.dims() == 5,
+                errors::InvalidArgument("input must be 5-dimensional: ",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(channels_t.shape()),
+                errors::InvalidArgument("channels must be a scalar: ",
+                                        channels_t.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 num_blocks = input.dim_size(1);
+    const int64 rows = input.dim_size(2);
+    const int64 cols = input.dim_size(3);
+    const int64 block = input.dim_size(4);
+    const int64 channels = channels_t.scalar<int32>()();
+    OP_REQUIRES_OK(context, CheckBlockedChannels(channels, num_blocks, block));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch, rows, cols, channels}),
+                                &output));
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // One unit of work is one (n, row) output row.
+    auto work = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        const int64 r = i % rows;
+        const int64 n = i / rows;
+        T* dst = out + i * cols * channels;
+        for (int64 cb = 0; cb < num_blocks; ++cb) {
+          const int64 c_begin = cb * block;
+          const int64 c_count = std::min(block, channels - c_begin);
+          const T* src = in + ((n * num_blocks + cb) * rows + r) * cols * block;
+          for (int64 col = 0; col < cols; ++col) {
+            std::copy_n(src + col * block, c_count,
+                        dst + col * channels + c_begin);
+          }
+        }
+      }
+    };
+    ShardRows(context, batch * rows, cols * channels, work);
+  }
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(NCHWcToNHWCOp);
+};
+
+namespace {
+
+// Shape of a blocked convolution or pooling window, in NHWC terms.
+struct NCHWcWindow {
+  int64 batch;
+  int64 in_blocks;
+  int64 in_rows;
+  int64 in_cols;
+  int64 out_blocks;
+  int64 out_rows;
+  int64 out_cols;
+  int64 window_rows;
+  int64 window_cols;
+  int64 stride_rows;
+  int64 stride_cols;
+  int64 pad_rows;
+  int64 pad_cols;
+};
+
+// Computes one output row (n, out block, out row) of a blocked convolution per
+// unit of work. 'filter' is packed as
+// [out_blocks, in_blocks, window_rows, window_cols, block (in), block (out)],
+// so the innermost loop is a block-wide multiply-add into the accumulators.
+template <int kBlock>
+struct NCHWcConvRows {
+  template <typename T>
+  void operator()(int64 runtime_block, const NCHWcWindow& w, const T* input,
+                  const T* filter, T* output, int64 start, int64 limit) {
+    const int64 block = kBlock > 0 ? kBlock : runtime_block;
+    for (int64 i = start; i < limit; ++i) {
+      const int64 out_r = i % w.out_rows;
+      const int64 ob = (i / w.out_rows) % w.out_blocks;
+      const int64 n = i / (w.out_rows * w.out_blocks);
+      T* out_row = output + i * w.out_cols * block;
+      std::fill(out_row, out_row + w.out_cols * block, T(0));
+      for (int64 ib = 0; ib < w.in_blocks; ++ib) {
+        for (int64 fr = 0; fr < w.window_rows; ++fr) {
+          const int64 in_r = out_r * w.stride_rows + fr - w.pad_rows;
+          if (in_r < 0 || in_r >= w.in_rows) continue;
+          const T* in_row =
+              input + ((n * w.in_blocks + ib) * w.in_rows + in_r) * w.in_cols *
+                          block;
+          for (int64 fc = 0; fc < w.window_cols; ++fc) {
+            const T* f =
+                filter +
+                (((ob * w.in_blocks + ib) * w.window_rows + fr) *
+                     w.window_cols +
+                 fc) *
+                    block * block;
+            for (int64 out_c = 0; out_c < w.out_cols; ++out_c) {
+              const int64 in_c = out_c * w.stride_cols + fc - w.pad_cols;
+              if (in_c < 0 || in_c >= w.in_cols) continue;
+              const T* x = in_row + in_c * block;
+              T* y = out_row + out_c * block;
+              for (int64 ic = 0; ic < block; ++ic) {
+                const T xv = x[ic];
+                const T* f_ic = f + ic * block;
+                for (int64 oc = 0; oc < block; ++oc) {
+                  y[oc] += xv * f_ic[oc];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+template <typename T>
+class NCHWcConv2DOp : public OpKernel {
+ public:
+  explicit NCHWcConv2DOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    OP_REQUIRES(
+        context, strides_[0] == 1 && strides_[3] == 1,
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& filter = context->input(1);
+    OP_REQUIRES(context, input.dims() == 5,
+                errors::InvalidArgument("input must be 5-dimensional: ",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    const int64 block = input.dim_size(4);
+    const int64 in_depth = filter.dim_size(2);
+    const int64 out_depth = filter.dim_size(3);
+    OP_REQUIRES(context, out_depth <= std::numeric_limits<int32>::max(),
+                errors::InvalidArgument("too many output channels: ",
+                                        out_depth));
+
+    NCHWcWindow w;
+    w.batch = input.dim_size(0);
+    w.in_blocks = input.dim_size(1);
+    w.in_rows = input.dim_size(2);
+    w.in_cols = input.dim_size(3);
+    OP_REQUIRES_OK(context,
+                   CheckBlockedChannels(in_depth, w.in_blocks, block));
+    w.out_blocks = NumChannelBlocks(out_depth, block);
+    w.window_rows = filter.dim_size(0);
+    w.window_cols = filter.dim_size(1);
+    w.stride_rows = strides_[1];
+    w.stride_cols = strides_[2];
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(w.in_rows, w.window_rows,
+                                         w.stride_rows, padding_, &w.out_rows,
+                                         &w.pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(w.in_cols, w.window_cols,
+                                         w.stride_cols, padding_, &w.out_cols,
+                                         &w.pad_cols));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({w.batch, w.out_blocks, w.out_rows,
+                                       w.out_cols, block}),
+                       &output));
+    Tensor* channels_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(1, TensorShape({}),
+                                                     &channels_out));
+    channels_out->scalar<int32>()() = static_cast<int32>(out_depth);
+    if (output->NumElements() == 0) return;
+
+    // Pack [rows, cols, in_depth, out_depth] into
+    // [out_blocks, in_blocks, rows, cols, block (in), block (out)],
+    // zero-filling the channels past in_depth and out_depth.
+    Tensor packed_filter;
+    OP_REQUIRES_OK(
+        context,
+        context->allocate_temp(
+            DataTypeToEnum<T>::value,
+            TensorShape({w.out_blocks, w.in_blocks, w.window_rows,
+                         w.window_cols, block, block}),
+            &packed_filter));
+    const T* filter_data = filter.flat<T>().data();
+    T* packed = packed_filter.flat<T>().data();
+    const int64 window_size = w.window_rows * w.window_cols;
+    auto pack = [&](int64 start, int64 limit) {
+      // One unit of work is one (out block, in block) pair.
+      for (int64 i = start; i < limit; ++i) {
+        const int64 ib = i % w.in_blocks;
+        const int64 ob = i / w.in_blocks;
+        T* dst = packed + i * window_size * block * block;
+        for (int64 k = 0; k < window_size; ++k) {
+          for (int64 ic = 0; ic < block; ++ic) {
+            const int64 in_c = ib * block + ic;
+            for (int64 oc = 0; oc < block; ++oc) {
+              const int64 out_c = ob * block + oc;
+              *dst++ = (in_c < in_depth && out_c < out_depth)
+                           ? filter_data[(k * in_depth + in_c) * out_depth +
+                                         out_c]
+                           : T(0);
+            }
+          }
+        }
+      }
+    };
+    ShardRows(context, w.out_blocks * w.in_blocks,
+              window_size * block * block, pack);
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    auto work = [&](int64 start, int64 limit) {
+      DispatchBlockSize<NCHWcConvRows>(block, w, in, packed, out, start,
+                                       limit);
+    };
+    ShardRows(context, w.batch * w.out_blocks * w.out_rows,
+              w.out_cols * w.in_blocks * window_size * block * block, work);
+  }
+
+ private:
+  std::vector<int32> strides_;
+  Padding padding_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(NCHWcConv2DOp);
+};
+
+template <typename T>
+class NCHWcBiasAddOp : public OpKernel {
+ public:
+  explicit NCHWcBiasAddOp(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& bias = context->input(1);
+    OP_REQUIRES(context, input.dims() == 5,
+                errors::InvalidArgument("value must be 5-dimensional: ",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()),
+                errors::InvalidArgument("bias must be 1-D: ",
+                                        bias.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 num_blocks = input.dim_size(1);
+    const int64 spatial = input.dim_size(2) * input.dim_size(3);
+    const int64 block = input.dim_size(4);
+    const int64 channels = bias.dim_size(0);
+    OP_REQUIRES_OK(context, CheckBlockedChannels(channels, num_blocks, block));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                {0}, 0, input.shape(), &output));
+    if (output->NumElements() == 0) return;
+
+    std::vector<T> padded_bias(num_blocks * block, T(0));
+    std::copy_n(bias.flat<T>().data(), channels, padded_bias.begin());
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    // One unit of work is one (n, channel block) plane.
+    auto work = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        const T* b = padded_bias.data() + (i % num_blocks) * block;
+        const T* src = in + i * spatial * block;
+        T* dst = out + i * spatial * block;
+        for (int64 s = 0; s < spatial; ++s) {
+          for (int64 c = 0; c < block; ++c) {
+            dst[c] = src[c] + b[c];
+          }
+          src += block;
+          dst += block;
+        }
+      }
+    };
+    ShardRows(context, batch * num_blocks, spatial * block, work);
+  }
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(NCHWcBiasAddOp);
+};
+
+namespace {
+
+// Computes one output row (n, block, out row) of a blocked max or average
+// pooling per unit of work. Average pooling divides by the number of window
+// positions inside the input, as AvgPool does for SAME padding.
+template <bool kMax>
+struct NCHWcPoolRows {
+  template <int kBlock>
+  struct Impl {
+    template <typename T>
+    void operator()(int64 runtime_block, const NCHWcWindow& w, const T* input,
+                    T* output, int64 start, int64 limit) {
+      const int64 block = kBlock > 0 ? kBlock : runtime_block;
+      for (int64 i = start; i < limit; ++i) {
+        const int64 out_r = i % w.out_rows;
+        const int64 plane = i / w.out_rows;  // n * blocks + block index.
+        const int64 r_begin = std::max<int64>(
+            out_r * w.stride_rows - w.pad_rows, 0);
+        const int64 r_end = std::min<int64>(
+            out_r * w.stride_rows - w.pad_rows + w.window_rows, w.in_rows);
+        const T* in_plane = input + plane * w.in_rows * w.in_cols * block;
+        T* y = output + i * w.out_cols * block;
+        for (int64 out_c = 0; out_c < w.out_cols; ++out_c, y += block) {
+          const int64 c_begin = std::max<int64>(
+              out_c * w.stride_cols - w.pad_cols, 0);
+          const int64 c_end = std::min<int64>(
+              out_c * w.stride_cols - w.pad_cols + w.window_cols, w.in_cols);
+          std::fill(y, y + block,
+                    kMax ? std::numeric_limits<T>::lowest() : T(0));
+          for (int64 r = r_begin; r < r_end; ++r) {
+            const T* x = in_plane + (r * w.in_cols + c_begin) * block;
+            for (int64 c = c_begin; c < c_end; ++c, x += block) {
+              for (int64 k = 0; k < block; ++k) {
+                y[k] = kMax ? std::max(y[k], x[k]) : y[k] + x[k];
+              }
+            }
+          }
+          if (!kMax) {
+            const T scale =
+                T(1) / static_cast<T>((r_end - r_begin) * (c_end - c_begin));
+            for (int64 k = 0; k < block; ++k) y[k] *= scale;
+          }
+        }
+      }
+    }
+  };
+};
+
+}  // namespace
+
+template <typename T, bool kMax>
+class NCHWcPoolOp : public OpKernel {
+ public:
+  explicit NCHWcPoolOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("ksize", &ksize_));
+    OP_REQUIRES(context, ksize_.size() == 4,
+                errors::InvalidArgument("Sliding window ksize field must "
+                                        "specify 4 dimensions"));
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window stride field must "
+                                        "specify 4 dimensions"));
+    OP_REQUIRES(context, ksize_[0] == 1 && ksize_[3] == 1 &&
+                             strides_[0] == 1 && strides_[3] == 1,
+                errors::Unimplemented(
+                    "Pooling is not yet supported on the batch or depth "
+                    "dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES(context, input.dims() == 5,
+                errors::InvalidArgument("input must be 5-dimensional: ",
+                                        input.shape().DebugString()));
+    const int64 block = input.dim_size(4);
+    NCHWcWindow w;
+    w.batch = input.dim_size(0);
+    w.in_blocks = input.dim_size(1);
+    w.out_blocks = w.in_blocks;
+    w.in_rows = input.dim_size(2);
+    w.in_cols = input.dim_size(3);
+    w.window_rows = ksize_[1];
+    w.window_cols = ksize_[2];
+    w.stride_rows = strides_[1];
+    w.stride_cols = strides_[2];
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(w.in_rows, w.window_rows,
+                                         w.stride_rows, padding_, &w.out_rows,
+                                         &w.pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(w.in_cols, w.window_cols,
+                                         w.stride_cols, padding_, &w.out_cols,
+                                         &w.pad_cols));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({w.batch, w.out_blocks, w.out_rows,
+                                       w.out_cols, block}),
+                       &output));
+    if (output->NumElements() == 0) return;
+
+    const T* in = input.flat<T>().data();
+    T* out = output->flat<T>().data();
+    auto work = [&](int64 start, int64 limit) {
+      DispatchBlockSize<NCHWcPoolRows<kMax>::template Impl>(block, w, in, out,
+                                                            start, limit);
+    };
+    ShardRows(context, w.batch * w.out_blocks * w.out_rows,
+              w.out_cols * w.window_rows * w.window_cols * block, work);
+  }
+
+ private:
+  std::vector<int32> ksize_;
+  std::vector<int32> strides_;
+  Padding padding_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(NCHWcPoolOp);
+};
+
+#define REGISTER_CPU(T)                                                      \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NHWCToNCHWc").Device(DEVICE_CPU).TypeConstraint<T>("T"),        \
+      NHWCToNCHWcOp<T>);                                                     \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NCHWcToNHWC").Device(DEVICE_CPU).TypeConstraint<T>("T"),        \
+      NCHWcToNHWCOp<T>);                                                     \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NCHWcConv2D").Device(DEVICE_CPU).TypeConstraint<T>("T"),        \
+      NCHWcConv2DOp<T>);                                                     \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NCHWcBiasAdd").Device(DEVICE_CPU).TypeConstraint<T>("T"),       \
+      NCHWcBiasAddOp<T>);                                                    \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NCHWcMaxPool").Device(DEVICE_CPU).TypeConstraint<T>("T"),       \
+      NCHWcPoolOp<T, true>);                                                 \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_NCHWcAvgPool").Device(DEVICE_CPU).TypeConstraint<T>("T"),       \
+      NCHWcPoolOp<T, false>);
+
+TF_CALL_float(REGISTER_CPU);
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -0,0 +1,178 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/cc/ops/nn_ops.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/blocked_layout_pass.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+// Builds Conv2D -> BiasAdd -> Relu -> MaxPool -> Conv2D -> Relu -> AvgPool on
+// random data, with channel counts that do not fill whole blocks.
+GraphDef ConvChainGraph(int batch, int rows, int cols, int in_depth,
+                        int depth) {
+  auto root = Scope::NewRootScope();
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  auto random = [](const TensorShape& shape) {
+    Tensor t(DT_FLOAT, shape);
+    t.flat<float>().setRandom();
+    t.flat<float>() = t.flat<float>() - 0.5f;
+    return t;
+  };
+  Output input =
+      Const(root.WithOpName("input"),
+            Input::Initializer(random({batch, rows, cols, in_depth})));
+  Output filter1 = Const(root.WithOpName("filter1"),
+                         Input::Initializer(random({3, 3, in_depth, depth})));
+  Output bias =
+      Const(root.WithOpName("bias"), Input::Initializer(random({depth})));
+  Output filter2 = Const(root.WithOpName("filter2"),
+                         Input::Initializer(random({3, 3, depth, depth + 3})));
+
+  Output conv1 =
+      Conv2D(root.WithOpName("conv1"), input, filter1, {1, 1, 1, 1}, "SAME");
+  Output bias_add = BiasAdd(root.WithOpName("bias_add"), conv1, bias);
+  Output relu1 = Relu(root.WithOpName("relu1"), bias_add);
+  Output pool1 = MaxPool(root.WithOpName("pool1"), relu1, {1, 3, 3, 1},
+                         {1, 2, 2, 1}, "SAME");
+  Output conv2 =
+      Conv2D(root.WithOpName("conv2"), pool1, filter2, {1, 2, 1, 1}, "VALID");
+  Output relu2 = Relu(root.WithOpName("relu2"), conv2);
+  AvgPool(root.WithOpName("output"), relu2, {1, 2, 2, 1}, {1, 1, 1, 1},
+          "SAME");
+
+  GraphDef graph_def;
+  TF_CHECK_OK(root.ToGraphDef(&graph_def));
+  return graph_def;
+}
+
+std::unique_ptr<Graph> BlockedGraph(const GraphDef& graph_def,
+                                    int block_size) {
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_CHECK_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), graph_def,
+                                     graph.get()));
+  CHECK(RunBlockedLayoutRewritePass(&graph, block_size));
+  return graph;
+}
+
+Tensor RunGraph(const GraphDef& graph_def, const string& fetch) {
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  TF_CHECK_OK(session->Create(graph_def));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({}, {fetch}, {}, &outputs));
+  return outputs[0];
+}
+
+void CompareBlockedAndNHWC(int block_size) {
+  const GraphDef graph_def = ConvChainGraph(2, 13, 11, 5, 13);
+  const Tensor expected = RunGraph(graph_def, "output");
+
+  GraphDef blocked_def;
+  BlockedGraph(graph_def, block_size)->ToGraphDef(&blocked_def);
+  int num_blocked_ops = 0;
+  for (const NodeDef& node : blocked_def.node()) {
+    if (StringPiece(node.op()).starts_with("_NCHWc")) ++num_blocked_ops;
+  }
+  // Two convolutions, a bias-add, two poolings and the final conversion.
+  EXPECT_EQ(6, num_blocked_ops);
+
+  test::ExpectTensorNear<float>(expected, RunGraph(blocked_def, "output"),
+                                1e-4);
+}
+
+TEST(NCHWcOpsTest, ChainMatchesNHWC_Block8) { CompareBlockedAndNHWC(8); }
+
+TEST(NCHWcOpsTest, ChainMatchesNHWC_Block16) { CompareBlockedAndNHWC(16); }
+
+TEST(NCHWcOpsTest, ChainMatchesNHWC_Block3) { CompareBlockedAndNHWC(3); }
+
+// Runs a chain of 'num_layers' 3x3 Conv2D + BiasAdd + Relu layers, in NHWC or
+// (with block_size > 0) in the blocked layout.
+static void BM_ConvChain(int iters, int batch, int rows, int cols, int depth,
+                         int num_layers, int block_size, const string& label) {
+  testing::StopTiming();
+  auto root = Scope::NewRootScope();
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  Tensor input_t(DT_FLOAT, TensorShape({batch, rows, cols, depth}));
+  input_t.flat<float>().setRandom();
+  Output x = Const(root.WithOpName("input"), Input::Initializer(input_t));
+  for (int i = 0; i < num_layers; ++i) {
+    Tensor filter_t(DT_FLOAT, TensorShape({3, 3, depth, depth}));
+    filter_t.flat<float>().setRandom();
+    Tensor bias_t(DT_FLOAT, TensorShape({depth}));
+    bias_t.flat<float>().setRandom();
+    x = Conv2D(root, x, Const(root, Input::Initializer(filter_t)),
+               {1, 1, 1, 1}, "SAME");
+    x = Relu(root, BiasAdd(root, x, Const(root, Input::Initializer(bias_t))));
+  }
+  GraphDef graph_def;
+  TF_CHECK_OK(root.ToGraphDef(&graph_def));
+
+  std::unique_ptr<Graph> graph;
+  if (block_size > 0) {
+    graph = BlockedGraph(graph_def, block_size);
+  } else {
+    graph.reset(new Graph(OpRegistry::Global()));
+    TF_CHECK_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), graph_def,
+                                       graph.get()));
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch * rows * cols *
+                          depth * depth * 9 * num_layers);
+  testing::SetLabel(label);
+  testing::StartTiming();
+  test::Benchmark("cpu", graph.release()).Run(iters);
+}
+
+#define BM_ConvChainDef(BATCH, ROWS, COLS, DEPTH, LAYERS, LABEL)             \
+  static void BM_ConvChain_NHWC_##LABEL(int iters) {                         \
+    BM_ConvChain(iters, BATCH, ROWS, COLS, DEPTH, LAYERS, 0,                 \
+                 "NHWC " #LABEL);                                            \
+  }                                                                          \
+  BENCHMARK(BM_ConvChain_NHWC_##LABEL);                                      \
+  static void BM_ConvChain_NCHW8c_##LABEL(int iters) {                       \
+    BM_ConvChain(iters, BATCH, ROWS, COLS, DEPTH, LAYERS, 8,                 \
+                 "NCHW8c " #LABEL);                                          \
+  }                                                                          \
+  BENCHMARK(BM_ConvChain_NCHW8c_##LABEL);                                    \
+  static void BM_ConvChain_NCHW16c_##LABEL(int iters) {                      \
+    BM_ConvChain(iters, BATCH, ROWS, COLS, DEPTH, LAYERS, 16,                \
+                 "NCHW16c " #LABEL);                                         \
+  }                                                                          \
+  BENCHMARK(BM_ConvChain_NCHW16c_##LABEL);
+
+// ResNet-style 3x3 stages.
+BM_ConvChainDef(8, 56, 56, 64, 4, resnet_56x56x64);
+BM_ConvChainDef(8, 28, 28, 128, 4, resnet_28x28x128);
+BM_ConvChainDef(8, 14, 14, 256, 4, resnet_14x14x256);
+BM_ConvChainDef(8, 7, 7, 512, 4, resnet_7x7x512);
+
+}  // namespace
+}  // namespace tensorflow
@@ -46,6 +46,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/gtl/top_n.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -331,6 +334,12 @@ BM_ConvFloatFwd(32, 73, 73, 64, 192, 3, 3, 1, VALID, conv52);
 BM_ConvFloatFwd(32, 73, 73, 64, 64, 1, 1, 1, VALID, conv53);
 BM_ConvFloatFwd(32, 147, 147, 24, 64, 1, 1, 1, VALID, conv54);
 
+// 3x3 layers from ResNet-50, which DeepConv2D selects a Winograd tile for.
+BM_ConvFloatFwd(32, 56, 56, 64, 64, 3, 3, 1, SAME, resnet50_3x3_56);
+BM_ConvFloatFwd(32, 28, 28, 128, 128, 3, 3, 1, SAME, resnet50_3x3_28);
+BM_ConvFloatFwd(32, 14, 14, 256, 256, 3, 3, 1, SAME, resnet50_3x3_14);
+BM_ConvFloatFwd(32, 7, 7, 512, 512, 3, 3, 1, SAME, resnet50_3x3_7);
+
 #define BM_ConvFloatBkInAndFilter(BS, R, C, ID, OD, KR, KC, STR, PAD, LABEL)  \
   static void BM_ConvFloatBkInCPU1_##LABEL(int iters) {                       \
     BM_ConvFloat(iters, BS, R, C, ID, OD, KR, KC, CONV_OP_BACKPROP_INPUT, 1,  \
@@ -447,6 +456,16 @@ BM_ConvFloatBkInAndFilter(32, 73, 73, 64, 192, 3, 3, 1, VALID, conv52);
 BM_ConvFloatBkInAndFilter(32, 73, 73, 64, 64, 1, 1, 1, VALID, conv53);
 BM_ConvFloatBkInAndFilter(32, 147, 147, 24, 64, 1, 1, 1, VALID, conv54);
 
+// 3x3 layers from ResNet-50, which DeepConv2D selects a Winograd tile for.
+BM_ConvFloatBkInAndFilter(32, 56, 56, 64, 64, 3, 3, 1, SAME,
+                          resnet50_3x3_56);
+BM_ConvFloatBkInAndFilter(32, 28, 28, 128, 128, 3, 3, 1, SAME,
+                          resnet50_3x3_28);
+BM_ConvFloatBkInAndFilter(32, 14, 14, 256, 256, 3, 3, 1, SAME,
+                          resnet50_3x3_14);
+BM_ConvFloatBkInAndFilter(32, 7, 7, 512, 512, 3, 3, 1, SAME,
+                          resnet50_3x3_7);
+
 #define BM_ConvFloatBkFCPU(BS, R, C, ID, OD, KR, KC, TH, LABEL)                \
   static void                                                                  \
       BM_ConvFloatBkFCPU_##BS##_##R##_##C##_##ID##_##OD##_##KR##_##KC##_##TH(  \
@@ -1315,6 +1334,119 @@ BM_ImageNetSoftmaxFwdCPU(128, 1008, 1, "softmax128");
 BM_ImageNetSoftmaxFwdCPU(32, 1008, 4, "softmax32");
 BM_ImageNetSoftmaxFwdCPU(128, 1008, 4, "softmax128");
 
+// Output layers over large vocabularies. The input is [node_depth,
+// batch_size], so these are 16 and 64 rows of 100000 classes.
+BM_ImageNetSoftmaxFwdCPU(100000, 16, 1, "softmax16x100k");
+BM_ImageNetSoftmaxFwdCPU(100000, 64, 1, "softmax64x100k");
+BM_ImageNetSoftmaxFwdCPU(100000, 16, 4, "softmax16x100k");
+BM_ImageNetSoftmaxFwdCPU(100000, 64, 4, "softmax64x100k");
+
+// Checks the CPU TopK kernel against the gtl::TopN heap it used for every
+// row before wide rows were selected by threshold filtering. The device has
+// more intra-op threads than the tests have rows, so rows of at least 128K
+// columns are also split into segments.
+class TopKOpTest : public OpsTestBase {
+ protected:
+  TopKOpTest() : pool_(Env::Default(), "topk_test", kNumThreads) {
+    workers_.num_threads = kNumThreads;
+    workers_.workers = &pool_;
+    device_->set_tensorflow_cpu_worker_threads(&workers_);
+  }
+
+  // Runs TopKV2 on "data", a [rows, cols] matrix, and compares the result
+  // with the TopN heap's. When "sorted" is false only the sets of indices
+  // must agree.
+  void ExpectMatchesTopN(int rows, int cols, int k, bool sorted,
+                         const std::vector<float>& data) {
+    TF_ASSERT_OK(NodeDefBuilder("topk", "TopKV2")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("sorted", sorted)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    AddInputFromArray<float>(TensorShape({rows, cols}), data);
+    AddInputFromArray<int32>(TensorShape({}), {k});
+    TF_ASSERT_OK(RunOpKernel());
+    const auto values = GetOutput(0)->matrix<float>();
+    const auto indices = GetOutput(1)->matrix<int32>();
+
+    for (int r = 0; r < rows; ++r) {
+      const float* row = data.data() + static_cast<int64>(r) * cols;
+      auto comp = [row](int32 a, int32 b) {
+        if (row[b] < row[a]) return true;
+        if (row[b] > row[a]) return false;
+        return a < b;
+      };
+      gtl::TopN<int32, decltype(comp)> filter(k, comp);
+      for (int32 c = 0; c < cols; ++c) filter.push(c);
+      std::unique_ptr<std::vector<int32>> expected(filter.Extract());
+
+      std::vector<int32> actual(&indices(r, 0), &indices(r, 0) + k);
+      if (!sorted) {
+        std::sort(expected->begin(), expected->end());
+        std::sort(actual.begin(), actual.end());
+      }
+      EXPECT_EQ(*expected, actual) << "row " << r;
+      for (int i = 0; i < k; ++i) {
+        const float v = row[indices(r, i)];
+        if (!std::isnan(v)) EXPECT_EQ(v, values(r, i));
+      }
+    }
+  }
+
+  static const int kNumThreads = 8;
+  thread::ThreadPool pool_;
+  DeviceBase::CpuWorkerThreads workers_;
+};
+
+// Returns "n" values drawn from "num_distinct" levels, so that rows have
+// many ties, including at the k-th largest value.
+static std::vector<float> TiedValues(int64 n, int num_distinct) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<float> data(n);
+  for (int64 i = 0; i < n; ++i) {
+    data[i] = static_cast<float>(rnd.Uniform(num_distinct)) - num_distinct / 2;
+  }
+  return data;
+}
+
+TEST_F(TopKOpTest, ThresholdFilterWithTies) {
+  ExpectMatchesTopN(4, 4096, 20, true, TiedValues(4 * 4096, 200));
+}
+
+TEST_F(TopKOpTest, ThresholdFilterUnsorted) {
+  ExpectMatchesTopN(4, 5000, 64, false, TiedValues(4 * 5000, 1000));
+}
+
+TEST_F(TopKOpTest, ThresholdFilterAllEqual) {
+  ExpectMatchesTopN(2, 2048, 7, true, std::vector<float>(2 * 2048, 1.0f));
+}
+
+TEST_F(TopKOpTest, ThresholdFilterWithNaN) {
+  std::vector<float> data = TiedValues(4 * 4096, 200);
+  // A NaN in a sampled column, one in a filtered block, and a clean row.
+  data[16 * 5] = std::numeric_limits<float>::quiet_NaN();
+  data[4096 + 1001] = std::numeric_limits<float>::quiet_NaN();
+  data[3 * 4096 + 4095] = std::numeric_limits<float>::quiet_NaN();
+  ExpectMatchesTopN(4, 4096, 20, true, data);
+}
+
+TEST_F(TopKOpTest, SegmentsWithTies) {
+  // Two rows on eight threads give four segments per row.
+  ExpectMatchesTopN(2, 300000, 50, true, TiedValues(2 * 300000, 5000));
+}
+
+TEST_F(TopKOpTest, SegmentsUnsorted) {
+  ExpectMatchesTopN(1, 200000, 100, false, TiedValues(200000, 20000));
+}
+
+TEST_F(TopKOpTest, SegmentsWithNaN) {
+  std::vector<float> data = TiedValues(2 * 300000, 5000);
+  data[300000 + 123457] = std::numeric_limits<float>::quiet_NaN();
+  ExpectMatchesTopN(2, 300000, 50, true, data);
+}
+
 static void BM_TopK(int iters, int rows, int cols, int k, int num_threads,
                     bool use_gpu, const string& label) {
   testing::StopTiming();
@@ -1408,4 +1540,23 @@ BM_TopKCPU(128, 70000, 70000, 16, "topk_nmt_r_128_c_70000_k_70000_th_16");
 BM_TopKCPU(128, 175000, 175000, 16, "topk_nmt_r_128_c_175000_k_175000_th_16");
 BM_TopKCPU(128, 350000, 350000, 16, "topk_nmt_r_128_c_350000_k_350000_th_16");
 
+// Retrieval: few rows of up to 1M scores, k up to 1000.
+BM_TopKCPU(1, 100000, 10, 16, "topk_retrieval_r_1_c_100000_k_10_th_16");
+BM_TopKCPU(1, 100000, 100, 16, "topk_retrieval_r_1_c_100000_k_100_th_16");
+BM_TopKCPU(1, 100000, 1000, 16, "topk_retrieval_r_1_c_100000_k_1000_th_16");
+BM_TopKCPU(1, 1000000, 10, 16, "topk_retrieval_r_1_c_1000000_k_10_th_16");
+BM_TopKCPU(1, 1000000, 100, 16, "topk_retrieval_r_1_c_1000000_k_100_th_16");
+BM_TopKCPU(1, 1000000, 1000, 16, "topk_retrieval_r_1_c_1000000_k_1000_th_16");
+BM_TopKCPU(4, 100000, 10, 16, "topk_retrieval_r_4_c_100000_k_10_th_16");
+BM_TopKCPU(4, 100000, 100, 16, "topk_retrieval_r_4_c_100000_k_100_th_16");
+BM_TopKCPU(4, 100000, 1000, 16, "topk_retrieval_r_4_c_100000_k_1000_th_16");
+BM_TopKCPU(4, 1000000, 10, 16, "topk_retrieval_r_4_c_1000000_k_10_th_16");
+BM_TopKCPU(4, 1000000, 100, 16, "topk_retrieval_r_4_c_1000000_k_100_th_16");
+BM_TopKCPU(4, 1000000, 1000, 16, "topk_retrieval_r_4_c_1000000_k_1000_th_16");
+BM_TopKCPU(64, 100000, 10, 16, "topk_retrieval_r_64_c_100000_k_10_th_16");
+BM_TopKCPU(64, 100000, 100, 16, "topk_retrieval_r_64_c_100000_k_100_th_16");
+BM_TopKCPU(64, 100000, 1000, 16, "topk_retrieval_r_64_c_100000_k_1000_th_16");
+BM_TopKCPU(1, 1000000, 1000, 1, "topk_retrieval_r_1_c_1000000_k_1000_th_1");
+BM_TopKCPU(1, 1000000, 1000, 4, "topk_retrieval_r_1_c_1000000_k_1000_th_4");
+
 }  // namespace tensorflow
@@ -29,7 +29,10 @@ limitations under the License.
 #include <arm_neon.h>
 #endif
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #define GEMMLOWP_ALLOW_SLOW_SCALAR_FALLBACK
@@ -135,6 +138,65 @@ void QuantizationRangeForMultiplication(float min_a, float max_a, float min_b,
   *max_c = c_float_for_one_quant_level * c_highest;
 }
 
+// Rescaling a 32-bit accumulator into an eight-bit range multiplies it by a
+// real number, which we represent as quantized_multiplier * 2^-shift with the
+// multiplier in [2^30, 2^31) to keep 31 bits of precision. Returns false if
+// real_multiplier is too large to be represented this way.
+inline bool QuantizeMultiplier(double real_multiplier,
+                               int32* quantized_multiplier, int* shift) {
+  if (real_multiplier <= 0.0) {
+    *quantized_multiplier = 0;
+    *shift = 1;
+    return true;
+  }
+  const int64 kOne = static_cast<int64>(1) << 31;
+  int exponent;
+  const double fraction = std::frexp(real_multiplier, &exponent);
+  int64 multiplier = static_cast<int64>(round(fraction * kOne));
+  if (multiplier == kOne) {
+    multiplier /= 2;
+    ++exponent;
+  }
+  *shift = 31 - exponent;
+  if (*shift < 1) {
+    return false;
+  }
+  // The rounding shift has to stay within 64 bits, so tiny multipliers lose
+  // their low bits instead.
+  const int kMaxShift = 62;
+  if (*shift > kMaxShift) {
+    multiplier = (*shift - kMaxShift < 31) ? multiplier >> (*shift - kMaxShift)
+                                            : 0;
+    *shift = kMaxShift;
+  }
+  *quantized_multiplier = static_cast<int32>(multiplier);
+  return true;
+}
+
+// Returns round(value * real_multiplier) for the multiplier represented by
+// QuantizeMultiplier, rounding halves up. value is first clamped to
+// (-2^32, 2^32), which keeps the product within 64 bits. A shift of zero or
+// less multiplies by 2^-shift instead, saturating to the int64 range.
+inline int64 MultiplyByQuantizedMultiplier(int64 value,
+                                           int32 quantized_multiplier,
+                                           int shift) {
+  const int64 kLimit = (static_cast<int64>(1) << 32) - 1;
+  const int64 product =
+      std::max(-kLimit, std::min(kLimit, value)) * quantized_multiplier;
+  if (shift > 0) {
+    // Same as (product + 2^(shift - 1)) >> shift, but cannot overflow.
+    return ((product >> (shift - 1)) + 1) >> 1;
+  }
+  const int left_shift = std::min(-shift, 63);
+  if (product > (std::numeric_limits<int64>::max() >> left_shift)) {
+    return std::numeric_limits<int64>::max();
+  }
+  if (product < (std::numeric_limits<int64>::min() >> left_shift)) {
+    return std::numeric_limits<int64>::min();
+  }
+  return static_cast<int64>(static_cast<uint64>(product) << left_shift);
+}
+
 // input_array is an eigen Tensor.  q2f is a QuantizedToFloatStruct.
 // This evaluates to an eigen tensor expression, to be used like:
 // auto tensor = DEQUANTIZE_WITH_EIGEN(input_tensor, q2f);
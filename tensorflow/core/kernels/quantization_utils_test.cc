@@ -722,6 +722,41 @@ void TestQuantizedToFloatInPlaceUsingEigen() {
   TestQuantizedToFloatInPlaceUsingEigen<qint32>(&eigen_device);
 }
 
+void TestMultiplyByQuantizedMultiplier() {
+  int32 multiplier;
+  int shift;
+  ASSERT_TRUE(QuantizeMultiplier(0.25, &multiplier, &shift));
+  EXPECT_EQ(25, MultiplyByQuantizedMultiplier(100, multiplier, shift));
+  // Halves round up.
+  EXPECT_EQ(1, MultiplyByQuantizedMultiplier(2, multiplier, shift));
+  EXPECT_EQ(0, MultiplyByQuantizedMultiplier(-2, multiplier, shift));
+  EXPECT_EQ(-1, MultiplyByQuantizedMultiplier(-3, multiplier, shift));
+
+  // The largest multiplier and value must not overflow the product or the
+  // rounding.
+  ASSERT_TRUE(QuantizeMultiplier(0.9999999, &multiplier, &shift));
+  const int64 kLimit = (static_cast<int64>(1) << 32) - 1;
+  const int64 expected = static_cast<int64>(std::round(kLimit * 0.9999999));
+  EXPECT_NEAR(expected,
+              MultiplyByQuantizedMultiplier(kLimit, multiplier, shift), 1);
+  EXPECT_NEAR(-expected,
+              MultiplyByQuantizedMultiplier(-kLimit, multiplier, shift), 1);
+  // Values beyond the documented range are clamped to it.
+  EXPECT_EQ(MultiplyByQuantizedMultiplier(kLimit, multiplier, shift),
+            MultiplyByQuantizedMultiplier(std::numeric_limits<int64>::max(),
+                                          multiplier, shift));
+
+  // Shifts of zero or less multiply by a power of two.
+  EXPECT_EQ(static_cast<int64>(3) << 30,
+            MultiplyByQuantizedMultiplier(3, 1 << 30, 0));
+  EXPECT_EQ(static_cast<int64>(3) << 32,
+            MultiplyByQuantizedMultiplier(3, 1 << 30, -2));
+  EXPECT_EQ(std::numeric_limits<int64>::max(),
+            MultiplyByQuantizedMultiplier(kLimit, 1 << 30, -40));
+  EXPECT_EQ(std::numeric_limits<int64>::min(),
+            MultiplyByQuantizedMultiplier(-kLimit, 1 << 30, -40));
+}
+
 void BenchmarkRequantizeManyInNewRange() {
   TimeRequantizeManyInNewRange<qint32, quint8>(1000, 1000, false);
   TimeRequantizeManyInNewRange<qint32, quint8>(1000, 1000, true);
@@ -936,6 +971,7 @@ int main(int argc, char** argv) {
   RUN_TEST(TestOverflowWithEigen);
   RUN_TEST(TestQuantizedTensorToFloat);
   RUN_TEST(TestQuantizedToFloatInPlaceUsingEigen);
+  RUN_TEST(TestMultiplyByQuantizedMultiplier);
 
 #if defined(__ANDROID__)
 #ifdef QUANTIZATION_UTILS_USE_NEON
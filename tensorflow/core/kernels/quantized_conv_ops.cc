@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/reference_gemm.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -191,6 +192,91 @@ class ReferenceConvFunctor {
 // experimentation.
 const size_t kMaxChunkSize = (1 * 1024 * 1024);
 
+// Packs the input patches read by the output positions in
+// [patch_index_start, patch_index_end) into consecutive rows of
+// im2col_buffer, as described in Im2ColConvFunctor below. Positions outside
+// the input are filled with input_offset, the quantized value of zero.
+template <class T1>
+void Im2ColPatches(const T1* input_data, int input_height, int input_width,
+                   int input_depth, int input_offset, int filter_height,
+                   int filter_width, int filter_left_offset,
+                   int filter_top_offset, int stride, int output_height,
+                   int output_width, int64 patch_index_start,
+                   int64 patch_index_end, T1* im2col_buffer) {
+  const int filter_value_count = filter_width * filter_height * input_depth;
+  for (int64 patch_index = patch_index_start; patch_index < patch_index_end;
+       ++patch_index) {
+    const int64 batch = patch_index / (output_height * output_width);
+    const int64 out_y = (patch_index / output_width) % output_height;
+    const int64 out_x = patch_index % output_width;
+    const T1* input_batch_start =
+        input_data + (batch * input_height * input_width * input_depth);
+    const int in_y_origin = (out_y * stride) - filter_top_offset;
+    const int in_x_origin = (out_x * stride) - filter_left_offset;
+    T1* im2col_patch_start =
+        im2col_buffer +
+        ((patch_index - patch_index_start) * filter_value_count);
+    for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+      const int in_y = in_y_origin + filter_y;
+      T1* im2col_row_start =
+          im2col_patch_start + (filter_y * filter_width * input_depth);
+      // If we're off the top or the bottom of the input, fill the
+      // whole row with zeroes.
+      if ((in_y < 0) || (in_y >= input_height)) {
+        // On Android, memset and memcpy are significantly faster than the
+        // more modern std::set and std::copy equivalents.
+        memset(im2col_row_start, input_offset, (filter_width * input_depth));
+      } else {
+        // What we're doing here is trying to copy and fill the im2col
+        // buffer as efficiently as possible, using functions to set or
+        // duplicate values en masse. We know we don't have to worry about
+        // vertical edges because we dealt with that case above, so we
+        // just need to handle filters that overlap the left or right
+        // edges. Here's what that looks like:
+        //
+        // < left_zero_count > < center_copy_count > < right_zero_count >
+        // +------------------+---------------------+--------------------+
+        // |     (filter)     |       (image)       |      (filter)      |
+        // +------------------+---------------------+--------------------+
+        // in_x_origin        0                 input_width       in_x_end
+        //
+        // In reality it's unlikely that a filter patch will be wider
+        // than an input, but this shows all the edge cases.
+        // We use memset() to set the left and right sections to zeroes
+        // and memcpy() to copy over the input data for the center. These
+        // are preferred to std::fill and std::copy because they're much
+        // faster on Android.
+        const int in_x_end = in_x_origin + filter_width;
+        const int left_zero_count = std::max(0, 0 - in_x_origin);
+        const int right_zero_count = std::max(0, in_x_end - input_width);
+        const int center_copy_count =
+            filter_width - (left_zero_count + right_zero_count);
+        if (left_zero_count > 0) {
+          T1* im2col_left_start = im2col_row_start;
+          memset(im2col_left_start, input_offset,
+                 (left_zero_count * input_depth));
+        }
+        if (center_copy_count > 0) {
+          const T1* input_row_start =
+              input_batch_start + (in_y * input_width * input_depth) +
+              (std::max(0, in_x_origin) * input_depth);
+          T1* im2col_center_start =
+              im2col_row_start + (left_zero_count * input_depth);
+          memcpy(im2col_center_start, input_row_start,
+                 (center_copy_count * input_depth));
+        }
+        if (right_zero_count > 0) {
+          T1* im2col_right_start =
+              im2col_row_start +
+              ((left_zero_count + center_copy_count) * input_depth);
+          memset(im2col_right_start, input_offset,
+                 (right_zero_count * input_depth));
+        }
+      }
+    }
+  }
+}
+
 // Implements convolution as a two stage process, first packing the patches of
 // the input image into columns (im2col) and then running GEMM to produce the
 // final result.
@@ -291,78 +377,11 @@ class Im2ColConvFunctor {
       const int64 patch_index_start = chunk_index * patches_per_chunk;
       const int64 patch_index_end =
           std::min(patch_index_start + patches_per_chunk, patch_count);
-      for (int64 patch_index = patch_index_start; patch_index < patch_index_end;
-           ++patch_index) {
-        const int64 batch = patch_index / (output_height * output_width);
-        const int64 out_y = (patch_index / output_width) % output_height;
-        const int64 out_x = patch_index % output_width;
-        const T1* input_batch_start =
-            input_data + (batch * input_height * input_width * input_depth);
-        const int in_y_origin = (out_y * stride) - filter_top_offset;
-        const int in_x_origin = (out_x * stride) - filter_left_offset;
-        const int patch_index_within_chunk = patch_index % patches_per_chunk;
-        T1* im2col_patch_start =
-            im2col_buffer + (patch_index_within_chunk * filter_value_count);
-        for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
-          const int in_y = in_y_origin + filter_y;
-          T1* im2col_row_start =
-              im2col_patch_start + (filter_y * filter_width * input_depth);
-          // If we're off the top or the bottom of the input, fill the
-          // whole row with zeroes.
-          if ((in_y < 0) || (in_y >= input_height)) {
-            // On Android, memset and memcpy are significantly faster than the
-            // more modern std::set and std::copy equivalents.
-            memset(im2col_row_start, input_offset,
-                   (filter_width * input_depth));
-          } else {
-            // What we're doing here is trying to copy and fill the im2col
-            // buffer as efficiently as possible, using functions to set or
-            // duplicate values en masse. We know we don't have to worry about
-            // vertical edges because we dealt with that case above, so we
-            // just need to handle filters that overlap the left or right
-            // edges. Here's what that looks like:
-            //
-            // < left_zero_count > < center_copy_count > < right_zero_count >
-            // +------------------+---------------------+--------------------+
-            // |     (filter)     |       (image)       |      (filter)      |
-            // +------------------+---------------------+--------------------+
-            // in_x_origin        0                 input_width       in_x_end
-            //
-            // In reality it's unlikely that a filter patch will be wider
-            // than an input, but this shows all the edge cases.
-            // We use memset() to set the left and right sections to zeroes
-            // and memcpy() to copy over the input data for the center. These
-            // are preferred to std::fill and std::copy because they're much
-            // faster on Android.
-            const int in_x_end = in_x_origin + filter_width;
-            const int left_zero_count = std::max(0, 0 - in_x_origin);
-            const int right_zero_count = std::max(0, in_x_end - input_width);
-            const int center_copy_count =
-                filter_width - (left_zero_count + right_zero_count);
-            if (left_zero_count > 0) {
-              T1* im2col_left_start = im2col_row_start;
-              memset(im2col_left_start, input_offset,
-                     (left_zero_count * input_depth));
-            }
-            if (center_copy_count > 0) {
-              const T1* input_row_start =
-                  input_batch_start + (in_y * input_width * input_depth) +
-                  (std::max(0, in_x_origin) * input_depth);
-              T1* im2col_center_start =
-                  im2col_row_start + (left_zero_count * input_depth);
-              memcpy(im2col_center_start, input_row_start,
-                     (center_copy_count * input_depth));
-            }
-            if (right_zero_count > 0) {
-              T1* im2col_right_start =
-                  im2col_row_start +
-                  ((left_zero_count + center_copy_count) * input_depth);
-              memset(im2col_right_start, input_offset,
-                     (right_zero_count * input_depth));
-            }
-          }
-        }
-      }
+      Im2ColPatches(input_data, input_height, input_width, input_depth,
+                    input_offset, filter_height, filter_width,
+                    filter_left_offset, filter_top_offset, stride,
+                    output_height, output_width, patch_index_start,
+                    patch_index_end, im2col_buffer);
       // Now we've assembled a set of image patches into a matrix, apply a
       // GEMM matrix multiply of the patches as rows, times the filter
       // weights in columns, to get partial results in the output matrix.
@@ -575,4 +594,327 @@ REGISTER_KERNEL_BUILDER(
         .TypeConstraint<qint32>("out_type"),
     QuantizedConv2DOp<quint8, quint8, qint32, Im2ColConvFunctor>);
 
+// Computes QuantizedConv2D, adds a float bias and requantizes the result to
+// eight bits, one im2col chunk at a time. Each chunk's 32-bit accumulators are
+// rescaled into the output while they are still in cache, so the op never
+// writes the qint32 result that QuantizedConv2D, RequantizationRange and
+// Requantize would otherwise pass over three times.
+//
+// Per output channel c, with input, filter and output scales s_in, s_f[c] and
+// s_out, the output is
+//
+//   zero_out + round((acc + bias[c] / (s_in * s_f[c])) * s_in * s_f[c] / s_out)
+//
+// where acc is the integer dot product of the zero-point-adjusted input and
+// filter values. The multiplier is applied in fixed point, see
+// QuantizeMultiplier.
+class QuantizedConv2DWithBiasAndRequantizeOp : public OpKernel {
+ public:
+  explicit QuantizedConv2DWithBiasAndRequantizeOp(
+      OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    OP_REQUIRES(context, strides_[1] == strides_[2],
+                errors::InvalidArgument(
+                    "Current implementation only supports equal length "
+                    "strides in the row and column dimensions."));
+    OP_REQUIRES(
+        context, (strides_[0] == 1 && strides_[3] == 1),
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    const Tensor& filter = context->input(1);
+    const Tensor& bias = context->input(2);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    const int64 in_depth = input.dim_size(3);
+    OP_REQUIRES(context, in_depth == filter.dim_size(2),
+                errors::InvalidArgument(
+                    "input and filter must have the same depth: ", in_depth,
+                    " vs ", filter.dim_size(2)));
+    const int64 out_depth = filter.dim_size(3);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(bias.shape()) &&
+                    bias.dim_size(0) == out_depth,
+                errors::InvalidArgument("bias must be a vector of size ",
+                                        out_depth, ": ",
+                                        bias.shape().DebugString()));
+
+    const float min_input = context->input(3).flat<float>()(0);
+    const float max_input = context->input(4).flat<float>()(0);
+    const Tensor& min_filter = context->input(5);
+    const Tensor& max_filter = context->input(6);
+    const float min_output = context->input(7).flat<float>()(0);
+    const float max_output = context->input(8).flat<float>()(0);
+    OP_REQUIRES(context,
+                min_filter.NumElements() == max_filter.NumElements() &&
+                    (min_filter.NumElements() == 1 ||
+                     min_filter.NumElements() == out_depth),
+                errors::InvalidArgument(
+                    "min_filter and max_filter must both hold 1 or ",
+                    out_depth, " values, got ", min_filter.NumElements(),
+                    " and ", max_filter.NumElements()));
+    OP_REQUIRES(context, min_input < max_input && min_output < max_output,
+                errors::InvalidArgument(
+                    "Input and output ranges must not be empty: [", min_input,
+                    ", ", max_input, "] and [", min_output, ", ", max_output,
+                    "]"));
+    // Unlike QuantizedConv2D there is no reference fallback here, so the
+    // border of the input has to be padded with a representable zero.
+    const int32 offset_input =
+        FloatToQuantizedUnclamped<quint8>(0.0f, min_input, max_input);
+    OP_REQUIRES(context, offset_input >= 0 && offset_input <= 255,
+                errors::InvalidArgument(
+                    "Zero is not representable in the input range [",
+                    min_input, ", ", max_input, "]"));
+
+    const int64 input_rows = input.dim_size(1);
+    const int64 filter_rows = filter.dim_size(0);
+    const int64 input_cols = input.dim_size(2);
+    const int64 filter_cols = filter.dim_size(1);
+    const int64 batch = input.dim_size(0);
+    const int stride = strides_[1];
+    int64 out_rows = 0, out_cols = 0, pad_rows = 0, pad_cols = 0;
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(input_rows, filter_rows, stride,
+                                         padding_, &out_rows, &pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(input_cols, filter_cols, stride,
+                                         padding_, &out_cols, &pad_cols));
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch, out_rows, out_cols, out_depth}),
+                       &output));
+    Tensor* output_min = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(1, {}, &output_min));
+    output_min->flat<float>()(0) = min_output;
+    Tensor* output_max = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(2, {}, &output_max));
+    output_max->flat<float>()(0) = max_output;
+    if (output->NumElements() == 0) {
+      return;
+    }
+
+    // Folds the filter zero points, bias and scales of every channel into
+    // the integer parameters of the output stage.
+    const auto min_filter_flat = min_filter.flat<float>();
+    const auto max_filter_flat = max_filter.flat<float>();
+    const auto bias_flat = bias.flat<float>();
+    const double input_scale =
+        FloatForOneQuantizedLevel<quint8>(min_input, max_input);
+    const double output_scale =
+        FloatForOneQuantizedLevel<quint8>(min_output, max_output);
+    OutputStage stage;
+    stage.offset_input = offset_input;
+    stage.offset_output =
+        FloatToQuantizedUnclamped<quint8>(0.0f, min_output, max_output);
+    stage.offset_filter.resize(out_depth);
+    stage.bias.resize(out_depth);
+    stage.multiplier.resize(out_depth);
+    stage.shift.resize(out_depth);
+    stage.uniform_filter_offset = true;
+    for (int64 c = 0; c < out_depth; ++c) {
+      const int64 r = min_filter.NumElements() == 1 ? 0 : c;
+      const float min_f = min_filter_flat(r);
+      const float max_f = max_filter_flat(r);
+      OP_REQUIRES(context, min_f < max_f,
+                  errors::InvalidArgument("Filter range of channel ", c,
+                                          " must not be empty: [", min_f, ", ",
+                                          max_f, "]"));
+      stage.offset_filter[c] =
+          FloatToQuantizedUnclamped<quint8>(0.0f, min_f, max_f);
+      stage.uniform_filter_offset &=
+          stage.offset_filter[c] == stage.offset_filter[0];
+      const double accumulator_scale =
+          input_scale * FloatForOneQuantizedLevel<quint8>(min_f, max_f);
+      const double kMaxBias = static_cast<double>(static_cast<int64>(1) << 31);
+      stage.bias[c] = static_cast<int64>(round(
+          std::max(-kMaxBias,
+                   std::min(kMaxBias, bias_flat(c) / accumulator_scale))));
+      OP_REQUIRES(context,
+                  QuantizeMultiplier(accumulator_scale / output_scale,
+                                     &stage.multiplier[c], &stage.shift[c]),
+                  errors::InvalidArgument(
+                      "The output range [", min_output, ", ", max_output,
+                      "] is too narrow for the input and filter ranges of "
+                      "channel ",
+                      c));
+    }
+
+    ConvWithOutputStage(context, input.flat<quint8>().data(), batch,
+                        input_rows, input_cols, in_depth,
+                        filter.flat<quint8>().data(), filter_rows, filter_cols,
+                        out_depth, stride, out_rows, out_cols, stage,
+                        output->flat<quint8>().data());
+  }
+
+ private:
+  struct OutputStage {
+    int32 offset_input;
+    int32 offset_output;
+    // Whether all channels share one filter zero point, which gemmlowp can
+    // then subtract itself.
+    bool uniform_filter_offset;
+    std::vector<int32> offset_filter;
+    // The bias in units of the accumulator.
+    std::vector<int64> bias;
+    std::vector<int32> multiplier;
+    std::vector<int> shift;
+  };
+
+  // Multiplies 'm' im2col rows of 'k' values by the [k, n] filter matrix into
+  // 'accumulators', and writes the requantized rows to 'output_data'.
+  static void GemmWithOutputStage(OpKernelContext* context,
+                                  const quint8* patches, const quint8* filter,
+                                  int m, int n, int k,
+                                  const OutputStage& stage, int32* accumulators,
+                                  quint8* output_data) {
+    const int32 offset_filter =
+        stage.uniform_filter_offset ? stage.offset_filter[0] : 0;
+    if (meta::IsSupportedAndEnabled()) {
+      meta::QuantizedGemm(context, false, false, patches, filter,
+                          reinterpret_cast<qint32*>(accumulators), m, n, k,
+                          -stage.offset_input, -offset_filter, k, n, n);
+    } else {
+      gemmlowp::MatrixMap<const std::uint8_t, gemmlowp::MapOrder::RowMajor>
+          lhs(&patches->value, m, k, k);
+      gemmlowp::MatrixMap<const std::uint8_t, gemmlowp::MapOrder::RowMajor>
+          rhs(&filter->value, k, n, n);
+      gemmlowp::MatrixMap<std::int32_t, gemmlowp::MapOrder::RowMajor> result(
+          accumulators, m, n, n);
+      const std::tuple<> empty_pipeline = {};
+      auto& worker_threads =
+          *(context->device()->tensorflow_cpu_worker_threads());
+      TensorflowGemmContext gemm_context(worker_threads.num_threads,
+                                         worker_threads.workers);
+      gemmlowp::GemmWithOutputPipeline<std::uint8_t, std::int32_t,
+                                       gemmlowp::DefaultL8R8BitDepthParams>(
+          &gemm_context, lhs, rhs, &result, -stage.offset_input,
+          -offset_filter, empty_pipeline);
+      TF_ANNOTATE_MEMORY_IS_INITIALIZED(accumulators, m * n * sizeof(int32));
+    }
+
+    // The gemmlowp output stages at this revision only rescale by a single
+    // multiplier, so the per-channel rescaling runs here, on the chunk that
+    // the GEMM just wrote.
+    auto requantize_rows = [&](int64 begin, int64 end) {
+      for (int64 i = begin; i < end; ++i) {
+        const int32* acc = accumulators + i * n;
+        quint8* out = output_data + i * n;
+        // With per-channel filter zero points the GEMM ran with a zero filter
+        // offset, and sum_j (x_j - z_in) * z_f[c] is subtracted here.
+        int64 patch_sum = 0;
+        if (!stage.uniform_filter_offset) {
+          const quint8* patch = patches + i * k;
+          for (int j = 0; j < k; ++j) {
+            patch_sum += static_cast<int32>(patch[j]);
+          }
+          patch_sum -= static_cast<int64>(k) * stage.offset_input;
+        }
+        for (int c = 0; c < n; ++c) {
+          const int64 value = static_cast<int64>(acc[c]) + stage.bias[c] -
+                              patch_sum * stage.offset_filter[c];
+          const int64 quantized =
+              stage.offset_output +
+              MultiplyByQuantizedMultiplier(value, stage.multiplier[c],
+                                            stage.shift[c]);
+          out[c] = static_cast<uint8>(
+              std::max<int64>(0, std::min<int64>(255, quantized)));
+        }
+      }
+    };
+    const int64 cost_per_row = (stage.uniform_filter_offset ? 0 : k) + 8 * n;
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, m, cost_per_row,
+          requantize_rows);
+  }
+
+  void ConvWithOutputStage(OpKernelContext* context, const quint8* input_data,
+                           int input_batches, int input_height,
+                           int input_width, int input_depth,
+                           const quint8* filter_data, int filter_height,
+                           int filter_width, int filter_count, int stride,
+                           int output_height, int output_width,
+                           const OutputStage& stage, quint8* output_data) {
+    const int filter_value_count = filter_width * filter_height * input_depth;
+    const int64 patch_count =
+        static_cast<int64>(input_batches) * output_height * output_width;
+    const int64 patches_per_chunk = std::min<int64>(
+        patch_count, std::max<int64>(1, kMaxChunkSize / filter_value_count));
+    Tensor accumulators;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DT_INT32,
+                                TensorShape({patches_per_chunk, filter_count}),
+                                &accumulators));
+    int32* accumulator_data = accumulators.flat<int32>().data();
+
+    // A 1x1 convolution with unit stride reads each input pixel as its patch,
+    // so the input itself is the im2col matrix.
+    if (filter_height == 1 && filter_width == 1 && stride == 1) {
+      for (int64 start = 0; start < patch_count; start += patches_per_chunk) {
+        const int64 end = std::min(start + patches_per_chunk, patch_count);
+        GemmWithOutputStage(context, input_data + start * input_depth,
+                            filter_data, end - start, filter_count,
+                            filter_value_count, stage, accumulator_data,
+                            output_data + start * filter_count);
+      }
+      return;
+    }
+
+    // As in Im2ColConvFunctor.
+    int filter_left_offset;
+    int filter_top_offset;
+    if (padding_ == VALID) {
+      filter_left_offset =
+          ((output_width - 1) * stride + filter_width - input_width + 1) / 2;
+      filter_top_offset =
+          ((output_height - 1) * stride + filter_height - input_height + 1) / 2;
+    } else {
+      filter_left_offset =
+          ((output_width - 1) * stride + filter_width - input_width) / 2;
+      filter_top_offset =
+          ((output_height - 1) * stride + filter_height - input_height) / 2;
+    }
+    Tensor im2col;
+    OP_REQUIRES_OK(context,
+                   context->allocate_temp(
+                       DT_QUINT8,
+                       TensorShape({patches_per_chunk, filter_value_count}),
+                       &im2col));
+    quint8* im2col_buffer = im2col.flat<quint8>().data();
+    for (int64 start = 0; start < patch_count; start += patches_per_chunk) {
+      const int64 end = std::min(start + patches_per_chunk, patch_count);
+      Im2ColPatches(input_data, input_height, input_width, input_depth,
+                    stage.offset_input, filter_height, filter_width,
+                    filter_left_offset, filter_top_offset, stride,
+                    output_height, output_width, start, end, im2col_buffer);
+      GemmWithOutputStage(context, im2col_buffer, filter_data, end - start,
+                          filter_count, filter_value_count, stage,
+                          accumulator_data, output_data + start * filter_count);
+    }
+  }
+
+  std::vector<int32> strides_;
+  Padding padding_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("QuantizedConv2DWithBiasAndRequantize")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<quint8>("Tinput")
+                            .TypeConstraint<quint8>("Tfilter")
+                            .TypeConstraint<quint8>("out_type"),
+                        QuantizedConv2DWithBiasAndRequantizeOp);
+
 }  // namespace tensorflow
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/kernels/quantization_utils.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -322,4 +323,143 @@ TEST_F(QuantizedConv2DTest, SmallWithNoZero) {
   test::ExpectTensorNear<float>(expected_float, output_float, 1.0);
 }
 
+
+class QuantizedConv2DWithBiasAndRequantizeTest : public OpsTestBase {
+ protected:
+  void MakeOp() {
+    TF_ASSERT_OK(NodeDefBuilder("quantized_conv_op",
+                                "QuantizedConv2DWithBiasAndRequantize")
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_QUINT8))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("out_type", DataTypeToEnum<quint8>::v())
+                     .Attr("strides", {1, 1, 1, 1})
+                     .Attr("padding", "SAME")
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Adds the image of QuantizedConv2DTest.Small, in a range where each of its
+  // values is exactly representable.
+  void AddImage() {
+    const float image_min = 0.0f;
+    const float image_max = 25.5f;
+    Tensor image_float(DT_FLOAT, {1, 3, 4, 1});
+    test::FillValues<float>(&image_float,
+                            {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+    Tensor image_quantized =
+        FloatTensorToQuantized<quint8>(image_float, image_min, image_max);
+    AddInputFromArray<quint8>(image_quantized.shape(),
+                              image_quantized.flat<quint8>());
+  }
+};
+
+// The filter of QuantizedConv2DTest.Small and the same filter scaled by -0.1
+// form two output channels, quantized with different ranges and zero points.
+TEST_F(QuantizedConv2DWithBiasAndRequantizeTest, PerChannelFilterRanges) {
+  MakeOp();
+  AddImage();
+  const std::vector<float> filter_values = {1, 4, 7, 2, 5, 8, 3, 6, 9};
+  const float filter_min[] = {-5.1f, -2.55f};
+  const float filter_max[] = {20.4f, 0.0f};
+  Tensor filter_quantized(DT_QUINT8, {3, 3, 1, 2});
+  auto filter_flat = filter_quantized.flat<quint8>();
+  for (int i = 0; i < 9; ++i) {
+    filter_flat(2 * i) = FloatToQuantized<quint8>(
+        filter_values[i], filter_min[0], filter_max[0]);
+    filter_flat(2 * i + 1) = FloatToQuantized<quint8>(
+        -0.1f * filter_values[i], filter_min[1], filter_max[1]);
+  }
+  AddInputFromArray<quint8>(filter_quantized.shape(), filter_flat);
+  AddInputFromArray<float>(TensorShape({2}), {10.0f, -5.0f});
+  AddInputFromArray<float>(TensorShape({}), {0.0f});
+  AddInputFromArray<float>(TensorShape({}), {25.5f});
+  AddInputFromArray<float>(TensorShape({2}), {filter_min[0], filter_min[1]});
+  AddInputFromArray<float>(TensorShape({2}), {filter_max[0], filter_max[1]});
+  AddInputFromArray<float>(TensorShape({}), {-102.0f});
+  AddInputFromArray<float>(TensorShape({}), {408.0f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // The convolutions are those of QuantizedConv2DTest.Small, plus the bias.
+  const std::vector<float> conv = {105, 150, 183, 95,  235, 312,
+                                   357, 178, 187, 234, 261, 121};
+  Tensor expected_float(DT_FLOAT, TensorShape({1, 3, 4, 2}));
+  auto expected_flat = expected_float.flat<float>();
+  for (int i = 0; i < 12; ++i) {
+    expected_flat(2 * i) = conv[i] + 10.0f;
+    expected_flat(2 * i + 1) = -0.1f * conv[i] - 5.0f;
+  }
+  const float output_min = GetOutput(1)->flat<float>()(0);
+  const float output_max = GetOutput(2)->flat<float>()(0);
+  EXPECT_EQ(-102.0f, output_min);
+  EXPECT_EQ(408.0f, output_max);
+  // One output level is 2.0.
+  Tensor output_float =
+      QuantizedTensorToFloat<quint8>(*GetOutput(0), output_min, output_max);
+  test::ExpectTensorNear<float>(expected_float, output_float, 1.01);
+}
+
+// A 1x1 convolution with one range for the whole filter, whose outputs beyond
+// the frozen output range saturate.
+TEST_F(QuantizedConv2DWithBiasAndRequantizeTest, PointwiseSaturates) {
+  MakeOp();
+  AddImage();
+  const float filter_min = -2.55f;
+  const float filter_max = 0.0f;
+  Tensor filter_float(DT_FLOAT, {1, 1, 1, 3});
+  test::FillValues<float>(&filter_float, {-2.0f, -0.5f, -2.0f});
+  Tensor filter_quantized =
+      FloatTensorToQuantized<quint8>(filter_float, filter_min, filter_max);
+  AddInputFromArray<quint8>(filter_quantized.shape(),
+                            filter_quantized.flat<quint8>());
+  AddInputFromArray<float>(TensorShape({3}), {-1.0f, 2.0f, 30.0f});
+  AddInputFromArray<float>(TensorShape({}), {0.0f});
+  AddInputFromArray<float>(TensorShape({}), {25.5f});
+  AddInputFromArray<float>(TensorShape({}), {filter_min});
+  AddInputFromArray<float>(TensorShape({}), {filter_max});
+  AddInputFromArray<float>(TensorShape({}), {-12.8f});
+  AddInputFromArray<float>(TensorShape({}), {12.7f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_float(DT_FLOAT, TensorShape({1, 3, 4, 3}));
+  auto expected_flat = expected_float.flat<float>();
+  for (int i = 0; i < 12; ++i) {
+    const float x = i + 1;
+    expected_flat(3 * i) = std::max(-12.8f, -1.0f - 2.0f * x);
+    expected_flat(3 * i + 1) = 2.0f - 0.5f * x;
+    expected_flat(3 * i + 2) = std::min(12.7f, 30.0f - 2.0f * x);
+  }
+  // One output level is 0.1.
+  Tensor output_float = QuantizedTensorToFloat<quint8>(
+      *GetOutput(0), GetOutput(1)->flat<float>()(0),
+      GetOutput(2)->flat<float>()(0));
+  test::ExpectTensorNear<float>(expected_float, output_float, 0.06);
+}
+
+TEST_F(QuantizedConv2DWithBiasAndRequantizeTest, ZeroNotInInputRange) {
+  MakeOp();
+  Tensor image_float(DT_FLOAT, {1, 1, 2, 1});
+  test::FillValues<float>(&image_float, {1, 2});
+  Tensor image_quantized = FloatTensorToQuantized<quint8>(image_float, 1, 2);
+  AddInputFromArray<quint8>(image_quantized.shape(),
+                            image_quantized.flat<quint8>());
+  AddInputFromArray<quint8>(TensorShape({1, 1, 1, 1}), {quint8(255)});
+  AddInputFromArray<float>(TensorShape({1}), {0.0f});
+  AddInputFromArray<float>(TensorShape({}), {1.0f});
+  AddInputFromArray<float>(TensorShape({}), {2.0f});
+  AddInputFromArray<float>(TensorShape({}), {0.0f});
+  AddInputFromArray<float>(TensorShape({}), {1.0f});
+  AddInputFromArray<float>(TensorShape({}), {0.0f});
+  AddInputFromArray<float>(TensorShape({}), {2.0f});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("Zero is not representable"))
+      << s;
+}
+
 }  // namespace tensorflow
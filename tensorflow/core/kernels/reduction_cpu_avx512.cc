@@ -0,0 +1,68 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// AVX-512F versions of the functions in reduction_cpu_isa.h. This file is
+// compiled with -mavx512f on x86; see reduction_cpu_isa_impl.h for what it may
+// include.
+
+#include "tensorflow/core/kernels/reduction_cpu_isa.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+#include "tensorflow/core/kernels/reduction_cpu_isa_impl.h"
+#endif
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+namespace internal {
+
+#ifdef __AVX512F__
+
+namespace {
+
+struct Avx512Ops {
+  typedef __m512 Packet;
+  static const int kSize = 16;
+
+  static inline Packet Load(const float* p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float* p, Packet a) { _mm512_storeu_ps(p, a); }
+  static inline Packet Add(Packet a, Packet b) { return _mm512_add_ps(a, b); }
+  static inline Packet Mul(Packet a, Packet b) { return _mm512_mul_ps(a, b); }
+  static inline Packet Min(Packet a, Packet b) { return _mm512_min_ps(a, b); }
+  static inline Packet Max(Packet a, Packet b) { return _mm512_max_ps(a, b); }
+};
+
+}  // namespace
+
+const FloatReductionFunctions* GetAvx512FloatReductionFunctions(
+    FloatReduction r) {
+  return GetFloatReductionFunctionsFor<Avx512Ops>(r);
+}
+
+#else
+
+const FloatReductionFunctions* GetAvx512FloatReductionFunctions(
+    FloatReduction r) {
+  return nullptr;
+}
+
+#endif  // __AVX512F__
+
+}  // namespace internal
+}  // namespace reduction_cpu
+}  // namespace functor
+}  // namespace tensorflow
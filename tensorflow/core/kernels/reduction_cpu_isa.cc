@@ -0,0 +1,43 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/reduction_cpu_isa.h"
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+
+const FloatReductionFunctions* GetFloatReductionFunctions(
+    FloatReduction r, cpu_dispatch::InstructionSet isa) {
+  if (!cpu_dispatch::CPUSupports(isa)) return nullptr;
+  switch (isa) {
+    case cpu_dispatch::kAvx2:
+      return internal::GetAvx2FloatReductionFunctions(r);
+    case cpu_dispatch::kAvx512:
+      return internal::GetAvx512FloatReductionFunctions(r);
+    default:
+      return nullptr;
+  }
+}
+
+const FloatReductionFunctions* GetFloatReductionFunctions(FloatReduction r) {
+  return cpu_dispatch::Select<const FloatReductionFunctions*>(
+      nullptr, GetFloatReductionFunctions(r, cpu_dispatch::kAvx2),
+      GetFloatReductionFunctions(r, cpu_dispatch::kAvx512));
+}
+
+}  // namespace reduction_cpu
+}  // namespace functor
+}  // namespace tensorflow
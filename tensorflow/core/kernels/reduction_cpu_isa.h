@@ -0,0 +1,70 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_H_
+#define TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_H_
+
+// Versions of the float inner loops of reduction_ops_cpu.h that are compiled
+// for AVX2 and AVX-512, and selected at runtime as described in
+// cpu_dispatch.h. reduction_ops_cpu.h otherwise uses Eigen packets, which
+// are at most 128 bits wide in a binary built for a baseline instruction
+// set.
+
+#include "tensorflow/core/kernels/cpu_dispatch.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+
+enum FloatReduction { kFloatSum, kFloatProd, kFloatMax, kFloatMin };
+
+struct FloatReductionFunctions {
+  // Returns the reduction of in[0, n). Sums are accumulated in several
+  // independent packets, so they may round differently from a sequential
+  // sum; reduction_ops_cpu.h only calls this on leaves of a pairwise sum.
+  float (*reduce_vector)(const float* in, int64 n);
+  // Sets out[j] to the reduction of in[i * stride + j] over i in [0, rows),
+  // for j in [0, cols), like ReduceColumns in reduction_ops_cpu.h. 'rows'
+  // must be at least 1.
+  void (*reduce_columns)(const float* in, int64 stride, int64 rows,
+                         int64 cols, float* out);
+};
+
+// Returns the implementation of 'r' for 'isa', or nullptr if 'isa' is
+// kBaseline, this binary was not built with code for 'isa' or the CPU does
+// not support it.
+const FloatReductionFunctions* GetFloatReductionFunctions(
+    FloatReduction r, cpu_dispatch::InstructionSet isa);
+
+// Returns the implementation of 'r' that cpu_dispatch::Select() picks, or
+// nullptr if there is none and callers should use Eigen packets instead.
+const FloatReductionFunctions* GetFloatReductionFunctions(FloatReduction r);
+
+namespace internal {
+
+// Defined in reduction_cpu_avx2.cc and reduction_cpu_avx512.cc. Return
+// nullptr when the file was compiled without the instruction set.
+const FloatReductionFunctions* GetAvx2FloatReductionFunctions(
+    FloatReduction r);
+const FloatReductionFunctions* GetAvx512FloatReductionFunctions(
+    FloatReduction r);
+
+}  // namespace internal
+}  // namespace reduction_cpu
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_H_
@@ -0,0 +1,196 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_IMPL_H_
+#define TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_IMPL_H_
+
+// The functions of reduction_cpu_isa.h, written once against a small set of
+// packet operations, as in vectorized_math_impl.h. Each of
+// reduction_cpu_avx2.cc and reduction_cpu_avx512.cc defines the operations
+// with intrinsics in an anonymous namespace and instantiates the templates
+// below with them. The same restrictions apply: only those files may include
+// this header, and they must not call inline functions defined in other
+// headers, including the standard library's.
+//
+// The operations class 'Ops' provides, for a packet type Packet of kSize
+// floats:
+//
+//   Load(p), Store(p, a), Add(a, b), Mul(a, b), Min(a, b), Max(a, b)
+//
+// Min and Max must return their second argument if either one is NaN, as
+// the x86 instructions and Eigen's pmin and pmax do.
+
+#include <math.h>
+#include <string.h>
+
+#include "tensorflow/core/kernels/reduction_cpu_isa.h"
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+namespace internal {
+
+// The reductions, on packets and on scalars as in reduction_ops_cpu.h.
+template <typename Ops>
+struct Sum {
+  typedef typename Ops::Packet Packet;
+  static inline float Identity() { return 0.0f; }
+  static inline float Apply(float a, float b) { return a + b; }
+  static inline Packet Apply(Packet a, Packet b) { return Ops::Add(a, b); }
+};
+
+template <typename Ops>
+struct Prod {
+  typedef typename Ops::Packet Packet;
+  static inline float Identity() { return 1.0f; }
+  static inline float Apply(float a, float b) { return a * b; }
+  static inline Packet Apply(Packet a, Packet b) { return Ops::Mul(a, b); }
+};
+
+template <typename Ops>
+struct Max {
+  typedef typename Ops::Packet Packet;
+  static inline float Identity() { return -INFINITY; }
+  static inline float Apply(float a, float b) { return a < b ? b : a; }
+  static inline Packet Apply(Packet a, Packet b) { return Ops::Max(a, b); }
+};
+
+template <typename Ops>
+struct Min {
+  typedef typename Ops::Packet Packet;
+  static inline float Identity() { return INFINITY; }
+  static inline float Apply(float a, float b) { return b < a ? b : a; }
+  static inline Packet Apply(Packet a, Packet b) { return Ops::Min(a, b); }
+};
+
+template <typename Ops, typename Reduce>
+float ReduceVector(const float* in, int64 n) {
+  typedef typename Ops::Packet Packet;
+  const int64 kSize = Ops::kSize;
+  float result = Reduce::Identity();
+  int64 i = 0;
+  if (n >= kSize) {
+    Packet accum = Ops::Load(in);
+    i = kSize;
+    if (n >= 4 * kSize) {
+      // Independent accumulators hide the latency of each operation.
+      Packet accum1 = Ops::Load(in + kSize);
+      Packet accum2 = Ops::Load(in + 2 * kSize);
+      Packet accum3 = Ops::Load(in + 3 * kSize);
+      for (i = 4 * kSize; i + 4 * kSize <= n; i += 4 * kSize) {
+        accum = Reduce::Apply(accum, Ops::Load(in + i));
+        accum1 = Reduce::Apply(accum1, Ops::Load(in + i + kSize));
+        accum2 = Reduce::Apply(accum2, Ops::Load(in + i + 2 * kSize));
+        accum3 = Reduce::Apply(accum3, Ops::Load(in + i + 3 * kSize));
+      }
+      accum = Reduce::Apply(Reduce::Apply(accum, accum1),
+                            Reduce::Apply(accum2, accum3));
+    }
+    for (; i + kSize <= n; i += kSize) {
+      accum = Reduce::Apply(accum, Ops::Load(in + i));
+    }
+    float lanes[kSize];
+    Ops::Store(lanes, accum);
+    result = lanes[0];
+    for (int64 k = 1; k < kSize; ++k) result = Reduce::Apply(result, lanes[k]);
+  }
+  for (; i < n; ++i) result = Reduce::Apply(result, in[i]);
+  return result;
+}
+
+// Sets out[j] to the reduction of in[i * stride + j] over i in [0, 4), and
+// of out[j] too if 'accumulate' is true, for j in [0, cols).
+template <typename Ops, typename Reduce, bool accumulate>
+inline void ReduceFourRows(const float* in, int64 stride, int64 cols,
+                           float* out) {
+  typedef typename Ops::Packet Packet;
+  const int64 kSize = Ops::kSize;
+  const float* in0 = in;
+  const float* in1 = in0 + stride;
+  const float* in2 = in1 + stride;
+  const float* in3 = in2 + stride;
+  int64 j = 0;
+  for (; j + kSize <= cols; j += kSize) {
+    Packet a = Reduce::Apply(Ops::Load(in0 + j), Ops::Load(in1 + j));
+    const Packet b = Reduce::Apply(Ops::Load(in2 + j), Ops::Load(in3 + j));
+    a = Reduce::Apply(a, b);
+    if (accumulate) a = Reduce::Apply(Ops::Load(out + j), a);
+    Ops::Store(out + j, a);
+  }
+  for (; j < cols; ++j) {
+    const float a = Reduce::Apply(Reduce::Apply(in0[j], in1[j]),
+                                  Reduce::Apply(in2[j], in3[j]));
+    out[j] = accumulate ? Reduce::Apply(out[j], a) : a;
+  }
+}
+
+template <typename Ops, typename Reduce>
+void ReduceColumns(const float* in, int64 stride, int64 rows, int64 cols,
+                   float* out) {
+  const int64 kSize = Ops::kSize;
+  int64 i = 0;
+  if (rows >= 4) {
+    ReduceFourRows<Ops, Reduce, false>(in, stride, cols, out);
+    i = 4;
+  } else {
+    memcpy(out, in, cols * sizeof(float));
+    i = 1;
+  }
+  for (; i + 4 <= rows; i += 4) {
+    ReduceFourRows<Ops, Reduce, true>(in + i * stride, stride, cols, out);
+  }
+  for (; i < rows; ++i) {
+    const float* row = in + i * stride;
+    int64 j = 0;
+    for (; j + kSize <= cols; j += kSize) {
+      Ops::Store(out + j,
+                 Reduce::Apply(Ops::Load(out + j), Ops::Load(row + j)));
+    }
+    for (; j < cols; ++j) out[j] = Reduce::Apply(out[j], row[j]);
+  }
+}
+
+template <typename Ops, typename Reduce>
+struct Functions {
+  static const FloatReductionFunctions kFunctions;
+};
+
+template <typename Ops, typename Reduce>
+const FloatReductionFunctions Functions<Ops, Reduce>::kFunctions = {
+    &ReduceVector<Ops, Reduce>, &ReduceColumns<Ops, Reduce>};
+
+template <typename Ops>
+const FloatReductionFunctions* GetFloatReductionFunctionsFor(
+    FloatReduction r) {
+  switch (r) {
+    case kFloatSum:
+      return &Functions<Ops, Sum<Ops>>::kFunctions;
+    case kFloatProd:
+      return &Functions<Ops, Prod<Ops>>::kFunctions;
+    case kFloatMax:
+      return &Functions<Ops, Max<Ops>>::kFunctions;
+    case kFloatMin:
+      return &Functions<Ops, Min<Ops>>::kFunctions;
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace internal
+}  // namespace reduction_cpu
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_REDUCTION_CPU_ISA_IMPL_H_
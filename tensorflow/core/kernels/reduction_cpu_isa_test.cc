@@ -0,0 +1,195 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/reduction_cpu_isa.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+namespace {
+
+using cpu_dispatch::InstructionSet;
+
+const InstructionSet kInstructionSets[] = {cpu_dispatch::kAvx2,
+                                           cpu_dispatch::kAvx512};
+
+// Reduces in double, so that sums and products are exact for the small
+// integers and powers of two used below.
+double Reference(FloatReduction r, const std::vector<float>& in) {
+  double result = in[0];
+  for (size_t i = 1; i < in.size(); ++i) {
+    switch (r) {
+      case kFloatSum:
+        result += in[i];
+        break;
+      case kFloatProd:
+        result *= in[i];
+        break;
+      case kFloatMax:
+        result = std::max<double>(result, in[i]);
+        break;
+      case kFloatMin:
+        result = std::min<double>(result, in[i]);
+        break;
+    }
+  }
+  return result;
+}
+
+// Values whose sums and products are exactly representable as floats.
+float Value(FloatReduction r, int64 i) {
+  if (r == kFloatProd) return (i % 7 == 3) ? 2.0f : ((i % 5 == 1) ? 0.5f : 1.0f);
+  return static_cast<float>((i * 37) % 101) - 50.0f;
+}
+
+class ReductionCpuIsaTest : public ::testing::TestWithParam<FloatReduction> {};
+
+TEST_P(ReductionCpuIsaTest, ReduceVectorAllLengths) {
+  const FloatReduction r = GetParam();
+  for (InstructionSet isa : kInstructionSets) {
+    const FloatReductionFunctions* functions =
+        GetFloatReductionFunctions(r, isa);
+    if (functions == nullptr) continue;
+    for (int64 n = 1; n < 300; ++n) {
+      std::vector<float> in(n);
+      for (int64 i = 0; i < n; ++i) in[i] = Value(r, i);
+      EXPECT_EQ(Reference(r, in), functions->reduce_vector(in.data(), n))
+          << "r=" << r << " isa=" << isa << " n=" << n;
+    }
+  }
+}
+
+TEST_P(ReductionCpuIsaTest, ReduceColumns) {
+  const FloatReduction r = GetParam();
+  const int64 kStride = 70;
+  for (InstructionSet isa : kInstructionSets) {
+    const FloatReductionFunctions* functions =
+        GetFloatReductionFunctions(r, isa);
+    if (functions == nullptr) continue;
+    for (int64 rows = 1; rows < 12; ++rows) {
+      for (int64 cols = 1; cols < kStride; cols += 3) {
+        std::vector<float> in(rows * kStride);
+        for (int64 i = 0; i < rows * kStride; ++i) in[i] = Value(r, i);
+        // Guards after the end must stay untouched.
+        std::vector<float> out(cols + 16, -7.0f);
+        functions->reduce_columns(in.data(), kStride, rows, cols, out.data());
+        for (int64 j = 0; j < cols; ++j) {
+          std::vector<float> column(rows);
+          for (int64 i = 0; i < rows; ++i) column[i] = in[i * kStride + j];
+          EXPECT_EQ(Reference(r, column), out[j])
+              << "r=" << r << " isa=" << isa << " rows=" << rows
+              << " cols=" << cols << " j=" << j;
+        }
+        for (int64 j = cols; j < cols + 16; ++j) EXPECT_EQ(-7.0f, out[j]);
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(AllReductions, ReductionCpuIsaTest,
+                        ::testing::Values(kFloatSum, kFloatProd, kFloatMax,
+                                          kFloatMin));
+
+TEST(ReductionCpuIsaTest, InfinitiesAndNaN) {
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> in(100, 1.0f);
+  in[37] = inf;
+  in[61] = -inf;
+  for (InstructionSet isa : kInstructionSets) {
+    if (GetFloatReductionFunctions(kFloatMax, isa) == nullptr) continue;
+    EXPECT_EQ(inf, GetFloatReductionFunctions(kFloatMax, isa)
+                       ->reduce_vector(in.data(), in.size()));
+    EXPECT_EQ(-inf, GetFloatReductionFunctions(kFloatMin, isa)
+                        ->reduce_vector(in.data(), in.size()));
+    EXPECT_TRUE(std::isnan(GetFloatReductionFunctions(kFloatSum, isa)
+                               ->reduce_vector(in.data(), in.size())));
+  }
+}
+
+TEST(ReductionCpuIsaTest, Dispatch) {
+  // The widest version allowed by cpu_dispatch, if any.
+  const FloatReductionFunctions* expected = nullptr;
+  for (InstructionSet isa : kInstructionSets) {
+    if (isa <= cpu_dispatch::MaxInstructionSet() &&
+        GetFloatReductionFunctions(kFloatSum, isa) != nullptr) {
+      expected = GetFloatReductionFunctions(kFloatSum, isa);
+    }
+  }
+  EXPECT_EQ(expected, GetFloatReductionFunctions(kFloatSum));
+  EXPECT_EQ(nullptr,
+            GetFloatReductionFunctions(kFloatSum, cpu_dispatch::kBaseline));
+}
+
+static void BM_ReduceVector(int iters, InstructionSet isa) {
+  testing::StopTiming();
+  const FloatReductionFunctions* functions =
+      GetFloatReductionFunctions(kFloatSum, isa);
+  if (functions == nullptr) return;
+  const int kSize = 1024;
+  std::vector<float> in(kSize, 1.0f);
+  testing::ItemsProcessed(static_cast<int64>(iters) * kSize);
+  testing::StartTiming();
+  float sum = 0;
+  while (--iters >= 0) {
+    sum += functions->reduce_vector(in.data(), kSize);
+  }
+  CHECK_GT(sum, 0);
+}
+
+static void BM_ReduceColumns(int iters, InstructionSet isa) {
+  testing::StopTiming();
+  const FloatReductionFunctions* functions =
+      GetFloatReductionFunctions(kFloatSum, isa);
+  if (functions == nullptr) return;
+  const int kRows = 64;
+  const int kCols = 1024;
+  std::vector<float> in(kRows * kCols, 1.0f);
+  std::vector<float> out(kCols);
+  testing::ItemsProcessed(static_cast<int64>(iters) * kRows * kCols);
+  testing::StartTiming();
+  while (--iters >= 0) {
+    functions->reduce_columns(in.data(), kCols, kRows, kCols, out.data());
+  }
+}
+
+static void BM_ReduceVector_Avx2(int iters) {
+  BM_ReduceVector(iters, cpu_dispatch::kAvx2);
+}
+static void BM_ReduceVector_Avx512(int iters) {
+  BM_ReduceVector(iters, cpu_dispatch::kAvx512);
+}
+static void BM_ReduceColumns_Avx2(int iters) {
+  BM_ReduceColumns(iters, cpu_dispatch::kAvx2);
+}
+static void BM_ReduceColumns_Avx512(int iters) {
+  BM_ReduceColumns(iters, cpu_dispatch::kAvx512);
+}
+BENCHMARK(BM_ReduceVector_Avx2);
+BENCHMARK(BM_ReduceVector_Avx512);
+BENCHMARK(BM_ReduceColumns_Avx2);
+BENCHMARK(BM_ReduceColumns_Avx512);
+
+}  // namespace
+}  // namespace reduction_cpu
+}  // namespace functor
+}  // namespace tensorflow
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/reduction_ops.h"
+#include "tensorflow/core/kernels/reduction_ops_cpu.h"
 #include "tensorflow/core/kernels/transpose_functor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
@@ -273,7 +274,31 @@ struct ReduceFunctorBase {
 
 template <typename Reducer>
 struct ReduceFunctor<CPUDevice, Reducer>
-        : ReduceFunctorBase<CPUDevice, Reducer>{};
+    : ReduceFunctorBase<CPUDevice, Reducer> {
+  // Uses CpuReduction for the shapes and reducers it implements, and Eigen
+  // otherwise.
+  template <typename OUT_T, typename IN_T, typename ReductionAxes>
+  static void Reduce(const CPUDevice& d, OUT_T out, IN_T in,
+                     const ReductionAxes& reduction_axes,
+                     const Reducer& reducer) {
+    typedef CpuReduction<Reducer> Cpu;
+    const int num_axes = Eigen::internal::array_size<ReductionAxes>::value;
+    bool done = false;
+    if (in.rank() == 1 && num_axes == 1) {
+      done = Cpu::ReduceAll(d, in.data(), in.dimension(0), out.data());
+    } else if (in.rank() == 2 && num_axes == 1 && reduction_axes[0] == 1) {
+      done = Cpu::ReduceInner(d, in.data(), in.dimension(0), in.dimension(1),
+                              out.data());
+    } else if (in.rank() == 2 && num_axes == 1 && reduction_axes[0] == 0) {
+      done = Cpu::ReduceOuter(d, in.data(), in.dimension(0), in.dimension(1),
+                              out.data());
+    } else if (in.rank() == 3 && num_axes == 1 && reduction_axes[0] == 1) {
+      done = Cpu::ReduceMiddle(d, in.data(), in.dimension(0), in.dimension(1),
+                               in.dimension(2), out.data());
+    }
+    if (!done) ReduceEigenImpl(d, out, in, reduction_axes, reducer);
+  }
+};
 #if TENSORFLOW_USE_SYCL
 template <typename Reducer>
 struct ReduceFunctor<SYCLDevice, Reducer>
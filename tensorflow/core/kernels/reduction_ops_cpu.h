@@ -0,0 +1,514 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_REDUCTION_OPS_CPU_H_
+#define TENSORFLOW_KERNELS_REDUCTION_OPS_CPU_H_
+
+// CPU implementations of the reductions ReductionOp reshapes its input to:
+//
+//   [n] -> []                               (ReduceAll)
+//   [rows, cols] -> [rows]                  (ReduceInner)
+//   [rows, cols] -> [cols]                  (ReduceOuter)
+//   [planes, rows, cols] -> [planes, cols]  (ReduceMiddle)
+//
+// for Sum, Mean, Max, Min and Prod of float, double, int32 and int64.
+//
+// Eigen's tensor reductions shard the output coefficients and compute each
+// one separately, so a [8, 1M] reduction over the first dimension runs on
+// at most 8 threads, and a [1M, 8] reduction over the last one spends most
+// of its time setting up each coefficient. Here the input is split into
+// blocks of both rows and columns, as many as the device has threads to
+// keep busy; blocks that share an output coefficient write partial results,
+// which are reduced again. Rows are accumulated a packet at a time in
+// registers or in an L1-sized block of columns.
+//
+// Sums are computed pairwise over blocks of at most kLeafSize elements, so
+// that their rounding error grows with the logarithm of the number of
+// elements reduced rather than linearly.
+//
+// The float reductions use the AVX2 or AVX-512 versions of ReduceLeaf and
+// ReduceColumns in reduction_cpu_isa.h when the CPU supports them.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/kernels/reduction_cpu_isa.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+namespace reduction_cpu {
+
+// The operations of a reduction on scalars and on Eigen packets of T. A
+// packet of an unvectorized T is a single T.
+template <typename T>
+struct SumOp {
+  typedef typename Eigen::internal::packet_traits<T>::type Packet;
+  static const int kCost = Eigen::NumTraits<T>::AddCost;
+  static T Identity() { return T(0); }
+  static T Apply(T a, T b) { return a + b; }
+  static Packet ApplyPacket(const Packet& a, const Packet& b) {
+    return Eigen::internal::padd(a, b);
+  }
+  static T Horizontal(const Packet& a) { return Eigen::internal::predux(a); }
+};
+
+template <typename T>
+struct ProdOp {
+  typedef typename Eigen::internal::packet_traits<T>::type Packet;
+  static const int kCost = Eigen::NumTraits<T>::MulCost;
+  static T Identity() { return T(1); }
+  static T Apply(T a, T b) { return a * b; }
+  static Packet ApplyPacket(const Packet& a, const Packet& b) {
+    return Eigen::internal::pmul(a, b);
+  }
+  static T Horizontal(const Packet& a) {
+    return Eigen::internal::predux_mul(a);
+  }
+};
+
+template <typename T>
+struct MaxOp {
+  typedef typename Eigen::internal::packet_traits<T>::type Packet;
+  static const int kCost = Eigen::NumTraits<T>::AddCost;
+  static T Identity() {
+    return std::numeric_limits<T>::has_infinity
+               ? -std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::lowest();
+  }
+  static T Apply(T a, T b) { return a < b ? b : a; }
+  static Packet ApplyPacket(const Packet& a, const Packet& b) {
+    return Eigen::internal::pmax(a, b);
+  }
+  static T Horizontal(const Packet& a) {
+    return Eigen::internal::predux_max(a);
+  }
+};
+
+template <typename T>
+struct MinOp {
+  typedef typename Eigen::internal::packet_traits<T>::type Packet;
+  static const int kCost = Eigen::NumTraits<T>::AddCost;
+  static T Identity() {
+    return std::numeric_limits<T>::has_infinity
+               ? std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::max();
+  }
+  static T Apply(T a, T b) { return b < a ? b : a; }
+  static Packet ApplyPacket(const Packet& a, const Packet& b) {
+    return Eigen::internal::pmin(a, b);
+  }
+  static T Horizontal(const Packet& a) {
+    return Eigen::internal::predux_min(a);
+  }
+};
+
+// Maps an Eigen reducer to the operation computing it, if there is one.
+// 'kMean' is true if the result is divided by the number of elements
+// reduced.
+template <typename Reducer>
+struct ReducerTraits {
+  static const bool kSupported = false;
+};
+
+#define REDUCTION_CPU_TRAITS(T, REDUCER, OP, MEAN) \
+  template <>                                      \
+  struct ReducerTraits<REDUCER<T>> {               \
+    static const bool kSupported = true;           \
+    static const bool kMean = MEAN;                \
+    typedef OP<T> Op;                              \
+  };
+#define REDUCTION_CPU_ALL_TRAITS(T)                                         \
+  REDUCTION_CPU_TRAITS(T, Eigen::internal::SumReducer, SumOp, false)        \
+  REDUCTION_CPU_TRAITS(T, Eigen::internal::MeanReducer, SumOp, true)        \
+  REDUCTION_CPU_TRAITS(T, Eigen::internal::ProdReducer, ProdOp, false)      \
+  REDUCTION_CPU_TRAITS(T, Eigen::internal::MaxReducer, MaxOp, false)        \
+  REDUCTION_CPU_TRAITS(T, Eigen::internal::MinReducer, MinOp, false)
+REDUCTION_CPU_ALL_TRAITS(float)
+REDUCTION_CPU_ALL_TRAITS(double)
+REDUCTION_CPU_ALL_TRAITS(int32)
+REDUCTION_CPU_ALL_TRAITS(int64)
+#undef REDUCTION_CPU_ALL_TRAITS
+#undef REDUCTION_CPU_TRAITS
+
+// The versions of ReduceLeaf and ReduceColumns for Op and T selected at
+// runtime, or nullptr if there are none.
+template <typename Op, typename T>
+struct IsaFunctions {
+  typedef T (*ReduceVectorFunction)(const T* in, int64 n);
+  typedef void (*ReduceColumnsFunction)(const T* in, int64 stride,
+                                        int64 rows, int64 cols, T* out);
+  ReduceVectorFunction reduce_vector;
+  ReduceColumnsFunction reduce_columns;
+
+  static const IsaFunctions* Get() { return nullptr; }
+};
+
+#define REDUCTION_CPU_ISA_FUNCTIONS(OP, REDUCTION)                          \
+  template <>                                                               \
+  inline const IsaFunctions<OP<float>, float>*                              \
+  IsaFunctions<OP<float>, float>::Get() {                                   \
+    static const FloatReductionFunctions* isa =                             \
+        GetFloatReductionFunctions(REDUCTION);                              \
+    static const IsaFunctions functions = {                                 \
+        isa != nullptr ? isa->reduce_vector : nullptr,                      \
+        isa != nullptr ? isa->reduce_columns : nullptr};                    \
+    return isa != nullptr ? &functions : nullptr;                           \
+  }
+REDUCTION_CPU_ISA_FUNCTIONS(SumOp, kFloatSum)
+REDUCTION_CPU_ISA_FUNCTIONS(ProdOp, kFloatProd)
+REDUCTION_CPU_ISA_FUNCTIONS(MaxOp, kFloatMax)
+REDUCTION_CPU_ISA_FUNCTIONS(MinOp, kFloatMin)
+#undef REDUCTION_CPU_ISA_FUNCTIONS
+
+// Vectors longer than this are reduced pairwise.
+const int64 kLeafSize = 1024;
+// The fewest elements a shard reduces when a row or a column is split
+// between shards.
+const int64 kMinBlockSize = 16 << 10;
+// The most columns whose partial results ReduceMiddle keeps in L1.
+const int64 kColumnBlockSize = 1024;
+// The most rows ReduceMiddle accumulates before writing a partial result.
+const int64 kMaxRowBlockSize = 1024;
+// Shorter leaves are reduced with ReduceLeaf even if there is an
+// IsaFunctions: the indirect call and the horizontal reduction of a wide
+// packet cost more than the wider packets save.
+const int64 kMinIsaLeafSize = 256;
+// Narrower blocks of columns are reduced with ReduceColumns, whose narrower
+// packets leave fewer columns to the scalar loop.
+const int64 kMinIsaColumns = 64;
+
+// Returns the reduction of in[0, n) for n <= kLeafSize.
+template <typename Op, typename T>
+inline T ReduceLeaf(const T* in, int64 n) {
+  typedef typename Op::Packet Packet;
+  const int kPacketSize = Eigen::internal::unpacket_traits<Packet>::size;
+  T result = Op::Identity();
+  int64 i = 0;
+  if (n >= kPacketSize) {
+    Packet accum = Eigen::internal::ploadu<Packet>(in);
+    i = kPacketSize;
+    if (n >= 4 * kPacketSize) {
+      // Independent accumulators hide the latency of each operation.
+      Packet accum1 = Eigen::internal::ploadu<Packet>(in + kPacketSize);
+      Packet accum2 = Eigen::internal::ploadu<Packet>(in + 2 * kPacketSize);
+      Packet accum3 = Eigen::internal::ploadu<Packet>(in + 3 * kPacketSize);
+      for (i = 4 * kPacketSize; i + 4 * kPacketSize <= n;
+           i += 4 * kPacketSize) {
+        accum = Op::ApplyPacket(accum, Eigen::internal::ploadu<Packet>(in + i));
+        accum1 = Op::ApplyPacket(
+            accum1, Eigen::internal::ploadu<Packet>(in + i + kPacketSize));
+        accum2 = Op::ApplyPacket(
+            accum2, Eigen::internal::ploadu<Packet>(in + i + 2 * kPacketSize));
+        accum3 = Op::ApplyPacket(
+            accum3, Eigen::internal::ploadu<Packet>(in + i + 3 * kPacketSize));
+      }
+      accum = Op::ApplyPacket(Op::ApplyPacket(accum, accum1),
+                              Op::ApplyPacket(accum2, accum3));
+    }
+    for (; i + kPacketSize <= n; i += kPacketSize) {
+      accum = Op::ApplyPacket(accum, Eigen::internal::ploadu<Packet>(in + i));
+    }
+    result = Op::Horizontal(accum);
+  }
+  for (; i < n; ++i) result = Op::Apply(result, in[i]);
+  return result;
+}
+
+// Returns the reduction of in[0, n), pairwise over leaves, which are reduced
+// by 'isa' unless it is nullptr or they are short.
+template <typename Op, typename T>
+T ReduceVector(const T* in, int64 n, const IsaFunctions<Op, T>* isa) {
+  if (n <= kLeafSize) {
+    return isa != nullptr && n >= kMinIsaLeafSize ? isa->reduce_vector(in, n)
+                                                  : ReduceLeaf<Op>(in, n);
+  }
+  const int64 half = (n / 2 + kLeafSize - 1) / kLeafSize * kLeafSize;
+  return Op::Apply(ReduceVector<Op>(in, half, isa),
+                   ReduceVector<Op>(in + half, n - half, isa));
+}
+
+// Sets out[j] to the reduction of in[i * stride + j] over i in [0, 4), and
+// of out[j] too if 'accumulate' is true, for j in [0, cols).
+template <typename Op, bool accumulate, typename T>
+inline void ReduceFourRows(const T* in, int64 stride, int64 cols, T* out) {
+  typedef typename Op::Packet Packet;
+  const int kPacketSize = Eigen::internal::unpacket_traits<Packet>::size;
+  const T* in0 = in;
+  const T* in1 = in0 + stride;
+  const T* in2 = in1 + stride;
+  const T* in3 = in2 + stride;
+  int64 j = 0;
+  for (; j + kPacketSize <= cols; j += kPacketSize) {
+    Packet a = Op::ApplyPacket(Eigen::internal::ploadu<Packet>(in0 + j),
+                               Eigen::internal::ploadu<Packet>(in1 + j));
+    const Packet b = Op::ApplyPacket(Eigen::internal::ploadu<Packet>(in2 + j),
+                                     Eigen::internal::ploadu<Packet>(in3 + j));
+    a = Op::ApplyPacket(a, b);
+    if (accumulate) {
+      a = Op::ApplyPacket(Eigen::internal::ploadu<Packet>(out + j), a);
+    }
+    Eigen::internal::pstoreu(out + j, a);
+  }
+  for (; j < cols; ++j) {
+    T a = Op::Apply(Op::Apply(in0[j], in1[j]), Op::Apply(in2[j], in3[j]));
+    out[j] = accumulate ? Op::Apply(out[j], a) : a;
+  }
+}
+
+// Sets out[j] to the reduction of in[i * stride + j] over i in [0, rows),
+// for j in [0, cols). Four rows at a time are reduced in registers before
+// they are combined with 'out', which stays in L1.
+template <typename Op, typename T>
+void ReduceColumns(const T* in, int64 stride, int64 rows, int64 cols,
+                   T* out) {
+  typedef typename Op::Packet Packet;
+  const int kPacketSize = Eigen::internal::unpacket_traits<Packet>::size;
+  int64 i = 0;
+  if (rows >= 4) {
+    ReduceFourRows<Op, false>(in, stride, cols, out);
+    i = 4;
+  } else {
+    std::copy(in, in + cols, out);
+    i = 1;
+  }
+  for (; i + 4 <= rows; i += 4) {
+    ReduceFourRows<Op, true>(in + i * stride, stride, cols, out);
+  }
+  for (; i < rows; ++i) {
+    const T* row = in + i * stride;
+    int64 j = 0;
+    for (; j + kPacketSize <= cols; j += kPacketSize) {
+      Eigen::internal::pstoreu(
+          out + j, Op::ApplyPacket(Eigen::internal::ploadu<Packet>(out + j),
+                                   Eigen::internal::ploadu<Packet>(row + j)));
+    }
+    for (; j < cols; ++j) out[j] = Op::Apply(out[j], row[j]);
+  }
+}
+
+// Applied to the results: either nothing, or the division of a Mean.
+template <typename T>
+struct NoFinalize {
+  T operator()(T x) const { return x; }
+};
+
+template <typename T>
+struct DivideBy {
+  explicit DivideBy(int64 count) : divisor(static_cast<T>(count)) {}
+  T operator()(T x) const { return x / divisor; }
+  const T divisor;
+};
+
+// The number of shards parallelFor should be able to spread work over.
+inline int64 TargetShards(const Eigen::ThreadPoolDevice& d) {
+  return 4 * d.numThreads();
+}
+
+template <typename Op, typename T, typename Finalize>
+void ReduceInnerImpl(const Eigen::ThreadPoolDevice& d, const T* in,
+                     int64 rows, int64 cols, const Finalize& finalize,
+                     T* out) {
+  const IsaFunctions<Op, T>* isa = IsaFunctions<Op, T>::Get();
+  const int64 target_shards = TargetShards(d);
+  if (rows >= target_shards || cols < 2 * kMinBlockSize) {
+    const Eigen::TensorOpCost cost(cols * sizeof(T), sizeof(T),
+                                   cols * Op::kCost);
+    d.parallelFor(rows, cost, [in, cols, &finalize, isa, out](int64 start,
+                                                              int64 end) {
+      if (cols <= kLeafSize && (isa == nullptr || cols < kMinIsaLeafSize)) {
+        for (int64 i = start; i < end; ++i) {
+          out[i] = finalize(ReduceLeaf<Op>(in + i * cols, cols));
+        }
+      } else {
+        for (int64 i = start; i < end; ++i) {
+          out[i] = finalize(ReduceVector<Op>(in + i * cols, cols, isa));
+        }
+      }
+    });
+    return;
+  }
+  // Splits each row into blocks, which are multiples of kLeafSize so that
+  // sums stay pairwise.
+  const int64 blocks_per_row =
+      std::min(cols / kMinBlockSize, (target_shards + rows - 1) / rows);
+  int64 block_size = (cols + blocks_per_row - 1) / blocks_per_row;
+  block_size = (block_size + kLeafSize - 1) / kLeafSize * kLeafSize;
+  const int64 num_blocks = (cols + block_size - 1) / block_size;
+  std::vector<T> partial(rows * num_blocks);
+  T* partial_data = partial.data();
+  const Eigen::TensorOpCost cost(block_size * sizeof(T), sizeof(T),
+                                 block_size * Op::kCost);
+  d.parallelFor(rows * num_blocks, cost, [in, cols, block_size, num_blocks,
+                                          isa, partial_data](int64 start,
+                                                             int64 end) {
+    for (int64 b = start; b < end; ++b) {
+      const int64 col = b % num_blocks * block_size;
+      partial_data[b] = ReduceVector<Op>(in + b / num_blocks * cols + col,
+                                         std::min(block_size, cols - col), isa);
+    }
+  });
+  for (int64 i = 0; i < rows; ++i) {
+    out[i] = finalize(ReduceVector<Op>(partial_data + i * num_blocks,
+                                       num_blocks, isa));
+  }
+}
+
+template <typename Op, typename T, typename Finalize>
+void ReduceMiddleImpl(const Eigen::ThreadPoolDevice& d, const T* in,
+                      int64 planes, int64 rows, int64 cols,
+                      const Finalize& finalize, T* out) {
+  const IsaFunctions<Op, T>* isa = IsaFunctions<Op, T>::Get();
+  const int64 target_shards = TargetShards(d);
+  const int64 col_block_size = std::min(cols, kColumnBlockSize);
+  const int64 num_col_blocks = (cols + col_block_size - 1) / col_block_size;
+  // Splits the rows as well if there are too few blocks of columns to keep
+  // the threads busy, in blocks of at least kMinBlockSize elements, or if
+  // there are too many rows to accumulate at once.
+  int64 row_block_size = rows;
+  const int64 col_shards = planes * num_col_blocks;
+  if (col_shards < target_shards || rows > kMaxRowBlockSize) {
+    const int64 min_rows =
+        (kMinBlockSize + col_block_size - 1) / col_block_size;
+    const int64 row_blocks = (target_shards + col_shards - 1) / col_shards;
+    row_block_size = std::max(min_rows, (rows + row_blocks - 1) / row_blocks);
+    row_block_size = std::min(row_block_size, kMaxRowBlockSize);
+  }
+  const int64 num_row_blocks = (rows + row_block_size - 1) / row_block_size;
+  // Partial results for each block of rows, unless there is only one.
+  std::vector<T> partial;
+  T* partial_data = out;
+  if (num_row_blocks > 1) {
+    partial.resize(planes * num_row_blocks * cols);
+    partial_data = partial.data();
+  }
+  const int64 block_elements = row_block_size * col_block_size;
+  const Eigen::TensorOpCost cost(block_elements * sizeof(T),
+                                 col_block_size * sizeof(T),
+                                 block_elements * Op::kCost);
+  d.parallelFor(
+      planes * num_row_blocks * num_col_blocks, cost,
+      [in, rows, cols, col_block_size, num_col_blocks, row_block_size,
+       num_row_blocks, partial_data, &finalize, isa](int64 start, int64 end) {
+        for (int64 b = start; b < end; ++b) {
+          // Consecutive blocks are side by side in the same rows.
+          const int64 col = b % num_col_blocks * col_block_size;
+          const int64 row_block = b / num_col_blocks % num_row_blocks;
+          const int64 plane = b / (num_col_blocks * num_row_blocks);
+          const int64 row = row_block * row_block_size;
+          const int64 block_cols = std::min(col_block_size, cols - col);
+          T* block_out =
+              partial_data + (plane * num_row_blocks + row_block) * cols + col;
+          const T* block_in = in + (plane * rows + row) * cols + col;
+          const int64 block_rows = std::min(row_block_size, rows - row);
+          if (isa != nullptr && block_cols >= kMinIsaColumns) {
+            isa->reduce_columns(block_in, cols, block_rows, block_cols,
+                                block_out);
+          } else {
+            ReduceColumns<Op>(block_in, cols, block_rows, block_cols,
+                              block_out);
+          }
+          if (num_row_blocks == 1) {
+            for (int64 j = 0; j < block_cols; ++j) {
+              block_out[j] = finalize(block_out[j]);
+            }
+          }
+        }
+      });
+  if (num_row_blocks > 1) {
+    ReduceMiddleImpl<Op>(d, partial_data, planes, num_row_blocks, cols,
+                         finalize, out);
+  }
+}
+
+}  // namespace reduction_cpu
+
+// Computes the reductions listed at the top of this file with Reducer. Each
+// function returns false without doing anything if there is no
+// implementation for Reducer. The input must not be empty.
+template <typename Reducer,
+          bool supported = reduction_cpu::ReducerTraits<Reducer>::kSupported>
+struct CpuReduction {
+  template <typename T>
+  static bool ReduceAll(const Eigen::ThreadPoolDevice& d, const T* in,
+                        int64 n, T* out) {
+    return false;
+  }
+  template <typename T>
+  static bool ReduceInner(const Eigen::ThreadPoolDevice& d, const T* in,
+                          int64 rows, int64 cols, T* out) {
+    return false;
+  }
+  template <typename T>
+  static bool ReduceOuter(const Eigen::ThreadPoolDevice& d, const T* in,
+                          int64 rows, int64 cols, T* out) {
+    return false;
+  }
+  template <typename T>
+  static bool ReduceMiddle(const Eigen::ThreadPoolDevice& d, const T* in,
+                           int64 planes, int64 rows, int64 cols, T* out) {
+    return false;
+  }
+};
+
+template <typename Reducer>
+struct CpuReduction<Reducer, true> {
+  typedef reduction_cpu::ReducerTraits<Reducer> Traits;
+  typedef typename Traits::Op Op;
+
+  template <typename T>
+  static bool ReduceAll(const Eigen::ThreadPoolDevice& d, const T* in,
+                        int64 n, T* out) {
+    return ReduceInner(d, in, 1, n, out);
+  }
+  template <typename T>
+  static bool ReduceInner(const Eigen::ThreadPoolDevice& d, const T* in,
+                          int64 rows, int64 cols, T* out) {
+    if (Traits::kMean) {
+      reduction_cpu::ReduceInnerImpl<Op>(
+          d, in, rows, cols, reduction_cpu::DivideBy<T>(cols), out);
+    } else {
+      reduction_cpu::ReduceInnerImpl<Op>(
+          d, in, rows, cols, reduction_cpu::NoFinalize<T>(), out);
+    }
+    return true;
+  }
+  template <typename T>
+  static bool ReduceOuter(const Eigen::ThreadPoolDevice& d, const T* in,
+                          int64 rows, int64 cols, T* out) {
+    return ReduceMiddle(d, in, 1, rows, cols, out);
+  }
+  template <typename T>
+  static bool ReduceMiddle(const Eigen::ThreadPoolDevice& d, const T* in,
+                           int64 planes, int64 rows, int64 cols, T* out) {
+    if (Traits::kMean) {
+      reduction_cpu::ReduceMiddleImpl<Op>(
+          d, in, planes, rows, cols, reduction_cpu::DivideBy<T>(rows), out);
+    } else {
+      reduction_cpu::ReduceMiddleImpl<Op>(
+          d, in, planes, rows, cols, reduction_cpu::NoFinalize<T>(), out);
+    }
+    return true;
+  }
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_REDUCTION_OPS_CPU_H_
@@ -64,6 +64,67 @@ static void BM_Mean3DToScalarCPU(int iters, int num) {
 }
 BENCHMARK(BM_Mean3DToScalarCPU)->Range(1 << 13, 1 << 20);
 
+// Creates a Graph which "reduce"s a float tensor of shape "dims" along
+// dimension "axis".
+static Graph* AlongAxis(const string& reduce, const TensorShape& dims,
+                        int axis) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor data(DT_FLOAT, dims);
+  data.flat<float>().setRandom();
+  Tensor axes(DT_INT32, TensorShape({}));
+  axes.scalar<int32>()() = axis;
+  test::graph::Reduce(g, reduce, test::graph::Constant(g, data),
+                      test::graph::Constant(g, axes));
+  return g;
+}
+
+static void ReduceAlongAxis(int iters, const string& reduce,
+                            const TensorShape& dims, int axis) {
+  testing::ItemsProcessed(static_cast<int64>(iters) * dims.num_elements());
+  testing::BytesProcessed(static_cast<int64>(iters) * dims.num_elements() *
+                          sizeof(float));
+  test::Benchmark("cpu", AlongAxis(reduce, dims, axis)).Run(iters);
+}
+
+// Reductions of [rows, cols] matrices of various aspect ratios over their
+// inner (cols) and outer (rows) dimension.
+#define BM_REDUCE_2D(REDUCE)                                                  \
+  static void BM_##REDUCE##2DInnerCPU(int iters, int rows, int cols) {        \
+    ReduceAlongAxis(iters, #REDUCE, TensorShape({rows, cols}), 1);            \
+  }                                                                           \
+  BENCHMARK(BM_##REDUCE##2DInnerCPU)                                          \
+      ->ArgPair(1 << 20, 8)                                                   \
+      ->ArgPair(1 << 16, 128)                                                 \
+      ->ArgPair(2048, 2048)                                                   \
+      ->ArgPair(128, 1 << 16)                                                 \
+      ->ArgPair(8, 1 << 20)                                                   \
+      ->ArgPair(1, 1 << 23);                                                  \
+  static void BM_##REDUCE##2DOuterCPU(int iters, int rows, int cols) {        \
+    ReduceAlongAxis(iters, #REDUCE, TensorShape({rows, cols}), 0);            \
+  }                                                                           \
+  BENCHMARK(BM_##REDUCE##2DOuterCPU)                                          \
+      ->ArgPair(1 << 20, 8)                                                   \
+      ->ArgPair(1 << 16, 128)                                                 \
+      ->ArgPair(2048, 2048)                                                   \
+      ->ArgPair(128, 1 << 16)                                                 \
+      ->ArgPair(8, 1 << 20);
+
+BM_REDUCE_2D(Sum);
+BM_REDUCE_2D(Mean);
+BM_REDUCE_2D(Max);
+BM_REDUCE_2D(Min);
+BM_REDUCE_2D(Prod);
+
+// Reductions of [planes, rows, 64] tensors over their middle dimension.
+static void BM_Sum3DMiddleCPU(int iters, int planes, int rows) {
+  ReduceAlongAxis(iters, "Sum", TensorShape({planes, rows, 64}), 1);
+}
+BENCHMARK(BM_Sum3DMiddleCPU)
+    ->ArgPair(1, 1 << 16)
+    ->ArgPair(16, 4096)
+    ->ArgPair(256, 256)
+    ->ArgPair(4096, 16);
+
 static void BM_Sum3DToScalarGPU(int iters, int num) {
   ReduceToScalar(iters, "gpu", "Sum", num);
 }
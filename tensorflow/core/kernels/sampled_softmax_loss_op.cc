@@ -0,0 +1,456 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/nn_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/kernels/range_sampler.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/util/guarded_philox_random.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+// Copies the rows 'ids' of 'params' into 'out', which has one row per id.
+void GatherRows(const CPUDevice& d, TTypes<float>::ConstMatrix params,
+                gtl::ArraySlice<int64> ids, TTypes<float>::Matrix out) {
+  const int64 dim = params.dimension(1);
+  auto work = [&params, &ids, &out, dim](int64 start, int64 end) {
+    for (int64 i = start; i < end; ++i) {
+      memcpy(out.data() + i * dim, params.data() + ids[i] * dim,
+             dim * sizeof(float));
+    }
+  };
+  d.parallelFor(ids.size(),
+                Eigen::TensorOpCost(dim * sizeof(float), dim * sizeof(float),
+                                    0),
+                work);
+}
+
+// Returns an error unless all of 'ids' are in [0, limit).
+Status CheckIds(const char* name, gtl::ArraySlice<int64> ids, int64 limit) {
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (ids[i] < 0 || ids[i] >= limit) {
+      return errors::InvalidArgument(name, "[", i, "] = ", ids[i],
+                                     " is not in [0, ", limit, ")");
+    }
+  }
+  return Status::OK();
+}
+
+float Dot(const float* a, const float* b, int64 size) {
+  float sum = 0.0f;
+  for (int64 i = 0; i < size; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+// out[0, size) += scale * in[0, size).
+void AddScaled(float scale, const float* in, int64 size, float* out) {
+  for (int64 i = 0; i < size; ++i) {
+    out[i] += scale * in[i];
+  }
+}
+
+// Contracts the columns of 'a' with the columns of 'b', that is a * b^T.
+const Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> kInnerDims = {
+    Eigen::IndexPair<Eigen::DenseIndex>(1, 1)};
+// Contracts the columns of 'a' with the rows of 'b', that is a * b.
+const Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> kMatMulDims = {
+    Eigen::IndexPair<Eigen::DenseIndex>(1, 0)};
+// Contracts the rows of 'a' with the rows of 'b', that is a^T * b.
+const Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> kOuterDims = {
+    Eigen::IndexPair<Eigen::DenseIndex>(0, 0)};
+
+}  // namespace
+
+// Computes the sampled softmax loss of a batch in one kernel. The sampled
+// classes' weights are gathered into one small [num_sampled, dim] matrix
+// that is multiplied with the inputs, the true classes' logits are dot
+// products with rows read in place, and each example's softmax cross
+// entropy is then computed in the row of the backprop output that its
+// logits were written to.
+class SampledSoftmaxLossOp : public OpKernel {
+ public:
+  explicit SampledSoftmaxLossOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("num_sampled", &num_sampled_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_true", &num_true_));
+    OP_REQUIRES_OK(context, context->GetAttr("range_max", &range_max_));
+    OP_REQUIRES_OK(context, context->GetAttr("unique", &unique_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("subtract_log_q", &subtract_log_q_));
+    OP_REQUIRES_OK(context, context->GetAttr("remove_accidental_hits",
+                                             &remove_accidental_hits_));
+    OP_REQUIRES(context, !unique_ || num_sampled_ <= range_max_,
+                errors::InvalidArgument("Sampler's range is too small."));
+    string sampler;
+    OP_REQUIRES_OK(context, context->GetAttr("sampler", &sampler));
+    if (sampler == "uniform") {
+      sampler_.reset(new UniformSampler(range_max_));
+    } else {
+      sampler_.reset(new LogUniformSampler(range_max_));
+    }
+    OP_REQUIRES_OK(context, generator_.Init(context));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& weights_in = context->input(0);
+    const Tensor& biases_in = context->input(1);
+    const Tensor& labels_in = context->input(2);
+    const Tensor& inputs_in = context->input(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(weights_in.shape()),
+                errors::InvalidArgument("weights must be 2-dimensional"));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(biases_in.shape()) &&
+                             biases_in.dim_size(0) == weights_in.dim_size(0),
+                errors::InvalidArgument(
+                    "biases must be a vector with one element per row of "
+                    "weights: biases_size=",
+                    biases_in.shape().DebugString(),
+                    " weights_size=", weights_in.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(labels_in.shape()) &&
+                             labels_in.dim_size(1) == num_true_,
+                errors::InvalidArgument(
+                    "labels must be a matrix with num_true columns"));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(inputs_in.shape()) &&
+                             inputs_in.dim_size(0) == labels_in.dim_size(0) &&
+                             inputs_in.dim_size(1) == weights_in.dim_size(1),
+                errors::InvalidArgument(
+                    "inputs must be a [batch_size, dim] matrix: "
+                    "inputs_size=",
+                    inputs_in.shape().DebugString(),
+                    " labels_size=", labels_in.shape().DebugString(),
+                    " weights_size=", weights_in.shape().DebugString()));
+    const int64 num_classes = weights_in.dim_size(0);
+    OP_REQUIRES(context, range_max_ <= num_classes,
+                errors::InvalidArgument("range_max = ", range_max_,
+                                        " is larger than the ", num_classes,
+                                        " rows of weights"));
+    const int64 batch_size = inputs_in.dim_size(0);
+    const int64 dim = inputs_in.dim_size(1);
+    const int64 num_logits = num_true_ + num_sampled_;
+
+    gtl::ArraySlice<int64> labels(labels_in.matrix<int64>().data(),
+                                  batch_size * num_true_);
+    OP_REQUIRES_OK(context, CheckIds("labels", labels, num_classes));
+
+    Tensor* loss_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch_size}), &loss_out));
+    Tensor* backprop_out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       1, TensorShape({batch_size, num_logits}),
+                       &backprop_out));
+    Tensor* sampled_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                2, TensorShape({num_sampled_}), &sampled_out));
+
+    // Samples the candidates as CandidateSamplerOp does, so that the same
+    // seeds give the same candidates.
+    std::vector<float> true_expected_count(batch_size * num_true_);
+    std::vector<float> sampled_expected_count(num_sampled_);
+    gtl::MutableArraySlice<int64> sampled(sampled_out->vec<int64>().data(),
+                                          num_sampled_);
+    {
+      auto local_gen = generator_.ReserveSamples32(2048 * num_sampled_);
+      random::SimplePhilox random(&local_gen);
+      gtl::MutableArraySlice<float> true_expected_slice(&true_expected_count);
+      gtl::MutableArraySlice<float> sampled_expected_slice(
+          &sampled_expected_count);
+      sampler_->SampleBatchGetExpectedCount(&random, unique_, &sampled,
+                                            &sampled_expected_slice, labels,
+                                            &true_expected_slice);
+    }
+
+    const CPUDevice& d = context->eigen_device<CPUDevice>();
+    auto weights = weights_in.matrix<float>();
+    auto biases = biases_in.vec<float>();
+    auto inputs = inputs_in.matrix<float>();
+
+    // sampled_logits = inputs * sampled_weights^T.
+    Tensor sampled_weights;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DT_FLOAT, TensorShape({num_sampled_, dim}),
+                                &sampled_weights));
+    GatherRows(d, weights, sampled, sampled_weights.matrix<float>());
+    Tensor sampled_logits_tensor;
+    OP_REQUIRES_OK(context,
+                   context->allocate_temp(
+                       DT_FLOAT, TensorShape({batch_size, num_sampled_}),
+                       &sampled_logits_tensor));
+    auto sampled_logits = sampled_logits_tensor.matrix<float>();
+    sampled_logits.device(d) =
+        inputs.contract(sampled_weights.matrix<float>(), kInnerDims);
+
+    // The sampled logits' corrections are the same for every example.
+    std::vector<float> sampled_offsets(num_sampled_);
+    for (int64 k = 0; k < num_sampled_; ++k) {
+      sampled_offsets[k] = biases(sampled[k]);
+      if (subtract_log_q_) {
+        sampled_offsets[k] -= std::log(sampled_expected_count[k]);
+      }
+    }
+
+    auto loss = loss_out->vec<float>();
+    auto backprop = backprop_out->matrix<float>();
+    const int32 num_true = num_true_;
+    const int32 num_sampled = num_sampled_;
+    const bool subtract_log_q = subtract_log_q_;
+    const bool remove_accidental_hits = remove_accidental_hits_;
+    auto work = [&](int64 start_row, int64 end_row) {
+      for (int64 b = start_row; b < end_row; ++b) {
+        const float* input = inputs.data() + b * dim;
+        const int64* row_labels = labels.data() + b * num_true;
+        float* logits = backprop.data() + b * num_logits;
+        for (int32 j = 0; j < num_true; ++j) {
+          const int64 label = row_labels[j];
+          logits[j] =
+              Dot(input, weights.data() + label * dim, dim) + biases(label);
+          if (subtract_log_q) {
+            logits[j] -= std::log(true_expected_count[b * num_true + j]);
+          }
+        }
+        for (int32 k = 0; k < num_sampled; ++k) {
+          logits[num_true + k] = sampled_logits(b, k) + sampled_offsets[k];
+          if (remove_accidental_hits &&
+              std::find(row_labels, row_labels + num_true, sampled[k]) !=
+                  row_labels + num_true) {
+            logits[num_true + k] = -FLT_MAX;
+          }
+        }
+
+        // Each true class has a target probability of 1 / num_true, so
+        //   loss = log(sum(exp(logits))) - mean(true logits)
+        //   backprop = softmax(logits) - targets.
+        const float max_logit = *std::max_element(logits, logits + num_logits);
+        float sum = 0.0f;
+        for (int64 j = 0; j < num_logits; ++j) {
+          sum += std::exp(logits[j] - max_logit);
+        }
+        const float log_sum = max_logit + std::log(sum);
+        const float target = 1.0f / num_true;
+        float true_sum = 0.0f;
+        for (int32 j = 0; j < num_true; ++j) {
+          true_sum += logits[j];
+        }
+        loss(b) = log_sum - true_sum * target;
+        for (int64 j = 0; j < num_logits; ++j) {
+          logits[j] = std::exp(logits[j] - log_sum);
+        }
+        for (int32 j = 0; j < num_true; ++j) {
+          logits[j] -= target;
+        }
+      }
+    };
+    d.parallelFor(batch_size,
+                  Eigen::TensorOpCost(num_true_ * dim * sizeof(float),
+                                      num_logits * sizeof(float),
+                                      2 * num_true_ * dim + 30 * num_logits),
+                  work);
+  }
+
+ private:
+  int32 num_sampled_;
+  int32 num_true_;
+  int64 range_max_;
+  bool unique_;
+  bool subtract_log_q_;
+  bool remove_accidental_hits_;
+  std::unique_ptr<RangeSampler> sampler_;
+  GuardedPhiloxRandom generator_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("SampledSoftmaxLoss").Device(DEVICE_CPU),
+                        SampledSoftmaxLossOp);
+
+// Backpropagates the gradient of SampledSoftmaxLoss. Like the loss, the
+// sampled classes' contributions are two matrix products with the gathered
+// [num_sampled, dim] weights, and the true classes' are computed row by row.
+// The weight gradient has one row per distinct class, sampled classes first.
+class SampledSoftmaxLossGradOp : public OpKernel {
+ public:
+  explicit SampledSoftmaxLossGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& grad_loss_in = context->input(0);
+    const Tensor& backprop_in = context->input(1);
+    const Tensor& weights_in = context->input(2);
+    const Tensor& labels_in = context->input(3);
+    const Tensor& sampled_in = context->input(4);
+    const Tensor& inputs_in = context->input(5);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(weights_in.shape()),
+                errors::InvalidArgument("weights must be 2-dimensional"));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(inputs_in.shape()) &&
+                             inputs_in.dim_size(1) == weights_in.dim_size(1),
+                errors::InvalidArgument(
+                    "inputs must be a [batch_size, dim] matrix"));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(sampled_in.shape()),
+                errors::InvalidArgument(
+                    "sampled_candidates must be a vector"));
+    const int64 batch_size = inputs_in.dim_size(0);
+    const int64 dim = inputs_in.dim_size(1);
+    const int64 num_sampled = sampled_in.dim_size(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(labels_in.shape()) &&
+                             labels_in.dim_size(0) == batch_size,
+                errors::InvalidArgument(
+                    "labels must be a matrix with one row per example"));
+    const int64 num_true = labels_in.dim_size(1);
+    const int64 num_logits = num_true + num_sampled;
+    OP_REQUIRES(context, backprop_in.shape() ==
+                             TensorShape({batch_size, num_logits}),
+                errors::InvalidArgument(
+                    "backprop must be a [batch_size, num_true + num_sampled] "
+                    "matrix: backprop_size=",
+                    backprop_in.shape().DebugString()));
+    OP_REQUIRES(context, grad_loss_in.shape() == TensorShape({batch_size}),
+                errors::InvalidArgument(
+                    "grad_loss must be a vector with one element per "
+                    "example"));
+
+    const int64 num_classes = weights_in.dim_size(0);
+    gtl::ArraySlice<int64> labels(labels_in.matrix<int64>().data(),
+                                  batch_size * num_true);
+    gtl::ArraySlice<int64> sampled(sampled_in.vec<int64>().data(),
+                                   num_sampled);
+    OP_REQUIRES_OK(context, CheckIds("labels", labels, num_classes));
+    OP_REQUIRES_OK(context,
+                   CheckIds("sampled_candidates", sampled, num_classes));
+
+    const CPUDevice& d = context->eigen_device<CPUDevice>();
+    auto grad_loss = grad_loss_in.vec<float>();
+    auto backprop = backprop_in.matrix<float>();
+    auto weights = weights_in.matrix<float>();
+    auto inputs = inputs_in.matrix<float>();
+
+    // The sampled part of the logits' gradient, scaled by grad_loss.
+    Tensor sampled_grad_tensor;
+    OP_REQUIRES_OK(context,
+                   context->allocate_temp(
+                       DT_FLOAT, TensorShape({batch_size, num_sampled}),
+                       &sampled_grad_tensor));
+    auto sampled_grad = sampled_grad_tensor.matrix<float>();
+    for (int64 b = 0; b < batch_size; ++b) {
+      for (int64 k = 0; k < num_sampled; ++k) {
+        sampled_grad(b, k) = grad_loss(b) * backprop(b, num_true + k);
+      }
+    }
+    Tensor sampled_weights;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DT_FLOAT, TensorShape({num_sampled, dim}),
+                                &sampled_weights));
+    GatherRows(d, weights, sampled, sampled_weights.matrix<float>());
+
+    // inputs_grad = sampled_grad * sampled_weights + the true classes' rows.
+    Tensor* inputs_grad_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, inputs_in.shape(),
+                                                     &inputs_grad_out));
+    auto inputs_grad = inputs_grad_out->matrix<float>();
+    inputs_grad.device(d) =
+        sampled_grad.contract(sampled_weights.matrix<float>(), kMatMulDims);
+    auto add_true_rows = [&](int64 start_row, int64 end_row) {
+      for (int64 b = start_row; b < end_row; ++b) {
+        for (int64 j = 0; j < num_true; ++j) {
+          AddScaled(grad_loss(b) * backprop(b, j),
+                    weights.data() + labels[b * num_true + j] * dim, dim,
+                    inputs_grad.data() + b * dim);
+        }
+      }
+    };
+    d.parallelFor(batch_size,
+                  Eigen::TensorOpCost(num_true * dim * sizeof(float),
+                                      dim * sizeof(float), 2 * num_true * dim),
+                  add_true_rows);
+
+    // Assigns a gradient row to each distinct class.
+    std::unordered_map<int64, int64> rows;
+    std::vector<int64> classes;
+    rows.reserve(num_sampled + labels.size());
+    for (int64 id : sampled) {
+      if (rows.emplace(id, classes.size()).second) classes.push_back(id);
+    }
+    for (int64 id : labels) {
+      if (rows.emplace(id, classes.size()).second) classes.push_back(id);
+    }
+    const int64 num_rows = classes.size();
+
+    Tensor* indices_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                1, TensorShape({num_rows}), &indices_out));
+    std::copy(classes.begin(), classes.end(),
+              indices_out->vec<int64>().data());
+    Tensor* weights_grad_out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(2, TensorShape({num_rows, dim}),
+                                            &weights_grad_out));
+    Tensor* biases_grad_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                3, TensorShape({num_rows}), &biases_grad_out));
+    auto weights_grad = weights_grad_out->matrix<float>();
+    auto biases_grad = biases_grad_out->vec<float>();
+    weights_grad.setZero();
+    biases_grad.setZero();
+
+    // The sampled classes' rows are sampled_grad^T * inputs. With unique
+    // sampling they are the first num_sampled rows of weights_grad.
+    Tensor sampled_rows_tensor;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DT_FLOAT, TensorShape({num_sampled, dim}),
+                                &sampled_rows_tensor));
+    auto sampled_rows = sampled_rows_tensor.matrix<float>();
+    sampled_rows.device(d) = sampled_grad.contract(inputs, kOuterDims);
+    for (int64 k = 0; k < num_sampled; ++k) {
+      const int64 row = rows[sampled[k]];
+      AddScaled(1.0f, sampled_rows.data() + k * dim, dim,
+                weights_grad.data() + row * dim);
+      for (int64 b = 0; b < batch_size; ++b) {
+        biases_grad(row) += sampled_grad(b, k);
+      }
+    }
+    for (int64 b = 0; b < batch_size; ++b) {
+      for (int64 j = 0; j < num_true; ++j) {
+        const float grad = grad_loss(b) * backprop(b, j);
+        const int64 row = rows[labels[b * num_true + j]];
+        AddScaled(grad, inputs.data() + b * dim, dim,
+                  weights_grad.data() + row * dim);
+        biases_grad(row) += grad;
+      }
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("SampledSoftmaxLossGrad").Device(DEVICE_CPU),
+                        SampledSoftmaxLossGradOp);
+
+}  // namespace tensorflow
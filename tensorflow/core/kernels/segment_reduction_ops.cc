@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -855,4 +856,253 @@ REGISTER_CPU_SPARSE_KERNELS(double);
 REGISTER_CPU_SPARSE_KERNELS(float);
 REGISTER_CPU_SPARSE_KERNELS(double);
 #undef REGISTER_CPU_SPARSE_KERNELS
+
+// Reads the combiner attribute shared by SparseSegmentCombine and
+// SparseSegmentCombineGrad.
+enum class SegmentCombiner { kSum, kMean, kSqrtN };
+
+static Status GetSegmentCombiner(OpKernelConstruction* context,
+                                 SegmentCombiner* combiner) {
+  string name;
+  TF_RETURN_IF_ERROR(context->GetAttr("combiner", &name));
+  if (name == "sum") {
+    *combiner = SegmentCombiner::kSum;
+  } else if (name == "mean") {
+    *combiner = SegmentCombiner::kMean;
+  } else if (name == "sqrtn") {
+    *combiner = SegmentCombiner::kSqrtN;
+  } else {
+    return errors::InvalidArgument("Unknown combiner: ", name);
+  }
+  return Status::OK();
+}
+
+// Validates the indices, weights and segment_ids inputs of
+// SparseSegmentCombine and SparseSegmentCombineGrad. On success,
+// "segment_starts" holds, for each of the "num_segments" segments, the
+// offset of its first entry, followed by the number of entries, "scales"
+// holds the weight of each entry, and "norms" holds the divisor that the
+// combiner applies to the weighted sum of each non-empty segment. As with
+// dividing by the sum of the weights, a zero divisor is not special-cased.
+template <typename T>
+static Status ComputeSegmentScales(
+    const typename TTypes<int32>::ConstVec& segment_vec, const Tensor& weights,
+    SegmentCombiner combiner, std::vector<int64>* segment_starts,
+    std::vector<T>* scales, std::vector<T>* norms) {
+  const int64 N = segment_vec.size();
+  if (weights.NumElements() != 0 && weights.NumElements() != N) {
+    return errors::InvalidArgument(
+        "weights should be empty or have the same size as indices, got ",
+        weights.NumElements(), " and ", N);
+  }
+  const bool has_weights = weights.NumElements() != 0;
+  const auto weights_vec = weights.flat<T>();
+  const int32 num_segments = segment_starts->size() - 1;
+
+  // Segment ids are sorted, so each segment is a contiguous range.
+  int32 segment = 0;
+  for (int64 i = 0; i < N; ++i) {
+    const int32 id = internal::SubtleMustCopy(segment_vec(i));
+    if (id < segment || id >= num_segments) {
+      return errors::InvalidArgument(
+          "segment_ids[", i, "] == ", id,
+          " is not increasing or not in range [0, ", num_segments, ")");
+    }
+    while (segment < id) (*segment_starts)[++segment] = i;
+  }
+  while (segment < num_segments) (*segment_starts)[++segment] = N;
+
+  scales->resize(N);
+  norms->assign(num_segments, T(1));
+  for (int32 s = 0; s < num_segments; ++s) {
+    double norm = 0;
+    for (int64 i = (*segment_starts)[s]; i < (*segment_starts)[s + 1]; ++i) {
+      const double w = has_weights ? static_cast<double>(weights_vec(i)) : 1.0;
+      (*scales)[i] = static_cast<T>(w);
+      norm += combiner == SegmentCombiner::kSqrtN ? w * w : w;
+    }
+    if ((*segment_starts)[s] == (*segment_starts)[s + 1]) {
+      // Empty segments stay zero.
+      continue;
+    } else if (combiner == SegmentCombiner::kMean) {
+      (*norms)[s] = static_cast<T>(norm);
+    } else if (combiner == SegmentCombiner::kSqrtN) {
+      (*norms)[s] = static_cast<T>(std::sqrt(norm));
+    }
+  }
+  return Status::OK();
+}
+
+// Gathers rows of "data" and combines them per segment in one pass, without
+// materializing the gathered rows. Segments are sharded over the intra-op
+// threads; every segment owns its output row.
+template <typename T, typename Index>
+class SparseSegmentCombineOp : public OpKernel {
+ public:
+  explicit SparseSegmentCombineOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, GetSegmentCombiner(context, &combiner_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& indices = context->input(1);
+    const Tensor& weights = context->input(2);
+    const Tensor& segment_ids = context->input(3);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(data.shape()),
+                errors::InvalidArgument("data must be at least 1-D."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(indices.shape()),
+                errors::InvalidArgument("indices should be a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(weights.shape()),
+                errors::InvalidArgument("weights should be a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(segment_ids.shape()),
+                errors::InvalidArgument("segment_ids should be a vector."));
+
+    const int64 N = indices.NumElements();
+    OP_REQUIRES(context, N == segment_ids.NumElements(),
+                errors::InvalidArgument(
+                    "segment_ids and indices should have same size."));
+
+    const auto segment_vec = segment_ids.vec<int32>();
+    const int32 num_segments =
+        N > 0 ? internal::SubtleMustCopy(segment_vec(N - 1)) + 1 : 0;
+    OP_REQUIRES(context, num_segments >= 0,
+                errors::InvalidArgument("segment ids must be >= 0"));
+
+    TensorShape output_shape = data.shape();
+    output_shape.set_dim(0, num_segments);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    if (N == 0) return;
+
+    std::vector<int64> segment_starts(num_segments + 1, 0);
+    std::vector<T> scales;
+    std::vector<T> norms;
+    OP_REQUIRES_OK(context, ComputeSegmentScales<T>(
+                                segment_vec, weights, combiner_,
+                                &segment_starts, &scales, &norms));
+
+    const auto data_flat = data.flat_outer_dims<T>();
+    const Index num_rows = data_flat.dimension(0);
+    const int64 num_col = data_flat.dimension(1);
+    const auto indices_vec = indices.vec<Index>();
+    std::vector<Index> rows(N);
+    for (int64 i = 0; i < N; ++i) {
+      rows[i] = internal::SubtleMustCopy(indices_vec(i));
+      OP_REQUIRES(context, FastBoundsCheck(rows[i], num_rows),
+                  errors::InvalidArgument("indices[", i, "] == ", rows[i],
+                                          " out of range [0, ", num_rows,
+                                          ")"));
+    }
+
+    auto output_flat = output->flat_outer_dims<T>();
+    typedef Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> Row;
+    typedef Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> ConstRow;
+    auto work = [&](int64 begin, int64 end) {
+      for (int64 s = begin; s < end; ++s) {
+        Row out(&output_flat(s, 0), num_col);
+        out.setZero();
+        for (int64 i = segment_starts[s]; i < segment_starts[s + 1]; ++i) {
+          out += ConstRow(&data_flat(rows[i], 0), num_col) * scales[i];
+        }
+        if (combiner_ != SegmentCombiner::kSum) out /= norms[s];
+      }
+    };
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          (N / num_segments + 1) * num_col * 2, work);
+  }
+
+ private:
+  SegmentCombiner combiner_;
+};
+
+// Computes the gradient of SparseSegmentCombine with respect to the rows of
+// "data" that it read, as the values of an IndexedSlices whose indices are
+// the "indices" input. Entries are independent, so they are sharded over
+// the intra-op threads.
+template <typename T, typename Index>
+class SparseSegmentCombineGradOp : public OpKernel {
+ public:
+  explicit SparseSegmentCombineGradOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, GetSegmentCombiner(context, &combiner_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& grad = context->input(0);
+    const Tensor& indices = context->input(1);
+    const Tensor& weights = context->input(2);
+    const Tensor& segment_ids = context->input(3);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(grad.shape()),
+                errors::InvalidArgument("grad must be at least 1-D."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(indices.shape()),
+                errors::InvalidArgument("indices should be a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(weights.shape()),
+                errors::InvalidArgument("weights should be a vector."));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(segment_ids.shape()),
+                errors::InvalidArgument("segment_ids should be a vector."));
+
+    const int64 N = indices.NumElements();
+    OP_REQUIRES(context, N == segment_ids.NumElements(),
+                errors::InvalidArgument(
+                    "segment_ids and indices should have same size."));
+
+    TensorShape output_shape = grad.shape();
+    output_shape.set_dim(0, N);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    if (N == 0) return;
+
+    const int32 num_segments = grad.dim_size(0);
+    std::vector<int64> segment_starts(num_segments + 1, 0);
+    std::vector<T> scales;
+    std::vector<T> norms;
+    OP_REQUIRES_OK(context, ComputeSegmentScales<T>(
+                                segment_ids.vec<int32>(), weights, combiner_,
+                                &segment_starts, &scales, &norms));
+
+    const auto grad_flat = grad.flat_outer_dims<T>();
+    const int64 num_col = grad_flat.dimension(1);
+    auto output_flat = output->flat_outer_dims<T>();
+    typedef Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> Row;
+    typedef Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> ConstRow;
+    auto work = [&](int64 begin, int64 end) {
+      // Segments overlapping [begin, end).
+      int64 s = std::upper_bound(segment_starts.begin(), segment_starts.end(),
+                                 begin) -
+                segment_starts.begin() - 1;
+      for (int64 i = begin; i < end; ++i) {
+        while (segment_starts[s + 1] <= i) ++s;
+        Row(&output_flat(i, 0), num_col) =
+            ConstRow(&grad_flat(s, 0), num_col) * (scales[i] / norms[s]);
+      }
+    };
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, N, num_col,
+          work);
+  }
+
+ private:
+  SegmentCombiner combiner_;
+};
+
+#define REGISTER_CPU_SPARSE_KERNELS(type, index_type)                \
+  REGISTER_KERNEL_BUILDER(Name("SparseSegmentCombine")               \
+                              .Device(DEVICE_CPU)                    \
+                              .TypeConstraint<type>("T")             \
+                              .TypeConstraint<index_type>("Tidx"),   \
+                          SparseSegmentCombineOp<type, index_type>); \
+  REGISTER_KERNEL_BUILDER(Name("SparseSegmentCombineGrad")           \
+                              .Device(DEVICE_CPU)                    \
+                              .TypeConstraint<type>("T")             \
+                              .TypeConstraint<index_type>("Tidx"),   \
+                          SparseSegmentCombineGradOp<type, index_type>);
+REGISTER_CPU_SPARSE_KERNELS(float, int32);
+REGISTER_CPU_SPARSE_KERNELS(float, int64);
+REGISTER_CPU_SPARSE_KERNELS(double, int32);
+REGISTER_CPU_SPARSE_KERNELS(double, int64);
+#undef REGISTER_CPU_SPARSE_KERNELS
 }  // namespace tensorflow
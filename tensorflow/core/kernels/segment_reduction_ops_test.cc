@@ -166,4 +166,76 @@ static void BM_SparseSegmentMeanGrad_High(int iters, int size) {
 BENCHMARK(BM_SparseSegmentMeanGrad_Low)->Arg(1000)->Arg(100000);
 BENCHMARK(BM_SparseSegmentMeanGrad_High)->Arg(1000)->Arg(100000);
 
+// Combines "ids_per_row" rows of a [kEmbeddingRows, 64] embedding for each of
+// "batch" examples, either with SparseSegmentCombine or by gathering the rows
+// and reducing them with SegmentSum.
+static void EmbeddingCombineHelper(int iters, bool fused, bool weighted,
+                                   int batch, int ids_per_row) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  const int kEmbeddingRows = 100000;
+  const int kDim = 64;
+  const int num_ids = batch * ids_per_row;
+
+  Tensor params(DT_FLOAT, TensorShape({kEmbeddingRows, kDim}));
+  params.flat<float>().setRandom();
+  Tensor ids(DT_INT64, TensorShape({num_ids}));
+  Tensor segments(DT_INT32, TensorShape({num_ids}));
+  for (int i = 0; i < num_ids; ++i) {
+    ids.flat<int64>()(i) = (i * 7919LL) % kEmbeddingRows;
+    segments.flat<int32>()(i) = i / ids_per_row;
+  }
+  Tensor weights(DT_FLOAT, TensorShape({weighted ? num_ids : 0}));
+  weights.flat<float>().setRandom();
+
+  Node* node;
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "SparseSegmentCombine")
+                    .Input(test::graph::Constant(g, params))
+                    .Input(test::graph::Constant(g, ids))
+                    .Input(test::graph::Constant(g, weights))
+                    .Input(test::graph::Constant(g, segments))
+                    .Attr("combiner", "mean")
+                    .Finalize(g, &node));
+  } else {
+    Tensor axis(DT_INT32, TensorShape({}));
+    axis.scalar<int32>()() = 0;
+    Node* gathered = test::graph::Gather(g, test::graph::Constant(g, params),
+                                         test::graph::Constant(g, ids),
+                                         test::graph::HostConstant(g, axis));
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "SegmentSum")
+                    .Input(gathered)
+                    .Input(test::graph::Constant(g, segments))
+                    .Finalize(g, &node));
+  }
+
+  testing::UseRealTime();
+  testing::BytesProcessed(static_cast<int64>(iters) * num_ids * kDim *
+                          sizeof(float));
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+static void BM_EmbeddingCombine_Fused(int iters, int batch, int ids_per_row) {
+  EmbeddingCombineHelper(iters, true, false, batch, ids_per_row);
+}
+
+static void BM_EmbeddingCombine_FusedWeighted(int iters, int batch,
+                                              int ids_per_row) {
+  EmbeddingCombineHelper(iters, true, true, batch, ids_per_row);
+}
+
+static void BM_EmbeddingCombine_GatherSegmentSum(int iters, int batch,
+                                                 int ids_per_row) {
+  EmbeddingCombineHelper(iters, false, false, batch, ids_per_row);
+}
+
+BENCHMARK(BM_EmbeddingCombine_Fused)->ArgPair(128, 10)->ArgPair(4096, 50);
+BENCHMARK(BM_EmbeddingCombine_FusedWeighted)
+    ->ArgPair(128, 10)
+    ->ArgPair(4096, 50);
+BENCHMARK(BM_EmbeddingCombine_GatherSegmentSum)
+    ->ArgPair(128, 10)
+    ->ArgPair(4096, 50);
+
 }  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/softmax_op.h"
+#include "tensorflow/core/kernels/softmax_op_cpu_impl.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -45,6 +46,16 @@ struct SoftmaxFunctorBase {
 template <typename T>
 struct SoftmaxFunctor<CPUDevice, T> : SoftmaxFunctorBase<CPUDevice, T> {};
 
+// Float, by far the most common type, uses the row-wise kernel from
+// softmax_op_cpu_impl.h, which streams the logits through memory once.
+template <>
+struct SoftmaxFunctor<CPUDevice, float> {
+  void operator()(const CPUDevice& d, TTypes<float>::ConstMatrix logits,
+                  TTypes<float>::Matrix softmax, const bool log) {
+    SoftmaxRowsCPU(d, logits, softmax, log);
+  }
+};
+
 #ifdef TENSORFLOW_USE_SYCL
 template <typename T>
 struct SoftmaxFunctor<SYCLDevice, T> : SoftmaxFunctorBase<SYCLDevice, T> {};
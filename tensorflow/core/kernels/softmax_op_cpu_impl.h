@@ -0,0 +1,235 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_IMPL_H_
+#define TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_IMPL_H_
+
+// Row-wise CPU kernels for float Softmax, LogSoftmax and
+// SoftmaxCrossEntropyWithLogits.
+//
+// The Eigen expressions in softmax_op_functor.h and xent_op.h evaluate one
+// reduction or broadcast at a time, so each of them streams the whole
+// [batch_size, num_classes] matrix through memory, three or four times in
+// all. These kernels instead finish one row before moving to the next, with
+// the rows sharded over the device's threads. Each row is read once to find
+// its maximum and the sum of its exponentials together, and once more to
+// write the outputs; for rows of up to a few hundred thousand classes the
+// second read comes from cache.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+namespace softmax_cpu {
+
+typedef Eigen::internal::packet_traits<float>::type Packet;
+const int64 kPacketSize = sizeof(Packet) / sizeof(float);
+
+// Number of floats whose maximum is found before their exponentials are
+// summed. Small enough for the block to be read twice from L1.
+const int64 kBlockSize = 64 * kPacketSize;
+
+// Sets *max_value to the maximum of row[0, size) and *sum to the sum of
+// exp(row[i] - *max_value), reading the row once.
+//
+// The usual online formulation rescales the running sum for every element,
+// which costs two exponentials each. Here the running sum is only rescaled
+// when a whole block raises the maximum, which for most rows happens in the
+// first few blocks only.
+inline void RowMaxAndSumExp(const float* row, int64 size, float* max_value,
+                            float* sum) {
+  float row_max = -std::numeric_limits<float>::infinity();
+  Packet packet_sum = Eigen::internal::pset1<Packet>(0.0f);
+  float scalar_sum = 0.0f;
+  for (int64 start = 0; start < size; start += kBlockSize) {
+    const int64 end = std::min(size, start + kBlockSize);
+    const int64 vectorized_end = start + (end - start) / kPacketSize *
+                                             kPacketSize;
+
+    float block_max = row_max;
+    if (vectorized_end > start) {
+      Packet packet_max = Eigen::internal::ploadu<Packet>(row + start);
+      for (int64 i = start + kPacketSize; i < vectorized_end;
+           i += kPacketSize) {
+        const Packet x = Eigen::internal::ploadu<Packet>(row + i);
+        packet_max = Eigen::internal::pmax(packet_max, x);
+      }
+      block_max =
+          std::max(block_max, Eigen::internal::predux_max(packet_max));
+    }
+    for (int64 i = vectorized_end; i < end; ++i) {
+      block_max = std::max(block_max, row[i]);
+    }
+    if (block_max > row_max) {
+      // exp(-inf) is zero, so this also covers the first block.
+      const float scale = std::exp(row_max - block_max);
+      packet_sum = Eigen::internal::pmul(packet_sum,
+                                         Eigen::internal::pset1<Packet>(scale));
+      scalar_sum *= scale;
+      row_max = block_max;
+    }
+
+    const Packet packet_row_max = Eigen::internal::pset1<Packet>(row_max);
+    for (int64 i = start; i < vectorized_end; i += kPacketSize) {
+      const Packet shifted = Eigen::internal::psub(
+          Eigen::internal::ploadu<Packet>(row + i), packet_row_max);
+      packet_sum =
+          Eigen::internal::padd(packet_sum, Eigen::internal::pexp(shifted));
+    }
+    for (int64 i = vectorized_end; i < end; ++i) {
+      scalar_sum += std::exp(row[i] - row_max);
+    }
+  }
+  *max_value = row_max;
+  *sum = Eigen::internal::predux(packet_sum) + scalar_sum;
+}
+
+// Returns a cost for sharding rows of 'num_classes' elements that are read
+// twice and written once, with 'num_exps' exponentials per element.
+inline Eigen::TensorOpCost RowCost(int64 num_classes, int num_exps) {
+  const double exp_cycles =
+      Eigen::internal::functor_traits<
+          Eigen::internal::scalar_exp_op<float>>::Cost;
+  return Eigen::TensorOpCost(2 * num_classes * sizeof(float),
+                             num_classes * sizeof(float),
+                             num_classes * (num_exps * exp_cycles + 4));
+}
+
+}  // namespace softmax_cpu
+
+// Computes Softmax or LogSoftmax of each row of 'logits' into 'softmax'.
+inline void SoftmaxRowsCPU(const Eigen::ThreadPoolDevice& d,
+                           TTypes<float>::ConstMatrix logits,
+                           TTypes<float>::Matrix softmax, const bool log) {
+  using softmax_cpu::Packet;
+  using softmax_cpu::kPacketSize;
+  const int64 num_classes = logits.dimension(1);
+  const int64 vectorized_size = num_classes / kPacketSize * kPacketSize;
+  auto work = [&logits, &softmax, log, num_classes, vectorized_size](
+                  int64 start_row, int64 end_row) {
+    for (int64 r = start_row; r < end_row; ++r) {
+      const float* in = logits.data() + r * num_classes;
+      float* out = softmax.data() + r * num_classes;
+      float row_max;
+      float sum;
+      softmax_cpu::RowMaxAndSumExp(in, num_classes, &row_max, &sum);
+      if (log) {
+        // log(softmax) = logits - (max + log(sum(exp(logits - max)))).
+        const float shift = row_max + std::log(sum);
+        const Packet packet_shift = Eigen::internal::pset1<Packet>(shift);
+        for (int64 i = 0; i < vectorized_size; i += kPacketSize) {
+          const Packet x = Eigen::internal::ploadu<Packet>(in + i);
+          Eigen::internal::pstoreu(out + i,
+                                   Eigen::internal::psub(x, packet_shift));
+        }
+        for (int64 i = vectorized_size; i < num_classes; ++i) {
+          out[i] = in[i] - shift;
+        }
+      } else {
+        const float scale = 1.0f / sum;
+        const Packet packet_row_max = Eigen::internal::pset1<Packet>(row_max);
+        const Packet packet_scale = Eigen::internal::pset1<Packet>(scale);
+        for (int64 i = 0; i < vectorized_size; i += kPacketSize) {
+          const Packet shifted = Eigen::internal::psub(
+              Eigen::internal::ploadu<Packet>(in + i), packet_row_max);
+          Eigen::internal::pstoreu(
+              out + i, Eigen::internal::pmul(Eigen::internal::pexp(shifted),
+                                             packet_scale));
+        }
+        for (int64 i = vectorized_size; i < num_classes; ++i) {
+          out[i] = std::exp(in[i] - row_max) * scale;
+        }
+      }
+    }
+  };
+  d.parallelFor(logits.dimension(0),
+                softmax_cpu::RowCost(num_classes, log ? 1 : 2), work);
+}
+
+// Computes the loss and backprop of SoftmaxCrossEntropyWithLogits for each
+// row of 'logits' and 'labels'. 'backprop' may share its buffer with
+// 'logits'.
+inline void XentRowsCPU(const Eigen::ThreadPoolDevice& d,
+                        TTypes<float>::ConstMatrix logits,
+                        TTypes<float>::ConstMatrix labels,
+                        TTypes<float>::Vec loss,
+                        TTypes<float>::Matrix backprop) {
+  using softmax_cpu::Packet;
+  using softmax_cpu::kPacketSize;
+  const int64 num_classes = logits.dimension(1);
+  if (num_classes == 0) {
+    loss.setZero();
+    return;
+  }
+  const int64 vectorized_size = num_classes / kPacketSize * kPacketSize;
+  auto work = [&logits, &labels, &loss, &backprop, num_classes,
+               vectorized_size](int64 start_row, int64 end_row) {
+    for (int64 r = start_row; r < end_row; ++r) {
+      const float* in = logits.data() + r * num_classes;
+      const float* label = labels.data() + r * num_classes;
+      float* out = backprop.data() + r * num_classes;
+      float row_max;
+      float sum;
+      softmax_cpu::RowMaxAndSumExp(in, num_classes, &row_max, &sum);
+
+      // With shifted = logits - max, the loss is
+      //   sum(labels * (log(sum) - shifted))
+      //     = log(sum) * sum(labels) - sum(labels * shifted)
+      // and the backprop is exp(shifted) / sum - labels.
+      const float scale = 1.0f / sum;
+      const Packet packet_row_max = Eigen::internal::pset1<Packet>(row_max);
+      const Packet packet_scale = Eigen::internal::pset1<Packet>(scale);
+      Packet packet_label_sum = Eigen::internal::pset1<Packet>(0.0f);
+      Packet packet_label_dot = Eigen::internal::pset1<Packet>(0.0f);
+      for (int64 i = 0; i < vectorized_size; i += kPacketSize) {
+        const Packet shifted = Eigen::internal::psub(
+            Eigen::internal::ploadu<Packet>(in + i), packet_row_max);
+        const Packet packet_label = Eigen::internal::ploadu<Packet>(label + i);
+        packet_label_sum =
+            Eigen::internal::padd(packet_label_sum, packet_label);
+        packet_label_dot =
+            Eigen::internal::pmadd(packet_label, shifted, packet_label_dot);
+        const Packet probability = Eigen::internal::pmul(
+            Eigen::internal::pexp(shifted), packet_scale);
+        Eigen::internal::pstoreu(
+            out + i, Eigen::internal::psub(probability, packet_label));
+      }
+      float label_sum = Eigen::internal::predux(packet_label_sum);
+      float label_dot = Eigen::internal::predux(packet_label_dot);
+      for (int64 i = vectorized_size; i < num_classes; ++i) {
+        const float shifted = in[i] - row_max;
+        label_sum += label[i];
+        label_dot += label[i] * shifted;
+        out[i] = std::exp(shifted) * scale - label[i];
+      }
+      loss(r) = std::log(sum) * label_sum - label_dot;
+    }
+  };
+  d.parallelFor(logits.dimension(0), softmax_cpu::RowCost(num_classes, 2),
+                work);
+}
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_IMPL_H_
@@ -19,6 +19,9 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/sparse_tensor_dense_matmul_op.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/kernels/bounds_check.h"
@@ -253,63 +256,101 @@ struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
     const std::size_t lhs_right = (ADJ_B ? b.dimension(1) : b.dimension(0));
     const int lhs_index_a = ADJ_A ? 1 : 0;
     const int rhs_index_a = ADJ_A ? 0 : 1;
+    const int64 out_rows = out.dimension(0);
+
+    // Validate every index up front, and count the entries that land in each
+    // output row.  row_start[m + 1] holds the count for row m until it is
+    // turned into a prefix sum below.
+    std::vector<Tindices> ks(nnz);
+    std::vector<Tindices> ms(nnz);
+    std::vector<int64> row_start(out_rows + 1, 0);
+    for (std::size_t i = 0; i < nnz; ++i) {
+      const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a));
+      const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a));
+      if (!FastBoundsCheck(k, lhs_right)) {
+        return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);
+      }
+      if (!FastBoundsCheck(m, out_rows)) {
+        return MOutOfBoundsError(m, i, lhs_index_a, out_rows);
+      }
+      ms[i] = m;
+      ks[i] = k;
+      ++row_start[m + 1];
+    }
+    for (int64 m = 0; m < out_rows; ++m) {
+      row_start[m + 1] += row_start[m];
+    }
 
-    out.setZero();
-
-    // TODO(ebrevdo): After many failed experiments, can't find a multi-threaded
-    // approach that achieves the performance of the single threaded
-    // one.  Perhaps Eigen threadpool implementation is just too slow?
-
-    if (rhs_right < kNumVectorize) {
-      // Disable vectorization if the RHS of output is too small
-      auto maybe_adjoint_b = MaybeAdjoint<decltype(b), ADJ_B>(b);
-
+    // Counting sort of the entries by output row.  The sort is stable, so the
+    // accumulation order within a row matches the order of the input, and
+    // each output row is owned by exactly one shard below.
+    std::vector<int64> order(nnz);
+    {
+      std::vector<int64> next(row_start.begin(), row_start.end() - 1);
       for (std::size_t i = 0; i < nnz; ++i) {
-        const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a));
-        const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a));
-        if (!FastBoundsCheck(k, lhs_right)) {
-          return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);
-        }
-        if (!FastBoundsCheck(m, out.dimension(0))) {
-          return MOutOfBoundsError(m, i, lhs_index_a, out.dimension(0));
-        }
-        const T a_value = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
-        for (std::size_t n = 0; n < rhs_right; ++n) {
-          const T b_value = maybe_adjoint_b(k, n);
-          out(m, n) += a_value * b_value;
-        }
+        order[next[ms[i]]++] = i;
       }
-    } else {
-      // Vectorization via Eigen.
-      const int b_chip_index = ADJ_B ? 1 : 0;
-
-#define LOOP_NNZ(b_passed)                                                  \
-  for (std::size_t i = 0; i < nnz; ++i) {                                   \
-    const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a)); \
-    const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a)); \
-    const T a_value = (ADJ_A) ? MaybeConj(a_values(i)) : a_values(i);       \
-    if (!FastBoundsCheck(k, lhs_right)) {                                   \
-      return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);               \
-    }                                                                       \
-    if (!FastBoundsCheck(m, out.dimension(0))) {                            \
-      return MOutOfBoundsError(m, i, lhs_index_a, out.dimension(0));        \
-    }                                                                       \
-    out.template chip<0>(m) +=                                              \
-        b_passed.template chip<b_chip_index>(k) * a_value;                  \
-  }
+    }
 
-      if (ADJ_B) {
-        // Perform transpose and conjugation on B once, since we chip out B's
-        // columns in the nnz loop.
-        Eigen::array<int, 2> shuffle(1, 0);  // preserve dimension order
-        Eigen::Tensor<T, 2, Eigen::ColMajor> col_major_conj_b =
-            b.swap_layout().shuffle(shuffle).conjugate();
-        LOOP_NNZ(col_major_conj_b);
-      } else {
-        LOOP_NNZ(b);
+    typedef Eigen::Matrix<T, 1, Eigen::Dynamic> RowVector;
+    typedef Eigen::Map<RowVector> OutRow;
+    typedef Eigen::Map<const RowVector> ConstRow;
+    const T* b_data = b.data();
+    const int64 b_cols = b.dimension(1);
+
+    auto compute_rows = [&](int64 begin, int64 end) {
+      for (int64 m = begin; m < end; ++m) {
+        T* out_data = &out(m, 0);
+        const int64 row_begin = row_start[m];
+        const int64 row_end = row_start[m + 1];
+        if (ADJ_B) {
+          // out(m, n) = sum_e a_e * conj(b(n, k_e)).  Row n of b is
+          // contiguous, so read it directly rather than transposing b.
+          for (std::size_t n = 0; n < rhs_right; ++n) {
+            const T* b_row = b_data + n * b_cols;
+            T sum = T(0);
+            for (int64 e = row_begin; e < row_end; ++e) {
+              const int64 i = order[e];
+              const T a_value = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
+              sum += a_value * Eigen::numext::conj(b_row[ks[i]]);
+            }
+            out_data[n] = sum;
+          }
+        } else if (rhs_right < kNumVectorize) {
+          // Disable vectorization if the RHS of output is too small
+          std::fill(out_data, out_data + rhs_right, T(0));
+          for (int64 e = row_begin; e < row_end; ++e) {
+            const int64 i = order[e];
+            const T a_value = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
+            const T* b_row = b_data + ks[i] * b_cols;
+            for (std::size_t n = 0; n < rhs_right; ++n) {
+              out_data[n] += a_value * b_row[n];
+            }
+          }
+        } else {
+          // Vectorized AXPY of row k of b into row m of the output.
+          OutRow out_row(out_data, rhs_right);
+          out_row.setZero();
+          for (int64 e = row_begin; e < row_end; ++e) {
+            const int64 i = order[e];
+            const T a_value = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
+            out_row += a_value * ConstRow(b_data + ks[i] * b_cols, rhs_right);
+          }
+        }
       }
-#undef LOOP_NNZ
-    }
+    };
+
+    // Every output row is written (zero rows included), so the cost of a row
+    // is its share of the multiply-adds plus the store of the row itself.
+    const double nnz_per_row =
+        out_rows > 0 ? static_cast<double>(nnz) / out_rows : 0.0;
+    const double row_bytes = static_cast<double>(rhs_right) * sizeof(T);
+    const Eigen::TensorOpCost cost(
+        nnz_per_row * row_bytes, row_bytes,
+        nnz_per_row * rhs_right *
+            (Eigen::TensorOpCost::MulCost<T>() +
+             Eigen::TensorOpCost::AddCost<T>()));
+    d.parallelFor(out_rows, cost, compute_rows);
     return Status::OK();
   }
 };
@@ -117,4 +117,19 @@ BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, false, true);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, false);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, true);
 
+// Density x dims grid over all adjoint combinations.  NNZ is ~0.1%, 1% and
+// 10% of a 1024x1024 sparse operand.
+#define BM_SparseTensorDenseMatmulAdjoints(NNZ, M, K, N)  \
+  BM_SparseTensorDenseMatmul(NNZ, M, K, N, false, false); \
+  BM_SparseTensorDenseMatmul(NNZ, M, K, N, false, true);  \
+  BM_SparseTensorDenseMatmul(NNZ, M, K, N, true, false);  \
+  BM_SparseTensorDenseMatmul(NNZ, M, K, N, true, true);
+
+BM_SparseTensorDenseMatmulAdjoints(1024, 1024, 1024, 16);
+BM_SparseTensorDenseMatmulAdjoints(1024, 1024, 1024, 256);
+BM_SparseTensorDenseMatmulAdjoints(10240, 1024, 1024, 16);
+BM_SparseTensorDenseMatmulAdjoints(10240, 1024, 1024, 256);
+BM_SparseTensorDenseMatmulAdjoints(102400, 1024, 1024, 16);
+BM_SparseTensorDenseMatmulAdjoints(102400, 1024, 1024, 256);
+
 }  // end namespace tensorflow
@@ -78,7 +78,8 @@ class SplitOpBase : public OpKernel {
       return;
     }
 
-    // Special case 2: split along the 1st dimension. We can share the
+    // Special case 2: split along the 1st dimension, or along a dimension
+    // that only has dimensions of size 1 before it. We can share the
     // underlying buffer.
     //
     // Apply this optimization conservatively: if input is aligned,
@@ -86,11 +87,28 @@ class SplitOpBase : public OpKernel {
     // because if the immediate consumer of the resulting tensors are
     // not using eigen for computation, its perfectly fine to avoid
     // the copying.
-    if ((split_dim == 0) && IsInnerDimsSizeAligned<T>(input_shape)) {
-      VLOG(1) << "Slice dim 0: " << input_shape.DebugString();
-      const int64 delta = input_shape.dim_size(0) / num_split;
+    int64 prefix_dim_size = 1;
+    TensorShape suffix_shape;
+    for (int i = 0; i < input_shape.dims(); ++i) {
+      if (i < split_dim) {
+        prefix_dim_size *= input_shape.dim_size(i);
+      } else {
+        suffix_shape.AddDim(input_shape.dim_size(i));
+      }
+    }
+    if (prefix_dim_size == 1 && IsInnerDimsSizeAligned<T>(suffix_shape)) {
+      VLOG(1) << "Slice dim " << split_dim << ": "
+              << input_shape.DebugString();
+      Tensor input_suffix;
+      CHECK(input_suffix.CopyFrom(input, suffix_shape));
+      const int64 delta = input_shape.dim_size(split_dim) / num_split;
+      TensorShape output_shape(input_shape);
+      output_shape.set_dim(split_dim, delta);
       for (int i = 0; i < num_split; ++i) {
-        context->set_output(i, input.Slice(i * delta, (i + 1) * delta));
+        Tensor output;
+        CHECK(output.CopyFrom(input_suffix.Slice(i * delta, (i + 1) * delta),
+                              output_shape));
+        context->set_output(i, output);
       }
       *done = true;
       return;
@@ -131,7 +131,8 @@ class SplitVOpBase : public OpKernel {
       (*split_sizes_vec)[neg_one_dim] = input_size_split_dim - determined_size;
     }
 
-    // Special case 2: split along the 1st dimension. We can share the
+    // Special case 2: split along the 1st dimension, or along a dimension
+    // that only has dimensions of size 1 before it. We can share the
     // underlying buffer.
     //
     // Apply this optimization conservatively: if input is aligned,
@@ -139,11 +140,27 @@ class SplitVOpBase : public OpKernel {
     // because if the immediate consumer of the resulting tensors are
     // not using eigen for computation, its perfectly fine to avoid
     // the copying.
-    if ((split_dim == 0) && IsInnerDimsSizeAligned<T>(input_shape)) {
+    int64 prefix_dim_size = 1;
+    TensorShape suffix_shape;
+    for (int i = 0; i < input_shape.dims(); ++i) {
+      if (i < split_dim) {
+        prefix_dim_size *= input_shape.dim_size(i);
+      } else {
+        suffix_shape.AddDim(input_shape.dim_size(i));
+      }
+    }
+    if (prefix_dim_size == 1 && IsInnerDimsSizeAligned<T>(suffix_shape)) {
+      Tensor input_suffix;
+      CHECK(input_suffix.CopyFrom(input, suffix_shape));
+      TensorShape output_shape(input_shape);
       Tlen start = 0;
       for (int i = 0; i < num_split; ++i) {
-        context->set_output(i,
-                            input.Slice(start, start + (*split_sizes_vec)[i]));
+        output_shape.set_dim(split_dim, (*split_sizes_vec)[i]);
+        Tensor output;
+        CHECK(output.CopyFrom(
+            input_suffix.Slice(start, start + (*split_sizes_vec)[i]),
+            output_shape));
+        context->set_output(i, output);
         start += (*split_sizes_vec)[i];
       }
       *done = true;
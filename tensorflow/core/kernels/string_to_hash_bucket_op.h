@@ -23,10 +23,84 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
-template <uint64 hash(const string&)>
+// Sets output[i] = hash(input[i]) % num_buckets for each string of 'input',
+// sharded across the intra-op threads.
+//
+// Strings that are too long to be stored inline in the string object live
+// at unrelated heap addresses, and hashing them one after the other mostly
+// waits for their first bytes to arrive from memory. So the bytes of the
+// string a few positions ahead are prefetched, to keep several of these
+// loads in flight.
+template <typename Hash>
+void HashStringsToBuckets(OpKernelContext* context, const Tensor& input,
+                          int64 num_buckets, Hash hash, Tensor* output) {
+  // Strings ahead of the one being hashed that are prefetched.
+  static const int64 kPrefetchDistance = 8;
+  // Rough cost of hashing a string of typical length, in nanoseconds.
+  static const int64 kCostPerString = 100;
+
+  const string* input_base = input.flat<string>().data();
+  int64* output_base = output->flat<int64>().data();
+  auto work = [input_base, output_base, num_buckets, &hash](int64 start,
+                                                            int64 limit) {
+    const int64 prefetch_limit = limit - kPrefetchDistance;
+    for (int64 i = start; i < limit; ++i) {
+      if (i < prefetch_limit) {
+        port::prefetch<port::PREFETCH_HINT_T0>(
+            input_base[i + kPrefetchDistance].data());
+      }
+      const uint64 input_hash = hash(input_base[i]);
+      const uint64 bucket_id = input_hash % num_buckets;
+      // The number of buckets is always in the positive range of int64 so is
+      // the resulting bucket_id. Casting the bucket_id from uint64 to int64 is
+      // safe.
+      output_base[i] = static_cast<int64>(bucket_id);
+    }
+  };
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads.num_threads, worker_threads.workers,
+        input.NumElements(), kCostPerString, work);
+}
+
+// As HashStringsToBuckets, with the hashes of each shard's strings computed
+// by hash_strings(in, n, out), which sets out[i] to the hash of in[i] for i
+// in [0, n).
+template <typename HashStrings>
+void HashStringBatchesToBuckets(OpKernelContext* context, const Tensor& input,
+                                int64 num_buckets, HashStrings hash_strings,
+                                Tensor* output) {
+  // Rough cost of hashing a string of typical length, in nanoseconds.
+  static const int64 kCostPerString = 100;
+
+  const string* input_base = input.flat<string>().data();
+  int64* output_base = output->flat<int64>().data();
+  auto work = [input_base, output_base, num_buckets, &hash_strings](
+                  int64 start, int64 limit) {
+    // The hashes are written to the output, and replaced by their buckets.
+    uint64* hashes = reinterpret_cast<uint64*>(output_base + start);
+    hash_strings(input_base + start, limit - start, hashes);
+    for (int64 i = 0; i < limit - start; ++i) {
+      output_base[start + i] = static_cast<int64>(hashes[i] % num_buckets);
+    }
+  };
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads.num_threads, worker_threads.workers,
+        input.NumElements(), kCostPerString, work);
+}
+
+// Maps strings to buckets with 'hash', or with 'hash_many', which hashes many
+// strings at once, like Fingerprint64Lanes, when use_hash_many() says so for
+// the whole input.
+template <uint64 hash(const string&),
+          void hash_many(const string* in, int64 n, uint64* out),
+          bool use_hash_many(const string* in, int64 n)>
 class StringToHashBucketOp : public OpKernel {
  public:
   explicit StringToHashBucketOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
@@ -36,22 +110,21 @@ class StringToHashBucketOp : public OpKernel {
   void Compute(OpKernelContext* context) override {
     const Tensor* input_tensor;
     OP_REQUIRES_OK(context, context->input("input", &input_tensor));
-    const auto& input_flat = input_tensor->flat<string>();
 
     Tensor* output_tensor = nullptr;
     OP_REQUIRES_OK(context,
                    context->allocate_output("output", input_tensor->shape(),
                                             &output_tensor));
-    auto output_flat = output_tensor->flat<int64>();
-
-    typedef decltype(input_flat.size()) Index;
-    for (Index i = 0; i < input_flat.size(); ++i) {
-      const uint64 input_hash = hash(input_flat(i));
-      const uint64 bucket_id = input_hash % num_buckets_;
-      // The number of buckets is always in the positive range of int64 so is
-      // the resulting bucket_id. Casting the bucket_id from uint64 to int64 is
-      // safe.
-      output_flat(i) = static_cast<int64>(bucket_id);
+    if (use_hash_many(input_tensor->flat<string>().data(),
+                      input_tensor->NumElements())) {
+      HashStringBatchesToBuckets(
+          context, *input_tensor, num_buckets_,
+          [](const string* in, int64 n, uint64* out) { hash_many(in, n, out); },
+          output_tensor);
+    } else {
+      HashStringsToBuckets(context, *input_tensor, num_buckets_,
+                           [](const string& s) { return hash(s); },
+                           output_tensor);
     }
   }
 
@@ -78,23 +151,15 @@ class StringToKeyedHashBucketOp : public OpKernel {
   void Compute(OpKernelContext* context) override {
     const Tensor* input_tensor;
     OP_REQUIRES_OK(context, context->input("input", &input_tensor));
-    const auto& input_flat = input_tensor->flat<string>();
 
     Tensor* output_tensor = nullptr;
     OP_REQUIRES_OK(context,
                    context->allocate_output("output", input_tensor->shape(),
                                             &output_tensor));
-    auto output_flat = output_tensor->flat<int64>();
-
-    typedef decltype(input_flat.size()) Index;
-    for (Index i = 0; i < input_flat.size(); ++i) {
-      const uint64 input_hash = hash(key_, input_flat(i));
-      const uint64 bucket_id = input_hash % num_buckets_;
-      // The number of buckets is always in the positive range of int64 so is
-      // the resulting bucket_id. Casting the bucket_id from uint64 to int64 is
-      // safe.
-      output_flat(i) = static_cast<int64>(bucket_id);
-    }
+    const uint64(&key)[2] = key_;
+    HashStringsToBuckets(context, *input_tensor, num_buckets_,
+                         [&key](const string& s) { return hash(key, s); },
+                         output_tensor);
   }
 
  private:
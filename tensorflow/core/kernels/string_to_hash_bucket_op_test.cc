@@ -0,0 +1,162 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/strong_hash.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns 'n' strings of lengths drawn uniformly from [min_length,
+// max_length].
+std::vector<string> RandomStrings(int n, int min_length, int max_length) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> strings(n);
+  for (string& s : strings) {
+    s.resize(min_length + rnd.Uniform(max_length - min_length + 1));
+    for (char& c : s) {
+      c = 'a' + rnd.Uniform(26);
+    }
+  }
+  return strings;
+}
+
+class StringToHashBucketOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const string& op, const string& input, int num_buckets) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", op)
+                     .Input(input, 0, DT_STRING)
+                     .Attr("num_buckets", num_buckets)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  Status MakeKeyedOp(const string& op, const std::vector<int64>& key,
+                     int num_buckets) {
+    TF_CHECK_OK(NodeDefBuilder("myop", op)
+                    .Input("input", 0, DT_STRING)
+                    .Attr("num_buckets", num_buckets)
+                    .Attr("key", key)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+
+  // Runs the op on enough strings to be sharded and checks each bucket. The
+  // strings are long enough for several 64 byte blocks.
+  void CheckManyStrings(uint64 hash(const string&)) {
+    const int kNumBuckets = 1000;
+    const std::vector<string> strings = RandomStrings(10000, 0, 300);
+    AddInputFromArray<string>(TensorShape({100, 100}), strings);
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected(allocator(), DT_INT64, TensorShape({100, 100}));
+    for (int i = 0; i < strings.size(); ++i) {
+      expected.flat<int64>()(i) = hash(strings[i]) % kNumBuckets;
+    }
+    test::ExpectTensorEqual<int64>(expected, *GetOutput(0));
+  }
+};
+
+uint64 Hash64String(const string& s) { return Hash64(s); }
+
+const int64 kStrongKey[2] = {98765, 43210};
+
+uint64 StrongKeyedHashString(const string& s) {
+  const uint64 key[2] = {static_cast<uint64>(kStrongKey[0]),
+                         static_cast<uint64>(kStrongKey[1])};
+  return StrongKeyedHash(key, s);
+}
+
+TEST_F(StringToHashBucketOpTest, Fast_ManyStrings) {
+  MakeOp("StringToHashBucketFast", "input", 1000);
+  CheckManyStrings(Fingerprint64);
+}
+
+TEST_F(StringToHashBucketOpTest, Legacy_ManyStrings) {
+  MakeOp("StringToHashBucket", "string_tensor", 1000);
+  CheckManyStrings(Hash64String);
+}
+
+TEST_F(StringToHashBucketOpTest, Strong_ManyStrings) {
+  TF_ASSERT_OK(MakeKeyedOp("StringToHashBucketStrong",
+                           {kStrongKey[0], kStrongKey[1]}, 1000));
+  CheckManyStrings(StrongKeyedHashString);
+}
+
+TEST_F(StringToHashBucketOpTest, Strong_BadKey) {
+  Status s = MakeKeyedOp("StringToHashBucketStrong", {1, 2, 3}, 1000);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("Key must have 2 elements"))
+      << s;
+}
+
+TEST_F(StringToHashBucketOpTest, Fast_Empty) {
+  MakeOp("StringToHashBucketFast", "input", 10);
+  AddInputFromArray<string>(TensorShape({0}), {});
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(0, GetOutput(0)->NumElements());
+}
+
+static Graph* StringToHashBucketFast(int n, int min_length, int max_length) {
+  Graph* g = new Graph(OpRegistry::Global());
+  const std::vector<string> strings = RandomStrings(n, min_length, max_length);
+  Tensor input(DT_STRING, TensorShape({n}));
+  std::copy(strings.begin(), strings.end(), input.flat<string>().data());
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "StringToHashBucketFast")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("num_buckets", 1000000)
+                  .Finalize(g, &node));
+  return g;
+}
+
+// Sweeps over (minimum length, maximum length) pairs of the hashed strings.
+// Strings of up to 15 bytes are usually stored inline in the string object.
+static void BM_StringToHashBucketFast(int iters, int min_length,
+                                      int max_length) {
+  const int kStrings = 1 << 20;
+  const int64 tot = static_cast<int64>(iters) * kStrings;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * (min_length + max_length) / 2);
+  testing::UseRealTime();
+  Graph* g = StringToHashBucketFast(kStrings, min_length, max_length);
+  test::Benchmark("cpu", g).Run(iters);
+}
+BENCHMARK(BM_StringToHashBucketFast)
+    ->ArgPair(4, 12)
+    ->ArgPair(16, 32)
+    ->ArgPair(8, 64)
+    ->ArgPair(64, 128)
+    ->ArgPair(1, 1024);
+
+}  // namespace
+}  // namespace tensorflow
@@ -97,6 +97,109 @@ class TopK : public OpKernel {
 
 namespace functor {
 
+namespace {
+
+// Orders column indices by decreasing value, breaking ties by increasing
+// index.  This is the order in which TopK reports its results.
+template <typename T>
+struct TopKGreater {
+  explicit TopKGreater(const T* data) : data(data) {}
+  bool operator()(const int32 a, const int32 b) const {
+    if (data[b] < data[a]) {
+      return true;
+    } else if (data[b] > data[a]) {
+      return false;
+    } else {
+      return a < b;
+    }
+  }
+  const T* data;
+};
+
+// Rows at least this wide select their top k by threshold filtering instead
+// of pushing every column through a TopN heap.
+const int64 kMinSelectCols = 1024;
+
+// Threshold filtering samples one column in kSampleStride.
+const int64 kSampleStride = 16;
+
+// Width of the blocks that are tested against the threshold before any of
+// their columns are compacted into the candidate list.
+const int kFilterBlock = 16;
+
+// When a row is split across threads, each piece covers at least this many
+// columns.
+const int64 kMinSegmentCols = 64 * 1024;
+
+// Appends to *out the indices of the min(k, limit - start) columns of
+// data[start, limit) that come first under TopKGreater, in no particular
+// order.
+//
+// The k-th largest value t of any subset of at least k columns is no greater
+// than the k-th largest value of the whole range, so every column of the
+// answer satisfies data[c] >= t.  t is taken from a strided sample, and a
+// single filtering pass whose blocks are first checked with a vectorizable
+// comparison collects the few columns that pass; std::nth_element then picks
+// the answer from those candidates alone.
+//
+// Returns false, having appended nothing, if the range holds a NaN, for
+// which neither the threshold nor nth_element's ordering is well defined.
+template <typename T>
+bool SelectTopK(const T* data, int64 start, int64 limit, int k,
+                std::vector<int32>* out) {
+  const int64 n = limit - start;
+  const TopKGreater<T> comp(data);
+  std::vector<int32> candidates;
+  if (n <= k || n / kSampleStride < 2 * k) {
+    // Too little to filter away; select among all of the columns.
+    candidates.resize(n);
+    for (int64 c = start; c < limit; ++c) {
+      if (Eigen::numext::isnan(data[c])) return false;
+      candidates[c - start] = c;
+    }
+  } else {
+    std::vector<T> sample;
+    sample.reserve(n / kSampleStride + 1);
+    for (int64 c = start; c < limit; c += kSampleStride) {
+      if (Eigen::numext::isnan(data[c])) return false;
+      sample.push_back(data[c]);
+    }
+    std::nth_element(sample.begin(), sample.begin() + k - 1, sample.end(),
+                     [](const T a, const T b) { return b < a; });
+    const T threshold = sample[k - 1];
+
+    candidates.reserve(2 * k + n / kSampleStride);
+    int64 c = start;
+    for (; c + kFilterBlock <= limit; c += kFilterBlock) {
+      bool any = false;
+      for (int j = 0; j < kFilterBlock; ++j) {
+        any |= !(data[c + j] < threshold);
+      }
+      if (!any) continue;
+      for (int j = 0; j < kFilterBlock; ++j) {
+        const T v = data[c + j];
+        if (Eigen::numext::isnan(v)) return false;
+        if (v >= threshold) candidates.push_back(c + j);
+      }
+    }
+    for (; c < limit; ++c) {
+      const T v = data[c];
+      if (Eigen::numext::isnan(v)) return false;
+      if (v >= threshold) candidates.push_back(c);
+    }
+  }
+  const int64 num_selected = std::min<int64>(k, candidates.size());
+  if (num_selected < static_cast<int64>(candidates.size())) {
+    std::nth_element(candidates.begin(), candidates.begin() + num_selected - 1,
+                     candidates.end(), comp);
+  }
+  out->insert(out->end(), candidates.begin(),
+              candidates.begin() + num_selected);
+  return true;
+}
+
+}  // namespace
+
 template <typename T>
 struct TopKFunctor<CPUDevice, T> {
   static EIGEN_ALWAYS_INLINE Status
@@ -132,6 +235,17 @@ struct TopKFunctor<CPUDevice, T> {
       return Status::OK();
     }
 
+    // Sorts the indices of row b (already in indices(b, 0..k-1)) if
+    // requested and copies over the corresponding values.
+    auto FinishRow = [&, sorted](int32 b, bool needs_sort) {
+      if (sorted && needs_sort) {
+        std::sort(&indices(b, 0), &indices(b, k),
+                  TopKGreater<T>(&input(b, 0)));
+      }
+      std::transform(&indices(b, 0), &indices(b, k), &values(b, 0),
+                     [b, &input](const int32 loc) { return input(b, loc); });
+    };
+
     auto SortIndices = [&, context](int start_batch, int limit_batch) {
       for (int32 b = start_batch; b < limit_batch; ++b) {
         const T* input_data = &input(b, 0);
@@ -147,45 +261,102 @@ struct TopKFunctor<CPUDevice, T> {
         const auto comp = [input_data](const int32 a, const int32 b) {
           return input_data[b] < input_data[a];
         };
-        // TODO(ebrevdo): For large k < num_cols, instead of using
-        // TopN, it may be faster to create a temporary vector of
-        // values 0..num_cols - 1 and then use std::partial_sort_copy
-        // of this into indices. Choosing the appropriate minimum k or
-        // ratio of k/num_cols will require some experimentation.
         if (k == num_cols) {
           // Set the initial array of indices 0 ... k - 1.
           std::iota(&indices(b, 0), &indices(b, k), 0);
           // Use an in-place sort.
           std::stable_sort(&indices(b, 0), &indices(b, k), comp);
-        } else {
-          // Use the TopN heap object to sort.
-          gtl::TopN<int32, decltype(stable_comp)> filter(k, stable_comp);
-          filter.reserve(num_cols);
-          for (int32 c = 0; c < num_cols; ++c) {
-            filter.push(c);
+          FinishRow(b, false);
+          continue;
+        }
+        if (num_cols >= kMinSelectCols) {
+          std::vector<int32> selected;
+          selected.reserve(k);
+          if (SelectTopK(input_data, 0, num_cols, k, &selected)) {
+            std::copy(selected.begin(), selected.end(), &indices(b, 0));
+            FinishRow(b, true);
+            continue;
           }
+        }
+        // Use the TopN heap object to sort.
+        gtl::TopN<int32, decltype(stable_comp)> filter(k, stable_comp);
+        filter.reserve(num_cols);
+        for (int32 c = 0; c < num_cols; ++c) {
+          filter.push(c);
+        }
 
-          int32 i = 0;
-          if (sorted) {
-            std::unique_ptr<std::vector<int32>> top_k(filter.Extract());
-            for (auto top_k_it = top_k->begin(); top_k_it != top_k->end();
-                 ++top_k_it, ++i) {
-              indices(b, i) = *top_k_it;
-            }
-          } else {
-            for (auto top_k_it = filter.unsorted_begin();
-                 top_k_it != filter.unsorted_end(); ++top_k_it, ++i) {
-              indices(b, i) = *top_k_it;
-            }
+        int32 i = 0;
+        if (sorted) {
+          std::unique_ptr<std::vector<int32>> top_k(filter.Extract());
+          for (auto top_k_it = top_k->begin(); top_k_it != top_k->end();
+               ++top_k_it, ++i) {
+            indices(b, i) = *top_k_it;
+          }
+        } else {
+          for (auto top_k_it = filter.unsorted_begin();
+               top_k_it != filter.unsorted_end(); ++top_k_it, ++i) {
+            indices(b, i) = *top_k_it;
           }
         }
-        // Now that the indices are sorted, copy the values over in
-        // sorted order.
-        std::transform(&indices(b, 0), &indices(b, k), &values(b, 0),
-                       [b, &input](const int32 loc) { return input(b, loc); });
+        FinishRow(b, false);
       }  // for (int32 b = ...
     };
 
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+    // With fewer rows than threads, split each wide row into segments whose
+    // local top k are selected in parallel.  The union of the segments' top
+    // k holds the row's top k, which is then selected from those candidates.
+    int64 num_segments = 1;
+    if (k < num_cols && num_rows > 0 &&
+        num_rows < worker_threads.num_threads) {
+      const int64 min_segment_cols =
+          std::max<int64>(kMinSegmentCols, 4 * static_cast<int64>(k));
+      num_segments = std::min<int64>(worker_threads.num_threads / num_rows,
+                                     num_cols / min_segment_cols);
+    }
+    if (num_segments > 1) {
+      const int64 num_units = num_rows * num_segments;
+      std::vector<std::vector<int32>> unit_selected(num_units);
+      std::vector<char> unit_ok(num_units);
+      auto SelectSegments = [&](int64 start_unit, int64 limit_unit) {
+        for (int64 u = start_unit; u < limit_unit; ++u) {
+          const int64 b = u / num_segments;
+          const int64 s = u % num_segments;
+          const int64 start = num_cols * s / num_segments;
+          const int64 limit = num_cols * (s + 1) / num_segments;
+          unit_selected[u].reserve(k);
+          unit_ok[u] = SelectTopK(&input(b, 0), start, limit, k,
+                                  &unit_selected[u]);
+        }
+      };
+      // Roughly one filtering pass over the segment.
+      const int64 segment_cost = (num_cols / num_segments) *
+                                 Eigen::TensorOpCost::AddCost<T>();
+      Shard(worker_threads.num_threads, worker_threads.workers, num_units,
+            segment_cost, SelectSegments);
+
+      for (int32 b = 0; b < num_rows; ++b) {
+        std::vector<int32> candidates;
+        bool ok = true;
+        for (int64 s = 0; s < num_segments; ++s) {
+          const int64 u = b * num_segments + s;
+          ok = ok && unit_ok[u];
+          candidates.insert(candidates.end(), unit_selected[u].begin(),
+                            unit_selected[u].end());
+        }
+        if (!ok) {
+          SortIndices(b, b + 1);
+          continue;
+        }
+        std::nth_element(candidates.begin(), candidates.begin() + k - 1,
+                         candidates.end(), TopKGreater<T>(&input(b, 0)));
+        std::copy(candidates.begin(), candidates.begin() + k, &indices(b, 0));
+        FinishRow(b, true);
+      }
+      return Status::OK();
+    }
+
     // Guesstimate of cost; 4*N*log(K) where N == num_cols.
     // If K == N, assume the cost is N*log(K + 1).
     const double cmp_cost = 3 * Eigen::TensorOpCost::AddCost<int32>() +
@@ -200,7 +371,6 @@ struct TopKFunctor<CPUDevice, T> {
     const int64 final_cost = (total_cost >= static_cast<double>(kint64max))
                                  ? kint64max
                                  : static_cast<int64>(total_cost);
-    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
     Shard(worker_threads.num_threads, worker_threads.workers, num_rows,
           final_cost, SortIndices);
 
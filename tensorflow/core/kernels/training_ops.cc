@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 #ifdef TENSORFLOW_USE_SYCL
 #include "tensorflow/core/common_runtime/sycl/sycl_util.h"
@@ -40,6 +41,79 @@ inline T sgn(const T x) {
   T one(1);
   return (x == zero ? zero : (x < zero ? -one : one));
 }
+
+// Calls "update(i, index)" for every offset i in "indices", where index is
+// the validated value of indices(i). Returns an error, before applying any
+// update, if an index is not in [0, first_dim_size).
+//
+// When there is enough work, rows are striped over the CPU worker threads
+// by index modulo the number of stripes, so that every row is owned by
+// exactly one stripe. Updates to distinct rows then proceed in parallel
+// without further locking, while the updates to a repeated row are applied
+// by its stripe in the order in which they appear in "indices".
+// "cost_per_update" is the estimated cost of one call to "update", in
+// cycles.
+template <typename Tindex, typename Update>
+Status ParallelSparseApply(OpKernelContext* ctx,
+                           typename TTypes<Tindex>::ConstVec indices,
+                           Tindex first_dim_size, int64 cost_per_update,
+                           Update update) {
+  // Below this amount of work, striping costs more than it saves.
+  static const int64 kMinCostPerStripe = 10000;
+  const Tindex N = indices.dimension(0);
+  std::vector<Tindex> rows(N);
+  for (Tindex i = 0; i < N; i++) {
+    const Tindex index = internal::SubtleMustCopy(indices(i));
+    if (!FastBoundsCheck(index, first_dim_size)) {
+      return errors::InvalidArgument(strings::StrCat(
+          "Index ", index, " at offset ", i, " in indices is out of range"));
+    }
+    rows[i] = index;
+  }
+
+  auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+  const int64 total_cost = static_cast<int64>(N) * cost_per_update;
+  const int64 num_stripes = std::min<int64>(
+      {4 * static_cast<int64>(worker_threads.num_threads),
+       total_cost / kMinCostPerStripe, static_cast<int64>(first_dim_size)});
+  if (num_stripes <= 1) {
+    for (Tindex i = 0; i < N; i++) {
+      update(i, rows[i]);
+    }
+    return Status::OK();
+  }
+
+  // Counting sort of the offsets by stripe, which keeps the offsets of a
+  // stripe in increasing order.
+  std::vector<Tindex> stripe_begin(num_stripes + 1, 0);
+  for (Tindex i = 0; i < N; i++) {
+    ++stripe_begin[rows[i] % num_stripes + 1];
+  }
+  for (int64 s = 0; s < num_stripes; s++) {
+    stripe_begin[s + 1] += stripe_begin[s];
+  }
+  std::vector<Tindex> offsets(N);
+  {
+    std::vector<Tindex> next(stripe_begin.begin(), stripe_begin.end() - 1);
+    for (Tindex i = 0; i < N; i++) {
+      offsets[next[rows[i] % num_stripes]++] = i;
+    }
+  }
+
+  auto work = [&rows, &offsets, &stripe_begin, &update](int64 begin,
+                                                        int64 end) {
+    for (int64 s = begin; s < end; s++) {
+      for (Tindex k = stripe_begin[s]; k < stripe_begin[s + 1]; k++) {
+        const Tindex i = offsets[k];
+        update(i, rows[i]);
+      }
+    }
+  };
+  Shard(worker_threads.num_threads, worker_threads.workers, num_stripes,
+        total_cost / num_stripes, work);
+  return Status::OK();
+}
+
 }  // namespace
 
 namespace functor {
@@ -1359,20 +1433,16 @@ class SparseApplyAdagradOp : public OpKernel {
         auto grad_flat = grad.flat_outer_dims<T>();
         T lr_scalar = lr.scalar<T>()();
 
-        // Note(yonghui): It might be worth multi-threading square() and
-        // rsqrt().
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](Tindex i, Tindex index) {
           auto a = accum_flat.template chip<0>(index);
           auto g = grad_flat.template chip<0>(i);
           auto v = var_flat.template chip<0>(index);
           a += g.square();
           v -= g.constant(lr_scalar) * g * a.rsqrt();
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(
+                                ctx, indices_vec, first_dim_size,
+                                inner_dim * 20, update));
       } else {
         auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
@@ -1381,17 +1451,15 @@ class SparseApplyAdagradOp : public OpKernel {
         T lr_scalar = lr.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           const T& g = grad_flat(i);
           a += g * g;
           var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(ctx, indices_vec,
+                                                        first_dim_size, 20,
+                                                        update));
       }
     }
 
@@ -2173,12 +2241,7 @@ class SparseApplyFtrlOp : public OpKernel {
         }
         T lr_power_scalar = lr_power.scalar<T>()();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](Tindex i, Tindex index) {
           auto accum = accum_flat.template chip<0>(index);
           auto linear = linear_flat.template chip<0>(index);
           auto grad = grad_flat.template chip<0>(i);
@@ -2217,8 +2280,11 @@ class SparseApplyFtrlOp : public OpKernel {
           } else {
             COMPUTE_FTRL(grad);
           }
-        }
+        };
 #undef COMPUTE_FTRL
+        OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(
+                                ctx, indices_vec, first_dim_size,
+                                inner_dim * 50, update));
       } else {
         T lr_scalar = lr.scalar<T>()();
         T l1_scalar = l1.scalar<T>()();
@@ -2236,19 +2302,13 @@ class SparseApplyFtrlOp : public OpKernel {
         auto grad_flat = grad.flat<T>();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           T& l = linear_flat(index);
           T& v = var_flat(index);
           T g;
           if (has_l2_shrinkage) {
-            g = grad_flat(i) +
-                (static_cast<T>(2) * l2_shrinkage_scalar * var_flat(i));
+            g = grad_flat(i) + (static_cast<T>(2) * l2_shrinkage_scalar * v);
           } else {
             g = grad_flat(i);
           }
@@ -2262,7 +2322,10 @@ class SparseApplyFtrlOp : public OpKernel {
                           lr_power_scalar);
           a = updated_a;
           l = updated_l;
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(ctx, indices_vec,
+                                                        first_dim_size, 50,
+                                                        update));
       }
     }
 
@@ -2491,24 +2554,23 @@ class SparseApplyMomentumOp : public OpKernel {
       auto grad_flat = grad.flat_outer_dims<T>();
       T lr_scalar = lr.scalar<T>()();
       T momentum_scalar = momentum.scalar<T>()();
+      const bool use_nesterov = use_nesterov_;
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-        OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
+      auto update = [&](Tindex i, Tindex index) {
         auto a = accum_flat.template chip<0>(index);
         auto g = grad_flat.template chip<0>(i);
         auto v = var_flat.template chip<0>(index);
         a = a * a.constant(momentum_scalar) + g;
-        if (use_nesterov_) {
+        if (use_nesterov) {
           v -= g.constant(lr_scalar) * g +
                a.constant(lr_scalar) * a.constant(momentum_scalar) * a;
         } else {
           v -= a.constant(lr_scalar) * a;
         }
-      }
+      };
+      OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(
+                              ctx, indices_vec, first_dim_size,
+                              grad_flat.dimension(1) * 5, update));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -3130,16 +3192,7 @@ class SparseApplyRMSPropOp : public OpKernel {
 
     if (N > 0) {
       const Tindex first_dim_size = var.dim_size(0);
-      // Validate all the indices are in range
       auto indices_vec = indices.vec<Tindex>();
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        OP_REQUIRES(ctx, index >= 0 && index < first_dim_size,
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
-      }
-
       auto var_flat = var.flat_outer_dims<T>();
       auto ms_flat = ms.flat_outer_dims<T>();
       auto mom_flat = mom.flat_outer_dims<T>();
@@ -3149,9 +3202,7 @@ class SparseApplyRMSPropOp : public OpKernel {
       const T epsilon_scalar = epsilon.scalar<T>()();
       const T momentum_scalar = momentum.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-
+      auto update = [&](Tindex i, Tindex index) {
         auto ms_ = ms_flat.template chip<0>(index);
         auto mom_ = mom_flat.template chip<0>(index);
         auto grad_ = grad_flat.template chip<0>(i);
@@ -3164,7 +3215,10 @@ class SparseApplyRMSPropOp : public OpKernel {
 
         auto v = var_flat.template chip<0>(index);
         v -= mom_;
-      }
+      };
+      OP_REQUIRES_OK(ctx, ParallelSparseApply<Tindex>(
+                              ctx, indices_vec, first_dim_size,
+                              grad_flat.dimension(1) * 20, update));
     }
 
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
@@ -14,8 +14,16 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
@@ -233,4 +241,327 @@ static void BM_RMSProp(int iters, int params) {
 }
 BENCHMARK(BM_RMSProp)->Arg(128 << 10)->Arg(256 << 10);
 
+// The sparse benchmarks below update rows of a [kSparseRows, dim] variable
+// at indices drawn from a Zipf distribution, as is typical of embeddings.
+static const int kSparseRows = 256 << 10;
+static const int kSparseUpdates = 64 << 10;
+
+static SessionOptions ThreadedOptions(int num_threads) {
+  SessionOptions opts;
+  opts.config.set_intra_op_parallelism_threads(num_threads);
+  opts.config.set_inter_op_parallelism_threads(1);
+  return opts;
+}
+
+static Node* SparseVar(Graph* g, int dim) {
+  return test::graph::Var(g, DT_FLOAT, TensorShape({kSparseRows, dim}));
+}
+
+static Node* SparseZeros(Graph* g, int dim) {
+  Tensor data(DT_FLOAT, TensorShape({kSparseRows, dim}));
+  data.flat<float>().setZero();
+  return test::graph::Constant(g, data);
+}
+
+static Node* SparseGrad(Graph* g, int dim) {
+  Tensor data(DT_FLOAT, TensorShape({kSparseUpdates, dim}));
+  data.flat<float>().setRandom();
+  return test::graph::Constant(g, data);
+}
+
+// Returns kSparseUpdates indices in [0, kSparseRows) drawn from a Zipf
+// distribution with exponent 1.
+static Node* ZipfIndices(Graph* g) {
+  std::vector<double> cdf(kSparseRows);
+  double sum = 0;
+  for (int i = 0; i < kSparseRows; ++i) {
+    sum += 1.0 / (i + 1);
+    cdf[i] = sum;
+  }
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor data(DT_INT32, TensorShape({kSparseUpdates}));
+  auto indices = data.flat<int32>();
+  for (int i = 0; i < kSparseUpdates; ++i) {
+    const double u = rnd.RandDouble() * sum;
+    indices(i) = std::min<int>(
+        std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin(),
+        kSparseRows - 1);
+  }
+  return test::graph::Constant(g, data);
+}
+
+// Builds the graphs for "op", whose first "num_slots" inputs are variables
+// shaped like the parameters. "args" adds the remaining inputs.
+static void SparseApply(
+    const string& op, int num_slots, int dim,
+    const std::function<std::vector<Node*>(Graph*, const std::vector<Node*>&)>&
+        args,
+    Graph** init_g, Graph** train_g) {
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    std::vector<Node*> vars;
+    for (int i = 0; i < num_slots; ++i) vars.push_back(SparseVar(g, dim));
+    auto zero = SparseZeros(g, dim);
+    for (Node* var : vars) test::graph::Assign(g, var, zero);
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    std::vector<Node*> vars;
+    for (int i = 0; i < num_slots; ++i) vars.push_back(SparseVar(g, dim));
+    test::graph::Multi(g, op, args(g, vars));
+    *train_g = g;
+  }
+}
+
+static void RunSparseApply(int iters, int num_threads, int dim, Graph* init,
+                           Graph* train) {
+  const int64 tot = static_cast<int64>(iters) * kSparseUpdates * dim;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * sizeof(float));
+  testing::UseRealTime();
+  SessionOptions opts = ThreadedOptions(num_threads);
+  test::Benchmark("cpu", train, &opts, init).Run(iters);
+}
+
+static void BM_SparseAdagrad(int iters, int num_threads, int dim) {
+  testing::StopTiming();
+  Graph* init;
+  Graph* train;
+  SparseApply("SparseApplyAdagrad", 2, dim,
+              [dim](Graph* g, const std::vector<Node*>& v) {
+                return std::vector<Node*>{v[0], v[1], Scalar(g, 0.01),
+                                          SparseGrad(g, dim), ZipfIndices(g)};
+              },
+              &init, &train);
+  testing::StartTiming();
+  RunSparseApply(iters, num_threads, dim, init, train);
+}
+BENCHMARK(BM_SparseAdagrad)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 1)
+    ->ArgPair(1, 64)
+    ->ArgPair(8, 64);
+
+static void BM_SparseFtrl(int iters, int num_threads, int dim) {
+  testing::StopTiming();
+  Graph* init;
+  Graph* train;
+  SparseApply("SparseApplyFtrl", 3, dim,
+              [dim](Graph* g, const std::vector<Node*>& v) {
+                return std::vector<Node*>{v[0],
+                                          v[1],
+                                          v[2],
+                                          SparseGrad(g, dim),
+                                          ZipfIndices(g),
+                                          Scalar(g, 0.01),
+                                          Scalar(g, 0.1),
+                                          Scalar(g, 0.1),
+                                          Scalar(g, -0.5)};
+              },
+              &init, &train);
+  testing::StartTiming();
+  RunSparseApply(iters, num_threads, dim, init, train);
+}
+BENCHMARK(BM_SparseFtrl)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 1)
+    ->ArgPair(1, 64)
+    ->ArgPair(8, 64);
+
+static void BM_SparseMomentum(int iters, int num_threads, int dim) {
+  testing::StopTiming();
+  Graph* init;
+  Graph* train;
+  SparseApply("SparseApplyMomentum", 2, dim,
+              [dim](Graph* g, const std::vector<Node*>& v) {
+                return std::vector<Node*>{v[0], v[1], Scalar(g, 0.01),
+                                          SparseGrad(g, dim), ZipfIndices(g),
+                                          Scalar(g, 0.9)};
+              },
+              &init, &train);
+  testing::StartTiming();
+  RunSparseApply(iters, num_threads, dim, init, train);
+}
+BENCHMARK(BM_SparseMomentum)->ArgPair(1, 64)->ArgPair(8, 64);
+
+static void BM_SparseRMSProp(int iters, int num_threads, int dim) {
+  testing::StopTiming();
+  Graph* init;
+  Graph* train;
+  SparseApply("SparseApplyRMSProp", 3, dim,
+              [dim](Graph* g, const std::vector<Node*>& v) {
+                return std::vector<Node*>{v[0],
+                                          v[1],
+                                          v[2],
+                                          Scalar(g, 0.01),
+                                          Scalar(g, 0.9),
+                                          Scalar(g, 0.9),
+                                          Scalar(g, 1e-7),
+                                          SparseGrad(g, dim),
+                                          ZipfIndices(g)};
+              },
+              &init, &train);
+  testing::StartTiming();
+  RunSparseApply(iters, num_threads, dim, init, train);
+}
+BENCHMARK(BM_SparseRMSProp)->ArgPair(1, 64)->ArgPair(8, 64);
+
+class SparseApplyOpTest : public OpsTestBase {
+ protected:
+  // Runs the kernel with "num_threads" intra-op threads and returns copies
+  // of the first "num_slots" (ref) inputs afterwards. The slots are restored
+  // to their values from before the run, so the kernel can be run again.
+  std::vector<Tensor> RunWithThreads(int num_threads, int num_slots) {
+    std::vector<Tensor> before;
+    for (int i = 0; i < num_slots; ++i) {
+      before.push_back(tensor::DeepCopy(*mutable_input(i).tensor));
+    }
+    thread::ThreadPool pool(Env::Default(), "sparse_apply", num_threads);
+    DeviceBase::CpuWorkerThreads workers;
+    workers.num_threads = num_threads;
+    workers.workers = &pool;
+    const DeviceBase::CpuWorkerThreads* saved =
+        device_->tensorflow_cpu_worker_threads();
+    device_->set_tensorflow_cpu_worker_threads(&workers);
+    TF_EXPECT_OK(RunOpKernel());
+    device_->set_tensorflow_cpu_worker_threads(
+        const_cast<DeviceBase::CpuWorkerThreads*>(saved));
+
+    std::vector<Tensor> after;
+    for (int i = 0; i < num_slots; ++i) {
+      Tensor* slot = mutable_input(i).tensor;
+      after.push_back(tensor::DeepCopy(*slot));
+      slot->flat<float>() = before[i].flat<float>();
+    }
+    return after;
+  }
+
+  // Adds the [kRows, kDim] slots of a sparse apply op.
+  void AddSlots(int num_slots) {
+    for (int i = 0; i < num_slots; ++i) {
+      AddInput<float>(TensorShape({kRows, kDim}), [i](int k) -> float {
+        return i == 0 ? 0.01f * (k % 97) - 0.5f : 0.1f;
+      });
+    }
+  }
+
+  void AddGradient() {
+    AddInput<float>(TensorShape({kUpdates, kDim}),
+                    [](int k) -> float { return 0.001f * (k % 1013) - 0.5f; });
+  }
+
+  // Adds kUpdates indices that hit every row many times.
+  void AddIndices() {
+    AddInput<int32>(TensorShape({kUpdates}),
+                    [](int i) -> int32 { return (i * 37) % kRows; });
+  }
+
+  // With one thread the stripes run inline one after the other, which
+  // applies the updates of each row in the order of "indices" like the
+  // serial loop does. With more threads the stripes run concurrently and
+  // must give bit-identical results.
+  void ExpectStripedMatchesSerial(int num_slots) {
+    const std::vector<Tensor> serial = RunWithThreads(1, num_slots);
+    const std::vector<Tensor> striped = RunWithThreads(8, num_slots);
+    for (int i = 0; i < num_slots; ++i) {
+      test::ExpectTensorEqual<float>(serial[i], striped[i]);
+    }
+  }
+
+  static const int kRows = 512;
+  static const int kDim = 16;
+  static const int kUpdates = 8192;
+};
+
+TEST_F(SparseApplyOpTest, StripedAdagradMatchesSerial) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "SparseApplyAdagrad")
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddSlots(2);
+  AddInputFromArray<float>(TensorShape({}), {0.01f});
+  AddGradient();
+  AddIndices();
+  ExpectStripedMatchesSerial(2);
+}
+
+TEST_F(SparseApplyOpTest, StripedFtrlV2MatchesSerial) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "SparseApplyFtrlV2")
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddSlots(3);
+  AddGradient();
+  AddIndices();
+  for (float hyper : {0.01f, 0.1f, 0.1f, 0.2f, -0.5f}) {
+    AddInputFromArray<float>(TensorShape({}), {hyper});
+  }
+  ExpectStripedMatchesSerial(3);
+}
+
+// The scalar path of SparseApplyFtrlV2 shrinks the gradient towards the
+// variable at indices(i), not the one at offset i.
+TEST_F(SparseApplyOpTest, ScalarFtrlV2L2Shrinkage) {
+  TF_ASSERT_OK(NodeDefBuilder("op", "SparseApplyFtrlV2")
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT_REF))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const float lr = 0.5f, l1 = 0.01f, l2 = 0.1f, l2_shrinkage = 0.3f;
+  std::vector<float> var = {1.0f, -2.0f, 3.0f, -4.0f, 5.0f, -6.0f};
+  std::vector<float> accum(6, 0.1f);
+  std::vector<float> linear(6, 0.0f);
+  const std::vector<float> grad = {0.5f, -0.25f, 1.5f};
+  const std::vector<int32> indices = {4, 1, 4};
+  AddInputFromArray<float>(TensorShape({6}), var);
+  AddInputFromArray<float>(TensorShape({6}), accum);
+  AddInputFromArray<float>(TensorShape({6}), linear);
+  AddInputFromArray<float>(TensorShape({3}), grad);
+  AddInputFromArray<int32>(TensorShape({3}), indices);
+  AddInputFromArray<float>(TensorShape({}), {lr});
+  AddInputFromArray<float>(TensorShape({}), {l1});
+  AddInputFromArray<float>(TensorShape({}), {l2});
+  AddInputFromArray<float>(TensorShape({}), {l2_shrinkage});
+  AddInputFromArray<float>(TensorShape({}), {-0.5f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  for (int i = 0; i < 3; ++i) {
+    float& v = var[indices[i]];
+    float& a = accum[indices[i]];
+    float& l = linear[indices[i]];
+    const float g = grad[i] + 2 * l2_shrinkage * v;
+    const float updated_a = a + g * g;
+    l += g - (std::sqrt(updated_a) - std::sqrt(a)) / lr * v;
+    a = updated_a;
+    const float quadratic = std::sqrt(a) / lr + 2 * l2;
+    v = std::abs(l) > l1 ? ((l > 0 ? l1 : -l1) - l) / quadratic : 0.0f;
+  }
+  Tensor expected(DT_FLOAT, TensorShape({6}));
+  test::FillValues<float>(&expected, var);
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
 }  // end namespace tensorflow
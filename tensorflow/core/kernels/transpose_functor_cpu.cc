@@ -16,9 +16,17 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/transpose_functor.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/kernels/cpu_dispatch.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/kernels/transpose_tile.h"
 
 namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
 namespace internal {
 
 template <typename Device, typename T>
@@ -44,29 +52,319 @@ void TransposeSimple(const Device& d, const Tensor& in,
   }
 }
 
-}  // end namespace internal
+// Number of elements on each side of the square tiles that
+// TransposeUsingTiles copies at a time. A tile row spans at least one cache
+// line and a tile's input and output fit in L1 together.
+template <typename T>
+struct TransposeTileSize {
+  static const int64 value = sizeof(T) == 1 ? 64 : 32;
+};
 
-typedef Eigen::ThreadPoolDevice CPUDevice;
+// The Eigen packet type used to transpose square blocks of T, if any.
+template <typename T>
+struct TransposePacket {
+  typedef T Scalar;
+  typedef T Packet;
+  static const int size = 1;
+};
+
+template <>
+struct TransposePacket<uint32> {
+  typedef float Scalar;
+  typedef Eigen::internal::packet_traits<float>::type Packet;
+  static const int size = Eigen::internal::unpacket_traits<Packet>::size;
+};
+
+template <>
+struct TransposePacket<uint64> {
+  typedef double Scalar;
+  typedef Eigen::internal::packet_traits<double>::type Packet;
+  static const int size = Eigen::internal::unpacket_traits<Packet>::size;
+};
+
+// Copies the [rows, cols] matrix at 'src', whose rows are 'src_stride'
+// elements apart, to its transpose at 'dst', whose rows are 'dst_stride'
+// elements apart.
+template <typename T, bool vectorized = (TransposePacket<T>::size > 1)>
+struct TransposeTile {
+  static void run(const T* src, int64 src_stride, int64 rows, int64 cols,
+                  T* dst, int64 dst_stride) {
+    for (int64 i = 0; i < rows; ++i) {
+      for (int64 j = 0; j < cols; ++j) {
+        dst[j * dst_stride + i] = src[i * src_stride + j];
+      }
+    }
+  }
+};
+
+// Transposes the tile in square blocks of one packet per row, which are
+// transposed in registers. The elements are only moved, so it is safe to load
+// integers as floating point packets.
+template <typename T>
+struct TransposeTile<T, true> {
+  static void run(const T* src, int64 src_stride, int64 rows, int64 cols,
+                  T* dst, int64 dst_stride) {
+    typedef typename TransposePacket<T>::Scalar Scalar;
+    typedef typename TransposePacket<T>::Packet Packet;
+    const int kPacketSize = TransposePacket<T>::size;
+    const int64 vectorized_rows = rows / kPacketSize * kPacketSize;
+    const int64 vectorized_cols = cols / kPacketSize * kPacketSize;
+    for (int64 i = 0; i < vectorized_rows; i += kPacketSize) {
+      for (int64 j = 0; j < vectorized_cols; j += kPacketSize) {
+        Eigen::internal::PacketBlock<Packet, kPacketSize> block;
+        for (int k = 0; k < kPacketSize; ++k) {
+          block.packet[k] = Eigen::internal::ploadu<Packet>(
+              reinterpret_cast<const Scalar*>(src + (i + k) * src_stride + j));
+        }
+        Eigen::internal::ptranspose(block);
+        for (int k = 0; k < kPacketSize; ++k) {
+          Eigen::internal::pstoreu(
+              reinterpret_cast<Scalar*>(dst + (j + k) * dst_stride + i),
+              block.packet[k]);
+        }
+      }
+    }
+    TransposeTile<T, false>::run(src + vectorized_cols, src_stride,
+                                 vectorized_rows, cols - vectorized_cols,
+                                 dst + vectorized_cols * dst_stride,
+                                 dst_stride);
+    TransposeTile<T, false>::run(src + vectorized_rows * src_stride,
+                                 src_stride, rows - vectorized_rows, cols,
+                                 dst + vectorized_rows, dst_stride);
+  }
+};
+
+// TransposeTile, or a version of it for a wider instruction set when there is
+// one for T and the CPU supports it.
+template <typename T>
+struct DispatchedTransposeTile {
+  static void run(const T* src, int64 src_stride, int64 rows, int64 cols,
+                  T* dst, int64 dst_stride) {
+    TransposeTile<T>::run(src, src_stride, rows, cols, dst, dst_stride);
+  }
+};
+
+template <>
+struct DispatchedTransposeTile<uint32> {
+  static void run(const uint32* src, int64 src_stride, int64 rows,
+                  int64 cols, uint32* dst, int64 dst_stride) {
+    static const TransposeTile32Function dispatched =
+        cpu_dispatch::Select<TransposeTile32Function>(
+            nullptr, GetAvx2TransposeTile32(), nullptr);
+    if (dispatched != nullptr) {
+      dispatched(src, src_stride, rows, cols, dst, dst_stride);
+    } else {
+      TransposeTile<uint32>::run(src, src_stride, rows, cols, dst,
+                                 dst_stride);
+    }
+  }
+};
+
+// A dimension that the input and the output both iterate over, with its
+// stride in each.
+struct TransposeOuterDim {
+  int64 size;
+  int64 in_stride;
+  int64 out_stride;
+};
+
+typedef gtl::InlinedVector<TransposeOuterDim, 8> TransposeOuterDimsVec;
+
+// Sets *in_offset and *out_offset to the offsets of the 'index'-th element,
+// in row-major order, of the space spanned by 'dims'.
+inline void TransposeOuterOffsets(const TransposeOuterDimsVec& dims,
+                                  int64 index, int64* in_offset,
+                                  int64* out_offset) {
+  *in_offset = 0;
+  *out_offset = 0;
+  for (int i = dims.size() - 1; i >= 0; --i) {
+    const int64 coordinate = index % dims[i].size;
+    index /= dims[i].size;
+    *in_offset += coordinate * dims[i].in_stride;
+    *out_offset += coordinate * dims[i].out_stride;
+  }
+}
+
+// Transposes a tensor of a trivially copyable type.
+//
+// The dimensions of size 1 are dropped and the neighbouring dimensions that
+// stay neighbours in the output are merged, which leaves the fewest, largest
+// dimensions to iterate over. If the innermost dimension stays innermost, the
+// output is a gather of contiguous rows. Otherwise the innermost dimensions of
+// the input and the output form a 2D transpose for every index of the other
+// dimensions, which is copied in square tiles so that both sides are read
+// and written a cache line at a time. Rows or tiles are sharded over the
+// device's threads.
+template <typename T>
+void TransposeUsingTiles(const CPUDevice& d, const Tensor& in,
+                         const gtl::ArraySlice<int32> perm, Tensor* out) {
+  const int64 nelem = in.NumElements();
+  if (nelem == 0) return;
+  const T* p = reinterpret_cast<const T*>(in.tensor_data().data());
+  T* q = reinterpret_cast<T*>(const_cast<char*>((out->tensor_data().data())));
+
+  // Drops the dimensions of size 1.
+  TransposePermsVec new_index(in.dims(), -1);
+  TensorShape squeezed_shape;
+  for (int i = 0; i < in.dims(); ++i) {
+    if (in.dim_size(i) > 1) {
+      new_index[i] = squeezed_shape.dims();
+      squeezed_shape.AddDim(in.dim_size(i));
+    }
+  }
+  TransposePermsVec squeezed_perm;
+  for (int32 i : perm) {
+    if (new_index[i] >= 0) squeezed_perm.push_back(new_index[i]);
+  }
+  if (squeezed_shape.dims() <= 1) {
+    std::copy(p, p + nelem, q);
+    return;
+  }
+
+  TransposePermsVec new_perm;
+  TransposeDimsVec dims;
+  ReduceTransposeDimensions(squeezed_shape, squeezed_perm, &new_perm, &dims);
+  const int ndims = dims.size();
+  if (ndims == 1) {
+    std::copy(p, p + nelem, q);
+    return;
+  }
+  TransposeDimsVec in_strides(ndims);
+  TransposeDimsVec out_strides(ndims);
+  in_strides[ndims - 1] = 1;
+  out_strides[ndims - 1] = 1;
+  for (int i = ndims - 2; i >= 0; --i) {
+    in_strides[i] = in_strides[i + 1] * dims[i + 1];
+    out_strides[i] = out_strides[i + 1] * dims[new_perm[i + 1]];
+  }
+
+  if (new_perm[ndims - 1] == ndims - 1) {
+    // Every output row is a whole input row.
+    const int64 row_size = dims[ndims - 1];
+    TransposeOuterDimsVec outer_dims;
+    for (int i = 0; i < ndims - 1; ++i) {
+      outer_dims.push_back(
+          {dims[new_perm[i]], in_strides[new_perm[i]], out_strides[i]});
+    }
+    auto work = [p, q, row_size, &outer_dims](int64 start_row,
+                                              int64 end_row) {
+      // Walks the rows like an odometer to avoid dividing for every row.
+      const int num_outer_dims = outer_dims.size();
+      gtl::InlinedVector<int64, 8> coordinates(num_outer_dims);
+      int64 in_offset = 0;
+      int64 out_offset = 0;
+      int64 index = start_row;
+      for (int i = num_outer_dims - 1; i >= 0; --i) {
+        coordinates[i] = index % outer_dims[i].size;
+        index /= outer_dims[i].size;
+        in_offset += coordinates[i] * outer_dims[i].in_stride;
+        out_offset += coordinates[i] * outer_dims[i].out_stride;
+      }
+      for (int64 row = start_row; row < end_row; ++row) {
+        std::copy(p + in_offset, p + in_offset + row_size, q + out_offset);
+        for (int i = num_outer_dims - 1; i >= 0; --i) {
+          in_offset += outer_dims[i].in_stride;
+          out_offset += outer_dims[i].out_stride;
+          if (++coordinates[i] < outer_dims[i].size) break;
+          in_offset -= outer_dims[i].size * outer_dims[i].in_stride;
+          out_offset -= outer_dims[i].size * outer_dims[i].out_stride;
+          coordinates[i] = 0;
+        }
+      }
+    };
+    d.parallelFor(nelem / row_size,
+                  Eigen::TensorOpCost(row_size * sizeof(T),
+                                      row_size * sizeof(T), 0),
+                  work);
+    return;
+  }
+
+  // The output's innermost dimension is the input's dimension 'rows_dim',
+  // and the input's innermost dimension is the output's dimension
+  // 'cols_out_dim'. Together they form a [rows, cols] matrix transpose for
+  // every index of the other dimensions.
+  const int rows_dim = new_perm[ndims - 1];
+  int cols_out_dim = 0;
+  TransposeOuterDimsVec outer_dims;
+  for (int i = 0; i < ndims - 1; ++i) {
+    if (new_perm[i] == ndims - 1) {
+      cols_out_dim = i;
+    } else {
+      outer_dims.push_back(
+          {dims[new_perm[i]], in_strides[new_perm[i]], out_strides[i]});
+    }
+  }
+  const int64 rows = dims[rows_dim];
+  const int64 cols = dims[ndims - 1];
+  const int64 src_stride = in_strides[rows_dim];
+  const int64 dst_stride = out_strides[cols_out_dim];
+  // Each tile reads one page per row when the input's rows are a page or
+  // more apart, and writes one page per column when the output's are. If
+  // both are, smaller tiles keep the pages they touch in the TLB.
+  const int64 kPageSize = 4096;
+  int64 tile_size = TransposeTileSize<T>::value;
+  if (src_stride * sizeof(T) >= kPageSize &&
+      dst_stride * sizeof(T) >= kPageSize) {
+    tile_size /= 4;
+  }
+  const int64 row_tiles = (rows + tile_size - 1) / tile_size;
+  const int64 col_tiles = (cols + tile_size - 1) / tile_size;
+  const int64 num_tiles = nelem / (rows * cols) * row_tiles * col_tiles;
+
+  auto work = [p, q, &outer_dims, rows, cols, src_stride, dst_stride,
+               tile_size, row_tiles, col_tiles](int64 start_tile,
+                                                int64 end_tile) {
+    for (int64 tile = start_tile; tile < end_tile; ++tile) {
+      // Consecutive tiles extend the same output rows.
+      const int64 row_tile = tile % row_tiles;
+      const int64 col_tile = tile / row_tiles % col_tiles;
+      int64 in_offset;
+      int64 out_offset;
+      TransposeOuterOffsets(outer_dims, tile / (row_tiles * col_tiles),
+                            &in_offset, &out_offset);
+      const int64 row = row_tile * tile_size;
+      const int64 col = col_tile * tile_size;
+      DispatchedTransposeTile<T>::run(
+          p + in_offset + row * src_stride + col, src_stride,
+          std::min(tile_size, rows - row), std::min(tile_size, cols - col),
+          q + out_offset + col * dst_stride + row, dst_stride);
+    }
+  };
+  const int64 tile_bytes = tile_size * tile_size * sizeof(T);
+  d.parallelFor(num_tiles, Eigen::TensorOpCost(tile_bytes, tile_bytes, 0),
+                work);
+}
+
+}  // end namespace internal
 
 template <typename T>
 struct Transpose<CPUDevice, T> {
+  static void run(const CPUDevice& d, const Tensor& in,
+                  const gtl::ArraySlice<int32> perm, Tensor* out) {
+    internal::TransposeUsingTiles<T>(d, in, perm, out);
+  }
+};
+
+// Strings are not trivially copyable.
+template <>
+struct Transpose<CPUDevice, string> {
   static void run(const CPUDevice& d, const Tensor& in,
                   const gtl::ArraySlice<int32> perm, Tensor* out) {
     switch (in.dims()) {
       case 2:
-        internal::TransposeUsingEigen<CPUDevice, T, 2>(d, in, perm, out);
+        internal::TransposeUsingEigen<CPUDevice, string, 2>(d, in, perm, out);
         break;
       case 3:
-        internal::TransposeUsingEigen<CPUDevice, T, 3>(d, in, perm, out);
+        internal::TransposeUsingEigen<CPUDevice, string, 3>(d, in, perm, out);
         break;
       case 4:
-        internal::TransposeUsingEigen<CPUDevice, T, 4>(d, in, perm, out);
+        internal::TransposeUsingEigen<CPUDevice, string, 4>(d, in, perm, out);
         break;
       case 5:
-        internal::TransposeUsingEigen<CPUDevice, T, 5>(d, in, perm, out);
+        internal::TransposeUsingEigen<CPUDevice, string, 5>(d, in, perm, out);
         break;
       default:
-        internal::TransposeSimple<CPUDevice, T>(d, in, perm, out);
+        internal::TransposeSimple<CPUDevice, string>(d, in, perm, out);
         break;
     }
   }
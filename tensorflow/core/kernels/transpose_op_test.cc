@@ -0,0 +1,195 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class TransposeOpTest : public OpsTestBase {
+ protected:
+  // Transposes a tensor of 'shape' filled with 0, 1, 2, ... and checks the
+  // result against the output computed one element at a time.
+  template <typename T>
+  void TestTranspose(const TensorShape& shape, const std::vector<int32>& perm) {
+    TF_ASSERT_OK(NodeDefBuilder("transpose", "Transpose")
+                     .Input(FakeInput(DataTypeToEnum<T>::value))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    const int64 nelem = shape.num_elements();
+    AddInput<T>(shape, [](int i) -> T { return static_cast<T>(i); });
+    AddInputFromArray<int32>(TensorShape({static_cast<int64>(perm.size())}),
+                             perm);
+    TF_ASSERT_OK(RunOpKernel());
+
+    TensorShape out_shape;
+    for (int32 d : perm) out_shape.AddDim(shape.dim_size(d));
+    Tensor expected(allocator(), DataTypeToEnum<T>::value, out_shape);
+    const int ndims = shape.dims();
+    std::vector<int64> in_strides(ndims, 1);
+    for (int i = ndims - 2; i >= 0; --i) {
+      in_strides[i] = in_strides[i + 1] * shape.dim_size(i + 1);
+    }
+    auto expected_flat = expected.flat<T>();
+    for (int64 o = 0; o < nelem; ++o) {
+      int64 in_index = 0;
+      int64 t = o;
+      for (int i = ndims - 1; i >= 0; --i) {
+        in_index += t % out_shape.dim_size(i) * in_strides[perm[i]];
+        t /= out_shape.dim_size(i);
+      }
+      expected_flat(o) = static_cast<T>(in_index);
+    }
+    test::ExpectTensorEqual<T>(expected, *GetOutput(0));
+  }
+};
+
+TEST_F(TransposeOpTest, Matrix) {
+  TestTranspose<float>(TensorShape({100, 67}), {1, 0});
+}
+
+TEST_F(TransposeOpTest, NHWCToNCHW) {
+  TestTranspose<float>(TensorShape({2, 37, 41, 19}), {0, 3, 1, 2});
+}
+
+TEST_F(TransposeOpTest, NCHWToNHWC) {
+  TestTranspose<float>(TensorShape({3, 19, 70, 33}), {0, 2, 3, 1});
+}
+
+TEST_F(TransposeOpTest, ReverseDims) {
+  TestTranspose<float>(TensorShape({4, 5, 6}), {2, 1, 0});
+}
+
+TEST_F(TransposeOpTest, InnermostDimUnchanged) {
+  TestTranspose<float>(TensorShape({4, 5, 6}), {1, 0, 2});
+}
+
+TEST_F(TransposeOpTest, MergedDims) {
+  TestTranspose<float>(TensorShape({2, 3, 4, 5, 6}), {0, 4, 1, 2, 3});
+}
+
+TEST_F(TransposeOpTest, SizeOneDims) {
+  TestTranspose<float>(TensorShape({7, 1, 5, 1, 9}), {4, 3, 2, 1, 0});
+}
+
+TEST_F(TransposeOpTest, SixDims) {
+  TestTranspose<float>(TensorShape({2, 3, 2, 3, 2, 3}), {5, 3, 1, 4, 2, 0});
+}
+
+TEST_F(TransposeOpTest, LargeStrides) {
+  TestTranspose<float>(TensorShape({1100, 1300}), {1, 0});
+}
+
+TEST_F(TransposeOpTest, Uint8) {
+  TestTranspose<uint8>(TensorShape({3, 70, 90}), {0, 2, 1});
+}
+
+TEST_F(TransposeOpTest, Int16) {
+  TestTranspose<int16>(TensorShape({3, 70, 90}), {2, 1, 0});
+}
+
+TEST_F(TransposeOpTest, Double) {
+  TestTranspose<double>(TensorShape({5, 33, 47}), {0, 2, 1});
+}
+
+TEST_F(TransposeOpTest, Complex128) {
+  TestTranspose<complex128>(TensorShape({5, 33, 47}), {2, 0, 1});
+}
+
+static Graph* Transpose(const TensorShape& shape,
+                        const std::vector<int32>& perm) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, shape);
+  input.flat<float>().setRandom();
+  Tensor perm_tensor(DT_INT32, TensorShape({static_cast<int64>(perm.size())}));
+  std::copy(perm.begin(), perm.end(), perm_tensor.flat<int32>().data());
+  test::graph::Binary(g, "Transpose", test::graph::Constant(g, input),
+                      test::graph::Constant(g, perm_tensor));
+  return g;
+}
+
+static void RunTransposeBenchmark(int iters, const TensorShape& shape,
+                                  const std::vector<int32>& perm) {
+  const int64 tot = static_cast<int64>(iters) * shape.num_elements();
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(2 * tot * sizeof(float));
+  testing::UseRealTime();
+  test::Benchmark("cpu", Transpose(shape, perm)).Run(iters);
+}
+
+static void BM_Transpose2D(int iters, int rows, int cols) {
+  RunTransposeBenchmark(iters, TensorShape({rows, cols}), {1, 0});
+}
+
+BENCHMARK(BM_Transpose2D)
+    ->ArgPair(128, 128)
+    ->ArgPair(1024, 1024)
+    ->ArgPair(4096, 4096)
+    ->ArgPair(1000, 7)
+    ->ArgPair(7, 1000);
+
+// NHWC to NCHW for a batch of 32 images of size x size pixels.
+static void BM_TransposeNHWCToNCHW(int iters, int size, int channels) {
+  RunTransposeBenchmark(iters, TensorShape({32, size, size, channels}),
+                        {0, 3, 1, 2});
+}
+
+BENCHMARK(BM_TransposeNHWCToNCHW)
+    ->ArgPair(224, 3)
+    ->ArgPair(56, 64)
+    ->ArgPair(28, 256)
+    ->ArgPair(7, 2048);
+
+static void BM_TransposeNCHWToNHWC(int iters, int size, int channels) {
+  RunTransposeBenchmark(iters, TensorShape({32, channels, size, size}),
+                        {0, 2, 3, 1});
+}
+
+BENCHMARK(BM_TransposeNCHWToNHWC)
+    ->ArgPair(224, 3)
+    ->ArgPair(56, 64)
+    ->ArgPair(28, 256)
+    ->ArgPair(7, 2048);
+
+// NDHWC to NCDHW for a batch of 8 volumes of size^3 voxels.
+static void BM_TransposeNDHWCToNCDHW(int iters, int size, int channels) {
+  RunTransposeBenchmark(iters, TensorShape({8, size, size, size, channels}),
+                        {0, 4, 1, 2, 3});
+}
+
+BENCHMARK(BM_TransposeNDHWCToNCDHW)->ArgPair(16, 32)->ArgPair(32, 64);
+
+// Swaps the two outer dimensions, keeping rows of 'cols' elements intact.
+static void BM_TransposeOuterDims(int iters, int rows, int cols) {
+  RunTransposeBenchmark(iters, TensorShape({64, rows, cols}), {1, 0, 2});
+}
+
+BENCHMARK(BM_TransposeOuterDims)->ArgPair(512, 4)->ArgPair(512, 256);
+
+}  // namespace
+}  // namespace tensorflow
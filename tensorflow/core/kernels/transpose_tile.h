@@ -0,0 +1,43 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_TRANSPOSE_TILE_H_
+#define TENSORFLOW_KERNELS_TRANSPOSE_TILE_H_
+
+// Versions of the tile copy of transpose_functor_cpu.cc for 4-byte elements
+// that are compiled for wider instruction sets, and selected at runtime as
+// described in cpu_dispatch.h.
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace internal {
+
+// Copies the [rows, cols] matrix at 'src', whose rows are 'src_stride'
+// elements apart, to its transpose at 'dst', whose rows are 'dst_stride'
+// elements apart.
+typedef void (*TransposeTile32Function)(const uint32* src, int64 src_stride,
+                                        int64 rows, int64 cols, uint32* dst,
+                                        int64 dst_stride);
+
+// Defined in transpose_tile_avx2.cc. Returns nullptr when the file was
+// compiled without AVX2. There is no AVX-512 version: 16x16 blocks were no
+// faster than 8x8 ones, as the tiles are bound by the strided accesses.
+TransposeTile32Function GetAvx2TransposeTile32();
+
+}  // namespace internal
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_TRANSPOSE_TILE_H_
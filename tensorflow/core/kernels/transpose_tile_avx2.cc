@@ -0,0 +1,110 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// AVX2 version of the 4-byte tile copy of transpose_functor_cpu.cc. This file
+// is compiled with -mavx2 -mfma on x86, and must only use intrinsics and the
+// functions defined here; see cpu_dispatch.h.
+
+#include "tensorflow/core/kernels/transpose_tile.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+namespace internal {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+namespace {
+
+// Transposes the 8x8 block whose rows are in r[0..7]. The elements are only
+// moved, so integers may be loaded as floats.
+inline void Transpose8x8(__m256* r) {
+  const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+  const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+  const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+  const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+  const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+  const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+  const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+  // Within each 128-bit half, s<k> holds column k of rows 0-3 or 4-7.
+  const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+  r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+  r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+  r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+  r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+  r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+  r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+  r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+void TransposeScalar(const uint32* src, int64 src_stride, int64 rows,
+                     int64 cols, uint32* dst, int64 dst_stride) {
+  for (int64 i = 0; i < rows; ++i) {
+    for (int64 j = 0; j < cols; ++j) {
+      dst[j * dst_stride + i] = src[i * src_stride + j];
+    }
+  }
+}
+
+void TransposeTile32(const uint32* src, int64 src_stride, int64 rows,
+                     int64 cols, uint32* dst, int64 dst_stride) {
+  const int64 vectorized_rows = rows / 8 * 8;
+  const int64 vectorized_cols = cols / 8 * 8;
+  for (int64 i = 0; i < vectorized_rows; i += 8) {
+    for (int64 j = 0; j < vectorized_cols; j += 8) {
+      __m256 block[8];
+      for (int k = 0; k < 8; ++k) {
+        block[k] = _mm256_loadu_ps(
+            reinterpret_cast<const float*>(src + (i + k) * src_stride + j));
+      }
+      Transpose8x8(block);
+      for (int k = 0; k < 8; ++k) {
+        _mm256_storeu_ps(
+            reinterpret_cast<float*>(dst + (j + k) * dst_stride + i),
+            block[k]);
+      }
+    }
+  }
+  TransposeScalar(src + vectorized_cols, src_stride, vectorized_rows,
+                  cols - vectorized_cols, dst + vectorized_cols * dst_stride,
+                  dst_stride);
+  TransposeScalar(src + vectorized_rows * src_stride, src_stride,
+                  rows - vectorized_rows, cols, dst + vectorized_rows,
+                  dst_stride);
+}
+
+}  // namespace
+
+TransposeTile32Function GetAvx2TransposeTile32() { return TransposeTile32; }
+
+#else
+
+TransposeTile32Function GetAvx2TransposeTile32() { return nullptr; }
+
+#endif  // defined(__AVX2__) && defined(__FMA__)
+
+}  // namespace internal
+}  // namespace tensorflow
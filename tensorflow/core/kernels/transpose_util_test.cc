@@ -13,9 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <vector>
+
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/cpu_dispatch.h"
 #include "tensorflow/core/kernels/transpose_functor.h"
+#include "tensorflow/core/kernels/transpose_tile.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -130,4 +134,30 @@ TEST_F(TransposeUtilTest, NonSingletonDimensionAlignment) {
                                                      {0, 1, 2, 5, 4, 3}));
 }
 
+TEST_F(TransposeUtilTest, Avx2TransposeTile32) {
+  const internal::TransposeTile32Function tile =
+      internal::GetAvx2TransposeTile32();
+  if (tile == nullptr || !cpu_dispatch::CPUSupports(cpu_dispatch::kAvx2)) {
+    return;
+  }
+  const int64 kStride = 40;
+  std::vector<uint32> src(kStride * kStride);
+  for (size_t i = 0; i < src.size(); ++i) src[i] = i;
+  for (int64 rows = 0; rows <= 33; ++rows) {
+    for (int64 cols = 0; cols <= 33; ++cols) {
+      std::vector<uint32> dst(kStride * kStride, 0xdeadbeef);
+      tile(src.data(), kStride, rows, cols, dst.data(), kStride);
+      for (int64 i = 0; i < kStride; ++i) {
+        for (int64 j = 0; j < kStride; ++j) {
+          const uint32 expected =
+              j < rows && i < cols ? src[j * kStride + i] : 0xdeadbeef;
+          ASSERT_EQ(expected, dst[i * kStride + j])
+              << "rows=" << rows << " cols=" << cols << " i=" << i
+              << " j=" << j;
+        }
+      }
+    }
+  }
+}
+
 }  // namespace tensorflow
@@ -13,22 +13,59 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include <unordered_map>
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/flatmap.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
 
+namespace {
+
+// FlatMap takes the probe position from the upper bits of the hash and the
+// bucket marker from the low byte, but std::hash is the identity for integers.
+// Mix the bits so that small, dense ids spread over the whole table.
+template <typename T>
+struct UniqueHash {
+  size_t operator()(const T& v) const {
+    uint64 h = static_cast<uint64>(hash<T>()(v));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+};
+
+template <>
+struct UniqueHash<string> : hash<string> {};
+
+// Inputs with fewer elements than this are deduplicated on a single thread.
+const int64 kMinParallelSize = 64 * 1024;
+
+// Minimum number of elements handled by one chunk of the parallel path.
+const int64 kMinChunkSize = 16 * 1024;
+
+// Rough cost, in cycles, of one hash table lookup or insertion.
+const int64 kCostPerLookup = 50;
+
+}  // namespace
+
 template <typename T>
 class UniqueOp : public OpKernel {
  public:
+  // Open-addressing table from value to its index in the output.
+  typedef gtl::FlatMap<T, int32, UniqueHash<T>> UniqueMap;
+
   explicit UniqueOp(OpKernelConstruction* context) : OpKernel(context) {}
 
   void Compute(OpKernelContext* context) override {
@@ -50,32 +87,120 @@ class UniqueOp : public OpKernel {
                                 {0}, 1, input.shape(), &idx));
     auto idx_vec = idx->template vec<int32>();
 
-    std::unordered_map<T, int32> uniq;
-    uniq.reserve(2 * N);
-    for (int64 i = 0, j = 0; i < N; ++i) {
-      auto it = uniq.insert(std::make_pair(Tin(i), j));
-      idx_vec(i) = it.first->second;
-      if (it.second) {
-        ++j;
+    const bool with_counts = num_outputs() > 2;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int64 num_chunks =
+        std::min<int64>(worker_threads.num_threads, N / kMinChunkSize);
+    if (N < kMinParallelSize || num_chunks < 2) {
+      UniqueMap uniq;
+      for (int64 i = 0, j = 0; i < N; ++i) {
+        auto it = uniq.insert(std::make_pair(Tin(i), j));
+        idx_vec(i) = it.first->second;
+        if (it.second) {
+          ++j;
+        }
+      }
+      int64 uniq_size = static_cast<int64>(uniq.size());
+      Tensor* output = nullptr;
+      OP_REQUIRES_OK(context, context->allocate_output(
+                                  0, TensorShape({uniq_size}), &output));
+      auto output_vec = output->template vec<T>();
+
+      for (const auto& it : uniq) {
+        output_vec(it.second) = it.first;
+      }
+
+      if (with_counts) {
+        OP_REQUIRES_OK(context, context->allocate_output(
+                                    2, TensorShape({uniq_size}), &output));
+        auto count_output_vec = output->template vec<int32>();
+        count_output_vec.setZero();
+        for (int64 i = 0; i < N; ++i) {
+          count_output_vec(idx_vec(i))++;
+        }
+      }
+      return;
+    }
+
+    // Two-phase path for large inputs.  The input is split into contiguous
+    // chunks, each deduplicated in parallel into a chunk-local table that
+    // records its values in order of first occurrence; idx temporarily holds
+    // the chunk-local ids.  The chunk-local values are then merged serially,
+    // in chunk order, which preserves the global order of first occurrence.
+    // Finally the local ids in idx are remapped to global ids in parallel.
+    //
+    // idx may share its buffer with the input (for int32), so each chunk only
+    // reads Tin(i) before writing idx_vec(i) at the same position.
+    std::vector<std::vector<T>> chunk_values(num_chunks);
+    std::vector<std::vector<int32>> chunk_counts(num_chunks);
+    auto chunk_begin = [N, num_chunks](int64 c) { return N * c / num_chunks; };
+    const int64 cost_per_chunk = (N / num_chunks) * kCostPerLookup;
+
+    Shard(worker_threads.num_threads, worker_threads.workers, num_chunks,
+          cost_per_chunk, [&](int64 begin, int64 end) {
+            for (int64 c = begin; c < end; ++c) {
+              std::vector<T>& values = chunk_values[c];
+              std::vector<int32>& counts = chunk_counts[c];
+              UniqueMap local;
+              for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                const int32 next = static_cast<int32>(values.size());
+                auto it = local.insert(std::make_pair(Tin(i), next));
+                if (it.second) {
+                  values.push_back(Tin(i));
+                  counts.push_back(0);
+                }
+                const int32 id = it.first->second;
+                idx_vec(i) = id;
+                ++counts[id];
+              }
+            }
+          });
+
+    UniqueMap uniq;
+    std::vector<T> uniq_values;
+    std::vector<int32> uniq_counts;
+    std::vector<std::vector<int32>> remap(num_chunks);
+    for (int64 c = 0; c < num_chunks; ++c) {
+      const std::vector<T>& values = chunk_values[c];
+      remap[c].resize(values.size());
+      for (size_t j = 0; j < values.size(); ++j) {
+        const int32 next = static_cast<int32>(uniq_values.size());
+        auto it = uniq.insert(std::make_pair(values[j], next));
+        if (it.second) {
+          uniq_values.push_back(values[j]);
+          uniq_counts.push_back(0);
+        }
+        remap[c][j] = it.first->second;
+        uniq_counts[it.first->second] += chunk_counts[c][j];
       }
     }
-    int64 uniq_size = static_cast<int64>(uniq.size());
+
+    Shard(worker_threads.num_threads, worker_threads.workers, num_chunks,
+          N / num_chunks, [&](int64 begin, int64 end) {
+            for (int64 c = begin; c < end; ++c) {
+              const std::vector<int32>& ids = remap[c];
+              for (int64 i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                idx_vec(i) = ids[idx_vec(i)];
+              }
+            }
+          });
+
+    const int64 uniq_size = static_cast<int64>(uniq_values.size());
     Tensor* output = nullptr;
     OP_REQUIRES_OK(context, context->allocate_output(
                                 0, TensorShape({uniq_size}), &output));
     auto output_vec = output->template vec<T>();
-
-    for (auto it : uniq) {
-      output_vec(it.second) = it.first;
+    for (int64 j = 0; j < uniq_size; ++j) {
+      output_vec(j) = uniq_values[j];
     }
 
-    if (num_outputs() > 2) {
+    if (with_counts) {
       OP_REQUIRES_OK(context, context->allocate_output(
                                   2, TensorShape({uniq_size}), &output));
       auto count_output_vec = output->template vec<int32>();
-      count_output_vec.setZero();
-      for (int64 i = 0; i < N; ++i) {
-        count_output_vec(idx_vec(i))++;
+      for (int64 j = 0; j < uniq_size; ++j) {
+        count_output_vec(j) = uniq_counts[j];
       }
     }
   }
@@ -15,8 +15,12 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
@@ -25,7 +29,11 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -62,6 +70,97 @@ TensorProto GetRandomInt32TensorProtoWithRepeat(int dim, int repeat,
   return tensor_proto;
 }
 
+// Runs Unique and UniqueWithCounts on inputs large enough for the parallel
+// two-phase path, with several intra-op threads, and compares against a
+// serial reference.
+class UniqueOpTest : public OpsTestBase {
+ protected:
+  UniqueOpTest() : pool_(Env::Default(), "unique_test", kNumThreads) {
+    workers_.num_threads = kNumThreads;
+    workers_.workers = &pool_;
+    device_->set_tensorflow_cpu_worker_threads(&workers_);
+  }
+
+  void MakeOp(const string& op, DataType dtype) {
+    TF_ASSERT_OK(NodeDefBuilder("unique", op)
+                     .Input(FakeInput(dtype))
+                     .Attr("out_idx", DT_INT32)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Expects outputs in order of first occurrence of "values", and the counts
+  // as output 2 if "with_counts".
+  template <typename T>
+  void ExpectUnique(const std::vector<T>& values, bool with_counts) {
+    std::unordered_map<T, int32> ids;
+    std::vector<T> expected_y;
+    std::vector<int32> expected_idx, expected_count;
+    for (const T& v : values) {
+      const int32 next = expected_y.size();
+      auto it = ids.insert(std::make_pair(v, next)).first;
+      if (it->second == next) {
+        expected_y.push_back(v);
+        expected_count.push_back(0);
+      }
+      expected_idx.push_back(it->second);
+      ++expected_count[it->second];
+    }
+    const int64 n = expected_y.size();
+    test::ExpectTensorEqual<T>(*GetOutput(0),
+                               test::AsTensor<T>(expected_y, {n}));
+    test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                   test::AsTensor<int32>(expected_idx));
+    if (with_counts) {
+      test::ExpectTensorEqual<int32>(*GetOutput(2),
+                                     test::AsTensor<int32>(expected_count));
+    }
+  }
+
+  static const int kNumThreads = 4;
+  thread::ThreadPool pool_;
+  DeviceBase::CpuWorkerThreads workers_;
+};
+
+// Returns "n" values in [0, max) that are heavily repeated, with some values
+// first seen in every chunk of the parallel path.
+template <typename T>
+std::vector<T> RepeatedValues(int n, int max) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<T> values(n);
+  for (int i = 0; i < n; ++i) {
+    values[i] = static_cast<T>(rnd.Uniform(1 + i % max));
+  }
+  return values;
+}
+
+TEST_F(UniqueOpTest, ParallelUniqueWithCountsInt64) {
+  MakeOp("UniqueWithCounts", DT_INT64);
+  const std::vector<int64> values = RepeatedValues<int64>(300000, 50000);
+  AddInputFromArray<int64>(TensorShape({300000}), values);
+  TF_ASSERT_OK(RunOpKernel());
+  ExpectUnique(values, true);
+}
+
+// int32 inputs may share their buffer with idx.
+TEST_F(UniqueOpTest, ParallelUniqueInt32) {
+  MakeOp("Unique", DT_INT32);
+  const std::vector<int32> values = RepeatedValues<int32>(200000, 70000);
+  AddInputFromArray<int32>(TensorShape({200000}), values);
+  TF_ASSERT_OK(RunOpKernel());
+  ExpectUnique(values, false);
+}
+
+TEST_F(UniqueOpTest, ParallelAllDistinct) {
+  MakeOp("UniqueWithCounts", DT_INT64);
+  std::vector<int64> values(100000);
+  for (int i = 0; i < 100000; ++i) values[i] = 100000 - i;
+  AddInputFromArray<int64>(TensorShape({100000}), values);
+  TF_ASSERT_OK(RunOpKernel());
+  ExpectUnique(values, true);
+}
+
 static void BM_Unique_INT32(int iters, int dim, int max_int) {
   testing::StopTiming();
   Graph* g = new Graph(OpRegistry::Global());
@@ -138,6 +237,83 @@ static void BM_Unique_STRING(int iters, int dim) {
   test::Benchmark("cpu", g).Run(iters);
 }
 
+static SessionOptions ThreadedOptions(int num_threads) {
+  SessionOptions opts;
+  opts.config.set_intra_op_parallelism_threads(num_threads);
+  opts.config.set_inter_op_parallelism_threads(1);
+  return opts;
+}
+
+// Embedding-style ids: dim draws from a Zipf-like distribution over
+// [0, max_int), so a few ids repeat often and most appear once or not at all.
+Tensor GetZipfInt64Tensor(int dim, int max_int) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor t(DT_INT64, TensorShape({dim}));
+  auto ids = t.vec<int64>();
+  for (int i = 0; i < dim; ++i) {
+    ids(i) = rnd.Skewed(30) % max_int;
+  }
+  return t;
+}
+
+const int kZipfDim = 1024 * 1024;
+
+static void BM_Unique_INT64_Zipf(int iters, int num_threads, int max_int) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input = GetZipfInt64Tensor(kZipfDim, max_int);
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "UniqueWithCounts")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Finalize(g, &node));
+
+  SessionOptions opts = ThreadedOptions(num_threads);
+  testing::BytesProcessed(static_cast<int64>(iters) * kZipfDim *
+                          sizeof(int64));
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g, &opts).Run(iters);
+}
+
+// Reference point: the same input deduplicated the way the kernel used to,
+// with a std::unordered_map on a single thread.
+static void BM_Unique_INT64_Zipf_UnorderedMap(int iters, int max_int) {
+  testing::StopTiming();
+  Tensor input = GetZipfInt64Tensor(kZipfDim, max_int);
+  auto ids = input.vec<int64>();
+  std::vector<int32> idx(kZipfDim);
+  testing::BytesProcessed(static_cast<int64>(iters) * kZipfDim *
+                          sizeof(int64));
+  testing::StartTiming();
+  for (int it = 0; it < iters; ++it) {
+    std::unordered_map<int64, int32> uniq;
+    uniq.reserve(2 * kZipfDim);
+    for (int64 i = 0, j = 0; i < kZipfDim; ++i) {
+      auto res = uniq.insert(std::make_pair(ids(i), j));
+      idx[i] = res.first->second;
+      if (res.second) {
+        ++j;
+      }
+    }
+    CHECK_GE(idx[kZipfDim - 1], 0);
+  }
+}
+
+BENCHMARK(BM_Unique_INT64_Zipf)
+    ->ArgPair(1, 64 * 1024)
+    ->ArgPair(4, 64 * 1024)
+    ->ArgPair(16, 64 * 1024)
+    ->ArgPair(1, 16 * 1024 * 1024)
+    ->ArgPair(4, 16 * 1024 * 1024)
+    ->ArgPair(16, 16 * 1024 * 1024);
+
+BENCHMARK(BM_Unique_INT64_Zipf_UnorderedMap)
+    ->Arg(64 * 1024)
+    ->Arg(16 * 1024 * 1024);
+
 BENCHMARK(BM_Unique_INT32)
     ->ArgPair(32, 1024 * 1024)
     ->ArgPair(256, 1024 * 1024)
@@ -0,0 +1,40 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+namespace tensorflow {
+namespace vectorized_math {
+
+FloatFunction GetFloatFunction(Function f, cpu_dispatch::InstructionSet isa) {
+  if (!cpu_dispatch::CPUSupports(isa)) return nullptr;
+  switch (isa) {
+    case cpu_dispatch::kAvx2:
+      return internal::GetAvx2FloatFunction(f);
+    case cpu_dispatch::kAvx512:
+      return internal::GetAvx512FloatFunction(f);
+    default:
+      return nullptr;
+  }
+}
+
+FloatFunction GetFloatFunction(Function f) {
+  return cpu_dispatch::Select<FloatFunction>(
+      nullptr, GetFloatFunction(f, cpu_dispatch::kAvx2),
+      GetFloatFunction(f, cpu_dispatch::kAvx512));
+}
+
+}  // namespace vectorized_math
+}  // namespace tensorflow
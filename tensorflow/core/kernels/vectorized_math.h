@@ -0,0 +1,64 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_VECTORIZED_MATH_H_
+#define TENSORFLOW_KERNELS_VECTORIZED_MATH_H_
+
+// Vectorized float transcendental functions for CPU kernels.
+//
+// Binaries are usually built for a baseline instruction set, so Eigen's
+// packet math runs with 128-bit SSE vectors at best, and falls back to
+// scalar libm calls for functions it does not vectorize, such as erf. The
+// functions here are also compiled for AVX2 and AVX-512, and selected at
+// runtime as described in cpu_dispatch.h.
+//
+// Errors, in units in the last place (ulp) of the float result and measured
+// against the exact result in double precision, are at most 1.5 ulp for Exp,
+// Log, Tanh and Erf, and 3 ulp for Sigmoid. Denormal results, infinities and
+// NaNs are handled as in the C library.
+
+#include "tensorflow/core/kernels/cpu_dispatch.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace vectorized_math {
+
+enum Function { kExp, kLog, kTanh, kSigmoid, kErf, kNumFunctions };
+
+// Computes out[i] = f(in[i]) for i in [0, n). 'in' and 'out' may be the same
+// array.
+typedef void (*FloatFunction)(const float* in, float* out, int64 n);
+
+// Returns the implementation of 'f' for 'isa', or nullptr if 'isa' is
+// kBaseline, this binary was not built with code for 'isa' or the CPU does
+// not support it.
+FloatFunction GetFloatFunction(Function f, cpu_dispatch::InstructionSet isa);
+
+// Returns the implementation of 'f' that cpu_dispatch::Select() picks, or
+// nullptr if there is none and callers should use Eigen instead.
+FloatFunction GetFloatFunction(Function f);
+
+namespace internal {
+
+// Defined in vectorized_math_avx2.cc and vectorized_math_avx512.cc. Return
+// nullptr when the file was compiled without the instruction set.
+FloatFunction GetAvx2FloatFunction(Function f);
+FloatFunction GetAvx512FloatFunction(Function f);
+
+}  // namespace internal
+}  // namespace vectorized_math
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_VECTORIZED_MATH_H_
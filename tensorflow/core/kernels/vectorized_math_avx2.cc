@@ -0,0 +1,112 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// AVX2 and FMA versions of the functions in vectorized_math.h. This file is
+// compiled with -mavx2 -mfma on x86; see vectorized_math_impl.h for what it
+// may include.
+
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+#include "tensorflow/core/kernels/vectorized_math_impl.h"
+#endif
+
+namespace tensorflow {
+namespace vectorized_math {
+namespace internal {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+namespace {
+
+struct Avx2Ops {
+  typedef __m256 Packet;
+  typedef __m256 Mask;
+  static const int kSize = 8;
+
+  static inline Packet Set1(float x) { return _mm256_set1_ps(x); }
+  static inline Packet Load(const float* p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float* p, Packet a) { _mm256_storeu_ps(p, a); }
+  static inline Packet Add(Packet a, Packet b) { return _mm256_add_ps(a, b); }
+  static inline Packet Sub(Packet a, Packet b) { return _mm256_sub_ps(a, b); }
+  static inline Packet Mul(Packet a, Packet b) { return _mm256_mul_ps(a, b); }
+  static inline Packet Div(Packet a, Packet b) { return _mm256_div_ps(a, b); }
+  static inline Packet MulAdd(Packet a, Packet b, Packet c) {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  static inline Packet Min(Packet a, Packet b) { return _mm256_min_ps(a, b); }
+  static inline Packet Max(Packet a, Packet b) { return _mm256_max_ps(a, b); }
+  static inline Packet Round(Packet a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static inline Packet Abs(Packet a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+  }
+  static inline Packet CopySign(Packet magnitude, Packet sign) {
+    const Packet sign_bit = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(sign_bit, magnitude),
+                        _mm256_and_ps(sign_bit, sign));
+  }
+  static inline Mask Less(Packet a, Packet b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask Equal(Packet a, Packet b) {
+    return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+  }
+  static inline Mask IsNan(Packet a) {
+    return _mm256_cmp_ps(a, a, _CMP_UNORD_Q);
+  }
+  static inline Packet Select(Mask mask, Packet if_true, Packet if_false) {
+    return _mm256_blendv_ps(if_false, if_true, mask);
+  }
+  // Multiplies by 2^(n / 2) and 2^(n - n / 2), which are both normal.
+  static inline Packet Ldexp(Packet a, Packet n) {
+    const __m256i e = _mm256_cvtps_epi32(n);
+    const __m256i e1 = _mm256_srai_epi32(e, 1);
+    const __m256i e2 = _mm256_sub_epi32(e, e1);
+    const __m256i bias = _mm256_set1_epi32(127);
+    const Packet pow1 =
+        _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(e1, bias), 23));
+    const Packet pow2 =
+        _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(e2, bias), 23));
+    return _mm256_mul_ps(_mm256_mul_ps(a, pow1), pow2);
+  }
+  static inline Packet Frexp(Packet a, Packet* e) {
+    const __m256i bits = _mm256_castps_si256(a);
+    *e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+                                             _mm256_set1_epi32(126)));
+    return _mm256_castsi256_ps(
+        _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                        _mm256_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+FloatFunction GetAvx2FloatFunction(Function f) {
+  return GetFloatFunctionFor<Avx2Ops>(f);
+}
+
+#else
+
+FloatFunction GetAvx2FloatFunction(Function f) { return nullptr; }
+
+#endif  // defined(__AVX2__) && defined(__FMA__)
+
+}  // namespace internal
+}  // namespace vectorized_math
+}  // namespace tensorflow
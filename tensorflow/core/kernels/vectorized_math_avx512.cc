@@ -0,0 +1,107 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// AVX-512F versions of the functions in vectorized_math.h. This file is
+// compiled with -mavx512f on x86; see vectorized_math_impl.h for what it may
+// include.
+
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+#include "tensorflow/core/kernels/vectorized_math_impl.h"
+#endif
+
+namespace tensorflow {
+namespace vectorized_math {
+namespace internal {
+
+#ifdef __AVX512F__
+
+namespace {
+
+struct Avx512Ops {
+  typedef __m512 Packet;
+  typedef __mmask16 Mask;
+  static const int kSize = 16;
+
+  static inline Packet Set1(float x) { return _mm512_set1_ps(x); }
+  static inline Packet Load(const float* p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float* p, Packet a) { _mm512_storeu_ps(p, a); }
+  static inline Packet Add(Packet a, Packet b) { return _mm512_add_ps(a, b); }
+  static inline Packet Sub(Packet a, Packet b) { return _mm512_sub_ps(a, b); }
+  static inline Packet Mul(Packet a, Packet b) { return _mm512_mul_ps(a, b); }
+  static inline Packet Div(Packet a, Packet b) { return _mm512_div_ps(a, b); }
+  static inline Packet MulAdd(Packet a, Packet b, Packet c) {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  static inline Packet Min(Packet a, Packet b) { return _mm512_min_ps(a, b); }
+  static inline Packet Max(Packet a, Packet b) { return _mm512_max_ps(a, b); }
+  static inline Packet Round(Packet a) {
+    return _mm512_roundscale_ps(a,
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  // AVX-512F has no bitwise operations on floats, only on integers.
+  static inline Packet Abs(Packet a) {
+    return _mm512_castsi512_ps(_mm512_and_si512(
+        _mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff)));
+  }
+  static inline Packet CopySign(Packet magnitude, Packet sign) {
+    const __m512i abs_mask = _mm512_set1_epi32(0x7fffffff);
+    return _mm512_castsi512_ps(_mm512_or_si512(
+        _mm512_and_si512(_mm512_castps_si512(magnitude), abs_mask),
+        _mm512_andnot_si512(abs_mask, _mm512_castps_si512(sign))));
+  }
+  static inline Mask Less(Packet a, Packet b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+  }
+  static inline Mask Equal(Packet a, Packet b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+  }
+  static inline Mask IsNan(Packet a) {
+    return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q);
+  }
+  static inline Packet Select(Mask mask, Packet if_true, Packet if_false) {
+    return _mm512_mask_blend_ps(mask, if_false, if_true);
+  }
+  static inline Packet Ldexp(Packet a, Packet n) {
+    return _mm512_scalef_ps(a, n);
+  }
+  static inline Packet Frexp(Packet a, Packet* e) {
+    const __m512i bits = _mm512_castps_si512(a);
+    *e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23),
+                                             _mm512_set1_epi32(126)));
+    return _mm512_castsi512_ps(
+        _mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                        _mm512_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+FloatFunction GetAvx512FloatFunction(Function f) {
+  return GetFloatFunctionFor<Avx512Ops>(f);
+}
+
+#else
+
+FloatFunction GetAvx512FloatFunction(Function f) { return nullptr; }
+
+#endif  // __AVX512F__
+
+}  // namespace internal
+}  // namespace vectorized_math
+}  // namespace tensorflow
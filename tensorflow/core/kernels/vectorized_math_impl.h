@@ -0,0 +1,236 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_VECTORIZED_MATH_IMPL_H_
+#define TENSORFLOW_KERNELS_VECTORIZED_MATH_IMPL_H_
+
+// The functions of vectorized_math.h, written once against a small set of
+// packet operations. Each of vectorized_math_avx2.cc and
+// vectorized_math_avx512.cc defines those operations with intrinsics in an
+// anonymous namespace and instantiates the templates below with them.
+//
+// Only those files may include this header, and they must not call inline
+// functions defined in other headers: the linker keeps one copy of each
+// inline function, which could then be one compiled with instructions the
+// CPU lacks.
+//
+// The operations class 'Ops' provides, for a packet type Packet of kSize
+// floats and a comparison result type Mask:
+//
+//   Set1(x), Load(p), Store(p, a), Add(a, b), Sub(a, b), Mul(a, b),
+//   Div(a, b), MulAdd(a, b, c) = a * b + c, Min(a, b), Max(a, b),
+//   Round(a) to the nearest integer, Abs(a), CopySign(magnitude, sign),
+//   Less(a, b), Equal(a, b), IsNan(a), Select(mask, if_true, if_false),
+//   Ldexp(a, n) = a * 2^n for integer valued n in [-150, 128], and
+//   Frexp(a, &e) = m with a = m * 2^e and m in [0.5, 1) for normal a > 0.
+//
+// Min and Max must return their second argument if either one is NaN, as
+// the x86 instructions do.
+
+#include <math.h>
+#include <string.h>
+
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+namespace tensorflow {
+namespace vectorized_math {
+namespace internal {
+
+// exp(x), following Cephes' expf: x = n * ln(2) + r with |r| <= ln(2) / 2,
+// and exp(r) from a polynomial. x is clamped to where exp(x) rounds to 0 or
+// infinity, and Ldexp takes care of results in the denormal range.
+template <typename Ops>
+struct Exp {
+  typedef typename Ops::Packet Packet;
+  static inline Packet Run(Packet x) {
+    const Packet clamped = Ops::Min(Ops::Max(x, Ops::Set1(-104.0f)),
+                                    Ops::Set1(88.8f));
+    const Packet n =
+        Ops::Round(Ops::Mul(clamped, Ops::Set1(1.44269504088896341f)));
+    Packet r = Ops::MulAdd(n, Ops::Set1(-0.693359375f), clamped);
+    r = Ops::MulAdd(n, Ops::Set1(2.12194440e-4f), r);
+    Packet p = Ops::Set1(1.9875691500e-4f);
+    p = Ops::MulAdd(p, r, Ops::Set1(1.3981999507e-3f));
+    p = Ops::MulAdd(p, r, Ops::Set1(8.3334519073e-3f));
+    p = Ops::MulAdd(p, r, Ops::Set1(4.1665795894e-2f));
+    p = Ops::MulAdd(p, r, Ops::Set1(1.6666665459e-1f));
+    p = Ops::MulAdd(p, r, Ops::Set1(5.0000001201e-1f));
+    p = Ops::MulAdd(p, Ops::Mul(r, r), Ops::Add(r, Ops::Set1(1.0f)));
+    return Ops::Select(Ops::IsNan(x), x, Ops::Ldexp(p, n));
+  }
+};
+
+// log(x), following Cephes' logf: x = m * 2^e with m in [sqrt(1/2), sqrt(2)),
+// and log(m) from a polynomial in m - 1.
+template <typename Ops>
+struct Log {
+  typedef typename Ops::Packet Packet;
+  static inline Packet Run(Packet x) {
+    // Scale denormals into the normal range first.
+    const typename Ops::Mask denormal =
+        Ops::Less(x, Ops::Set1(1.17549435e-38f));
+    const Packet scaled =
+        Ops::Select(denormal, Ops::Mul(x, Ops::Set1(8388608.0f)), x);
+    Packet e;
+    Packet m = Ops::Frexp(scaled, &e);
+    e = Ops::Sub(e, Ops::Select(denormal, Ops::Set1(23.0f), Ops::Set1(0.0f)));
+    const typename Ops::Mask small_m =
+        Ops::Less(m, Ops::Set1(0.707106781186547524f));
+    e = Ops::Sub(e, Ops::Select(small_m, Ops::Set1(1.0f), Ops::Set1(0.0f)));
+    const Packet f =
+        Ops::Sub(Ops::Select(small_m, Ops::Add(m, m), m), Ops::Set1(1.0f));
+    const Packet z = Ops::Mul(f, f);
+    Packet p = Ops::Set1(7.0376836292e-2f);
+    p = Ops::MulAdd(p, f, Ops::Set1(-1.1514610310e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(1.1676998740e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(-1.2420140846e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(1.4249322787e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(-1.6668057665e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(2.0000714765e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(-2.4999993993e-1f));
+    p = Ops::MulAdd(p, f, Ops::Set1(3.3333331174e-1f));
+    Packet y = Ops::Mul(Ops::Mul(p, f), z);
+    y = Ops::MulAdd(e, Ops::Set1(-2.12194440e-4f), y);
+    y = Ops::MulAdd(z, Ops::Set1(-0.5f), y);
+    Packet result = Ops::MulAdd(e, Ops::Set1(0.693359375f), Ops::Add(f, y));
+
+    const Packet inf = Ops::Set1(INFINITY);
+    result = Ops::Select(Ops::Equal(x, inf), inf, result);
+    result = Ops::Select(Ops::Less(x, Ops::Set1(0.0f)), Ops::Set1(NAN), result);
+    result = Ops::Select(Ops::Equal(x, Ops::Set1(0.0f)),
+                         Ops::Set1(-INFINITY), result);
+    return Ops::Select(Ops::IsNan(x), x, result);
+  }
+};
+
+// tanh(x): an odd polynomial (Cephes' tanhf) for |x| < 0.625, and
+// 1 - 2 / (exp(2|x|) + 1) otherwise.
+template <typename Ops>
+struct Tanh {
+  typedef typename Ops::Packet Packet;
+  static inline Packet Run(Packet x) {
+    // tanh(10) rounds to 1.
+    const Packet a = Ops::Min(Ops::Abs(x), Ops::Set1(10.0f));
+    const Packet z = Ops::Mul(a, a);
+    Packet p = Ops::Set1(-5.70498872745e-3f);
+    p = Ops::MulAdd(p, z, Ops::Set1(2.06390887954e-2f));
+    p = Ops::MulAdd(p, z, Ops::Set1(-5.37397155531e-2f));
+    p = Ops::MulAdd(p, z, Ops::Set1(1.33314422036e-1f));
+    p = Ops::MulAdd(p, z, Ops::Set1(-3.33332819422e-1f));
+    const Packet small = Ops::MulAdd(Ops::Mul(p, z), a, a);
+    const Packet e = Exp<Ops>::Run(Ops::Add(a, a));
+    const Packet large =
+        Ops::Sub(Ops::Set1(1.0f),
+                 Ops::Div(Ops::Set1(2.0f), Ops::Add(e, Ops::Set1(1.0f))));
+    const Packet result = Ops::CopySign(
+        Ops::Select(Ops::Less(a, Ops::Set1(0.625f)), small, large), x);
+    return Ops::Select(Ops::IsNan(x), x, result);
+  }
+};
+
+// sigmoid(x) = 1 / (1 + exp(-x)), computed as exp(x) / (1 + exp(x)) for
+// negative x so that small results keep their precision.
+template <typename Ops>
+struct Sigmoid {
+  typedef typename Ops::Packet Packet;
+  static inline Packet Run(Packet x) {
+    const Packet one = Ops::Set1(1.0f);
+    const Packet e = Exp<Ops>::Run(Ops::CopySign(x, Ops::Set1(-1.0f)));
+    const typename Ops::Mask negative = Ops::Less(x, Ops::Set1(0.0f));
+    return Ops::Div(Ops::Select(negative, e, one), Ops::Add(one, e));
+  }
+};
+
+// erf(x): x * P(x^2) for |x| < 1, and 1 - exp(-x^2) * Q(1 / |x|) otherwise,
+// where Q approximates erfc(x) * exp(x^2) on [1, 4]. erf(x) rounds to 1 for
+// |x| >= 4.
+template <typename Ops>
+struct Erf {
+  typedef typename Ops::Packet Packet;
+  static inline Packet Run(Packet x) {
+    const Packet one = Ops::Set1(1.0f);
+    const Packet a = Ops::Min(Ops::Abs(x), Ops::Set1(4.0f));
+    const Packet z = Ops::Mul(a, a);
+
+    Packet p = Ops::Set1(7.853907582e-05f);
+    p = Ops::MulAdd(p, z, Ops::Set1(-8.010208783e-04f));
+    p = Ops::MulAdd(p, z, Ops::Set1(5.188329601e-03f));
+    p = Ops::MulAdd(p, z, Ops::Set1(-2.685381310e-02f));
+    p = Ops::MulAdd(p, z, Ops::Set1(1.128358518e-01f));
+    p = Ops::MulAdd(p, z, Ops::Set1(-3.761262583e-01f));
+    // The constant term is 1.128379166, split off to round only once.
+    p = Ops::MulAdd(p, z, Ops::Set1(1.28379166e-01f));
+    const Packet small = Ops::MulAdd(p, a, a);
+
+    const Packet t = Ops::Div(one, Ops::Max(a, one));
+    Packet q = Ops::Set1(3.071346223e-02f);
+    q = Ops::MulAdd(q, t, Ops::Set1(-1.797098392e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(4.382327757e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(-5.369380246e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(2.383244704e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(2.304005230e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(-3.758650633e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(2.053628989e-02f));
+    q = Ops::MulAdd(q, t, Ops::Set1(5.617679070e-01f));
+    q = Ops::MulAdd(q, t, Ops::Set1(1.210813587e-04f));
+    const Packet large = Ops::Sub(
+        one, Ops::Mul(Exp<Ops>::Run(Ops::Sub(Ops::Set1(0.0f), z)), q));
+
+    const Packet result =
+        Ops::CopySign(Ops::Select(Ops::Less(a, one), small, large), x);
+    return Ops::Select(Ops::IsNan(x), x, result);
+  }
+};
+
+// Applies F to in[0, n), using a zero padded buffer for the last partial
+// packet.
+template <typename Ops, typename F>
+void Apply(const float* in, float* out, int64 n) {
+  const int64 vectorized_end = n / Ops::kSize * Ops::kSize;
+  for (int64 i = 0; i < vectorized_end; i += Ops::kSize) {
+    Ops::Store(out + i, F::Run(Ops::Load(in + i)));
+  }
+  const int64 remainder = n - vectorized_end;
+  if (remainder > 0) {
+    float buffer[Ops::kSize] = {0.0f};
+    memcpy(buffer, in + vectorized_end, remainder * sizeof(float));
+    Ops::Store(buffer, F::Run(Ops::Load(buffer)));
+    memcpy(out + vectorized_end, buffer, remainder * sizeof(float));
+  }
+}
+
+template <typename Ops>
+FloatFunction GetFloatFunctionFor(Function f) {
+  switch (f) {
+    case kExp:
+      return &Apply<Ops, Exp<Ops>>;
+    case kLog:
+      return &Apply<Ops, Log<Ops>>;
+    case kTanh:
+      return &Apply<Ops, Tanh<Ops>>;
+    case kSigmoid:
+      return &Apply<Ops, Sigmoid<Ops>>;
+    case kErf:
+      return &Apply<Ops, Erf<Ops>>;
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace internal
+}  // namespace vectorized_math
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_VECTORIZED_MATH_IMPL_H_
@@ -0,0 +1,200 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/vectorized_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace vectorized_math {
+namespace {
+
+using cpu_dispatch::InstructionSet;
+
+const InstructionSet kInstructionSets[] = {cpu_dispatch::kAvx2,
+                                           cpu_dispatch::kAvx512};
+
+double Reference(Function f, double x) {
+  switch (f) {
+    case kExp:
+      return std::exp(x);
+    case kLog:
+      return std::log(x);
+    case kTanh:
+      return std::tanh(x);
+    case kSigmoid:
+      return 1.0 / (1.0 + std::exp(-x));
+    case kErf:
+      return std::erf(x);
+    default:
+      break;
+  }
+  LOG(FATAL) << "Unknown function " << f;
+  return 0;
+}
+
+// Returns the error of 'actual' in units of the spacing of floats around
+// 'expected'.
+double UlpError(float actual, double expected) {
+  const float rounded = static_cast<float>(expected);
+  if (std::isnan(expected)) return std::isnan(actual) ? 0 : 1e9;
+  if (std::isinf(rounded)) return actual == rounded ? 0 : 1e9;
+  if (std::isinf(actual)) return 1e9;
+  const float magnitude = std::fabs(rounded);
+  double ulp = std::nextafter(magnitude, std::numeric_limits<float>::max()) -
+               magnitude;
+  if (magnitude > 0) {
+    ulp = std::min(ulp, static_cast<double>(
+                            magnitude - std::nextafter(magnitude, 0.0f)));
+  }
+  return std::fabs(actual - expected) / ulp;
+}
+
+// The maximum errors documented in vectorized_math.h.
+double MaxUlpError(Function f) { return f == kSigmoid ? 3.0 : 1.5; }
+
+class VectorizedMathTest : public ::testing::TestWithParam<Function> {};
+
+TEST_P(VectorizedMathTest, Accuracy) {
+  const Function f = GetParam();
+  // Every 997th float bit pattern, which covers all exponents, infinities,
+  // NaNs and denormals of both signs.
+  std::vector<float> in;
+  for (uint64 bits = 0; bits < (1ull << 32); bits += 997) {
+    const uint32 b = static_cast<uint32>(bits);
+    float x;
+    memcpy(&x, &b, sizeof(x));
+    in.push_back(x);
+  }
+  for (InstructionSet isa : kInstructionSets) {
+    const FloatFunction function = GetFloatFunction(f, isa);
+    if (function == nullptr) continue;
+    std::vector<float> out(in.size());
+    function(in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      ASSERT_LE(UlpError(out[i], Reference(f, in[i])), MaxUlpError(f))
+          << "f=" << f << " isa=" << isa << " x=" << in[i] << " got "
+          << out[i];
+    }
+  }
+}
+
+TEST_P(VectorizedMathTest, SpecialValues) {
+  const Function f = GetParam();
+  const float inf = std::numeric_limits<float>::infinity();
+  const std::vector<float> in = {
+      0.0f, -0.0f, inf, -inf, std::numeric_limits<float>::quiet_NaN(),
+      std::numeric_limits<float>::min(),
+      std::numeric_limits<float>::denorm_min(),
+      std::numeric_limits<float>::max(), 1.0f, -1.0f};
+  for (InstructionSet isa : kInstructionSets) {
+    const FloatFunction function = GetFloatFunction(f, isa);
+    if (function == nullptr) continue;
+    std::vector<float> out(in.size());
+    function(in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      const float expected = static_cast<float>(Reference(f, in[i]));
+      if (std::isnan(expected)) {
+        EXPECT_TRUE(std::isnan(out[i])) << "f=" << f << " x=" << in[i];
+      } else if (std::isinf(expected) || expected == 0.0f) {
+        EXPECT_EQ(expected, out[i]) << "f=" << f << " x=" << in[i];
+      }
+    }
+  }
+}
+
+TEST_P(VectorizedMathTest, AllLengthsAndInPlace) {
+  const Function f = GetParam();
+  for (InstructionSet isa : kInstructionSets) {
+    const FloatFunction function = GetFloatFunction(f, isa);
+    if (function == nullptr) continue;
+    for (int n = 0; n < 40; ++n) {
+      std::vector<float> in(n);
+      for (int i = 0; i < n; ++i) in[i] = 0.25f * (i + 1);
+      // Guards after the end must stay untouched.
+      std::vector<float> out(n + 16, -7.0f);
+      function(in.data(), out.data(), n);
+      std::vector<float> in_place = in;
+      function(in_place.data(), in_place.data(), n);
+      for (int i = 0; i < n; ++i) {
+        EXPECT_LE(UlpError(out[i], Reference(f, in[i])), MaxUlpError(f));
+        EXPECT_EQ(out[i], in_place[i]);
+      }
+      for (int i = n; i < n + 16; ++i) EXPECT_EQ(-7.0f, out[i]);
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(AllFunctions, VectorizedMathTest,
+                        ::testing::Values(kExp, kLog, kTanh, kSigmoid, kErf));
+
+TEST(VectorizedMathTest, Dispatch) {
+  // The widest version allowed by cpu_dispatch, if any.
+  FloatFunction expected = nullptr;
+  for (InstructionSet isa : kInstructionSets) {
+    if (isa <= cpu_dispatch::MaxInstructionSet() &&
+        GetFloatFunction(kExp, isa) != nullptr) {
+      expected = GetFloatFunction(kExp, isa);
+    }
+  }
+  EXPECT_EQ(expected, GetFloatFunction(kExp));
+  EXPECT_EQ(nullptr, GetFloatFunction(kExp, cpu_dispatch::kBaseline));
+}
+
+static void BM_VectorizedMath(int iters, Function f, InstructionSet isa) {
+  testing::StopTiming();
+  const FloatFunction function = GetFloatFunction(f, isa);
+  if (function == nullptr) return;
+  const int kSize = 16 << 10;
+  std::vector<float> in(kSize);
+  std::vector<float> out(kSize);
+  for (int i = 0; i < kSize; ++i) in[i] = (i % 1000) * 0.01f - 5.0f;
+  testing::ItemsProcessed(static_cast<int64>(iters) * kSize);
+  testing::StartTiming();
+  while (--iters >= 0) {
+    function(in.data(), out.data(), kSize);
+  }
+}
+
+#define BM_VECTORIZED_MATH(FUNCTION, ISA)        \
+  static void BM_##FUNCTION##_##ISA(int iters) { \
+    BM_VectorizedMath(iters, FUNCTION, ISA);     \
+  }                                              \
+  BENCHMARK(BM_##FUNCTION##_##ISA);
+
+#define BM_VECTORIZED_MATH_ALL(ISA)  \
+  BM_VECTORIZED_MATH(kExp, ISA);     \
+  BM_VECTORIZED_MATH(kLog, ISA);     \
+  BM_VECTORIZED_MATH(kTanh, ISA);    \
+  BM_VECTORIZED_MATH(kSigmoid, ISA); \
+  BM_VECTORIZED_MATH(kErf, ISA);
+
+using cpu_dispatch::kAvx2;
+using cpu_dispatch::kAvx512;
+
+BM_VECTORIZED_MATH_ALL(kAvx2);
+BM_VECTORIZED_MATH_ALL(kAvx512);
+
+}  // namespace
+}  // namespace vectorized_math
+}  // namespace tensorflow
@@ -372,6 +372,194 @@ void WinogradTransform<T>::GetOutputTransformMatrix(const int64 rows,
   transform_matrix[3 * cols + 15] = T(1.0);
 };
 
+// Winograd DeepConv2DTransform implementation for 3x3 filters with larger
+// output tiles: F(4x4, 3x3) and F(6x6, 3x3).  Larger tiles need fewer
+// element-wise products per output (2.25 and 1.78 versus 4 for F(2x2, 3x3)),
+// at the cost of more expensive input/output transforms, so they pay off for
+// deep convolutions with enough spatial extent to fill the tiles.
+//
+// Each transform matrix is the kronecker product 'M * M' of the 1-D transform
+// matrix 'M' of F(m, 3) (see Lavin, Gray for the interpolation points).
+template <typename T>
+class WinogradLargeTileTransform : public DeepConv2DTransform<T> {
+ public:
+  typedef typename DeepConv2DTransform<T>::Shape Shape;
+
+  // 'out_tile_size' must be 4 or 6.
+  explicit WinogradLargeTileTransform(int out_tile_size)
+      : filter_shape_(3, 3),
+        input_shape_(out_tile_size + 2, out_tile_size + 2),
+        output_shape_(out_tile_size, out_tile_size) {
+    CHECK(out_tile_size == 4 || out_tile_size == 6) << out_tile_size;
+  }
+
+  virtual void GetFilterTransformMatrix(const int64 rows, const int64 cols,
+                                        T* transform_matrix) const;
+
+  virtual void GetInputTransformMatrix(const int64 rows, const int64 cols,
+                                       T* transform_matrix) const;
+
+  virtual void GetOutputTransformMatrix(const int64 rows, const int64 cols,
+                                        T* transform_matrix) const;
+
+  virtual const Shape& filter_shape() const { return filter_shape_; }
+  virtual const Shape& input_shape() const { return input_shape_; }
+  virtual const Shape& output_shape() const { return output_shape_; }
+
+ private:
+  // Writes the kronecker product 'M * M' of the 'm_rows' x 'm_cols' row-major
+  // matrix 'M' into 'transform_matrix' ('rows' x 'cols').
+  static void ComputeKroneckerProduct(const int64 m_rows, const int64 m_cols,
+                                      const double* m, const int64 rows,
+                                      const int64 cols, T* transform_matrix);
+
+  const Shape filter_shape_;
+  const Shape input_shape_;
+  const Shape output_shape_;
+};
+
+template <typename T>
+void WinogradLargeTileTransform<T>::ComputeKroneckerProduct(
+    const int64 m_rows, const int64 m_cols, const double* m, const int64 rows,
+    const int64 cols, T* transform_matrix) {
+  CHECK_EQ(rows, m_rows * m_rows);
+  CHECK_EQ(cols, m_cols * m_cols);
+  for (int64 i = 0; i < m_rows; ++i) {
+    for (int64 j = 0; j < m_cols; ++j) {
+      const double v = m[i * m_cols + j];
+      for (int64 k = 0; k < m_rows; ++k) {
+        for (int64 l = 0; l < m_cols; ++l) {
+          transform_matrix[(i * m_rows + k) * cols + (j * m_cols + l)] =
+              T(v * m[k * m_cols + l]);
+        }
+      }
+    }
+  }
+}
+
+// The filter transform matrix is the kronecker product 'M * M' of 'G':
+//
+// F(4x4, 3x3):
+//   [  1/4     0     0   ]
+//   [ -1/6  -1/6  -1/6   ]
+//   [ -1/6   1/6  -1/6   ]
+//   [  1/24  1/12  1/6   ]
+//   [  1/24 -1/12  1/6   ]
+//   [  0     0     1     ]
+//
+// F(6x6, 3x3):
+//   [  1      0      0     ]
+//   [ -2/9   -2/9   -2/9   ]
+//   [ -2/9    2/9   -2/9   ]
+//   [  1/90   1/45   2/45  ]
+//   [  1/90  -1/45   2/45  ]
+//   [  32/45  16/45  8/45  ]
+//   [  32/45 -16/45  8/45  ]
+//   [  0      0      1     ]
+//
+// The data layout of 'transform_matrix':
+//   [input_tile_spatial_size, filter_spatial_size]
+//
+template <typename T>
+void WinogradLargeTileTransform<T>::GetFilterTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kG4[] = {
+      1.0 / 4,  0.0,       0.0,      -1.0 / 6, -1.0 / 6, -1.0 / 6,
+      -1.0 / 6, 1.0 / 6,   -1.0 / 6, 1.0 / 24, 1.0 / 12, 1.0 / 6,
+      1.0 / 24, -1.0 / 12, 1.0 / 6,  0.0,      0.0,      1.0};
+  static const double kG6[] = {
+      1.0,       0.0,        0.0,      -2.0 / 9,  -2.0 / 9,  -2.0 / 9,
+      -2.0 / 9,  2.0 / 9,    -2.0 / 9, 1.0 / 90,  1.0 / 45,  2.0 / 45,
+      1.0 / 90,  -1.0 / 45,  2.0 / 45, 32.0 / 45, 16.0 / 45, 8.0 / 45,
+      32.0 / 45, -16.0 / 45, 8.0 / 45, 0.0,       0.0,       1.0};
+  const int64 out_tile_size = output_shape_.rows;
+  ComputeKroneckerProduct(input_shape_.rows, filter_shape_.rows,
+                          out_tile_size == 4 ? kG4 : kG6, rows, cols,
+                          transform_matrix);
+}
+
+// The input transform matrix is the kronecker product 'M * M' of 'B^T':
+//
+// F(4x4, 3x3):
+//   [ 4   0  -5   0   1   0 ]
+//   [ 0  -4  -4   1   1   0 ]
+//   [ 0   4  -4  -1   1   0 ]
+//   [ 0  -2  -1   2   1   0 ]
+//   [ 0   2  -1  -2   1   0 ]
+//   [ 0   4   0  -5   0   1 ]
+//
+// F(6x6, 3x3):
+//   [ 1   0    -21/4  0      21/4   0     -1  0 ]
+//   [ 0   1     1    -17/4  -17/4   1      1  0 ]
+//   [ 0  -1     1     17/4  -17/4  -1      1  0 ]
+//   [ 0   1/2   1/4  -5/2   -5/4    2      1  0 ]
+//   [ 0  -1/2   1/4   5/2   -5/4   -2      1  0 ]
+//   [ 0   2     4    -5/2   -5      1/2    1  0 ]
+//   [ 0  -2     4     5/2   -5     -1/2    1  0 ]
+//   [ 0  -1     0     21/4   0     -21/4   0  1 ]
+//
+// Data layout of 'transform_matrix':
+//   [tile_spatial_size, tile_spatial_size]
+//
+template <typename T>
+void WinogradLargeTileTransform<T>::GetInputTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kBT4[] = {
+      4, 0,  -5, 0,  1, 0, 0, -4, -4, 1,  1, 0, 0, 4,  -4, -1, 1, 0,
+      0, -2, -1, 2,  1, 0, 0, 2,  -1, -2, 1, 0, 0, 4,  0,  -5, 0, 1};
+  static const double kBT6[] = {
+      1, 0,    -5.25, 0,     5.25,  0,     -1, 0,  //
+      0, 1,    1,     -4.25, -4.25, 1,     1,  0,  //
+      0, -1,   1,     4.25,  -4.25, -1,    1,  0,  //
+      0, 0.5,  0.25,  -2.5,  -1.25, 2,     1,  0,  //
+      0, -0.5, 0.25,  2.5,   -1.25, -2,    1,  0,  //
+      0, 2,    4,     -2.5,  -5,    0.5,   1,  0,  //
+      0, -2,   4,     2.5,   -5,    -0.5,  1,  0,  //
+      0, -1,   0,     5.25,  0,     -5.25, 0,  1};
+  const int64 tile_size = input_shape_.rows;
+  const int64 out_tile_size = output_shape_.rows;
+  ComputeKroneckerProduct(tile_size, tile_size,
+                          out_tile_size == 4 ? kBT4 : kBT6, rows, cols,
+                          transform_matrix);
+}
+
+// The output transform matrix is the kronecker product 'M * M' of 'A^T':
+//
+// F(4x4, 3x3):
+//   [ 1  1   1  1   1  0 ]
+//   [ 0  1  -1  2  -2  0 ]
+//   [ 0  1   1  4   4  0 ]
+//   [ 0  1  -1  8  -8  1 ]
+//
+// F(6x6, 3x3):
+//   [ 1  1   1   1    1   1     1     0 ]
+//   [ 0  1  -1   2   -2   1/2  -1/2   0 ]
+//   [ 0  1   1   4    4   1/4   1/4   0 ]
+//   [ 0  1  -1   8   -8   1/8  -1/8   0 ]
+//   [ 0  1   1   16   16  1/16  1/16  0 ]
+//   [ 0  1  -1   32  -32  1/32 -1/32  1 ]
+//
+// Data layout of 'transform_matrix':
+//   [out_tile_spatial_size, tile_spatial_size]
+//
+template <typename T>
+void WinogradLargeTileTransform<T>::GetOutputTransformMatrix(
+    const int64 rows, const int64 cols, T* transform_matrix) const {
+  static const double kAT4[] = {1, 1, 1,  1, 1,  0, 0, 1, -1, 2, -2, 0,
+                                0, 1, 1,  4, 4,  0, 0, 1, -1, 8, -8, 1};
+  static const double kAT6[] = {
+      1, 1, 1,  1,  1,   1,       1,        0,  //
+      0, 1, -1, 2,  -2,  0.5,     -0.5,     0,  //
+      0, 1, 1,  4,  4,   0.25,    0.25,     0,  //
+      0, 1, -1, 8,  -8,  0.125,   -0.125,   0,  //
+      0, 1, 1,  16, 16,  0.0625,  0.0625,   0,  //
+      0, 1, -1, 32, -32, 0.03125, -0.03125, 1};
+  const int64 out_tile_size = output_shape_.rows;
+  ComputeKroneckerProduct(out_tile_size, input_shape_.rows,
+                          out_tile_size == 4 ? kAT4 : kAT6, rows, cols,
+                          transform_matrix);
+}
+
 }  // namespace tensorflow
 
 #endif  // THIRD_PARTY_TENSORFLOW_CORE_KERNELS_WINOGRAD_TRANSFORM_H_
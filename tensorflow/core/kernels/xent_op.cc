@@ -18,6 +18,8 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/xent_op.h"
+#include <type_traits>
+#include "tensorflow/core/kernels/softmax_op_cpu_impl.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -53,11 +55,16 @@ class SoftmaxXentWithLogitsOp : public OpKernel {
 
     // loss is 1-D (one per example), and size is batch_size.
 
+    // The float CPU functor works row by row and needs no scratch, so it is
+    // passed an empty one, which allocates nothing.
+    const bool needs_scratch = !(std::is_same<Device, CPUDevice>::value &&
+                                 std::is_same<T, float>::value);
+    const int64 scratch_rows = needs_scratch ? logits_in.dim_size(0) : 0;
     Tensor scratch;
-    OP_REQUIRES_OK(
-        context, context->allocate_temp(DataTypeToEnum<T>::value,
-                                        TensorShape({logits_in.dim_size(0), 1}),
-                                        &scratch));
+    OP_REQUIRES_OK(context,
+                   context->allocate_temp(DataTypeToEnum<T>::value,
+                                          TensorShape({scratch_rows, 1}),
+                                          &scratch));
 
     Tensor* loss_out = nullptr;
     OP_REQUIRES_OK(context,
@@ -92,6 +99,18 @@ struct XentFunctorBase {
 template <typename T>
 struct XentFunctor<CPUDevice, T> : XentFunctorBase<CPUDevice, T> {};
 
+// Float uses the row-wise kernel from softmax_op_cpu_impl.h, which computes
+// the loss and the backprop of each row together and needs no scratch.
+template <>
+struct XentFunctor<CPUDevice, float> {
+  void operator()(const CPUDevice& d, TTypes<float>::ConstMatrix logits,
+                  TTypes<float>::ConstMatrix labels,
+                  TTypes<float>::Matrix scratch, TTypes<float>::Vec loss,
+                  TTypes<float>::Matrix backprop) {
+    XentRowsCPU(d, logits, labels, loss, backprop);
+  }
+};
+
 #ifdef TENSORFLOW_USE_SYCL
 template <typename T>
 struct XentFunctor<SYCLDevice, T> : XentFunctorBase<SYCLDevice, T> {};
@@ -1809,6 +1809,99 @@ segment_ids: segment_ids passed to the corresponding SparseSegmentSqrtN op.
 output_dim0: dimension 0 of "data" passed to SparseSegmentSqrtN op.
 )doc");
 
+REGISTER_OP("SparseSegmentCombine")
+    .Input("data: T")
+    .Input("indices: Tidx")
+    .Input("weights: T")
+    .Input("segment_ids: int32")
+    .Output("output: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .Attr("T: {float, double}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle data_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &data_shape));
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &indices_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      TF_RETURN_IF_ERROR(c->Merge(c->input(3), indices_shape, &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(data_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(InferenceContext::kUnknownDim), subshape, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes a weighted combination of the rows of `data` along sparse segments.
+
+Like `SparseSegmentSum`, `SparseSegmentMean` and `SparseSegmentSqrtN`, but each
+selected row is scaled by the corresponding entry of `weights`. For segment
+`k` with entries `i` (that is, `segment_ids[i] == k`):
+
+    output[k] = sum_i(weights[i] * data[indices[i]]) / norm[k]
+
+where `norm[k]` is 1 for "sum", `sum_i(weights[i])` for "mean" and
+`sqrt(sum_i(weights[i]^2))` for "sqrtn". A zero `norm[k]` is divided by like
+any other, while segments with no entries are zero. The gathered rows are never
+materialized, which makes this suitable for combining multivalent sparse
+features looked up in a large embedding.
+
+data: The embedding, or any tensor whose rows are selected by `indices`.
+indices: A 1-D tensor. Has same rank as `segment_ids`.
+weights: A 1-D tensor with one weight per entry of `indices`, or an empty
+  tensor for unit weights.
+segment_ids: A 1-D tensor. Values should be sorted and can be repeated.
+combiner: How to normalize the weighted sum of each segment.
+output: Has same shape as data, except for dimension 0 which
+  has size `k`, the number of segments.
+)doc");
+
+REGISTER_OP("SparseSegmentCombineGrad")
+    .Input("grad: T")
+    .Input("indices: Tidx")
+    .Input("weights: T")
+    .Input("segment_ids: int32")
+    .Output("output: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .Attr("T: {float, double}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle grad_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &grad_shape));
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &indices_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      TF_RETURN_IF_ERROR(c->Merge(c->input(3), indices_shape, &unused));
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(grad_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(indices_shape, subshape, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes gradients for SparseSegmentCombine.
+
+Returns the gradient with respect to the rows of `data` that were read, one
+row per entry of `indices`, i.e. the values of an `IndexedSlices` whose
+indices are `indices`. The gradient with respect to `weights` is not computed
+here.
+
+grad: gradient propagated to the SparseSegmentCombine op.
+indices: indices passed to the corresponding SparseSegmentCombine op.
+weights: weights passed to the corresponding SparseSegmentCombine op.
+segment_ids: segment_ids passed to the corresponding SparseSegmentCombine op.
+combiner: combiner of the corresponding SparseSegmentCombine op.
+output: Has same shape as grad, except for dimension 0 which is the size of
+  `indices`.
+)doc");
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
@@ -809,6 +809,46 @@ strides: 1-D of length 4.  The stride of the sliding window for each dimension
 padding: The type of padding algorithm to use.
  )doc");
 
+REGISTER_OP("_FusedConv2DWithBias")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr("activation: {'Identity', 'Relu', 'Relu6'} = 'Identity'")
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(shape_inference::Conv2DShape(c));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &bias));
+      ShapeHandle output = c->output(0);
+      DimensionHandle depth;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(output, 3), c->Dim(bias, 0), &depth));
+      TF_RETURN_IF_ERROR(c->ReplaceDim(output, 3, depth, &output));
+      c->set_output(0, output);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes `activation(Conv2D(input, filter) + bias)`.
+
+The bias and activation are applied to the convolution's output in a single
+pass, rather than one pass each. Only the 'NHWC' data format is supported.
+
+input: 4-D with shape `[batch, in_height, in_width, in_channels]`.
+filter: 4-D with shape
+  `[filter_height, filter_width, in_channels, out_channels]`.
+bias: 1-D with size `out_channels`.
+strides: 1-D of length 4.  The stride of the sliding window for each dimension
+   of `input`.
+padding: The type of padding algorithm to use.
+activation: The activation applied after the bias.
+
+NOTE Do not invoke this operator directly in Python. A graph rewrite pass is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("DepthwiseConv2dNative")
@@ -1935,6 +1975,141 @@ loss: Per example loss (batch_size vector).
 backprop: backpropagated gradients (batch_size x num_classes matrix).
 )doc");
 
+REGISTER_OP("SampledSoftmaxLoss")
+    .Input("weights: float")
+    .Input("biases: float")
+    .Input("labels: int64")
+    .Input("inputs: float")
+    .Output("loss: float")
+    .Output("backprop: float")
+    .Output("sampled_candidates: int64")
+    .Attr("num_sampled: int >= 1")
+    .Attr("num_true: int >= 1")
+    .Attr("range_max: int >= 1")
+    .Attr("sampler: {'log_uniform', 'uniform'} = 'log_uniform'")
+    .Attr("unique: bool = true")
+    .Attr("subtract_log_q: bool = true")
+    .Attr("remove_accidental_hits: bool = true")
+    .Attr("seed: int = 0")
+    .Attr("seed2: int = 0")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle weights;
+      ShapeHandle biases;
+      ShapeHandle labels;
+      ShapeHandle inputs;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &weights));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &biases));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 2, &labels));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 2, &inputs));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(weights, 0), c->Dim(biases, 0), &unused));
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(weights, 1), c->Dim(inputs, 1), &unused));
+      int32 num_true;
+      int32 num_sampled;
+      TF_RETURN_IF_ERROR(c->GetAttr("num_true", &num_true));
+      TF_RETURN_IF_ERROR(c->GetAttr("num_sampled", &num_sampled));
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(labels, 1), num_true, &unused));
+      DimensionHandle batch_size;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(labels, 0), c->Dim(inputs, 0), &batch_size));
+      c->set_output(0, c->Vector(batch_size));
+      c->set_output(1, c->Matrix(batch_size, num_true + num_sampled));
+      c->set_output(2, c->Vector(num_sampled));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes sampled softmax cross entropy loss and gradients to backpropagate.
+
+Samples `num_sampled` candidate classes for the batch, computes the logits of
+the true and sampled classes from the corresponding rows of `weights` and
+`biases`, and returns the softmax cross entropy loss over those logits. Each
+of the `num_true` true classes of an example gets a target probability of
+`1 / num_true`. This computes the same loss as `tf.nn.sampled_softmax_loss`
+without gathering the weights of the true classes or materializing the
+intermediate logits as separate tensors.
+
+The gradient for the loss, SampledSoftmaxLossGrad, returns the gradients of
+`weights` and `biases` for only the rows that were used.
+
+weights: The class embeddings, a `[num_classes, dim]` matrix.
+biases: The class biases, a vector of length `num_classes`.
+labels: A `[batch_size, num_true]` matrix of target classes.
+inputs: The `[batch_size, dim]` forward activations of the input network.
+loss: Per example loss (batch_size vector).
+backprop: The gradient of `loss` with respect to the logits of the true
+  classes followed by those of the sampled ones, a
+  `[batch_size, num_true + num_sampled]` matrix.
+sampled_candidates: The `num_sampled` sampled classes.
+num_sampled: Number of candidates to sample for the batch.
+num_true: Number of target classes per example.
+range_max: The sampler picks classes from the interval [0, range_max). It
+  must not be larger than `num_classes`.
+sampler: The distribution of the sampled classes, either "log_uniform" (as
+  in `tf.nn.log_uniform_candidate_sampler`) or "uniform".
+unique: If true, the sampled classes are all different.
+subtract_log_q: If true, subtract the log of the expected count of each class
+  in the sample from its logit.
+remove_accidental_hits: If true, the sampled classes that are also true
+  classes of an example get no weight in that example's loss.
+seed: If either seed or seed2 are set to be non-zero, the random number
+  generator is seeded by the given seed.  Otherwise, it is seeded by a
+  random seed.
+seed2: An second seed to avoid seed collision.
+)doc");
+
+REGISTER_OP("SampledSoftmaxLossGrad")
+    .Input("grad_loss: float")
+    .Input("backprop: float")
+    .Input("weights: float")
+    .Input("labels: int64")
+    .Input("sampled_candidates: int64")
+    .Input("inputs: float")
+    .Output("inputs_grad: float")
+    .Output("indices: int64")
+    .Output("weights_grad: float")
+    .Output("biases_grad: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle grad_loss;
+      ShapeHandle backprop;
+      ShapeHandle weights;
+      ShapeHandle inputs;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &grad_loss));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &backprop));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 2, &weights));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 2, &inputs));
+      DimensionHandle dim;
+      TF_RETURN_IF_ERROR(c->Merge(c->Dim(weights, 1), c->Dim(inputs, 1), &dim));
+      c->set_output(0, inputs);
+      DimensionHandle num_rows = c->UnknownDim();
+      c->set_output(1, c->Vector(num_rows));
+      c->set_output(2, c->Matrix(num_rows, dim));
+      c->set_output(3, c->Vector(num_rows));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes the gradients of SampledSoftmaxLoss.
+
+The gradients of `weights` and `biases` are returned for the distinct classes
+in `labels` and `sampled_candidates` only, as the rows `weights_grad` and
+`biases_grad` for the classes in `indices`.
+
+grad_loss: The gradient with respect to the `loss` output of
+  SampledSoftmaxLoss.
+backprop: The `backprop` output of SampledSoftmaxLoss.
+weights: The `weights` input of SampledSoftmaxLoss.
+labels: The `labels` input of SampledSoftmaxLoss.
+sampled_candidates: The `sampled_candidates` output of SampledSoftmaxLoss.
+inputs: The `inputs` input of SampledSoftmaxLoss.
+inputs_grad: The gradient with respect to `inputs`.
+indices: The distinct classes with gradients.
+weights_grad: The gradient with respect to the rows `indices` of `weights`.
+biases_grad: The gradient with respect to the elements `indices` of
+  `biases`.
+)doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("InTopK")
@@ -2419,6 +2594,76 @@ max_output: The float value that the highest quantized output value represents.
 
 )doc");
 
+REGISTER_OP("QuantizedConv2DWithBiasAndRequantize")
+    .Input("input: Tinput")
+    .Input("filter: Tfilter")
+    .Input("bias: float")
+    .Input("min_input: float")
+    .Input("max_input: float")
+    .Input("min_filter: float")
+    .Input("max_filter: float")
+    .Input("min_freezed_output: float")
+    .Input("max_freezed_output: float")
+    .Output("output: out_type")
+    .Output("min_output: float")
+    .Output("max_output: float")
+    .Attr("Tinput: quantizedtype")
+    .Attr("Tfilter: quantizedtype")
+    .Attr("out_type: quantizedtype = DT_QUINT8")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(shape_inference::Conv2DShape(c));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &bias));
+      ShapeHandle output = c->output(0);
+      DimensionHandle depth;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(output, 3), c->Dim(bias, 0), &depth));
+      TF_RETURN_IF_ERROR(c->ReplaceDim(output, 3, depth, &output));
+      c->set_output(0, output);
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(5), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(6), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(7), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(8), 0, &unused));
+      c->set_output(1, c->Scalar());
+      c->set_output(2, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes `Requantize(QuantizedConv2D(input, filter) + bias)` in one op.
+
+The filter may be quantized per output channel: `min_filter` and `max_filter`
+are then vectors with one range per channel of the filter's last dimension.
+Each tile of 32-bit accumulators is rescaled to the eight-bit output range
+given by `min_freezed_output` and `max_freezed_output` as soon as it is
+computed, so the 32-bit result of the convolution is never materialized.
+Values outside the output range saturate. Zero must be representable in the
+input range.
+
+filter: filter's input_depth dimension must match input's depth dimensions.
+bias: 1-D float bias with size `out_channels`.
+strides: The stride of the sliding window for each dimension of the input
+  tensor.
+padding: The type of padding algorithm to use.
+min_input: The float value that the lowest quantized input value represents.
+max_input: The float value that the highest quantized input value represents.
+min_filter: The float value that the lowest quantized filter value represents,
+  either a scalar or one value per output channel.
+max_filter: The float value that the highest quantized filter value
+  represents, either a scalar or one value per output channel.
+min_freezed_output: The float value that the lowest quantized output value
+  represents.
+max_freezed_output: The float value that the highest quantized output value
+  represents.
+min_output: The float value that the lowest quantized output value represents.
+max_output: The float value that the highest quantized output value represents.
+
+)doc");
+
 REGISTER_OP("QuantizedMaxPool")
     .Input("input: T")
     .Input("min_input: float")
@@ -2618,6 +2863,217 @@ scale_after_normalization: A bool indicating whether the resulted tensor
   needs to be multiplied with gamma.
 )doc");
 
+// --------------------------------------------------------------------------
+// Ops on the blocked channel layout NCHWc, i.e. [batch, ceil(channels / c),
+// height, width, c]. The channels beyond the logical channel count in the
+// last block are always zero, which element-wise ops such as Relu preserve,
+// so those run on blocked tensors unchanged. These ops are inserted by the
+// blocked layout graph rewrite pass (graph/blocked_layout_pass.cc).
+
+namespace {
+
+// Returns in <*out> the number of blocks of size <block_size> needed to hold
+// <channels> channels.
+Status NumChannelBlocks(InferenceContext* c, DimensionHandle channels,
+                        int64 block_size, DimensionHandle* out) {
+  TF_RETURN_IF_ERROR(c->Add(channels, block_size - 1, out));
+  return c->Divide(*out, block_size, false /* evenly_divisible */, out);
+}
+
+// Shape function for the NCHWc pooling ops, whose ksize and strides are given
+// in NHWC order.
+Status NCHWcPoolShape(InferenceContext* c) {
+  ShapeHandle input;
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 5, &input));
+  std::vector<int32> ksize;
+  TF_RETURN_IF_ERROR(c->GetAttr("ksize", &ksize));
+  std::vector<int32> strides;
+  TF_RETURN_IF_ERROR(c->GetAttr("strides", &strides));
+  if (ksize.size() != 4 || strides.size() != 4) {
+    return errors::InvalidArgument(
+        "NCHWc pooling requires ksize and strides to contain 4 values");
+  }
+  Padding padding;
+  TF_RETURN_IF_ERROR(c->GetAttr("padding", &padding));
+  DimensionHandle out_rows, out_cols;
+  TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDims(
+      c, c->Dim(input, 2), ksize[1], strides[1], padding, &out_rows));
+  TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDims(
+      c, c->Dim(input, 3), ksize[2], strides[2], padding, &out_cols));
+  c->set_output(0, c->MakeShape({c->Dim(input, 0), c->Dim(input, 1), out_rows,
+                                 out_cols, c->Dim(input, 4)}));
+  return Status::OK();
+}
+
+}  // namespace
+
+REGISTER_OP("_NHWCToNCHWc")
+    .Input("input: T")
+    .Output("output: T")
+    .Output("channels: int32")
+    .Attr("T: {float}")
+    .Attr("block_size: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 4, &input));
+      int64 block_size;
+      TF_RETURN_IF_ERROR(c->GetAttr("block_size", &block_size));
+      DimensionHandle blocks;
+      TF_RETURN_IF_ERROR(
+          NumChannelBlocks(c, c->Dim(input, 3), block_size, &blocks));
+      c->set_output(0, c->MakeShape({c->Dim(input, 0), blocks,
+                                     c->Dim(input, 1), c->Dim(input, 2),
+                                     block_size}));
+      c->set_output(1, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Converts an NHWC tensor to the blocked NCHWc layout, zero-filling the channels
+past the end of the last block.
+
+input: 4-D tensor of shape `[batch, height, width, channels]`.
+output: 5-D tensor of shape
+  `[batch, ceil(channels / block_size), height, width, block_size]`.
+channels: The logical channel count of `output`, for `_NCHWcToNHWC`.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
+REGISTER_OP("_NCHWcToNHWC")
+    .Input("input: T")
+    .Input("channels: int32")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 5, &input));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      DimensionHandle channels = c->UnknownDim();
+      const Tensor* channels_t = c->input_tensor(1);
+      if (channels_t != nullptr) {
+        channels = c->MakeDim(channels_t->scalar<int32>()());
+      }
+      c->set_output(0, c->MakeShape({c->Dim(input, 0), c->Dim(input, 2),
+                                     c->Dim(input, 3), channels}));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Converts a tensor in the blocked NCHWc layout back to NHWC.
+
+input: 5-D tensor of shape `[batch, channel_blocks, height, width, block]`.
+channels: The logical channel count of `input`.
+output: 4-D tensor of shape `[batch, height, width, channels]`.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
+REGISTER_OP("_NCHWcConv2D")
+    .Input("input: T")
+    .Input("filter: T")
+    .Output("output: T")
+    .Output("channels: int32")
+    .Attr("T: {float}")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 5, &input));
+      ShapeHandle filter;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 4, &filter));
+      std::vector<int32> strides;
+      TF_RETURN_IF_ERROR(c->GetAttr("strides", &strides));
+      if (strides.size() != 4) {
+        return errors::InvalidArgument(
+            "_NCHWcConv2D requires the stride attribute to contain 4 values");
+      }
+      Padding padding;
+      TF_RETURN_IF_ERROR(c->GetAttr("padding", &padding));
+      DimensionHandle out_rows, out_cols, blocks;
+      TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDims(
+          c, c->Dim(input, 2), c->Dim(filter, 0), strides[1], padding,
+          &out_rows));
+      TF_RETURN_IF_ERROR(GetWindowedOutputSizeFromDims(
+          c, c->Dim(input, 3), c->Dim(filter, 1), strides[2], padding,
+          &out_cols));
+      DimensionHandle block = c->Dim(input, 4);
+      if (c->ValueKnown(block)) {
+        TF_RETURN_IF_ERROR(
+            NumChannelBlocks(c, c->Dim(filter, 3), c->Value(block), &blocks));
+      } else {
+        blocks = c->UnknownDim();
+      }
+      c->set_output(0, c->MakeShape({c->Dim(input, 0), blocks, out_rows,
+                                     out_cols, block}));
+      c->set_output(1, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes a 2-D convolution of a blocked NCHWc `input` with an ordinary
+`[filter_height, filter_width, in_channels, out_channels]` filter, producing a
+blocked NCHWc output with the same block size. `strides` are given in NHWC
+order.
+
+channels: The logical channel count of `output`, i.e. `out_channels`.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
+REGISTER_OP("_NCHWcBiasAdd")
+    .Input("value: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 5, &input));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &bias));
+      c->set_output(0, input);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Adds `bias`, one value per logical channel, to a blocked NCHWc `value`.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
+REGISTER_OP("_NCHWcMaxPool")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("ksize: list(int) >= 4")
+    .Attr("strides: list(int) >= 4")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn(NCHWcPoolShape)
+    .Doc(R"doc(
+Performs max pooling on a blocked NCHWc `input`. `ksize` and `strides` are
+given in NHWC order.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
+REGISTER_OP("_NCHWcAvgPool")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("ksize: list(int) >= 4")
+    .Attr("strides: list(int) >= 4")
+    .Attr(GetPaddingAttrString())
+    .SetShapeFn(NCHWcPoolShape)
+    .Doc(R"doc(
+Performs average pooling on a blocked NCHWc `input`. `ksize` and `strides` are
+given in NHWC order.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to invoke these operators.
+)doc");
+
 #ifdef INTEL_MKL
 REGISTER_OP("_MklConv2D")
     .Input("input: T")
@@ -252,6 +252,17 @@ def canonical_name(device):
     return device.to_string()
 
 
+def is_gpu(device):
+  """Returns whether the given `DeviceSpec` or device name names a GPU.
+
+  An empty or partial name that leaves the device type open, such as the
+  `device` of an op that has not been placed, is not a GPU.
+  """
+  if not isinstance(device, DeviceSpec):
+    device = DeviceSpec.from_string(device or "")
+  return (device.device_type or "").upper() == "GPU"
+
+
 def merge_device(spec):
   """Returns a device function that merges devices specifications.
 
@@ -139,6 +139,16 @@ class DeviceTest(test_util.TensorFlowTestCase):
                      device.canonical_name(
                          "/gpu:0/task:0/replica:0/job:foo"))
 
+  def testIsGpu(self):
+    self.assertTrue(device.is_gpu("/gpu:0"))
+    self.assertTrue(device.is_gpu("/job:foo/device:GPU:1"))
+    self.assertTrue(device.is_gpu("/device:gpu:0"))
+    self.assertTrue(device.is_gpu(device.DeviceSpec(device_type="GPU")))
+    self.assertFalse(device.is_gpu("/cpu:0"))
+    self.assertFalse(device.is_gpu("/job:foo/task:0"))
+    self.assertFalse(device.is_gpu(""))
+    self.assertFalse(device.is_gpu(None))
+
   def testCheckValid(self):
     device.check_valid("/job:foo/replica:0")
 
@@ -528,6 +528,17 @@ class ConcatOpTest(test.TestCase):
       output = gen_array_ops._concat_v2([t1, t2], 0).eval()
       self.assertFalse(output)  # Checks that output is empty
 
+  def testConcatSingleNonEmptyInput(self):
+    np.random.seed(7)
+    with self.test_session(use_gpu=True):
+      x = np.random.randn(3, 4, 5).astype(np.float32)
+      for axis in range(3):
+        shape = list(x.shape)
+        shape[axis] = 0
+        empty = np.zeros(shape, dtype=np.float32)
+        output = array_ops.concat([empty, x, empty], axis).eval()
+        self.assertAllEqual(x, output)
+
   def testConcatInvalidAxis(self):
     with self.assertRaises(ValueError):
       with self.test_session(use_gpu=True):
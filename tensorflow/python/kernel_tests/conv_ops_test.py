@@ -1350,6 +1350,40 @@ class DeepConv2DTest(test.TestCase):
 
       self.assertAllClose(values_expect, values_test, rtol=1e-5, atol=1e-5)
 
+  def _CompareBackpropInput(self, tensor_in_sizes, filter_in_sizes,
+                            conv_strides, padding):
+    """Verifies that DeepConv2D and Conv2D produce the same input gradients.
+
+    Args:
+      tensor_in_sizes: Input tensor dimensions in
+        [batch, input_rows, input_cols, input_depth].
+      filter_in_sizes: Filter tensor dimensions in
+        [kernel_rows, kernel_cols, input_depth, output_depth].
+      conv_strides: [row_stride, col_stride] for the convolution;
+      padding: Padding type.
+    """
+    x1 = np.random.rand(*tensor_in_sizes).astype(np.float32)
+    x2 = np.random.rand(*filter_in_sizes).astype(np.float32)
+
+    with self.test_session(use_gpu=False) as sess:
+      t1 = constant_op.constant(x1, shape=tensor_in_sizes)
+      t2 = constant_op.constant(x2, shape=filter_in_sizes)
+      strides = [1] + conv_strides + [1]
+
+      conv = nn_ops.conv2d(t1, t2, strides=strides, padding=padding)
+      x3 = np.random.rand(*conv.get_shape().as_list()).astype(np.float32)
+      t3 = constant_op.constant(x3, shape=conv.get_shape())
+      backprop = nn_ops.conv2d_backprop_input(
+          tensor_in_sizes, t2, t3, strides=strides, padding=padding)
+
+      os.environ["TF_USE_DEEP_CONV2D"] = "0"
+      values_expect = sess.run([backprop])
+
+      os.environ["TF_USE_DEEP_CONV2D"] = "1"
+      values_test = sess.run([backprop])
+
+      self.assertAllClose(values_expect, values_test, rtol=1e-5, atol=1e-5)
+
   def _RunTestCases(self, conv_strides, padding):
     input_sizes = [[5, 5, 5, 1248], [3, 17, 17, 192], [2, 35, 35, 288],
                    [2, 6, 8, 517], [2, 7, 4, 81], [3, 11, 3, 77]]
@@ -1357,6 +1391,8 @@ class DeepConv2DTest(test.TestCase):
                     [3, 3, 517, 64], [3, 3, 81, 77], [3, 3, 77, 181]]
     for input_shape, filter_shape in zip(input_sizes, filter_sizes):
       self._CompareFwdConv2D(input_shape, filter_shape, conv_strides, padding)
+      self._CompareBackpropInput(input_shape, filter_shape, conv_strides,
+                                 padding)
 
   def testConv2D3x3FilterStride1x1Valid(self):
     self._RunTestCases([1, 1], "VALID")
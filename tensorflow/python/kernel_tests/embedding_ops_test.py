@@ -719,6 +719,52 @@ class EmbeddingLookupSparseTest(test.TestCase):
             x, x_shape, y, y_shape, x_init_value=x_init_value)
       self.assertLess(err, 1e-5 if dtype == dtypes.float64 else 2e-3)
 
+  def testGradientsEmbeddingLookupSparseWeights(self):
+    vocab_size = 12
+    batch_size = 4
+    param_shape = [2, 3]
+    sp_ids, sp_weights, _, weights, _ = (self._RandomIdsAndWeights(
+        batch_size, vocab_size))
+
+    for num_shards, combiner in itertools.product([1, 3],
+                                                  ["sum", "mean", "sqrtn"]):
+      with self.test_session():
+        x, params, feed_dict = _EmbeddingParams(
+            num_shards, vocab_size, shape=param_shape, dtype=dtypes.float64)
+        w = constant_op.constant(weights, dtypes.float64)
+        y = embedding_ops.embedding_lookup_sparse(
+            x,
+            sp_ids,
+            sparse_tensor.SparseTensor(sp_weights.indices, w,
+                                       sp_weights.dense_shape),
+            combiner=combiner)
+        y_shape = [batch_size] + list(params[_PName(0) + ":0"].shape[1:])
+        err = gradient_checker.compute_gradient_error(
+            w, [len(weights)], y, y_shape, x_init_value=weights,
+            extra_feed_dict=feed_dict)
+      self.assertLess(err, 1e-5)
+
+  def testWeightedLookupUsesSparseSegmentCombine(self):
+    with ops.Graph().as_default() as g:
+      sp_ids, sp_weights, _, _, _ = self._RandomIdsAndWeights(4, 10)
+      x, _, _ = _EmbeddingParams(2, 10, dtype=dtypes.float32)
+      embedding_ops.embedding_lookup_sparse(
+          x, sp_ids, sp_weights, combiner="mean")
+      op_types = [op.type for op in g.get_operations()]
+      self.assertIn("SparseSegmentCombine", op_types)
+      self.assertNotIn("SegmentSum", op_types)
+
+    # The fused op has no GPU kernel, so GPU placements keep the old path.
+    with ops.Graph().as_default() as g:
+      sp_ids, sp_weights, _, _, _ = self._RandomIdsAndWeights(4, 10)
+      x, _, _ = _EmbeddingParams(2, 10, dtype=dtypes.float32)
+      with ops.device("/gpu:0"):
+        embedding_ops.embedding_lookup_sparse(
+            x, sp_ids, sp_weights, combiner="mean")
+      op_types = [op.type for op in g.get_operations()]
+      self.assertNotIn("SparseSegmentCombine", op_types)
+      self.assertIn("SegmentSum", op_types)
+
   def testIncompatibleShapes(self):
     with self.test_session():
       x, _, _ = _EmbeddingParams(1, 10, dtype=dtypes.float32)
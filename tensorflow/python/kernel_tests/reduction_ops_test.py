@@ -294,6 +294,15 @@ class SumReductionTest(BaseReductionTest):
         y = math_ops.reduce_sum(x, [0])
         self.assertAllEqual(y.eval(), np.zeros(9938))
 
+  def testAspectRatios(self):
+    # Shapes whose rows or columns are split into blocks on CPU.
+    for shape in [(1, 70001), (3, 40001), (70001, 3), (5, 3001, 7),
+                  (2, 1030, 2049)]:
+      for dtype in [dtypes.int32, dtypes.float64]:
+        np_arr = self._makeIncremental(shape, dtype) % 17
+        for axis in range(len(shape)):
+          self._compare(np_arr, [axis], keep_dims=False)
+
 
 class MeanReductionTest(BaseReductionTest):
 
@@ -373,6 +382,12 @@ class MeanReductionTest(BaseReductionTest):
         self.assertEqual(y.shape, (9938,))
         self.assertTrue(np.all(np.isnan(y)))
 
+  def testAspectRatios(self):
+    for shape in [(1, 70001), (70001, 3), (5, 3001, 7)]:
+      np_arr = self._makeIncremental(shape, dtypes.float64) % 17
+      for axis in range(len(shape)):
+        self._compare(np_arr, [axis], keep_dims=False)
+
 
 class ProdReductionTest(BaseReductionTest):
 
@@ -608,6 +623,14 @@ class MaxReductionTest(test.TestCase):
     self._compareAll(np_arr, [0, 2])
     self._compareAll(np_arr, [0, 1, 2])
 
+  def testAspectRatios(self):
+    for shape in [(1, 70001), (70001, 3), (5, 3001, 7)]:
+      for dtype in [np.int32, np.float32]:
+        np_arr = (np.arange(np.prod(shape)) * 7919 % 1009 - 500).reshape(
+            shape).astype(dtype)
+        for axis in range(len(shape)):
+          self._compare(np_arr, [axis], False)
+
   def testDoubleReduce3D(self):
     # Create a 3D array of doubles and reduce across all possible
     # dimensions
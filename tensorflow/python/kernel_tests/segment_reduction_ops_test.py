@@ -22,7 +22,11 @@ import numpy as np
 
 from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes as dtypes_lib
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import gen_math_ops
 from tensorflow.python.ops import gradient_checker
+from tensorflow.python.ops import gradients_impl
 from tensorflow.python.ops import math_ops
 import tensorflow.python.ops.nn_grad  # pylint: disable=unused-import
 from tensorflow.python.platform import test
@@ -636,5 +640,121 @@ class SparseSegmentReductionOpTest(SparseSegmentReductionHelper):
           s.eval()
 
 
+class SparseSegmentCombineTest(test.TestCase):
+
+  def _combine(self, x, indices, weights, segment_ids, combiner):
+    num_segments = segment_ids[-1] + 1
+    output = np.zeros((num_segments,) + x.shape[1:], dtype=x.dtype)
+    norms = np.zeros(num_segments)
+    for i, (index, segment) in enumerate(zip(indices, segment_ids)):
+      output[segment] += weights[i] * x[index]
+      norms[segment] += weights[i]**2 if combiner == "sqrtn" else weights[i]
+    for segment in set(segment_ids):
+      if combiner == "mean":
+        output[segment] /= norms[segment]
+      elif combiner == "sqrtn":
+        output[segment] /= np.sqrt(norms[segment])
+    return output
+
+  def testValues(self):
+    np.random.seed(42)
+    x = np.random.rand(50, 3, 2)
+    segment_ids = [0, 0, 0, 2, 2, 3, 5, 5, 5, 5]
+    indices = np.random.randint(0, 50, len(segment_ids))
+    weights = np.random.rand(len(segment_ids))
+    for dtype in [dtypes_lib.float32, dtypes_lib.float64]:
+      for index_dtype in [dtypes_lib.int32, dtypes_lib.int64]:
+        for combiner in ["sum", "mean", "sqrtn"]:
+          for use_weights in [False, True]:
+            with self.test_session(use_gpu=False):
+              w = weights if use_weights else np.ones(len(segment_ids))
+              np_ans = self._combine(x, indices, w, segment_ids, combiner)
+              tf_ans = gen_math_ops._sparse_segment_combine(
+                  constant_op.constant(x, dtype=dtype),
+                  constant_op.constant(indices, dtype=index_dtype),
+                  constant_op.constant(
+                      weights if use_weights else [], dtype=dtype),
+                  segment_ids,
+                  combiner=combiner).eval()
+              self.assertAllClose(np_ans, tf_ans)
+
+  def testMeanOfZeroWeights(self):
+    # Like dividing the weighted sum by the sum of the weights.
+    with self.test_session(use_gpu=False):
+      s = gen_math_ops._sparse_segment_combine(
+          constant_op.constant([[2.0], [3.0]]), [0, 1, 0, 1],
+          [1.0, -1.0, 0.0, 0.0], [0, 0, 1, 1], combiner="mean")
+      result = s.eval()
+    self.assertEqual(-np.inf, result[0, 0])
+    self.assertTrue(np.isnan(result[1, 0]))
+
+  def testIndicesInvalid(self):
+    with self.test_session(use_gpu=False):
+      s = gen_math_ops._sparse_segment_combine(
+          constant_op.constant([[1.0], [2.0]]), [0, 2], [], [0, 1])
+      with self.assertRaisesOpError(r"indices\[1\] == 2 out of range"):
+        s.eval()
+
+  def testSegmentIdsNotIncreasing(self):
+    with self.test_session(use_gpu=False):
+      s = gen_math_ops._sparse_segment_combine(
+          constant_op.constant([[1.0], [2.0]]), [0, 1, 1], [], [1, 0, 1])
+      with self.assertRaisesOpError("is not increasing"):
+        s.eval()
+
+  def testGradient(self):
+    np.random.seed(42)
+    x_init = np.random.rand(20, 3)
+    segment_ids = [0, 0, 1, 3, 3, 3]
+    indices = [1, 4, 4, 7, 0, 19]
+    weights = [0.5, 2.0, 1.0, 3.0, 0.25, 1.5]
+    for combiner in ["sum", "mean", "sqrtn"]:
+      with self.test_session(use_gpu=False):
+        x = constant_op.constant(x_init, dtype=dtypes_lib.float64)
+        s = gen_math_ops._sparse_segment_combine(
+            x, indices, constant_op.constant(weights, dtype=dtypes_lib.float64),
+            segment_ids, combiner=combiner)
+        grad = gradients_impl.gradients(s, x)[0]
+        self.assertTrue(isinstance(grad, ops.IndexedSlices))
+        jacob_t, jacob_n = gradient_checker.compute_gradient(
+            x, [20, 3], s, [4, 3], x_init_value=x_init, delta=1)
+        self.assertAllClose(jacob_t, jacob_n)
+
+  def testWeightsGradient(self):
+    np.random.seed(42)
+    x_init = np.random.rand(20, 3, 2)
+    segment_ids = [0, 0, 1, 2, 2, 2]
+    indices = [1, 4, 4, 7, 0, 19]
+    weights_init = np.array([0.5, 2.0, 1.0, 3.0, 0.25, 1.5])
+    for combiner in ["sum", "mean", "sqrtn"]:
+      with self.test_session(use_gpu=False):
+        x = constant_op.constant(x_init, dtype=dtypes_lib.float64)
+        weights = constant_op.constant(weights_init, dtype=dtypes_lib.float64)
+        s = gen_math_ops._sparse_segment_combine(
+            x, indices, weights, segment_ids, combiner=combiner)
+        err = gradient_checker.compute_gradient_error(
+            weights, [6], s, [3, 3, 2], x_init_value=weights_init)
+        self.assertLess(err, 1e-8)
+
+        # The same combination built from Gather and SegmentSum, as
+        # embedding_lookup_sparse did before SparseSegmentCombine.
+        composite = math_ops.segment_sum(
+            array_ops.gather(x, indices) *
+            array_ops.reshape(weights, [-1, 1, 1]), segment_ids)
+        if combiner == "mean":
+          composite /= array_ops.reshape(
+              math_ops.segment_sum(weights, segment_ids), [-1, 1, 1])
+        elif combiner == "sqrtn":
+          composite /= array_ops.reshape(
+              math_ops.sqrt(math_ops.segment_sum(weights * weights,
+                                                 segment_ids)), [-1, 1, 1])
+        output_grad = constant_op.constant(
+            np.random.rand(3, 3, 2), dtype=dtypes_lib.float64)
+        fused_grad = gradients_impl.gradients(s, weights, output_grad)[0]
+        composite_grad = gradients_impl.gradients(composite, weights,
+                                                  output_grad)[0]
+        self.assertAllClose(composite_grad.eval(), fused_grad.eval())
+
+
 if __name__ == "__main__":
   test.main()
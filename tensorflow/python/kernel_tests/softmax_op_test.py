@@ -120,6 +120,27 @@ class SoftmaxTest(test.TestCase):
     self._testAll(
         np.array([[1., 1., 1., 1.], [1., 2., 3., 4.]]).astype(np.float32))
 
+  def testFloatWideRows(self):
+    # Rows long enough for the CPU kernel's blocked pass, with maxima that
+    # come early, late and in the middle of the row.
+    np.random.seed(1)
+    for num_classes in [1, 7, 1037, 5000]:
+      ramp = np.linspace(-8., 8., num_classes)
+      features = np.array([
+          ramp, ramp[::-1], 8. * np.random.randn(num_classes)
+      ]).astype(np.float32)
+      with self.test_session(use_gpu=False):
+        tf_softmax = nn_ops.softmax(features).eval()
+        tf_log_softmax = nn_ops.log_softmax(features).eval()
+      np_features = features.astype(np.float64)
+      self.assertAllClose(
+          self._npSoftmax(np_features), tf_softmax, rtol=1e-5, atol=1e-7)
+      self.assertAllClose(
+          self._npSoftmax(np_features, log=True),
+          tf_log_softmax,
+          rtol=1e-5,
+          atol=1e-5)
+
   def testHalf(self):
     self._testAll(
         np.array([[1., 1., 1., 1.], [1., 2., 3., 4.]]).astype(np.float16))
@@ -245,6 +245,18 @@ class SplitOpTest(test.TestCase):
       self._compare(self._makeData((6, 7, 18), dtype), 0, 3)
       self._compare(self._makeData((6, 7, 9), dtype), 0, 3)
 
+  def testSplitAfterSizeOneDims(self):
+    for dtype in _TEST_DTYPES:
+      self._compare(self._makeData((1, 6, 16), dtype), 1, 3)
+      self._compare(self._makeData((1, 1, 6, 7), dtype), 2, 2)
+      self._compare(self._makeData((1, 3, 16), dtype), 2, 4)
+      inp = self._makeData((1, 10, 4), dtype)
+      with self.test_session(use_gpu=True) as sess:
+        result = sess.run(array_ops.split(inp, [2, 5, 3], 1))
+      self.assertAllEqual(result[0], inp[:, :2])
+      self.assertAllEqual(result[1], inp[:, 2:7])
+      self.assertAllEqual(result[2], inp[:, 7:])
+
   def _RunAndVerify(self, dtype, large_num_splits=False):
     # Random dims of rank 5
     shape = np.random.randint(0, 5, size=5)
@@ -151,6 +151,24 @@ class XentTest(test.TestCase):
         np.array([[1., 1., 1., 1.], [1., 2., 3., 4.]]).astype(np.float32),
         np.array([[0., 0., 0., 1.], [0., .5, .5, 0.]]).astype(np.float32))
 
+  def testFloatWideRows(self):
+    np.random.seed(1)
+    for num_classes in [1, 7, 1037, 5000]:
+      ramp = np.linspace(-8., 8., num_classes)
+      features = np.array([
+          ramp, ramp[::-1], 8. * np.random.randn(num_classes)
+      ]).astype(np.float32)
+      labels = np.random.rand(3, num_classes).astype(np.float32)
+      labels /= np.sum(labels, axis=1, keepdims=True)
+      np_loss, np_backprop = self._npXent(
+          features.astype(np.float64), labels.astype(np.float64))
+      with self.test_session(use_gpu=False) as sess:
+        loss, backprop = gen_nn_ops._softmax_cross_entropy_with_logits(
+            features, labels)
+        tf_loss, tf_backprop = sess.run([loss, backprop])
+      self.assertAllClose(np_loss, tf_loss, rtol=1e-5, atol=1e-5)
+      self.assertAllClose(np_backprop, tf_backprop, rtol=1e-5, atol=1e-6)
+
   def testDouble(self):
     self._testAll(
         np.array([[1., 1., 1., 1.], [1., 2., 3., 4.]]).astype(np.float64),
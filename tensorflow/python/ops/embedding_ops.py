@@ -20,6 +20,7 @@ from __future__ import print_function
 from six.moves import xrange  # pylint: disable=redefined-builtin
 
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import device as pydev
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
@@ -28,6 +29,7 @@ from tensorflow.python.ops import clip_ops
 # Imports gradient definitions.
 from tensorflow.python.ops import data_flow_grad  # pylint: disable=unused-import
 from tensorflow.python.ops import data_flow_ops
+from tensorflow.python.ops import gen_math_ops
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import resource_variable_ops
 from tensorflow.python.ops import variables
@@ -402,14 +404,28 @@ def embedding_lookup_sparse(params,
       segment_ids = math_ops.cast(segment_ids, dtypes.int32)
 
     ids = sp_ids.values
-    if ignore_weights:
+    # SparseSegmentCombine gathers and weights the rows in one pass, but only
+    # has a CPU kernel. segment_ids was created in the current device scope,
+    # so its device also reflects that scope.
+    combine_weights = (not ignore_weights and
+                       params[0].dtype.base_dtype in (dtypes.float32,
+                                                      dtypes.float64) and
+                       not pydev.is_gpu(segment_ids.device) and
+                       not any(pydev.is_gpu(p.device) for p in params))
+    if ignore_weights or combine_weights:
       ids, idx = array_ops.unique(ids)
     else:
       idx = None
 
     embeddings = embedding_lookup(
         params, ids, partition_strategy=partition_strategy, max_norm=max_norm)
-    if not ignore_weights:
+    if combine_weights:
+      weights = sp_weights.values
+      if weights.dtype != embeddings.dtype:
+        weights = math_ops.cast(weights, embeddings.dtype)
+      embeddings = gen_math_ops._sparse_segment_combine(
+          embeddings, idx, weights, segment_ids, combiner=combiner, name=name)
+    elif not ignore_weights:
       weights = sp_weights.values
       if weights.dtype != embeddings.dtype:
         weights = math_ops.cast(weights, embeddings.dtype)
@@ -190,6 +190,49 @@ def _SparseSegmentSqrtNGrad(op, grad):
                                               dim0), None, None)
 
 
+@ops.RegisterGradient("SparseSegmentCombine")
+def _SparseSegmentCombineGrad(op, grad):
+  """Gradient for SparseSegmentCombine.
+
+  The gradient of `data` is returned as `IndexedSlices` over the rows that were
+  read, so that it never has the dense shape of `data`. The gradient of each
+  weight is the dot product of the gradient of its segment with the derivative
+  of the segment's output with respect to the weight.
+  """
+  data, indices, weights, segment_ids = op.inputs
+  combiner = op.get_attr("combiner")
+  values = gen_math_ops._sparse_segment_combine_grad(
+      grad, indices, weights, segment_ids, combiner=combiner)
+  data_grad = ops.IndexedSlices(values, indices, array_ops.shape(data))
+  if weights.get_shape().num_elements() == 0:
+    # Unit weights.
+    return data_grad, None, None, None
+
+  # For segment k with norm n[k] and output out[k], weight i contributes
+  #   sum:   data[indices[i]]
+  #   mean:  (data[indices[i]] - out[k]) / n[k]
+  #   sqrtn: (data[indices[i]] - out[k] * weights[i] / n[k]) / n[k]
+  rows = array_ops.gather(data, indices)
+  segment_grads = array_ops.gather(grad, segment_ids)
+  weights_grad = math_ops.reduce_sum(
+      rows * segment_grads, math_ops.range(1, array_ops.rank(rows)))
+  if combiner != "sum":
+    output_grads = array_ops.gather(
+        math_ops.reduce_sum(grad * op.outputs[0],
+                            math_ops.range(1, array_ops.rank(grad))),
+        segment_ids)
+    if combiner == "mean":
+      norms = array_ops.gather(
+          math_ops.segment_sum(weights, segment_ids), segment_ids)
+      weights_grad = (weights_grad - output_grads) / norms
+    else:
+      norms = array_ops.gather(
+          math_ops.sqrt(math_ops.segment_sum(weights * weights, segment_ids)),
+          segment_ids)
+      weights_grad = (weights_grad - output_grads * weights / norms) / norms
+  return data_grad, None, weights_grad, None
+
+
 def _SegmentMinOrMaxGrad(op, grad, is_sorted):
   """Gradient for SegmentMin and (unsorted) SegmentMax. They share similar code."""
   zeros = array_ops.zeros(array_ops.shape(op.inputs[0]),
@@ -438,6 +438,35 @@ def _SparseSoftmaxCrossEntropyWithLogitsGrad(op, grad_0, _):
   return _BroadcastMul(grad_0, sparse_softmax_grad_without_gradient), None
 
 
+@ops.RegisterGradient("SampledSoftmaxLoss")
+def _SampledSoftmaxLossGrad(op, grad_loss, *_):
+  """Gradient function for SampledSoftmaxLoss.
+
+  The gradients of `weights` and `biases` are returned as `IndexedSlices` over
+  the true and sampled classes. There is no gradient for the labels.
+  """
+  weights = op.inputs[0]
+  # Like the forward op, the gradient only has a CPU kernel.
+  with ops.colocate_with(op):
+    inputs_grad, indices, weights_grad, biases_grad = (
+        gen_nn_ops._sampled_softmax_loss_grad(
+            grad_loss, op.outputs[1], weights, op.inputs[2], op.outputs[2],
+            op.inputs[3]))
+  return (ops.IndexedSlices(weights_grad, indices, array_ops.shape(weights)),
+          ops.IndexedSlices(biases_grad, indices,
+                            array_ops.shape(op.inputs[1])),
+          None, inputs_grad)
+
+
+@ops.RegisterGradient("SampledSoftmaxLossGrad")
+def _SampledSoftmaxLossGradGrad(op, *_):
+  """Raises an error, rather than silently dropping second derivatives."""
+  raise LookupError(
+      "Second derivatives of the fused sampled softmax loss (%s) are not "
+      "supported. Pass sampled_values to tf.nn.sampled_softmax_loss to use "
+      "the composite implementation instead." % op.name)
+
+
 @ops.RegisterGradient("Conv2D")
 def _Conv2DGrad(op, grad):
   return [nn_ops.conv2d_backprop_input(
@@ -21,8 +21,10 @@ from __future__ import print_function
 import math
 
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import device as pydev
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
+from tensorflow.python.framework import random_seed
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import candidate_sampling_ops
 from tensorflow.python.ops import embedding_ops
@@ -1228,10 +1230,50 @@ def sampled_softmax_loss(weights,
         Default is `"mod"`. See `tf.nn.embedding_lookup` for more details.
     name: A name for the operation (optional).
 
+  When `sampled_values` is None, `weights` and `biases` are single float32
+  tensors and neither is placed on a GPU, the loss is computed by the fused
+  `SampledSoftmaxLoss` kernel on the CPU, next to `weights`. It draws the same
+  log-uniform sample and computes the same loss without materializing the
+  sampled logits, and its gradients for `weights` and `biases` are
+  `IndexedSlices` over the true and sampled classes. The fused loss has no
+  second derivatives; pass `sampled_values` from
+  `tf.nn.log_uniform_candidate_sampler` to get the composite implementation,
+  which does.
+
   Returns:
     A `batch_size` 1-D tensor of per-example sampled softmax losses.
 
   """
+  if isinstance(weights, (list, tuple)) and len(weights) == 1:
+    weights = weights[0]
+  if isinstance(biases, (list, tuple)) and len(biases) == 1:
+    biases = biases[0]
+  if (sampled_values is None and
+      not isinstance(weights, (list, tuple, variables.PartitionedVariable)) and
+      not isinstance(biases, (list, tuple))):
+    with ops.name_scope(name, "sampled_softmax_loss",
+                        [weights, biases, labels, inputs]) as name:
+      weights = ops.convert_to_tensor(weights, name="weights")
+      biases = ops.convert_to_tensor(biases, name="biases")
+      inputs = ops.convert_to_tensor(inputs, name="inputs")
+      if (weights.dtype == dtypes.float32 and
+          biases.dtype == dtypes.float32 and
+          inputs.dtype == dtypes.float32 and
+          not pydev.is_gpu(weights.device) and
+          not pydev.is_gpu(biases.device)):
+        # The kernel only runs on the CPU. Colocating it with the weights
+        # keeps an enclosing GPU device scope from placing it on a GPU.
+        with ops.colocate_with(weights):
+          if labels.dtype != dtypes.int64:
+            labels = math_ops.cast(labels, dtypes.int64)
+          seed1, seed2 = random_seed.get_seed(None)
+          sampled_losses, _, _ = gen_nn_ops._sampled_softmax_loss(
+              weights, biases, labels, inputs, num_sampled=num_sampled,
+              num_true=num_true, range_max=num_classes, sampler="log_uniform",
+              unique=True, subtract_log_q=True,
+              remove_accidental_hits=remove_accidental_hits, seed=seed1,
+              seed2=seed2, name=name)
+        return sampled_losses
   logits, labels = _compute_sampled_logits(
       weights=weights,
       biases=biases,
@@ -23,14 +23,22 @@ import math
 import numpy as np
 from six.moves import xrange  # pylint: disable=redefined-builtin
 
+from tensorflow.python.client import session
 from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import device as pydev
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import control_flow_ops
+from tensorflow.python.ops import gen_candidate_sampling_ops
+from tensorflow.python.ops import gen_nn_ops
 from tensorflow.python.ops import gradient_checker
+from tensorflow.python.ops import gradients_impl
+from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import nn_impl
 from tensorflow.python.ops import nn_ops
 from tensorflow.python.ops import partitioned_variables
+from tensorflow.python.ops import random_ops
 from tensorflow.python.ops import variable_scope
 from tensorflow.python.ops import variables
 import tensorflow.python.ops.nn_grad  # pylint: disable=unused-import
@@ -798,6 +806,183 @@ class ComputeSampledLogitsTest(test_lib.TestCase):
                           got_sampled_softmax_loss.eval(), 1e-4)
 
 
+class SampledSoftmaxLossOpTest(test_lib.TestCase):
+
+  def _LossAndGradients(self, fused, num_classes, dim, batch_size, num_true,
+                        num_sampled, sampler):
+    np.random.seed(1)
+    weights = constant_op.constant(
+        np.random.randn(num_classes, dim).astype(np.float32))
+    biases = constant_op.constant(
+        np.random.randn(num_classes).astype(np.float32))
+    # Repeated labels make accidental hits and shared gradient rows likely.
+    labels = constant_op.constant(
+        np.random.randint(0, 8, size=(batch_size, num_true)), dtypes.int64)
+    inputs = constant_op.constant(
+        np.random.randn(batch_size, dim).astype(np.float32))
+    if fused:
+      loss, _, _ = gen_nn_ops._sampled_softmax_loss(
+          weights, biases, labels, inputs, num_sampled=num_sampled,
+          num_true=num_true, range_max=num_classes, sampler=sampler,
+          seed=7, seed2=11)
+    else:
+      if sampler == "uniform":
+        sample = gen_candidate_sampling_ops._uniform_candidate_sampler
+      else:
+        sample = gen_candidate_sampling_ops._log_uniform_candidate_sampler
+      sampled_values = sample(labels, num_true=num_true,
+                              num_sampled=num_sampled, unique=True,
+                              range_max=num_classes, seed=7, seed2=11)
+      loss = nn_impl.sampled_softmax_loss(
+          weights, biases, labels, inputs, num_sampled=num_sampled,
+          num_classes=num_classes, num_true=num_true,
+          sampled_values=sampled_values)
+    grads = gradients_impl.gradients(
+        math_ops.reduce_sum(loss * math_ops.range(1.0, batch_size + 1.0)),
+        [weights, biases, inputs])
+    return loss, [ops.convert_to_tensor(grad) for grad in grads]
+
+  def _CompareFusedAndUnfused(self, num_true, sampler):
+    args = dict(num_classes=50, dim=6, batch_size=9, num_true=num_true,
+                num_sampled=10, sampler=sampler)
+    with self.test_session() as sess:
+      fused = sess.run(self._LossAndGradients(True, **args))
+      unfused = sess.run(self._LossAndGradients(False, **args))
+    self.assertAllClose(unfused[0], fused[0], rtol=1e-5, atol=1e-5)
+    for unfused_grad, fused_grad in zip(unfused[1], fused[1]):
+      self.assertAllClose(unfused_grad, fused_grad, rtol=1e-4, atol=1e-5)
+
+  def testLogUniform(self):
+    self._CompareFusedAndUnfused(num_true=1, sampler="log_uniform")
+
+  def testUniform(self):
+    self._CompareFusedAndUnfused(num_true=1, sampler="uniform")
+
+  def testMultipleTrueClasses(self):
+    self._CompareFusedAndUnfused(num_true=3, sampler="log_uniform")
+
+  def testPublicWrapperUsesFusedOp(self):
+    np.random.seed(2)
+    weights = constant_op.constant(
+        np.random.randn(50, 6).astype(np.float32))
+    biases = constant_op.constant(np.random.randn(50).astype(np.float32))
+    labels = constant_op.constant(
+        np.random.randint(0, 8, size=(9, 2)), dtypes.int64)
+    inputs = constant_op.constant(np.random.randn(9, 6).astype(np.float32))
+    with self.test_session() as sess:
+      fused = nn_impl.sampled_softmax_loss(
+          weights, biases, labels, inputs, num_sampled=10, num_classes=50,
+          num_true=2)
+      self.assertEqual("SampledSoftmaxLoss", fused.op.type)
+      sample = gen_candidate_sampling_ops._log_uniform_candidate_sampler
+      sampled_values = sample(labels, num_true=2, num_sampled=10, unique=True,
+                              range_max=50, seed=fused.op.get_attr("seed"),
+                              seed2=fused.op.get_attr("seed2"))
+      unfused = nn_impl.sampled_softmax_loss(
+          weights, biases, labels, inputs, num_sampled=10, num_classes=50,
+          num_true=2, sampled_values=sampled_values)
+      self.assertNotEqual("SampledSoftmaxLoss", unfused.op.type)
+      grads = [
+          ops.convert_to_tensor(grad)
+          for grad in gradients_impl.gradients(
+              [fused, -unfused], [weights, biases, inputs])
+      ]
+      fused_loss, unfused_loss, grads = sess.run([fused, unfused, grads])
+    self.assertAllClose(unfused_loss, fused_loss, rtol=1e-5, atol=1e-5)
+    for grad in grads:
+      self.assertAllClose(np.zeros_like(grad), grad, atol=1e-5)
+
+  def testFusedOpIgnoresEnclosingGpuScope(self):
+    with ops.Graph().as_default():
+      weights = array_ops.ones([20, 3])
+      biases = array_ops.zeros([20])
+      labels = constant_op.constant([[1], [2]], dtypes.int64)
+      inputs = array_ops.ones([2, 3])
+      with ops.device("/gpu:0"):
+        loss = nn_impl.sampled_softmax_loss(
+            weights, biases, labels, inputs, num_sampled=5, num_classes=20)
+        weights_grad = gradients_impl.gradients(loss, weights)[0]
+      self.assertEqual("SampledSoftmaxLoss", loss.op.type)
+      self.assertFalse(pydev.is_gpu(loss.device))
+      self.assertFalse(pydev.is_gpu(weights_grad.values.device))
+
+  def testFusedOpRejectsSecondDerivatives(self):
+    with ops.Graph().as_default():
+      weights = array_ops.ones([20, 3])
+      labels = constant_op.constant([[1], [2]], dtypes.int64)
+      inputs = array_ops.ones([2, 3])
+      loss = nn_impl.sampled_softmax_loss(
+          weights, array_ops.zeros([20]), labels, inputs, num_sampled=5,
+          num_classes=20)
+      inputs_grad = gradients_impl.gradients(loss, inputs)[0]
+      with self.assertRaisesRegexp(LookupError, "Second derivatives"):
+        gradients_impl.gradients(inputs_grad, inputs)
+
+  def testSampledCandidates(self):
+    with self.test_session():
+      labels = constant_op.constant([[1], [2]], dtypes.int64)
+      _, _, sampled = gen_nn_ops._sampled_softmax_loss(
+          array_ops.ones([20, 3]), array_ops.zeros([20]), labels,
+          array_ops.ones([2, 3]), num_sampled=5, num_true=1, range_max=20,
+          seed=3, seed2=4)
+      sample = gen_candidate_sampling_ops._log_uniform_candidate_sampler
+      expected, _, _ = sample(labels, num_true=1, num_sampled=5, unique=True,
+                              range_max=20, seed=3, seed2=4)
+      self.assertAllEqual(expected.eval(), sampled.eval())
+
+  def testInvalidLabel(self):
+    with self.test_session():
+      loss, _, _ = gen_nn_ops._sampled_softmax_loss(
+          array_ops.ones([10, 3]), array_ops.zeros([10]),
+          constant_op.constant([[1], [10]], dtypes.int64),
+          array_ops.ones([2, 3]), num_sampled=2, num_true=1, range_max=10)
+      with self.assertRaisesOpError(r"labels\[1\] = 10 is not in \[0, 10\)"):
+        loss.eval()
+
+
+class SampledSoftmaxLossBenchmark(test_lib.Benchmark):
+
+  def _Run(self, fused, num_classes, dim, batch_size, num_sampled):
+    with ops.Graph().as_default():
+      weights = variables.Variable(
+          random_ops.random_normal([num_classes, dim]))
+      biases = variables.Variable(array_ops.zeros([num_classes]))
+      labels = math_ops.cast(
+          random_ops.random_uniform([batch_size, 1], maxval=num_classes,
+                                    dtype=dtypes.int32), dtypes.int64)
+      inputs = random_ops.random_normal([batch_size, dim])
+      if fused:
+        loss, _, _ = gen_nn_ops._sampled_softmax_loss(
+            weights, biases, labels, inputs, num_sampled=num_sampled,
+            num_true=1, range_max=num_classes)
+      else:
+        # Passing the sample explicitly keeps the wrapper off the fused op.
+        sampled_values = (
+            gen_candidate_sampling_ops._log_uniform_candidate_sampler(
+                labels, num_true=1, num_sampled=num_sampled, unique=True,
+                range_max=num_classes))
+        loss = nn_impl.sampled_softmax_loss(
+            weights, biases, labels, inputs, num_sampled=num_sampled,
+            num_classes=num_classes, sampled_values=sampled_values)
+      grads = gradients_impl.gradients(loss, [weights, biases, inputs])
+      train_op = control_flow_ops.group(*[
+          grad.values if isinstance(grad, ops.IndexedSlices) else grad
+          for grad in grads])
+      with session.Session() as sess:
+        sess.run(variables.global_variables_initializer())
+        self.run_op_benchmark(
+            sess, train_op, min_iters=20,
+            name="sampled_softmax_loss_%s_classes_%d_dim_%d_batch_%d_"
+            "sampled_%d" % ("fused" if fused else "unfused", num_classes, dim,
+                            batch_size, num_sampled))
+
+  def benchmarkSampledSoftmaxLoss(self):
+    for num_classes, dim, batch_size, num_sampled in [(100000, 256, 128, 512),
+                                                      (800000, 512, 256, 8192)]:
+      for fused in [False, True]:
+        self._Run(fused, num_classes, dim, batch_size, num_sampled)
+
+
 class CReluTest(test_lib.TestCase):
 
   def test(self):
@@ -0,0 +1,385 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/kernels/quantization_utils.h"
+#include "tensorflow/tools/graph_transforms/transform_utils.h"
+
+namespace tensorflow {
+namespace graph_transforms {
+
+namespace {
+
+const char kFusedConvOp[] = "QuantizedConv2DWithBiasAndRequantize";
+
+// Looks up the node producing 'input_name' and returns it if it's a Const of
+// the given type.
+const NodeDef* GetConstInput(const std::map<string, const NodeDef*>& nodes,
+                             const string& input_name, DataType dtype) {
+  auto it = nodes.find(NodeNameFromInput(input_name));
+  if (it == nodes.end() || it->second->op() != "Const" ||
+      !it->second->attr().count("dtype") ||
+      it->second->attr().at("dtype").type() != dtype) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+// Returns the float constant that 'node' quantizes through its inputs
+// 'input', 'min_input' and 'max_input'. That's either QuantizeV2 of a float
+// Const, as quantize_nodes leaves weights, or an eight-bit Const with constant
+// min/max inputs, as after quantize_weights.
+bool GetQuantizedConstant(const std::map<string, const NodeDef*>& nodes,
+                          const NodeDef& node, int input, int min_input,
+                          int max_input, Tensor* value) {
+  auto it = nodes.find(NodeNameFromInput(node.input(input)));
+  if (it == nodes.end()) {
+    return false;
+  }
+  if (it->second->op() == "QuantizeV2") {
+    const NodeDef* float_node =
+        GetConstInput(nodes, it->second->input(0), DT_FLOAT);
+    if (float_node == nullptr) {
+      return false;
+    }
+    *value = GetNodeTensorAttr(*float_node, "value");
+    return true;
+  }
+  const NodeDef* quantized_node =
+      GetConstInput(nodes, node.input(input), DT_QUINT8);
+  const NodeDef* min_node =
+      GetConstInput(nodes, node.input(min_input), DT_FLOAT);
+  const NodeDef* max_node =
+      GetConstInput(nodes, node.input(max_input), DT_FLOAT);
+  if (quantized_node == nullptr || min_node == nullptr ||
+      max_node == nullptr) {
+    return false;
+  }
+  *value = QuantizedTensorToFloat<quint8>(
+      GetNodeTensorAttr(*quantized_node, "value"),
+      GetNodeTensorAttr(*min_node, "value").flat<float>()(0),
+      GetNodeTensorAttr(*max_node, "value").flat<float>()(0));
+  return true;
+}
+
+// Quantizes each output channel of a [height, width, in, out] float filter
+// with its own range, symmetric around zero except for one more step on the
+// negative side, so that zero is exactly 128 and needs no rounding.
+void QuantizeFilterPerChannel(const Tensor& filter, Tensor* quantized,
+                              Tensor* min_filter, Tensor* max_filter) {
+  const int64 out_depth = filter.dim_size(3);
+  auto filter_matrix = filter.flat_inner_dims<float>();
+  std::vector<float> ranges(out_depth, 0.0f);
+  for (int64 i = 0; i < filter_matrix.dimension(0); ++i) {
+    for (int64 c = 0; c < out_depth; ++c) {
+      ranges[c] = std::max(ranges[c], std::abs(filter_matrix(i, c)));
+    }
+  }
+  // The bias of a channel is folded into its accumulator units, which must
+  // not overflow, so tiny channels share a small fraction of the largest
+  // range.
+  const float max_range = *std::max_element(ranges.begin(), ranges.end());
+  const float min_range = max_range > 0.0f ? max_range / 1024.0f : 1.0f;
+
+  *quantized = Tensor(DT_QUINT8, filter.shape());
+  *min_filter = Tensor(DT_FLOAT, {out_depth});
+  *max_filter = Tensor(DT_FLOAT, {out_depth});
+  auto quantized_matrix = quantized->flat_inner_dims<quint8>();
+  for (int64 c = 0; c < out_depth; ++c) {
+    const float range = std::max(ranges[c], min_range);
+    const float min_value = -range * 128.0f / 127.0f;
+    min_filter->flat<float>()(c) = min_value;
+    max_filter->flat<float>()(c) = range;
+    for (int64 i = 0; i < filter_matrix.dimension(0); ++i) {
+      quantized_matrix(i, c) =
+          FloatToQuantized<quint8>(filter_matrix(i, c), min_value, range);
+    }
+  }
+}
+
+NodeDef MakeConstNode(const string& name, const Tensor& value) {
+  NodeDef node;
+  node.set_op("Const");
+  node.set_name(name);
+  SetNodeAttr("dtype", value.dtype(), &node);
+  SetNodeTensorAttr<float>("value", value, &node);
+  return node;
+}
+
+NodeDef MakeScalarConstNode(const string& name, float value) {
+  Tensor tensor(DT_FLOAT, {});
+  tensor.scalar<float>()() = value;
+  return MakeConstNode(name, tensor);
+}
+
+// Copies the nodes of 'match', other than its head, that are also used outside
+// of it, so that the replacement keeps them.
+void AddExternallyUsedNodes(const NodeMatch& match,
+                            const std::set<string>& output_nodes,
+                            std::vector<NodeDef>* new_nodes) {
+  std::vector<NodeDef> matched_nodes;
+  MatchedNodesAsArray(match, &matched_nodes);
+  for (const NodeDef& node : matched_nodes) {
+    if (node.name() != match.node.name() && output_nodes.count(node.name())) {
+      new_nodes->push_back(node);
+    }
+  }
+}
+
+// Sets the frozen output range of the fused node, its last two inputs, to
+// [min_value, max_value] widened to contain zero, so that the next quantized
+// convolution can pad its input with it.
+void SetOutputRange(float min_value, float max_value, NodeDef* fused_node,
+                    std::vector<NodeDef>* new_nodes) {
+  const NodeDef min_node = MakeScalarConstNode(
+      fused_node->name() + "/min_output", std::min(min_value, 0.0f));
+  const NodeDef max_node = MakeScalarConstNode(
+      fused_node->name() + "/max_output", std::max(max_value, 0.0f));
+  fused_node->mutable_input()->DeleteSubrange(
+      7, std::max(0, fused_node->input_size() - 7));
+  AddNodeInput(min_node.name(), fused_node);
+  AddNodeInput(max_node.name(), fused_node);
+  new_nodes->push_back(min_node);
+  new_nodes->push_back(max_node);
+}
+
+float GetScalarConst(const std::map<string, const NodeDef*>& nodes,
+                     const string& input_name) {
+  return GetNodeTensorAttr(*nodes.at(NodeNameFromInput(input_name)), "value")
+      .flat<float>()(0);
+}
+
+}  // namespace
+
+// Rewrites the eight-bit convolutions produced by quantize_nodes into
+// QuantizedConv2DWithBiasAndRequantize ops, whose kernel requantizes each tile
+// of 32-bit results as soon as it's computed. First every
+//
+//   Requantize(QuantizedConv2D(input, filter), Const, Const)
+//
+// with constant weights and a frozen output range (from
+// freeze_requantization_ranges or quantize_nodes' fallback range) becomes a
+// fused op with a zero bias. The float weights are requantized with one range
+// per output channel, which keeps the precision of channels whose weights are
+// much smaller than the rest. Then a following QuantizedBiasAdd of a constant
+// and its Requantize are folded into the fused op's bias and output range, and
+// finally a following QuantizedRelu or QuantizedRelu6 is folded into its
+// output range, since clamping to the range's ends applies them.
+//
+// Each fused op takes the name of the last node it replaces. The nodes that
+// only fed the replaced ones are left behind, for strip_unused_nodes to remove.
+Status FuseQuantizedConvolutions(const GraphDef& input_graph_def,
+                                 const TransformFuncContext& context,
+                                 GraphDef* output_graph_def) {
+  std::map<string, const NodeDef*> graph_nodes;
+  MapNamesToNodes(input_graph_def, &graph_nodes);
+  GraphDef conv_graph_def;
+  TF_RETURN_IF_ERROR(ReplaceMatchingOpTypes(
+      input_graph_def,  // clang-format off
+      {"Requantize",
+        {
+          {"QuantizedConv2D"},
+          {"QuantizedConv2D"},
+          {"QuantizedConv2D"},
+          {"Const"},
+          {"Const"},
+        }
+      },  // clang-format on
+      [&graph_nodes](const NodeMatch& match,
+                     const std::set<string>& input_nodes,
+                     const std::set<string>& output_nodes,
+                     std::vector<NodeDef>* new_nodes) {
+        const NodeDef& requantize_node = match.node;
+        const NodeDef& conv_node = match.inputs[0].node;
+        DataType input_type;
+        DataType requantized_type;
+        Tensor filter;
+        if (output_nodes.count(conv_node.name()) ||
+            !GetNodeAttr(conv_node, "Tinput", &input_type).ok() ||
+            input_type != DT_QUINT8 ||
+            !GetNodeAttr(requantize_node, "out_type", &requantized_type)
+                 .ok() ||
+            requantized_type != DT_QUINT8 ||
+            !GetQuantizedConstant(graph_nodes, conv_node, 1, 4, 5, &filter) ||
+            filter.dims() != 4) {
+          CopyOriginalMatch(match, new_nodes);
+          return Status::OK();
+        }
+        AddExternallyUsedNodes(match, output_nodes, new_nodes);
+
+        Tensor quantized_filter;
+        Tensor min_filter;
+        Tensor max_filter;
+        QuantizeFilterPerChannel(filter, &quantized_filter, &min_filter,
+                                 &max_filter);
+        const string& name = requantize_node.name();
+        const NodeDef filter_node =
+            MakeConstNode(name + "/filter", quantized_filter);
+        const NodeDef min_filter_node =
+            MakeConstNode(name + "/min_filter", min_filter);
+        const NodeDef max_filter_node =
+            MakeConstNode(name + "/max_filter", max_filter);
+        Tensor bias(DT_FLOAT, {filter.dim_size(3)});
+        bias.flat<float>().setZero();
+        const NodeDef bias_node = MakeConstNode(name + "/bias", bias);
+        new_nodes->push_back(filter_node);
+        new_nodes->push_back(min_filter_node);
+        new_nodes->push_back(max_filter_node);
+        new_nodes->push_back(bias_node);
+
+        NodeDef fused_node;
+        fused_node.set_op(kFusedConvOp);
+        fused_node.set_name(name);
+        AddNodeInput(conv_node.input(0), &fused_node);
+        AddNodeInput(filter_node.name(), &fused_node);
+        AddNodeInput(bias_node.name(), &fused_node);
+        AddNodeInput(conv_node.input(2), &fused_node);
+        AddNodeInput(conv_node.input(3), &fused_node);
+        AddNodeInput(min_filter_node.name(), &fused_node);
+        AddNodeInput(max_filter_node.name(), &fused_node);
+        CopyNodeAttr(conv_node, "Tinput", "Tinput", &fused_node);
+        SetNodeAttr("Tfilter", DT_QUINT8, &fused_node);
+        SetNodeAttr("out_type", DT_QUINT8, &fused_node);
+        CopyNodeAttr(conv_node, "strides", "strides", &fused_node);
+        CopyNodeAttr(conv_node, "padding", "padding", &fused_node);
+        SetOutputRange(GetScalarConst(graph_nodes, requantize_node.input(3)),
+                       GetScalarConst(graph_nodes, requantize_node.input(4)),
+                       &fused_node, new_nodes);
+        new_nodes->push_back(fused_node);
+        return Status::OK();
+      },
+      {}, &conv_graph_def));
+  TF_RETURN_IF_ERROR(IsGraphValid(conv_graph_def));
+
+  std::map<string, const NodeDef*> conv_nodes;
+  MapNamesToNodes(conv_graph_def, &conv_nodes);
+  GraphDef bias_graph_def;
+  TF_RETURN_IF_ERROR(ReplaceMatchingOpTypes(
+      conv_graph_def,  // clang-format off
+      {"Requantize",
+        {
+          {"QuantizedBiasAdd",
+            {
+              {kFusedConvOp},
+              {"*"},
+              {kFusedConvOp},
+              {kFusedConvOp},
+              {"*"},
+              {"*"},
+            }
+          },
+          {"QuantizedBiasAdd"},
+          {"QuantizedBiasAdd"},
+          {"Const"},
+          {"Const"},
+        }
+      },  // clang-format on
+      [&conv_nodes](const NodeMatch& match,
+                    const std::set<string>& input_nodes,
+                    const std::set<string>& output_nodes,
+                    std::vector<NodeDef>* new_nodes) {
+        const NodeDef& requantize_node = match.node;
+        const NodeDef& bias_add_node = match.inputs[0].node;
+        const NodeDef& conv_node = match.inputs[0].inputs[0].node;
+        const NodeDef* conv_bias_node =
+            GetConstInput(conv_nodes, conv_node.input(2), DT_FLOAT);
+        Tensor added_bias;
+        DataType requantized_type;
+        if (output_nodes.count(bias_add_node.name()) ||
+            output_nodes.count(conv_node.name()) || conv_bias_node == nullptr ||
+            !GetQuantizedConstant(conv_nodes, bias_add_node, 1, 4, 5,
+                                  &added_bias) ||
+            !GetNodeAttr(requantize_node, "out_type", &requantized_type)
+                 .ok() ||
+            requantized_type != DT_QUINT8) {
+          CopyOriginalMatch(match, new_nodes);
+          return Status::OK();
+        }
+        Tensor bias = GetNodeTensorAttr(*conv_bias_node, "value");
+        if (added_bias.shape() != bias.shape()) {
+          CopyOriginalMatch(match, new_nodes);
+          return Status::OK();
+        }
+        AddExternallyUsedNodes(match, output_nodes, new_nodes);
+
+        bias.flat<float>() += added_bias.flat<float>();
+        NodeDef fused_node = conv_node;
+        fused_node.set_name(requantize_node.name());
+        const NodeDef new_bias_node =
+            MakeConstNode(fused_node.name() + "/bias", bias);
+        *fused_node.mutable_input(2) = new_bias_node.name();
+        new_nodes->push_back(new_bias_node);
+        SetOutputRange(GetScalarConst(conv_nodes, requantize_node.input(3)),
+                       GetScalarConst(conv_nodes, requantize_node.input(4)),
+                       &fused_node, new_nodes);
+        new_nodes->push_back(fused_node);
+        return Status::OK();
+      },
+      {}, &bias_graph_def));
+  TF_RETURN_IF_ERROR(IsGraphValid(bias_graph_def));
+
+  std::map<string, const NodeDef*> bias_nodes;
+  MapNamesToNodes(bias_graph_def, &bias_nodes);
+  TF_RETURN_IF_ERROR(ReplaceMatchingOpTypes(
+      bias_graph_def,  // clang-format off
+      {"QuantizedRelu|QuantizedRelu6",
+        {
+          {kFusedConvOp},
+          {kFusedConvOp},
+          {kFusedConvOp},
+        }
+      },  // clang-format on
+      [&bias_nodes](const NodeMatch& match,
+                    const std::set<string>& input_nodes,
+                    const std::set<string>& output_nodes,
+                    std::vector<NodeDef>* new_nodes) {
+        const NodeDef& relu_node = match.node;
+        const NodeDef& conv_node = match.inputs[0].node;
+        DataType out_type;
+        const float min_value = GetScalarConst(bias_nodes, conv_node.input(7));
+        float max_value = GetScalarConst(bias_nodes, conv_node.input(8));
+        if (relu_node.op() == "QuantizedRelu6") {
+          max_value = std::min(max_value, 6.0f);
+        }
+        // A range without positive values can't hold the activations.
+        if (output_nodes.count(conv_node.name()) || max_value <= 0.0f ||
+            !GetNodeAttr(relu_node, "out_type", &out_type).ok() ||
+            out_type != DT_QUINT8) {
+          CopyOriginalMatch(match, new_nodes);
+          return Status::OK();
+        }
+        NodeDef fused_node = conv_node;
+        fused_node.set_name(relu_node.name());
+        SetOutputRange(std::max(min_value, 0.0f), max_value, &fused_node,
+                       new_nodes);
+        new_nodes->push_back(fused_node);
+        return Status::OK();
+      },
+      {}, output_graph_def));
+  TF_RETURN_IF_ERROR(IsGraphValid(*output_graph_def));
+
+  return Status::OK();
+}
+
+REGISTER_GRAPH_TRANSFORM("fuse_quantized_convolutions",
+                         FuseQuantizedConvolutions);
+
+}  // namespace graph_transforms
+}  // namespace tensorflow
@@ -0,0 +1,221 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/cc/ops/nn_ops.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/tools/graph_transforms/transform_utils.h"
+
+namespace tensorflow {
+namespace graph_transforms {
+
+// Declare here, so we don't need a public header.
+Status QuantizeNodes(const GraphDef& input_graph_def,
+                     const TransformFuncContext& context,
+                     GraphDef* output_graph_def);
+Status FuseQuantizedConvolutions(const GraphDef& input_graph_def,
+                                 const TransformFuncContext& context,
+                                 GraphDef* output_graph_def);
+
+class FuseQuantizedConvolutionsTest : public ::testing::Test {
+ protected:
+  // Builds input -> Conv2D -> [BiasAdd] -> activation, with a second output
+  // channel whose weights are a hundred times smaller than the first's.
+  GraphDef ConvGraph(bool with_bias, const string& activation) {
+    auto root = tensorflow::Scope::NewRootScope();
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Output input_op =
+        Placeholder(root.WithOpName("input_op"), DT_FLOAT,
+                    Placeholder::Shape(TensorShape({1, 3, 4, 2})));
+
+    Tensor filter_data(DT_FLOAT, TensorShape({3, 3, 2, 2}));
+    auto filter_matrix = filter_data.flat_inner_dims<float>();
+    for (int i = 0; i < filter_matrix.dimension(0); ++i) {
+      const float value = ((i * 7) % 11 - 5) / 5.0f;
+      filter_matrix(i, 0) = value;
+      filter_matrix(i, 1) = -value / 100.0f;
+    }
+    Output filter_op =
+        Const(root.WithOpName("filter_op"), Input::Initializer(filter_data));
+    Output output = Conv2D(root.WithOpName("conv_op"), input_op, filter_op,
+                           {1, 1, 1, 1}, "SAME");
+
+    if (with_bias) {
+      Tensor bias_data(DT_FLOAT, TensorShape({2}));
+      test::FillValues<float>(&bias_data, {1.0f, 0.1f});
+      Output bias_op =
+          Const(root.WithOpName("bias_op"), Input::Initializer(bias_data));
+      output = BiasAdd(root.WithOpName("bias_add_op"), output, bias_op);
+    }
+    if (activation == "Relu") {
+      output = Relu(root.WithOpName("output"), output);
+    } else if (activation == "Relu6") {
+      output = Relu6(root.WithOpName("output"), output);
+    } else {
+      output = Identity(root.WithOpName("output"), output);
+    }
+
+    GraphDef graph_def;
+    TF_CHECK_OK(root.ToGraphDef(&graph_def));
+    return graph_def;
+  }
+
+  // Quantizes 'float_graph_def' with a fallback range, fuses its
+  // convolutions, and checks both versions against the float results.
+  void TestFusedVersusFloatGraph(const GraphDef& float_graph_def,
+                                 GraphDef* fused_graph_def) {
+    Tensor input_data(DT_FLOAT, TensorShape({1, 3, 4, 2}));
+    auto input_flat = input_data.flat<float>();
+    for (int i = 0; i < input_flat.size(); ++i) {
+      input_flat(i) = (i % 9) / 16.0f;
+    }
+    const std::vector<std::pair<string, Tensor>> inputs = {
+        {"input_op", input_data}};
+
+    TransformFuncContext context;
+    context.input_names = {"input_op"};
+    context.output_names = {"output"};
+    context.params["fallback_min"] = {strings::StrCat(-16.0f)};
+    context.params["fallback_max"] = {strings::StrCat(16.0f)};
+    GraphDef quantized_graph_def;
+    TF_ASSERT_OK(
+        QuantizeNodes(float_graph_def, context, &quantized_graph_def));
+    TF_ASSERT_OK(FuseQuantizedConvolutions(quantized_graph_def, context,
+                                           fused_graph_def));
+
+    std::map<string, int> op_counts;
+    for (const NodeDef& node : fused_graph_def->node()) {
+      ++op_counts[node.op()];
+    }
+    EXPECT_EQ(1, op_counts["QuantizedConv2DWithBiasAndRequantize"]);
+    for (const string& op : {"QuantizedConv2D", "QuantizedBiasAdd",
+                             "QuantizedRelu", "QuantizedRelu6"}) {
+      EXPECT_EQ(0, op_counts[op]) << op;
+    }
+
+    std::vector<Tensor> float_outputs;
+    std::unique_ptr<Session> float_session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(float_session->Create(float_graph_def));
+    TF_ASSERT_OK(float_session->Run(inputs, {"output"}, {}, &float_outputs));
+
+    std::vector<Tensor> fused_outputs;
+    std::unique_ptr<Session> fused_session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(fused_session->Create(*fused_graph_def));
+    TF_ASSERT_OK(fused_session->Run(inputs, {"output"}, {}, &fused_outputs));
+
+    // One step of the output range is 0.125.
+    test::ExpectTensorNear<float>(float_outputs[0], fused_outputs[0], 0.5);
+  }
+
+  std::map<string, float> OutputRange(const GraphDef& graph_def) {
+    std::map<string, const NodeDef*> nodes;
+    MapNamesToNodes(graph_def, &nodes);
+    const NodeDef* fused_node = nullptr;
+    for (const NodeDef& node : graph_def.node()) {
+      if (node.op() == "QuantizedConv2DWithBiasAndRequantize") {
+        fused_node = &node;
+      }
+    }
+    CHECK(fused_node != nullptr);
+    std::map<string, float> range;
+    range["min"] = GetNodeTensorAttr(*nodes.at(fused_node->input(7)), "value")
+                       .flat<float>()(0);
+    range["max"] = GetNodeTensorAttr(*nodes.at(fused_node->input(8)), "value")
+                       .flat<float>()(0);
+    return range;
+  }
+
+  void TestFuseConv() {
+    GraphDef fused_graph_def;
+    TestFusedVersusFloatGraph(ConvGraph(false, ""), &fused_graph_def);
+    std::map<string, float> range = OutputRange(fused_graph_def);
+    EXPECT_EQ(-16.0f, range["min"]);
+    EXPECT_EQ(16.0f, range["max"]);
+  }
+
+  void TestFuseConvBiasRelu() {
+    GraphDef fused_graph_def;
+    TestFusedVersusFloatGraph(ConvGraph(true, "Relu"), &fused_graph_def);
+    std::map<string, float> range = OutputRange(fused_graph_def);
+    EXPECT_EQ(0.0f, range["min"]);
+    EXPECT_EQ(16.0f, range["max"]);
+  }
+
+  void TestFuseConvRelu6() {
+    GraphDef fused_graph_def;
+    TestFusedVersusFloatGraph(ConvGraph(false, "Relu6"), &fused_graph_def);
+    std::map<string, float> range = OutputRange(fused_graph_def);
+    EXPECT_EQ(0.0f, range["min"]);
+    EXPECT_EQ(6.0f, range["max"]);
+  }
+
+  void TestLeaveSharedConv() {
+    auto root = tensorflow::Scope::NewRootScope();
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Tensor quantized_data(DT_QUINT8, TensorShape({1, 1, 1, 1}));
+    test::FillValues<quint8>(&quantized_data, {128});
+    Output input_op =
+        Const(root.WithOpName("input_op"), Input::Initializer(quantized_data));
+    Output filter_op =
+        Const(root.WithOpName("filter_op"), Input::Initializer(quantized_data));
+    Output min_op = Const(root.WithOpName("min_op"), -1.0f);
+    Output max_op = Const(root.WithOpName("max_op"), 1.0f);
+    QuantizedConv2D conv_op(root.WithOpName("conv_op"), input_op, filter_op,
+                            min_op, max_op, min_op, max_op, {1, 1, 1, 1},
+                            "SAME");
+    Requantize(root.WithOpName("requantize_op"), conv_op.output,
+               conv_op.min_output, conv_op.max_output, min_op, max_op,
+               DT_QUINT8);
+    RequantizationRange(root.WithOpName("range_op"), conv_op.output,
+                        conv_op.min_output, conv_op.max_output);
+
+    GraphDef graph_def;
+    TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+
+    // The 32-bit convolution result is also used by another node, so it has
+    // to stay.
+    GraphDef fused_graph_def;
+    TF_ASSERT_OK(FuseQuantizedConvolutions(
+        graph_def, {{}, {"requantize_op", "range_op"}}, &fused_graph_def));
+    std::map<string, const NodeDef*> nodes;
+    MapNamesToNodes(fused_graph_def, &nodes);
+    EXPECT_EQ("QuantizedConv2D", nodes.at("conv_op")->op());
+    EXPECT_EQ("Requantize", nodes.at("requantize_op")->op());
+  }
+};
+
+TEST_F(FuseQuantizedConvolutionsTest, TestFuseConv) { TestFuseConv(); }
+
+TEST_F(FuseQuantizedConvolutionsTest, TestFuseConvBiasRelu) {
+  TestFuseConvBiasRelu();
+}
+
+TEST_F(FuseQuantizedConvolutionsTest, TestFuseConvRelu6) {
+  TestFuseConvRelu6();
+}
+
+TEST_F(FuseQuantizedConvolutionsTest, TestLeaveSharedConv) {
+  TestLeaveSharedConv();
+}
+
+}  // namespace graph_transforms
+}  // namespace tensorflow